@@ -39,6 +39,7 @@
 #include "cc-snapd-client.h"
 #include "cc-snap-row.h"
 #endif
+#include "cc-permission-store.h"
 #include "cc-util.h"
 #include "globs.h"
 #include "search.h"
@@ -50,6 +51,20 @@
 
 #define PORTAL_SNAP_PREFIX "snap."
 
+/* The permission store tables and resources the panel shows */
+static const gchar * const portal_tables[] = {
+  "notifications", "notification",
+  "background", "background",
+  "wallpaper", "wallpaper",
+  "screenshot", "screenshot",
+  "gnome", "shortcuts-inhibitor",
+  "devices", "speakers",
+  "devices", "camera",
+  "devices", "microphone",
+  "location", "location",
+  NULL
+};
+
 struct _CcApplicationsPanel
 {
   CcPanel          parent;
@@ -80,8 +95,8 @@ struct _CcApplicationsPanel
   gchar           *current_app_id;
   GAppInfo        *current_app_info;
   gchar           *current_portal_app_id;
+  GCancellable    *selection_cancellable;
 
-  GHashTable      *globs;
   GHashTable      *search_providers;
 
   GtkImage        *app_icon_image;
@@ -91,7 +106,7 @@ struct _CcApplicationsPanel
   AdwBanner       *sandbox_banner;
   GtkWidget       *sandbox_info_button;
 
-  GDBusProxy      *perm_store;
+  CcPermissionStore *perm_store;
   GSettings       *media_handling_settings;
   GtkListBoxRow   *perm_store_pending_row;
   GSettings       *notification_settings;
@@ -123,6 +138,9 @@ struct _CcApplicationsPanel
   AdwPreferencesPage *builtin_page;
   GtkListBox      *builtin_list;
   GList           *snap_permission_rows;
+#ifdef HAVE_SNAP
+  CcSnapdClient   *snapd_client;
+#endif
 
   GtkButton       *handler_reset;
   GtkWindow       *handler_dialog;
@@ -221,28 +239,7 @@ get_portal_permissions (CcApplicationsPanel *self,
                         const gchar         *id,
                         const gchar         *app_id)
 {
-  g_autoptr(GVariant) ret = NULL;
-  g_autoptr(GVariantIter) iter = NULL;
-  const gchar *key = NULL;
-  GStrv val;
-  GStrv result = NULL;
-
-  ret = g_dbus_proxy_call_sync (self->perm_store,
-                                "Lookup",
-                                g_variant_new ("(ss)", table, id),
-                                0, G_MAXINT, NULL, NULL);
-  if (ret == NULL)
-    return NULL;
-
-  g_variant_get (ret, "(a{sas}v)", &iter, NULL);
-
-  while (g_variant_iter_loop (iter, "{&s^a&s}", &key, &val))
-    {
-      if (strcmp (key, app_id) == 0 && result == NULL)
-        result = g_strdupv (val);
-    }
-
-  return result;
+  return cc_permission_store_get_permissions (self->perm_store, table, id, app_id);
 }
 
 static void
@@ -252,17 +249,7 @@ set_portal_permissions (CcApplicationsPanel *self,
                         const gchar *app_id,
                         const gchar * const *permissions)
 {
-  g_autoptr(GError) error = NULL;
-
-  g_dbus_proxy_call_sync (self->perm_store,
-                          "SetPermission",
-                          g_variant_new ("(sbss^as)", table, TRUE, id, app_id, permissions),
-                          0,
-                          G_MAXINT,
-                          NULL,
-                          &error);
-  if (error)
-    g_warning ("Error setting portal permissions: %s", error->message);
+  cc_permission_store_set_permission (self->perm_store, table, id, app_id, permissions);
 }
 
 static gchar *
@@ -721,31 +708,27 @@ remove_snap_permissions (CcApplicationsPanel *self)
   g_clear_pointer (&self->snap_permission_rows, g_list_free);
 }
 
-static gboolean
-add_snap_permissions (CcApplicationsPanel *self,
-                      GAppInfo            *info,
-                      const gchar         *app_id)
+static void
+snap_connections_cb (GObject      *source,
+                     GAsyncResult *res,
+                     gpointer      data)
 {
+  CcApplicationsPanel *self = data;
   const gchar *snap_name;
-  g_autoptr(CcSnapdClient) client = NULL;
   g_autoptr(JsonArray) plugs = NULL;
   g_autoptr(JsonArray) slots = NULL;
   gint added = 0;
   g_autoptr(GError) error = NULL;
-  g_autoptr(GError) interfaces_error = NULL;
 
-  if (!g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    return FALSE;
-  snap_name = app_id + strlen (PORTAL_SNAP_PREFIX);
-
-  client = cc_snapd_client_new ();
-
-  if (!cc_snapd_client_get_all_connections_sync (client, &plugs, &slots, cc_panel_get_cancellable (CC_PANEL (self)), &error))
+  if (!cc_snapd_client_get_all_connections_finish (CC_SNAPD_CLIENT (source), res, &plugs, &slots, &error))
     {
-      g_warning ("Failed to get snap connections: %s", error->message);
-      return FALSE;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get snap connections: %s", error->message);
+      return;
     }
 
+  snap_name = self->current_portal_app_id + strlen (PORTAL_SNAP_PREFIX);
+
   for (guint i = 0; i < json_array_get_length (plugs); i++)
     {
       JsonObject *plug = json_array_get_object_element (plugs, i);
@@ -776,7 +759,7 @@ add_snap_permissions (CcApplicationsPanel *self,
           if (g_strcmp0 (plug_interface, json_object_get_string_member (slot, "interface")) != 0)
             continue;
 
-          json_array_add_object_element (available_slots, slot);
+          json_array_add_object_element (available_slots, json_object_ref (slot));
         }
 
       row = cc_snap_row_new (cc_panel_get_cancellable (CC_PANEL (self)), plug, available_slots);
@@ -785,7 +768,22 @@ add_snap_permissions (CcApplicationsPanel *self,
       added++;
     }
 
-    return added > 0;
+  if (added > 0)
+    gtk_widget_set_visible (GTK_WIDGET (self->integration_section), TRUE);
+}
+
+/* The rows are added once snapd answers, showing the section if needed */
+static void
+add_snap_permissions (CcApplicationsPanel *self,
+                      const gchar         *app_id)
+{
+  if (!g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    return;
+
+  cc_snapd_client_get_all_connections_async (self->snapd_client,
+                                             self->selection_cancellable,
+                                             snap_connections_cb,
+                                             self);
 }
 #endif
 
@@ -820,9 +818,8 @@ add_static_permission_row (CcApplicationsPanel *self,
 static gboolean
 add_static_permissions (CcApplicationsPanel *self,
                         GAppInfo            *info,
-                        const gchar         *app_id)
+                        GKeyFile            *keyfile)
 {
-  g_autoptr(GKeyFile) keyfile = NULL;
   g_auto(GStrv) sockets = NULL;
   g_auto(GStrv) devices = NULL;
   g_auto(GStrv) shared = NULL;
@@ -830,16 +827,6 @@ add_static_permissions (CcApplicationsPanel *self,
   g_autofree gchar *str = NULL;
   gint added = 0;
   g_autofree gchar *text = NULL;
-  gboolean is_sandboxed, is_snap = FALSE;
-
-  is_snap = app_id && g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX);
-  if (app_id && !is_snap)
-    keyfile = get_flatpak_metadata (app_id);
-
-  is_sandboxed = (keyfile != NULL) || is_snap;
-  update_sandbox_banner (self, is_sandboxed);
-  if (keyfile == NULL)
-    return FALSE;
 
   sockets = g_key_file_get_string_list (keyfile, "Context", "sockets", NULL, NULL);
   if (sockets && g_strv_contains ((const gchar * const*)sockets, "system-bus"))
@@ -983,7 +970,7 @@ update_integration_section (CcApplicationsPanel *self,
       has_any |= set;
 
 #ifdef HAVE_SNAP
-      has_any |= add_snap_permissions (self, info, portal_app_id);
+      add_snap_permissions (self, portal_app_id);
 #endif
     }
   else
@@ -1059,11 +1046,11 @@ add_file_type (CcApplicationsPanel *self,
                const gchar         *type)
 {
   g_autofree gchar *desc = NULL;
-  const gchar *glob;
+  g_autofree gchar *glob = NULL;
   GtkWidget *button;
   GtkWidget *row;
 
-  glob = g_hash_table_lookup (self->globs, type);
+  glob = get_glob_for_mime_type (type);
 
   desc = g_content_type_get_description (type);
   row = adw_action_row_new ();
@@ -1178,6 +1165,9 @@ update_handler_dialog (CcApplicationsPanel *self,
 
   hash = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
 
+  /* Once for all the types, rather than for each */
+  globs_revalidate ();
+
   gtk_widget_set_sensitive (GTK_WIDGET (self->handler_reset), FALSE);
   for (i = 0; types[i]; i++)
     {
@@ -1347,7 +1337,7 @@ update_cache_row (CcApplicationsPanel *self,
 {
   g_autoptr(GFile) dir = get_flatpak_app_dir (app_id, "cache");
   g_object_set (self->cache, "info", "...", NULL);
-  file_size_async (dir, cc_panel_get_cancellable (CC_PANEL (self)), set_cache_size, self);
+  file_size_async (dir, self->selection_cancellable, set_cache_size, self);
 }
 
 static void
@@ -1381,7 +1371,7 @@ update_data_row (CcApplicationsPanel *self,
   g_autoptr(GFile) dir = get_flatpak_app_dir (app_id, "data");
 
   g_object_set (self->data, "info", "...", NULL);
-  file_size_async (dir, cc_panel_get_cancellable (CC_PANEL (self)), set_data_size, self);
+  file_size_async (dir, self->selection_cancellable, set_data_size, self);
 }
 
 static void
@@ -1415,20 +1405,39 @@ clear_cache_cb (CcApplicationsPanel *self)
 }
 
 static void
-update_app_row (CcApplicationsPanel *self,
-                const gchar         *app_id)
+set_snap_app_size (GObject      *source,
+                   GAsyncResult *res,
+                   gpointer      data)
 {
+  CcApplicationsPanel *self = data;
   g_autofree gchar *formatted_size = NULL;
+  g_autoptr(GError) error = NULL;
+  guint64 size = 0;
 
-  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    self->app_size = get_snap_app_size (app_id + strlen (PORTAL_SNAP_PREFIX));
-  else
-    self->app_size = get_flatpak_app_size (app_id);
+  if (!get_snap_app_size_finish (res, &size, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_warning ("Failed to get snap size: %s", error->message);
+    }
+
+  self->app_size = size;
   formatted_size = g_format_size (self->app_size);
   g_object_set (self->app, "info", formatted_size, NULL);
   update_total_size (self);
 }
 
+static void
+update_app_row (CcApplicationsPanel *self,
+                const gchar         *app_id)
+{
+  g_object_set (self->app, "info", "...", NULL);
+
+  /* The size of flatpaks comes along with their metadata */
+  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    get_snap_app_size_async (app_id + strlen (PORTAL_SNAP_PREFIX), self->selection_cancellable, set_snap_app_size, self);
+}
+
 static void
 update_app_sizes (CcApplicationsPanel *self,
                   const gchar         *app_id)
@@ -1442,21 +1451,57 @@ update_app_sizes (CcApplicationsPanel *self,
   update_data_row (self, app_id);
 }
 
+static void
+flatpak_app_info_cb (GObject      *source,
+                     GAsyncResult *res,
+                     gpointer      data)
+{
+  CcApplicationsPanel *self = data;
+  g_autoptr(GKeyFile) metadata = NULL;
+  g_autofree gchar *formatted_size = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean has_builtin = FALSE;
+  guint64 size = 0;
+
+  if (!get_flatpak_app_info_finish (res, &metadata, &size, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        g_warning ("Failed to get flatpak metadata: %s", error->message);
+    }
+
+  update_sandbox_banner (self, metadata != NULL);
+  if (metadata != NULL)
+    has_builtin = add_static_permissions (self, self->current_app_info, metadata);
+  gtk_widget_set_visible (GTK_WIDGET (self->other_permissions_section), has_builtin);
+
+  self->app_size = size;
+  formatted_size = g_format_size (self->app_size);
+  g_object_set (self->app, "info", formatted_size, NULL);
+  update_total_size (self);
+}
+
 static void
 update_usage_section (CcApplicationsPanel *self,
                       GAppInfo            *info)
 {
   g_autofree gchar *portal_app_id = get_portal_app_id (info);
-  gboolean has_builtin = FALSE;
-
-  if (portal_app_id != NULL)
-    update_app_sizes (self, portal_app_id);
 
   remove_static_permissions (self);
-  has_builtin = add_static_permissions (self, info, portal_app_id);
-  gtk_widget_set_visible (GTK_WIDGET (self->other_permissions_section), has_builtin);
+  gtk_widget_set_visible (GTK_WIDGET (self->other_permissions_section), FALSE);
+  gtk_widget_set_visible (GTK_WIDGET (self->usage_section), portal_app_id != NULL);
+
+  /* Until the flatpak metadata has been read, apps with a portal app ID
+   * are assumed to be sandboxed rather than flashing the banner */
+  update_sandbox_banner (self, portal_app_id != NULL);
+  if (portal_app_id == NULL)
+    return;
 
-  gtk_widget_set_visible (GTK_WIDGET (self->usage_section), portal_app_id || has_builtin);
+  update_app_sizes (self, portal_app_id);
+
+  if (!g_str_has_prefix (portal_app_id, PORTAL_SNAP_PREFIX))
+    get_flatpak_app_info_async (portal_app_id, self->selection_cancellable, flatpak_app_info_cb, self);
 }
 
 static void
@@ -1515,6 +1560,11 @@ update_panel (CcApplicationsPanel *self,
   g_clear_pointer (&self->current_app_id, g_free);
   g_clear_pointer (&self->current_portal_app_id, g_free);
 
+  /* Whatever is still being looked up is for the previous app */
+  g_cancellable_cancel (self->selection_cancellable);
+  g_clear_object (&self->selection_cancellable);
+  self->selection_cancellable = g_cancellable_new ();
+
   update_header_section (self, info);
   update_integration_section (self, info);
   update_handler_dialog (self, info);
@@ -1529,33 +1579,13 @@ update_panel (CcApplicationsPanel *self,
 }
 
 
-static gint
-compare_rows (gconstpointer  a,
-              gconstpointer  b,
-              gpointer       data)
-{
-  GAppInfo *item1 = (GAppInfo *) a;
-  GAppInfo *item2 = (GAppInfo *) b;
-
-  g_autofree gchar *key1 = NULL;
-  g_autofree gchar *key2 = NULL;
-
-  key1 = g_utf8_casefold (g_app_info_get_display_name (item1), -1);
-  key2 = g_utf8_casefold (g_app_info_get_display_name (item2), -1);
-
-  const gchar *sort_key1 = g_utf8_collate_key (key1, -1);
-  const gchar *sort_key2 = g_utf8_collate_key (key2, -1);
-
-  return strcmp (sort_key1, sort_key2);
-}
-
 static void
 populate_applications (CcApplicationsPanel *self)
 {
   g_autolist(GObject) infos = NULL;
+  g_autoptr(GPtrArray) shown = NULL;
   GList *l;
 
-  g_list_store_remove_all (G_LIST_STORE (self->app_model));
 #ifdef HAVE_MALCONTENT
   g_signal_handler_block (self->manager, self->app_filter_id);
 #endif
@@ -1567,11 +1597,11 @@ populate_applications (CcApplicationsPanel *self)
   else
     gtk_widget_set_visible (GTK_WIDGET (self->app_search_entry), 1);
 
+  shown = g_ptr_array_new ();
+
   for (l = infos; l; l = l->next)
     {
       GAppInfo *info = l->data;
-      GtkWidget *row;
-      g_autofree gchar *id = NULL;
 
       if (!g_app_info_should_show (info))
         continue;
@@ -1581,13 +1611,12 @@ populate_applications (CcApplicationsPanel *self)
         continue;
 #endif
 
-      row = GTK_WIDGET (cc_applications_row_new (info));
-      g_list_store_insert_sorted (G_LIST_STORE (self->app_model), info, compare_rows, NULL);
-
-      id = get_app_id (info);
-      if (g_strcmp0 (id, self->current_app_id) == 0)
-        gtk_list_box_select_row (self->app_listbox, GTK_LIST_BOX_ROW (row));
+      g_ptr_array_add (shown, info);
     }
+
+  /* Rows of apps which did not change are kept, along with the selection */
+  update_app_list (G_LIST_STORE (self->app_model), shown);
+
 #ifdef HAVE_MALCONTENT
   g_signal_handler_unblock (self->manager, self->app_filter_id);
 #endif
@@ -1644,19 +1673,19 @@ on_perm_store_ready (GObject      *source_object,
                      gpointer      data)
 {
   CcApplicationsPanel *self = data;
-  GDBusProxy *proxy;
+  CcPermissionStore *perm_store = CC_PERMISSION_STORE (source_object);
   g_autoptr(GError) error = NULL;
 
-  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
-  if (proxy == NULL)
+  if (!cc_permission_store_load_finish (perm_store, res, &error))
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-          g_warning ("Failed to connect to portal permission store: %s",
-                     error->message);
-      return;
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+      /* The tables which failed to load show no permissions, as before */
+      g_warning ("Failed to load portal permissions: %s", error->message);
     }
 
-  self->perm_store = proxy;
+  self->perm_store = g_object_ref (perm_store);
 
   if (self->perm_store_pending_row)
     g_signal_emit_by_name (self->perm_store_pending_row, "activate");
@@ -1753,7 +1782,10 @@ cc_applications_panel_dispose (GObject *object)
   remove_all_handler_rows (self);
 #ifdef HAVE_SNAP
   remove_snap_permissions (self);
+  g_clear_object (&self->snapd_client);
 #endif
+  g_cancellable_cancel (self->selection_cancellable);
+  g_clear_object (&self->selection_cancellable);
   g_clear_object (&self->monitor);
   g_clear_object (&self->perm_store);
 
@@ -1783,7 +1815,6 @@ cc_applications_panel_finalize (GObject *object)
   g_clear_object (&self->current_app_info);
   g_clear_pointer (&self->current_app_id, g_free);
   g_clear_pointer (&self->current_portal_app_id, g_free);
-  g_clear_pointer (&self->globs, g_hash_table_unref);
   g_clear_pointer (&self->search_providers, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_applications_panel_parent_class)->finalize (object);
@@ -1954,6 +1985,11 @@ cc_applications_panel_init (CcApplicationsPanel *self)
 
   gtk_widget_set_visible (GTK_WIDGET (self->install_button), gnome_software_is_installed ());
 
+#ifdef HAVE_SNAP
+  /* Shared with the snap rows and the size lookups */
+  self->snapd_client = cc_snapd_client_get_default ();
+#endif
+
   g_signal_connect_object (self->app_listbox, "row-activated",
                            G_CALLBACK (row_activated_cb), self, G_CONNECT_SWAPPED);
 
@@ -2019,16 +2055,11 @@ cc_applications_panel_init (CcApplicationsPanel *self)
   self->monitor = g_app_info_monitor_get ();
   self->monitor_id = g_signal_connect_object (self->monitor, "changed", G_CALLBACK (apps_changed), self, G_CONNECT_SWAPPED);
 
-  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
-                            G_DBUS_PROXY_FLAGS_NONE,
-                            NULL,
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            "/org/freedesktop/impl/portal/PermissionStore",
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            cc_panel_get_cancellable (CC_PANEL (self)),
-                            on_perm_store_ready,
-                            self);
-
-  self->globs = parse_globs ();
+  cc_permission_store_load_async (cc_permission_store_get_default (),
+                                  portal_tables,
+                                  cc_panel_get_cancellable (CC_PANEL (self)),
+                                  on_perm_store_ready,
+                                  self);
+
   self->search_providers = parse_search_providers ();
 }
@@ -91,7 +91,6 @@ enable_controls (CcSnapRow *self)
 static void
 change_complete (CcSnapRow *self)
 {
-  g_clear_object (&self->client);
   g_clear_pointer (&self->target_slot, json_object_unref);
   g_clear_pointer (&self->change_id, g_free);
   g_clear_handle_id (&self->change_timeout, g_source_remove);
@@ -100,19 +99,23 @@ change_complete (CcSnapRow *self)
   enable_controls (self);
 }
 
-static gboolean
-poll_change_cb (gpointer user_data)
+static gboolean poll_change_cb (gpointer user_data);
+
+static void
+get_change_cb (GObject *object, GAsyncResult *result, gpointer user_data)
 {
-  CcSnapRow *self = user_data;
+  g_autoptr(CcSnapRow) self = user_data;
   g_autoptr(JsonObject) change = NULL;
   g_autoptr(GError) error = NULL;
 
-  change = cc_snapd_client_get_change_sync (self->client, self->change_id, self->cancellable, &error);
+  change = cc_snapd_client_get_change_finish (CC_SNAPD_CLIENT (object), result, &error);
   if (change == NULL)
     {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
       g_warning ("Failed to monitor change %s: %s", self->change_id, error->message);
       change_complete (self);
-      return G_SOURCE_REMOVE;
+      return;
     }
 
   if (json_object_get_boolean_member (change, "ready"))
@@ -130,10 +133,23 @@ poll_change_cb (gpointer user_data)
         }
 
       change_complete (self);
-      return G_SOURCE_REMOVE;
+      return;
     }
 
-  return G_SOURCE_CONTINUE;
+  /* Only poll again once snapd answered */
+  self->change_timeout = g_timeout_add (CHANGE_POLL_TIME, poll_change_cb, self);
+}
+
+static gboolean
+poll_change_cb (gpointer user_data)
+{
+  CcSnapRow *self = user_data;
+
+  self->change_timeout = 0;
+  cc_snapd_client_get_change_async (self->client, self->change_id, self->cancellable,
+                                    get_change_cb, g_object_ref (self));
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -145,20 +161,29 @@ monitor_change (CcSnapRow *self, const gchar *change_id)
   self->change_timeout = g_timeout_add (CHANGE_POLL_TIME, poll_change_cb, self);
 }
 
-static CcSnapdClient *
-get_client(CcSnapRow *self)
+static void
+connect_plug_cb (GObject *object, GAsyncResult *result, gpointer user_data)
 {
-  if (self->client == NULL)
-    self->client = cc_snapd_client_new ();
-  return self->client;
+  g_autoptr(CcSnapRow) self = user_data;
+  g_autofree gchar *change_id = NULL;
+  g_autoptr(GError) error = NULL;
+
+  change_id = cc_snapd_client_connect_interface_finish (CC_SNAPD_CLIENT (object), result, &error);
+  if (change_id == NULL)
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_warning ("Failed to connect plug: %s", error->message);
+      change_complete (self);
+      return;
+    }
+
+  monitor_change (self, change_id);
 }
 
 static void
 connect_plug (CcSnapRow *self, JsonObject *slot)
 {
-  g_autofree gchar *change_id = NULL;
-  g_autoptr(GError) error = NULL;
-
   /* already connected */
   if (self->connected_slot != NULL &&
       g_strcmp0 (json_object_get_string_member (self->connected_slot, "snap"),
@@ -169,51 +194,57 @@ connect_plug (CcSnapRow *self, JsonObject *slot)
 
   disable_controls (self);
 
-  change_id = cc_snapd_client_connect_interface_sync (get_client (self),
-                                                      json_object_get_string_member (self->plug, "snap"),
-                                                      json_object_get_string_member (self->plug, "plug"),
-                                                      json_object_get_string_member (slot, "snap"),
-                                                      json_object_get_string_member (slot, "slot"),
-                                                      self->cancellable,
-                                                      &error);
+  g_clear_pointer (&self->target_slot, json_object_unref);
+  self->target_slot = json_object_ref (slot);
+
+  cc_snapd_client_connect_interface_async (self->client,
+                                           json_object_get_string_member (self->plug, "snap"),
+                                           json_object_get_string_member (self->plug, "plug"),
+                                           json_object_get_string_member (slot, "snap"),
+                                           json_object_get_string_member (slot, "slot"),
+                                           self->cancellable,
+                                           connect_plug_cb,
+                                           g_object_ref (self));
+}
+
+static void
+disconnect_plug_cb (GObject *object, GAsyncResult *result, gpointer user_data)
+{
+  g_autoptr(CcSnapRow) self = user_data;
+  g_autofree gchar *change_id = NULL;
+  g_autoptr(GError) error = NULL;
+
+  change_id = cc_snapd_client_disconnect_interface_finish (CC_SNAPD_CLIENT (object), result, &error);
   if (change_id == NULL)
     {
-      g_warning ("Failed to connect plug: %s", error->message);
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_warning ("Failed to disconnect plug: %s", error->message);
       change_complete (self);
       return;
     }
 
-  g_clear_pointer (&self->target_slot, json_object_unref);
-  self->target_slot = json_object_ref (slot);
   monitor_change (self, change_id);
 }
 
 static void
 disconnect_plug (CcSnapRow *self)
 {
-  g_autofree gchar *change_id = NULL;
-  g_autoptr(GError) error = NULL;
-
   /* already disconnected */
   if (self->connected_slot == NULL)
     return;
 
   disable_controls (self);
 
-  change_id = cc_snapd_client_disconnect_interface_sync (get_client (self),
-                                                         json_object_get_string_member (self->plug, "snap"),
-                                                         json_object_get_string_member (self->plug, "plug"),
-                                                         "", "",
-                                                         self->cancellable, &error);
-  if (change_id == NULL)
-    {
-      g_warning ("Failed to disconnect plug: %s", error->message);
-      change_complete (self);
-      return;
-    }
-
   g_clear_pointer (&self->target_slot, json_object_unref);
-  monitor_change (self, change_id);
+
+  cc_snapd_client_disconnect_interface_async (self->client,
+                                              json_object_get_string_member (self->plug, "snap"),
+                                              json_object_get_string_member (self->plug, "plug"),
+                                              "", "",
+                                              self->cancellable,
+                                              disconnect_plug_cb,
+                                              g_object_ref (self));
 }
 
 static void
@@ -369,6 +400,7 @@ cc_snap_row_finalize (GObject *object)
   g_clear_object (&self->cancellable);
   g_clear_object (&self->client);
   g_clear_pointer (&self->plug, json_object_unref);
+  g_clear_pointer (&self->connected_slot, json_object_unref);
   g_clear_pointer (&self->slots, json_array_unref);
   g_clear_pointer (&self->target_slot, json_object_unref);
   g_clear_pointer (&self->change_id, g_free);
@@ -412,6 +444,7 @@ cc_snap_row_new (GCancellable *cancellable, JsonObject *plug, JsonArray *slots)
   self = CC_SNAP_ROW (g_object_new (CC_TYPE_SNAP_ROW, NULL));
 
   self->cancellable = g_object_ref (cancellable);
+  self->client = cc_snapd_client_get_default ();
   self->plug = json_object_ref (plug);
   self->slots = json_array_ref (slots);
 
@@ -428,7 +461,7 @@ cc_snap_row_new (GCancellable *cancellable, JsonObject *plug, JsonArray *slots)
                          json_object_get_string_member (connected_slot_ref, "snap")) == 0 &&
               g_strcmp0 (json_object_get_string_member (slot, "slot"),
                          json_object_get_string_member (connected_slot_ref, "slot")) == 0)
-            self->connected_slot = slot;
+            self->connected_slot = json_object_ref (slot);
         }
     }
 
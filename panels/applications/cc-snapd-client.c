@@ -25,14 +25,39 @@
 // Unix socket that snapd communicates on.
 #define SNAPD_SOCKET_PATH "/var/run/snapd.socket"
 
+// How long responses to GET requests are reused for, so that the rows
+// of an app, and apps selected one after the other, only ask snapd once.
+#define CACHE_LIFETIME (5 * G_USEC_PER_SEC)
+
 struct _CcSnapdClient
 {
   GObject parent;
 
-  // HTTP connection to snapd.
+  // HTTP connection to snapd, kept alive between requests.
   SoupSession *session;
+
+  // Path → CacheEntry, recent responses to GET requests.
+  GHashTable *cache;
+
+  // Path → GPtrArray of GTask, waiting for the same GET request.
+  GHashTable *pending;
 };
 
+typedef struct
+{
+  JsonObject *response;
+  gint64      time;
+} CacheEntry;
+
+typedef struct
+{
+  CcSnapdClient *self;
+  gchar         *path;
+  SoupMessage   *msg;
+  // Only set for requests which are not shared.
+  GTask         *task;
+} Request;
+
 G_DEFINE_TYPE (CcSnapdClient, cc_snapd_client, G_TYPE_OBJECT)
 
 // Make an HTTP request to send to snapd.
@@ -43,7 +68,7 @@ make_message (const gchar *method, const gchar *path, JsonNode *request_body)
   SoupMessage *msg;
   SoupMessageHeaders *request_headers;
 
-  uri = g_strdup_printf("http://locahost%s", path);
+  uri = g_strdup_printf("http://localhost%s", path);
   msg = soup_message_new (method, uri);
   request_headers = soup_message_get_request_headers (msg);
   // Allow authentication via polkit.
@@ -112,34 +137,180 @@ process_body (SoupMessage *msg, GBytes *body, GError **error)
   return json_object_ref (response);
 }
 
-// Send an HTTP request to snapd and process the response.
-static JsonObject *
-call_sync (CcSnapdClient *self,
-           const gchar *method, const gchar *path, JsonNode *request_body,
-           GCancellable *cancellable, GError **error)
+static void
+cache_entry_free (CacheEntry *entry)
 {
-  g_autoptr(SoupMessage) msg = NULL;
+  json_object_unref (entry->response);
+  g_free (entry);
+}
+
+static void
+request_free (Request *request)
+{
+  g_clear_object (&request->self);
+  g_free (request->path);
+  g_clear_object (&request->msg);
+  g_clear_object (&request->task);
+  g_free (request);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (Request, request_free)
+
+// Changes are polled until they are done, they can't be cached.
+static gboolean
+is_cacheable (const gchar *path)
+{
+  return !g_str_has_prefix (path, "/v2/changes/");
+}
+
+static void
+return_response (GTask *task, JsonObject *response, const GError *error)
+{
+  if (response != NULL)
+    g_task_return_pointer (task, json_object_ref (response), (GDestroyNotify) json_object_unref);
+  else
+    g_task_return_error (task, g_error_copy (error));
+}
+
+static void
+send_cb (GObject *object, GAsyncResult *result, gpointer user_data)
+{
+  g_autoptr(Request) request = user_data;
+  CcSnapdClient *self = request->self;
   g_autoptr(GBytes) response_body = NULL;
+  g_autoptr(JsonObject) response = NULL;
+  g_autoptr(GPtrArray) waiters = NULL;
+  g_autoptr(GError) error = NULL;
+  gchar *path;
+
+  response_body = soup_session_send_and_read_finish (SOUP_SESSION (object), result, &error);
+  if (response_body != NULL)
+    response = process_body (request->msg, response_body, &error);
+
+  if (request->task != NULL)
+    {
+      // Anything cached may be out of date now.
+      if (response != NULL)
+        g_hash_table_remove_all (self->cache);
+
+      return_response (request->task, response, error);
+      return;
+    }
+
+  if (response != NULL && is_cacheable (request->path))
+    {
+      CacheEntry *entry = g_new0 (CacheEntry, 1);
+
+      entry->response = json_object_ref (response);
+      entry->time = g_get_monotonic_time ();
+      g_hash_table_replace (self->cache, g_strdup (request->path), entry);
+    }
+
+  if (!g_hash_table_steal_extended (self->pending, request->path, (gpointer *) &path, (gpointer *) &waiters))
+    return;
+  g_free (path);
 
-  msg = make_message (method, path, request_body);
-  response_body = soup_session_send_and_read (self->session, msg, cancellable, error);
-  if (response_body == NULL)
+  for (guint i = 0; i < waiters->len; i++)
+    return_response (g_ptr_array_index (waiters, i), response, error);
+}
+
+// Send an HTTP request to snapd and complete @task with the response.
+//
+// GET requests are answered from the cache when possible, and share a
+// single request with the ones for the same path already being sent.
+// Only the keep-alive connections of the session are used, libsoup
+// doesn't pipeline requests but sends concurrent ones on a few
+// connections it keeps open.
+static void
+call_async (CcSnapdClient *self,
+            const gchar *method, const gchar *path, JsonNode *request_body,
+            GTask *task)
+{
+  Request *request;
+  GPtrArray *waiters;
+
+  if (g_str_equal (method, "GET"))
+    {
+      CacheEntry *entry = g_hash_table_lookup (self->cache, path);
+
+      if (entry != NULL && g_get_monotonic_time () - entry->time < CACHE_LIFETIME)
+        {
+          return_response (task, entry->response, NULL);
+          return;
+        }
+
+      waiters = g_hash_table_lookup (self->pending, path);
+      if (waiters != NULL)
+        {
+          g_ptr_array_add (waiters, g_object_ref (task));
+          return;
+        }
+
+      waiters = g_ptr_array_new_with_free_func (g_object_unref);
+      g_ptr_array_add (waiters, g_object_ref (task));
+      g_hash_table_insert (self->pending, g_strdup (path), waiters);
+    }
+
+  request = g_new0 (Request, 1);
+  request->self = g_object_ref (self);
+  request->path = g_strdup (path);
+  request->msg = make_message (method, path, request_body);
+
+  // Shared requests carry on even if one of their callers gives up.
+  if (!g_str_equal (method, "GET"))
+    request->task = g_object_ref (task);
+
+  soup_session_send_and_read_async (self->session, request->msg, G_PRIORITY_DEFAULT,
+                                    request->task != NULL ? g_task_get_cancellable (task) : NULL,
+                                    send_cb, request);
+}
+
+// Get the "result" member of a response.
+static JsonObject *
+get_result (GTask *task, GError **error)
+{
+  g_autoptr(JsonObject) response = NULL;
+  JsonObject *result;
+
+  response = g_task_propagate_pointer (task, error);
+  if (response == NULL)
     return NULL;
 
-  return process_body (msg, response_body, error);
+  result = json_object_get_object_member (response, "result");
+  if (result == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s",
+                   (const gchar *) g_task_get_task_data (task));
+      return NULL;
+    }
+
+  return json_object_ref (result);
+}
+
+static GTask *
+make_task (CcSnapdClient *self, const gchar *path,
+           GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data,
+           gpointer source_tag)
+{
+  GTask *task;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+  g_task_set_task_data (task, g_strdup (path), g_free);
+
+  return task;
 }
 
 // Perform a snap interface action.
-static gchar *
-call_interfaces_sync (CcSnapdClient *self,
-                      const gchar *action,
-                      const gchar *plug_snap, const gchar *plug_name,
-                      const gchar *slot_snap, const gchar *slot_name,
-                      GCancellable *cancellable, GError **error)
+static void
+call_interfaces_async (CcSnapdClient *self,
+                       const gchar *action,
+                       const gchar *plug_snap, const gchar *plug_name,
+                       const gchar *slot_snap, const gchar *slot_name,
+                       GTask *task)
 {
   g_autoptr(JsonBuilder) builder = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  const gchar *change_id;
+  g_autoptr(JsonNode) root = NULL;
 
   builder = json_builder_new();
   json_builder_begin_object (builder);
@@ -165,14 +336,20 @@ call_interfaces_sync (CcSnapdClient *self,
   json_builder_end_array (builder);
   json_builder_end_object (builder);
 
-  response = call_sync (self, "POST", "/v2/interfaces",
-                        json_builder_get_root (builder), cancellable, error);
+  root = json_builder_get_root (builder);
+  call_async (self, "POST", "/v2/interfaces", root, task);
+}
+
+static gchar *
+call_interfaces_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
+{
+  g_autoptr(JsonObject) response = NULL;
+
+  response = g_task_propagate_pointer (G_TASK (result), error);
   if (response == NULL)
     return NULL;
 
-  change_id = json_object_get_string_member (response, "change");
-
-  return g_strdup (change_id);
+  return g_strdup (json_object_get_string_member (response, "change"));
 }
 
 static void
@@ -181,6 +358,8 @@ cc_snapd_client_dispose (GObject *object)
   CcSnapdClient *self = CC_SNAPD_CLIENT (object);
 
   g_clear_object(&self->session);
+  g_clear_pointer (&self->cache, g_hash_table_unref);
+  g_clear_pointer (&self->pending, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_snapd_client_parent_class)->dispose (object);
 }
@@ -196,95 +375,154 @@ cc_snapd_client_class_init (CcSnapdClientClass *klass)
 static void
 cc_snapd_client_init (CcSnapdClient *self)
 {
-  g_autoptr(GSocketAddress) address = g_unix_socket_address_new (SNAPD_SOCKET_PATH);
-  self->session = soup_session_new_with_options ("remote-connectable", address, NULL);
+  self->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) cache_entry_free);
+  self->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
 }
 
 CcSnapdClient *
 cc_snapd_client_new (void)
 {
-  return CC_SNAPD_CLIENT (g_object_new (CC_TYPE_SNAPD_CLIENT, NULL));
+  return cc_snapd_client_new_for_socket (SNAPD_SOCKET_PATH);
 }
 
-JsonObject *
-cc_snapd_client_get_snap_sync (CcSnapdClient *self, const gchar *name, GCancellable *cancellable, GError **error)
+CcSnapdClient *
+cc_snapd_client_new_for_socket (const gchar *socket_path)
+{
+  g_autoptr(GSocketAddress) address = g_unix_socket_address_new (socket_path);
+  CcSnapdClient *self;
+
+  self = CC_SNAPD_CLIENT (g_object_new (CC_TYPE_SNAPD_CLIENT, NULL));
+  self->session = soup_session_new_with_options ("remote-connectable", address, NULL);
+
+  return self;
+}
+
+CcSnapdClient *
+cc_snapd_client_get_default (void)
+{
+  static CcSnapdClient *default_client = NULL;
+
+  if (default_client != NULL)
+    return g_object_ref (default_client);
+
+  default_client = cc_snapd_client_new ();
+  g_object_add_weak_pointer (G_OBJECT (default_client), (gpointer *) &default_client);
+
+  return default_client;
+}
+
+void
+cc_snapd_client_get_snap_async (CcSnapdClient *self, const gchar *name,
+                                GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
 {
+  g_autoptr(GTask) task = NULL;
   g_autofree gchar *path = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
 
   path = g_strdup_printf ("/v2/snaps/%s", name);
-  response = call_sync (self, "GET", path, NULL, cancellable, error);
-  if (response == NULL)
-    return NULL;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s", path);
-      return NULL;
-    }
-
-  return json_object_ref (result);
+  task = make_task (self, path, cancellable, callback, user_data, cc_snapd_client_get_snap_async);
+  call_async (self, "GET", path, NULL, task);
 }
 
 JsonObject *
-cc_snapd_client_get_change_sync (CcSnapdClient *self, const gchar *change_id, GCancellable *cancellable, GError **error)
+cc_snapd_client_get_snap_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
 {
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return get_result (G_TASK (result), error);
+}
+
+void
+cc_snapd_client_get_change_async (CcSnapdClient *self, const gchar *change_id,
+                                  GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
   g_autofree gchar *path = NULL;
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
 
   path = g_strdup_printf ("/v2/changes/%s", change_id);
-  response = call_sync (self, "GET", path, NULL, cancellable, error);
-  if (response == NULL)
-    return NULL;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to %s", path);
-      return NULL;
-    }
+  task = make_task (self, path, cancellable, callback, user_data, cc_snapd_client_get_change_async);
+  call_async (self, "GET", path, NULL, task);
+}
 
-  return json_object_ref (result);
+JsonObject *
+cc_snapd_client_get_change_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
+{
+  JsonObject *change;
+
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  change = get_result (G_TASK (result), error);
+
+  // The connections changed once the change is done.
+  if (change != NULL && json_object_get_boolean_member_with_default (change, "ready", FALSE))
+    g_hash_table_remove_all (self->cache);
+
+  return change;
+}
+
+void
+cc_snapd_client_get_all_connections_async (CcSnapdClient *self,
+                                           GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = make_task (self, "/v2/connections", cancellable, callback, user_data, cc_snapd_client_get_all_connections_async);
+  call_async (self, "GET", "/v2/connections?select=all", NULL, task);
 }
 
 gboolean
-cc_snapd_client_get_all_connections_sync (CcSnapdClient *self,
-                                          JsonArray **plugs, JsonArray **slots,
-                                          GCancellable *cancellable, GError **error)
+cc_snapd_client_get_all_connections_finish (CcSnapdClient *self, GAsyncResult *result,
+                                            JsonArray **plugs, JsonArray **slots,
+                                            GError **error)
 {
-  g_autoptr(JsonObject) response = NULL;
-  JsonObject *result;
+  g_autoptr(JsonObject) connections = NULL;
 
-  response = call_sync (self, "GET", "/v2/connections?select=all", NULL, cancellable, error);
-  if (response == NULL)
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  connections = get_result (G_TASK (result), error);
+  if (connections == NULL)
     return FALSE;
-  result = json_object_get_object_member (response, "result");
-  if (result == NULL)
-    {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Invalid response to /v2/connections");
-      return FALSE;
-    }
 
-  *plugs = json_array_ref (json_object_get_array_member (result, "plugs"));
-  *slots = json_array_ref (json_object_get_array_member (result, "slots"));
+  *plugs = json_array_ref (json_object_get_array_member (connections, "plugs"));
+  *slots = json_array_ref (json_object_get_array_member (connections, "slots"));
   return TRUE;
 }
 
+void
+cc_snapd_client_connect_interface_async (CcSnapdClient *self,
+                                         const gchar *plug_snap, const gchar *plug_name,
+                                         const gchar *slot_snap, const gchar *slot_name,
+                                         GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = make_task (self, "/v2/interfaces", cancellable, callback, user_data, cc_snapd_client_connect_interface_async);
+  call_interfaces_async (self, "connect", plug_snap, plug_name, slot_snap, slot_name, task);
+}
+
 gchar *
-cc_snapd_client_connect_interface_sync (CcSnapdClient *self,
-                                        const gchar *plug_snap, const gchar *plug_name,
-                                        const gchar *slot_snap, const gchar *slot_name,
-                                        GCancellable *cancellable, GError **error)
+cc_snapd_client_connect_interface_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
 {
-  return call_interfaces_sync (self, "connect", plug_snap, plug_name, slot_snap, slot_name, cancellable, error);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return call_interfaces_finish (self, result, error);
+}
+
+void
+cc_snapd_client_disconnect_interface_async (CcSnapdClient *self,
+                                            const gchar *plug_snap, const gchar *plug_name,
+                                            const gchar *slot_snap, const gchar *slot_name,
+                                            GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = make_task (self, "/v2/interfaces", cancellable, callback, user_data, cc_snapd_client_disconnect_interface_async);
+  call_interfaces_async (self, "disconnect", plug_snap, plug_name, slot_snap, slot_name, task);
 }
 
 gchar *
-cc_snapd_client_disconnect_interface_sync (CcSnapdClient *self,
-                                           const gchar *plug_snap, const gchar *plug_name,
-                                           const gchar *slot_snap, const gchar *slot_name,
-                                           GCancellable *cancellable, GError **error)
+cc_snapd_client_disconnect_interface_finish (CcSnapdClient *self, GAsyncResult *result, GError **error)
 {
-  return call_interfaces_sync (self, "disconnect", plug_snap, plug_name, slot_snap, slot_name, cancellable, error);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return call_interfaces_finish (self, result, error);
 }
@@ -20,43 +20,242 @@
 
 #include <config.h>
 
+#include <glib/gstdio.h>
+#include <string.h>
+
 #include "globs.h"
 
-/* parse mime/globs and return a string->string hash table */
-GHashTable *
-parse_globs (void)
+/* The globs files of all the system data dirs, read once into a single
+ * buffer, with an array of offsets into it sorted by MIME type to look
+ * up the glob of a MIME type.
+ *
+ * Lookups never touch the files. Callers about to look up a batch of
+ * types call globs_revalidate() first, which reads the files again only
+ * when one of them changed, as happens when update-mime-database runs.
+ */
+
+typedef struct
+{
+  guint32 mime_type;
+  guint32 glob;
+} GlobEntry;
+
+typedef struct
+{
+  gchar    *path;
+  gboolean  exists;
+  gint64    mtime;
+  goffset   size;
+  guint64   inode;
+} GlobsFile;
+
+typedef struct
+{
+  GArray *files;
+  gchar  *data;
+  GArray *by_mime_type;
+} GlobsIndex;
+
+static GMutex globs_lock;
+static GlobsIndex *globs_index = NULL;
+
+static void
+globs_file_clear (GlobsFile *file)
+{
+  g_free (file->path);
+}
+
+static void
+globs_index_free (GlobsIndex *index)
+{
+  g_array_unref (index->files);
+  g_free (index->data);
+  g_array_unref (index->by_mime_type);
+  g_free (index);
+}
+
+static void
+globs_file_stat (GlobsFile *file)
+{
+  GStatBuf buf;
+
+  file->exists = g_stat (file->path, &buf) == 0;
+  file->mtime = file->exists ? buf.st_mtime : 0;
+  file->size = file->exists ? buf.st_size : 0;
+  file->inode = file->exists ? buf.st_ino : 0;
+}
+
+static gboolean
+globs_index_is_current (GlobsIndex *index)
+{
+  guint i;
+
+  for (i = 0; i < index->files->len; i++)
+    {
+      GlobsFile *file = &g_array_index (index->files, GlobsFile, i);
+      GlobsFile current = { file->path, };
+
+      globs_file_stat (&current);
+      if (current.exists != file->exists ||
+          current.mtime != file->mtime ||
+          current.size != file->size ||
+          current.inode != file->inode)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Entries of equal keys stay in the order of the files, which is
+ * the order of their offsets */
+static gint
+compare_by_mime_type (gconstpointer a,
+                      gconstpointer b,
+                      gpointer      user_data)
+{
+  const GlobEntry *entry_a = a;
+  const GlobEntry *entry_b = b;
+  const gchar *data = user_data;
+  gint ret;
+
+  ret = strcmp (data + entry_a->mime_type, data + entry_b->mime_type);
+  if (ret != 0)
+    return ret;
+
+  return entry_a->mime_type < entry_b->mime_type ? -1 : entry_a->mime_type > entry_b->mime_type;
+}
+
+static GlobsIndex *
+globs_index_new (void)
 {
-  GHashTable *globs;
+  GlobsIndex *index;
   const gchar * const *dirs;
+  g_autoptr(GString) data = NULL;
+  GArray *entries;
+  gchar *line, *end;
   gint i;
 
-  globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  index = g_new0 (GlobsIndex, 1);
+  index->files = g_array_new (FALSE, TRUE, sizeof (GlobsFile));
+  g_array_set_clear_func (index->files, (GDestroyNotify) globs_file_clear);
+
+  /* Offset 0 is never a valid entry */
+  data = g_string_new ("\n");
 
   dirs = g_get_system_data_dirs ();
 
   for (i = 0; dirs[i]; i++)
     {
-      g_autofree gchar *file = g_build_filename (dirs[i], "mime", "globs", NULL);
+      GlobsFile file = { 0, };
       g_autofree gchar *contents = NULL;
+      gsize length;
+
+      file.path = g_build_filename (dirs[i], "mime", "globs", NULL);
+
+      /* Stat first, so that a change while reading is seen next time */
+      globs_file_stat (&file);
+      g_array_append_val (index->files, file);
 
-      if (g_file_get_contents (file, &contents, NULL, NULL))
+      if (g_file_get_contents (file.path, &contents, &length, NULL))
         {
-          g_auto(GStrv) strv = NULL;
-          int i;
+          g_string_append_len (data, contents, length);
+          g_string_append_c (data, '\n');
+        }
+    }
 
-          strv = g_strsplit (contents, "\n", 0);
-          for (i = 0; strv[i]; i++)
-            {
-              g_auto(GStrv) parts = NULL;
+  index->data = g_string_free (g_steal_pointer (&data), FALSE);
 
-              if (strv[i][0] == '#' || strv[i][0] == '\0')
-                continue;
+  /* Split the lines in place into "mime-type\0glob\0" */
+  entries = g_array_new (FALSE, FALSE, sizeof (GlobEntry));
+  for (line = index->data + 1; *line != '\0'; line = end + 1)
+    {
+      GlobEntry entry;
+      gchar *colon;
 
-              parts = g_strsplit (strv[i], ":", 2);
-              g_hash_table_insert (globs, g_strdup (parts[0]), g_strdup (parts[1]));
-            }
-        }
+      end = strchr (line, '\n');
+      *end = '\0';
+
+      if (line[0] == '#' || line[0] == '\0')
+        continue;
+
+      /* Lines without a glob are never looked up */
+      colon = strchr (line, ':');
+      if (colon == NULL)
+        continue;
+      *colon = '\0';
+
+      entry.mime_type = line - index->data;
+      entry.glob = colon + 1 - index->data;
+      g_array_append_val (entries, entry);
     }
 
-  return globs;
+  index->by_mime_type = entries;
+  g_array_sort_with_data (index->by_mime_type, compare_by_mime_type, index->data);
+
+  return index;
+}
+
+/* Must be called with globs_lock held */
+static GlobsIndex *
+get_globs_index (void)
+{
+  if (globs_index == NULL)
+    globs_index = globs_index_new ();
+
+  return globs_index;
+}
+
+/* Drop the index if any of the globs files changed since it was read,
+ * so that the next lookup reads them again */
+void
+globs_revalidate (void)
+{
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&globs_lock);
+
+  if (globs_index != NULL && !globs_index_is_current (globs_index))
+    g_clear_pointer (&globs_index, globs_index_free);
+}
+
+/* Index of the first entry whose MIME type is not before @mime_type */
+static guint
+lower_bound (GlobsIndex  *index,
+             GArray      *entries,
+             const gchar *mime_type)
+{
+  guint low = 0, high = entries->len;
+
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+      GlobEntry *entry = &g_array_index (entries, GlobEntry, mid);
+
+      if (strcmp (index->data + entry->mime_type, mime_type) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/* Return the glob of @mime_type, the last one listed when there are
+ * several, as the panel always showed */
+gchar *
+get_glob_for_mime_type (const gchar *mime_type)
+{
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&globs_lock);
+  GlobsIndex *index = get_globs_index ();
+  GArray *entries = index->by_mime_type;
+  guint i;
+
+  i = lower_bound (index, entries, mime_type);
+  if (i == entries->len ||
+      strcmp (index->data + g_array_index (entries, GlobEntry, i).mime_type, mime_type) != 0)
+    return NULL;
+
+  while (i + 1 < entries->len &&
+         strcmp (index->data + g_array_index (entries, GlobEntry, i + 1).mime_type, mime_type) == 0)
+    i++;
+
+  return g_strdup (index->data + g_array_index (entries, GlobEntry, i).glob);
 }
@@ -24,6 +24,8 @@
 
 G_BEGIN_DECLS
 
-GHashTable* parse_globs (void);
+void   globs_revalidate        (void);
+
+gchar *get_glob_for_mime_type  (const gchar *mime_type);
 
 G_END_DECLS
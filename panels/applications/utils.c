@@ -18,16 +18,21 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#ifndef _XOPEN_SOURCE
-#define _XOPEN_SOURCE 600
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
 #endif
 
 #include <config.h>
 #include <glib/gi18n.h>
+#include <gio/gdesktopappinfo.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <ftw.h>
+#include <unistd.h>
 
 #include "utils.h"
 #ifdef HAVE_SNAP
@@ -79,39 +84,413 @@ file_remove_finish (GFile        *file,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
-static GPrivate size_key = G_PRIVATE_INIT (g_free);
+/*
+ * Sizes are computed by walking the tree one directory per job on a
+ * shared thread pool. A job opens its directory by path and closes it
+ * before queueing the subdirectories, so no more descriptors are open
+ * than there are threads, however wide the tree. For every directory,
+ * the size of the files directly in it and the names of its
+ * subdirectories are cached along with its mtime, which changes whenever
+ * an entry is added, removed or renamed, so a directory which did not
+ * change is not read again. A file which grows in place is only
+ * accounted for once its directory changes. The cached entries of a
+ * directory which is removed, or can no longer be read, are dropped
+ * along with those of everything under it.
+ *
+ * A subdirectory which can't be read counts as empty, so that one bad
+ * entry deep in an app's data doesn't leave its size unknown; only a
+ * root which exists but can't be read fails the walk.
+ *
+ * A cancelled walk stops where it is, and what it had read so far is
+ * still cached for the next one.
+ */
 
-static gint
-ftw_size_cb (const gchar       *path,
-             const struct stat *sb,
-             gint               typeflags,
-             struct FTW        *ftwbuf)
-{
-  guint64 *size = (guint64*)g_private_get (&size_key);
-  if (typeflags == FTW_F)
-    *size += sb->st_size;
-  return 0;
+#define MAX_SIZE_THREADS 4
+
+typedef struct
+{
+  gint64   mtime_sec;
+  glong    mtime_nsec;
+  guint64  files_size;
+  GStrv    subdirs;
+} DirSize;
+
+typedef struct
+{
+  GTask   *task;
+  gint     pending;
+  GMutex   lock;
+  guint64  total;
+  GError  *error;
+} SizeWalk;
+
+typedef struct
+{
+  SizeWalk *walk;
+  gchar    *path;
+  gboolean  is_root;
+} SizeJob;
+
+static GMutex dir_sizes_lock;
+static GHashTable *dir_sizes = NULL;
+
+static void
+dir_size_free (DirSize *dir_size)
+{
+  g_strfreev (dir_size->subdirs);
+  g_free (dir_size);
+}
+
+static gboolean
+lookup_dir_size (const gchar        *path,
+                 const struct stat  *st,
+                 guint64            *files_size,
+                 GStrv              *subdirs)
+{
+  DirSize *dir_size;
+  gboolean found = FALSE;
+
+  g_mutex_lock (&dir_sizes_lock);
+
+  if (dir_sizes == NULL)
+    dir_sizes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       g_free, (GDestroyNotify) dir_size_free);
+
+  dir_size = g_hash_table_lookup (dir_sizes, path);
+  if (dir_size != NULL &&
+      dir_size->mtime_sec == st->st_mtim.tv_sec &&
+      dir_size->mtime_nsec == st->st_mtim.tv_nsec)
+    {
+      *files_size = dir_size->files_size;
+      *subdirs = g_strdupv (dir_size->subdirs);
+      found = TRUE;
+    }
+
+  g_mutex_unlock (&dir_sizes_lock);
+
+  return found;
 }
 
+/* Called with dir_sizes_lock held */
 static void
-file_size_thread_func (GTask        *task,
-                       gpointer      source_object,
-                       gpointer      task_data,
-                       GCancellable *cancellable)
+forget_dir_size_locked (const gchar *path)
 {
-  GFile *file = source_object;
-  g_autofree gchar *path = g_file_get_path (file);
+  gchar *key;
+  DirSize *dir_size;
+  guint i;
+
+  if (!g_hash_table_steal_extended (dir_sizes, path, (gpointer *) &key, (gpointer *) &dir_size))
+    return;
+
+  for (i = 0; dir_size->subdirs[i] != NULL; i++)
+    {
+      g_autofree gchar *subdir = g_build_filename (path, dir_size->subdirs[i], NULL);
+
+      forget_dir_size_locked (subdir);
+    }
+
+  g_free (key);
+  dir_size_free (dir_size);
+}
+
+static void
+forget_dir_size (const gchar *path)
+{
+  g_mutex_lock (&dir_sizes_lock);
+  if (dir_sizes != NULL)
+    forget_dir_size_locked (path);
+  g_mutex_unlock (&dir_sizes_lock);
+}
+
+static void
+store_dir_size (const gchar        *path,
+                const struct stat  *st,
+                guint64             files_size,
+                GStrv               subdirs)
+{
+  DirSize *dir_size;
+  DirSize *old_dir_size;
+  guint i;
+
+  dir_size = g_new0 (DirSize, 1);
+  dir_size->mtime_sec = st->st_mtim.tv_sec;
+  dir_size->mtime_nsec = st->st_mtim.tv_nsec;
+  dir_size->files_size = files_size;
+  dir_size->subdirs = g_strdupv (subdirs);
+
+  g_mutex_lock (&dir_sizes_lock);
+
+  /* Subdirectories which went away are not walked again, so drop them here */
+  old_dir_size = g_hash_table_lookup (dir_sizes, path);
+  if (old_dir_size != NULL)
+    {
+      for (i = 0; old_dir_size->subdirs[i] != NULL; i++)
+        {
+          g_autofree gchar *subdir = NULL;
+
+          if (g_strv_contains ((const gchar * const *) subdirs, old_dir_size->subdirs[i]))
+            continue;
+
+          subdir = g_build_filename (path, old_dir_size->subdirs[i], NULL);
+          forget_dir_size_locked (subdir);
+        }
+    }
+
+  g_hash_table_replace (dir_sizes, g_strdup (path), dir_size);
+
+  g_mutex_unlock (&dir_sizes_lock);
+}
+
+static gboolean
+stat_entry (gint         dirfd,
+            const gchar *name,
+            mode_t      *mode,
+            guint64     *size)
+{
+#if HAVE_STATX
+  struct statx stx;
+
+  /* Only what is needed, without forcing a sync on network file systems */
+  if (statx (dirfd, name,
+             AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC,
+             STATX_TYPE | STATX_SIZE, &stx) < 0)
+    return FALSE;
+
+  *mode = stx.stx_mode;
+  *size = stx.stx_size;
+#else
+  struct stat st;
+
+  if (fstatat (dirfd, name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+    return FALSE;
+
+  *mode = st.st_mode;
+  *size = st.st_size;
+#endif
+
+  return TRUE;
+}
+
+/* Takes @fd, which is closed with the directory stream */
+static gboolean
+read_dir_size (gint      fd,
+               guint64  *files_size,
+               GStrv    *subdirs)
+{
+  g_autoptr(GStrvBuilder) builder = NULL;
+  struct dirent *entry;
+  DIR *dir;
+
+  dir = fdopendir (fd);
+  if (dir == NULL)
+    {
+      gint saved_errno = errno;
+
+      close (fd);
+      errno = saved_errno;
+      return FALSE;
+    }
+
+  builder = g_strv_builder_new ();
+  *files_size = 0;
+
+  while ((entry = readdir (dir)) != NULL)
+    {
+      mode_t mode;
+      guint64 size;
+
+      if (g_str_equal (entry->d_name, ".") || g_str_equal (entry->d_name, ".."))
+        continue;
+
+      /* Like nftw() with FTW_PHYS, only regular files are counted */
+      if (entry->d_type == DT_DIR)
+        {
+          g_strv_builder_add (builder, entry->d_name);
+          continue;
+        }
+
+      if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)
+        continue;
+
+      if (!stat_entry (dirfd (dir), entry->d_name, &mode, &size))
+        continue;
+
+      if (S_ISREG (mode))
+        *files_size += size;
+      else if (S_ISDIR (mode))
+        g_strv_builder_add (builder, entry->d_name);
+    }
+
+  closedir (dir);
+
+  *subdirs = g_strv_builder_end (builder);
+
+  return TRUE;
+}
+
+static void
+size_walk_set_error (SizeWalk    *walk,
+                     gint         saved_errno,
+                     const gchar *path)
+{
+  g_autofree gchar *display_name = g_filename_display_name (path);
+
+  g_mutex_lock (&walk->lock);
+  if (walk->error == NULL)
+    walk->error = g_error_new (G_IO_ERROR,
+                               g_io_error_from_errno (saved_errno),
+                               "Failed to read %s: %s",
+                               display_name, g_strerror (saved_errno));
+  g_mutex_unlock (&walk->lock);
+}
+
+static void push_size_job (SizeWalk    *walk,
+                           const gchar *path,
+                           gboolean     is_root);
+
+static void
+walk_dir_failed (SizeWalk    *walk,
+                 const gchar *path,
+                 gboolean     is_root,
+                 gint         saved_errno)
+{
+  forget_dir_size (path);
+
+  /* Anything below the root just counts as empty */
+  if (is_root)
+    size_walk_set_error (walk, saved_errno, path);
+}
+
+static void
+walk_dir (SizeWalk    *walk,
+          const gchar *path,
+          gboolean     is_root)
+{
+  g_auto(GStrv) subdirs = NULL;
+  guint64 files_size;
+  struct stat st;
+  gint fd;
+  guint i;
+
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    {
+      gint saved_errno = errno;
+
+      /* Gone, not ours to read, or replaced by something which is not a
+       * directory since it was listed: there is nothing to count there */
+      if (saved_errno == ENOENT || saved_errno == EACCES ||
+          saved_errno == ENOTDIR || saved_errno == ELOOP)
+        forget_dir_size (path);
+      else
+        walk_dir_failed (walk, path, is_root, saved_errno);
+      return;
+    }
+
+  if (fstat (fd, &st) < 0)
+    {
+      gint saved_errno = errno;
+
+      close (fd);
+      walk_dir_failed (walk, path, is_root, saved_errno);
+      return;
+    }
+
+  if (lookup_dir_size (path, &st, &files_size, &subdirs))
+    {
+      close (fd);
+    }
+  else
+    {
+      if (!read_dir_size (fd, &files_size, &subdirs))
+        {
+          walk_dir_failed (walk, path, is_root, errno);
+          return;
+        }
+
+      store_dir_size (path, &st, files_size, subdirs);
+    }
+
+  g_mutex_lock (&walk->lock);
+  walk->total += files_size;
+  g_mutex_unlock (&walk->lock);
+
+  for (i = 0; subdirs[i] != NULL; i++)
+    {
+      g_autofree gchar *subdir = g_build_filename (path, subdirs[i], NULL);
+
+      push_size_job (walk, subdir, FALSE);
+    }
+}
+
+static void
+size_walk_finish (SizeWalk *walk)
+{
+  g_autoptr(GTask) task = g_steal_pointer (&walk->task);
   guint64 *total;
 
-  g_private_replace (&size_key, g_new0 (guint64, 1));
+  g_mutex_clear (&walk->lock);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_clear_error (&walk->error);
+    }
+  else if (walk->error != NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&walk->error));
+    }
+  else
+    {
+      total = g_new0 (guint64, 1);
+      *total = walk->total;
+      g_task_return_pointer (task, total, g_free);
+    }
+
+  g_free (walk);
+}
 
-  nftw (path, ftw_size_cb, 20, FTW_PHYS | FTW_DEPTH);
+static void
+size_job_func (gpointer data,
+               gpointer user_data)
+{
+  SizeJob *job = data;
+  SizeWalk *walk = job->walk;
 
-  total = g_new0 (guint64, 1);
-  *total = *(guint64*)g_private_get (&size_key);
+  if (!g_cancellable_is_cancelled (g_task_get_cancellable (walk->task)))
+    walk_dir (walk, job->path, job->is_root);
 
-  if (g_task_set_return_on_cancel (task, FALSE))
-    g_task_return_pointer (task, total, g_free);
+  g_free (job->path);
+  g_free (job);
+
+  if (g_atomic_int_dec_and_test (&walk->pending))
+    size_walk_finish (walk);
+}
+
+static void
+push_size_job (SizeWalk    *walk,
+               const gchar *path,
+               gboolean     is_root)
+{
+  static GThreadPool *pool = NULL;
+  SizeJob *job;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (size_job_func, NULL,
+                                    CLAMP (g_get_num_processors (), 1, MAX_SIZE_THREADS),
+                                    FALSE, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  job = g_new0 (SizeJob, 1);
+  job->walk = walk;
+  job->path = g_strdup (path);
+  job->is_root = is_root;
+
+  g_atomic_int_inc (&walk->pending);
+  g_thread_pool_push (pool, job, NULL);
 }
 
 void
@@ -120,9 +499,21 @@ file_size_async (GFile               *file,
                  GAsyncReadyCallback  callback,
                  gpointer             data)
 {
-  g_autoptr(GTask) task = g_task_new (file, cancellable, callback, data);
-  g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, file_size_thread_func);
+  g_autofree gchar *path = g_file_get_path (file);
+  SizeWalk *walk;
+
+  walk = g_new0 (SizeWalk, 1);
+  walk->task = g_task_new (file, cancellable, callback, data);
+  g_task_set_source_tag (walk->task, file_size_async);
+  g_mutex_init (&walk->lock);
+
+  if (path == NULL)
+    {
+      size_walk_finish (walk);
+      return;
+    }
+
+  push_size_job (walk, path, TRUE);
 }
 
 gboolean
@@ -142,109 +533,513 @@ file_size_finish (GFile        *file,
   return TRUE;
 }
 
+/*
+ * Flatpak installations are read directly rather than going through the
+ * flatpak CLI. A deployed app lives in
+ *
+ *   $installation/app/$app_id/$arch/$branch/$commit/
+ *
+ * with app/$app_id/current pointing to $arch/$branch and
+ * $arch/$branch/active pointing to $commit. The deploy directory holds
+ * the metadata keyfile and the "deploy" data, a serialized GVariant with
+ * the installed size. Since a deploy directory never changes once
+ * written, what was read from it is cached by path, and an update only
+ * needs the two links to be read again.
+ */
+
+#define FLATPAK_DEPLOY_DATA_FORMAT "(ssasta{sv})"
+
+typedef struct
+{
+  gchar   *metadata;
+  guint64  installed_size;
+} FlatpakAppInfo;
+
+typedef struct
+{
+  GKeyFile *metadata;
+  guint64   installed_size;
+} FlatpakAppInfoResult;
+
+static GMutex flatpak_cache_lock;
+static GHashTable *flatpak_cache = NULL;
+
+static void
+flatpak_app_info_free (FlatpakAppInfo *info)
+{
+  g_free (info->metadata);
+  g_free (info);
+}
+
+static void
+flatpak_app_info_result_free (FlatpakAppInfoResult *result)
+{
+  g_clear_pointer (&result->metadata, g_key_file_unref);
+  g_free (result);
+}
+
+static gchar *
+get_flatpak_user_installation (void)
+{
+  const gchar *path = g_getenv ("FLATPAK_USER_DIR");
+
+  if (path != NULL && *path != '\0')
+    return g_strdup (path);
+
+  return g_build_filename (g_get_user_data_dir (), "flatpak", NULL);
+}
+
+static gchar *
+get_flatpak_system_installation (void)
+{
+  const gchar *path = g_getenv ("FLATPAK_SYSTEM_DIR");
+
+  if (path != NULL && *path != '\0')
+    return g_strdup (path);
+
+  return g_strdup ("/var/lib/flatpak");
+}
+
 static gchar *
-get_output_of (const gchar **argv)
-{
-  g_autofree gchar *output = NULL;
-  int status;
-
-  if (!g_spawn_sync (NULL,
-                     (gchar**) argv,
-                     NULL,
-                     G_SPAWN_SEARCH_PATH,
-                     NULL, NULL,
-                     &output, NULL,
-                     &status, NULL))
+get_flatpak_deploy_dir (const gchar *installation,
+                        const gchar *app_id)
+{
+  g_autofree gchar *app_dir = NULL;
+  g_autofree gchar *current_link = NULL;
+  g_autofree gchar *current = NULL;
+  g_autofree gchar *branch_dir = NULL;
+  g_autofree gchar *active_link = NULL;
+  g_autofree gchar *active = NULL;
+
+  app_dir = g_build_filename (installation, "app", app_id, NULL);
+
+  current_link = g_build_filename (app_dir, "current", NULL);
+  current = g_file_read_link (current_link, NULL);
+  if (current == NULL)
     return NULL;
 
-  if (!g_spawn_check_wait_status (status, NULL))
+  branch_dir = g_build_filename (app_dir, current, NULL);
+  active_link = g_build_filename (branch_dir, "active", NULL);
+  active = g_file_read_link (active_link, NULL);
+  if (active == NULL)
     return NULL;
 
-  return g_steal_pointer (&output);
+  return g_build_filename (branch_dir, active, NULL);
 }
 
-GKeyFile *
-get_flatpak_metadata (const gchar *app_id)
+static guint64
+read_flatpak_installed_size (const gchar *deploy_dir)
 {
-  const gchar *argv[5] = { "flatpak", "info", "-m", "app", NULL };
-  g_autofree gchar *data = NULL;
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GKeyFile) keyfile = NULL;
+  g_autofree gchar *path = NULL;
+  g_autoptr(GVariant) deploy_data = NULL;
+  gchar *data = NULL;
+  gsize length;
+  guint64 size;
 
-  argv[3] = app_id;
+  path = g_build_filename (deploy_dir, "deploy", NULL);
+  if (!g_file_get_contents (path, &data, &length, NULL))
+    return 0;
 
-  data = get_output_of (argv);
-  if (data == NULL)
-    return NULL;
+  deploy_data = g_variant_new_from_data (G_VARIANT_TYPE (FLATPAK_DEPLOY_DATA_FORMAT),
+                                         data, length, FALSE, g_free, data);
+  g_variant_ref_sink (deploy_data);
+
+  /* Stored big endian, like flatpak does */
+  g_variant_get_child (deploy_data, 3, "t", &size);
+
+  return GUINT64_FROM_BE (size);
+}
+
+static FlatpakAppInfo *
+read_flatpak_app_info (const gchar  *deploy_dir,
+                       GError      **error)
+{
+  g_autofree gchar *path = NULL;
+  FlatpakAppInfo *info;
+
+  info = g_new0 (FlatpakAppInfo, 1);
 
-  keyfile = g_key_file_new ();
-  if (!g_key_file_load_from_data (keyfile, data, -1, 0, &error))
+  path = g_build_filename (deploy_dir, "metadata", NULL);
+  if (!g_file_get_contents (path, &info->metadata, NULL, error))
     {
-      g_warning ("%s", error->message);
+      flatpak_app_info_free (info);
       return NULL;
     }
 
-  return g_steal_pointer (&keyfile);
+  info->installed_size = read_flatpak_installed_size (deploy_dir);
+
+  return info;
 }
 
-guint64
-get_flatpak_app_size (const gchar *app_id)
+static void
+flatpak_app_info_thread_func (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
 {
-  const gchar *argv[5] = { "flatpak", "info", "-s", "app", NULL };
-  g_autofree gchar *data = NULL;
-  guint64 factor;
-  double val;
+  const gchar *app_id = task_data;
+  g_autofree gchar *user_installation = get_flatpak_user_installation ();
+  g_autofree gchar *system_installation = get_flatpak_system_installation ();
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *deploy_dir = NULL;
+  g_autofree gchar *metadata = NULL;
+  FlatpakAppInfoResult *result;
+  FlatpakAppInfo *info;
+  guint64 installed_size = 0;
 
-  argv[3] = app_id;
+  /* Same order as flatpak itself */
+  deploy_dir = get_flatpak_deploy_dir (user_installation, app_id);
+  if (deploy_dir == NULL)
+    deploy_dir = get_flatpak_deploy_dir (system_installation, app_id);
 
-  data = get_output_of (argv);
-  if (data == NULL)
-    return 0;
+  if (deploy_dir == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                               "%s is not installed", app_id);
+      return;
+    }
 
-  data = g_strstrip (data);
-
-  if (g_str_has_suffix (data, "kB") || g_str_has_suffix (data, "kb"))
-    factor = 1000;
-  else if (g_str_has_suffix (data, "MB") || g_str_has_suffix (data, "Mb"))
-    factor = 1000 * 1000;
-  else if (g_str_has_suffix (data, "GB") || g_str_has_suffix (data, "Gb"))
-    factor = 1000 * 1000 * 1000;
-  else if (g_str_has_suffix (data, "KiB") || g_str_has_suffix (data, "Kib"))
-    factor = 1024;
-  else if (g_str_has_suffix (data, "MiB") || g_str_has_suffix (data, "Mib"))
-    factor = 1024 * 1024;
-  else if (g_str_has_suffix (data, "GiB") || g_str_has_suffix (data, "Gib"))
-    factor = 1024 * 1024 * 1024;
-  else
-    factor = 1;
+  g_mutex_lock (&flatpak_cache_lock);
+  if (flatpak_cache == NULL)
+    flatpak_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, (GDestroyNotify) flatpak_app_info_free);
+  info = g_hash_table_lookup (flatpak_cache, deploy_dir);
+  if (info != NULL)
+    {
+      metadata = g_strdup (info->metadata);
+      installed_size = info->installed_size;
+    }
+  g_mutex_unlock (&flatpak_cache_lock);
+
+  if (metadata == NULL)
+    {
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      info = read_flatpak_app_info (deploy_dir, &error);
+      if (info == NULL)
+        {
+          g_task_return_error (task, g_steal_pointer (&error));
+          return;
+        }
+
+      metadata = g_strdup (info->metadata);
+      installed_size = info->installed_size;
+
+      g_mutex_lock (&flatpak_cache_lock);
+      g_hash_table_replace (flatpak_cache, g_steal_pointer (&deploy_dir), info);
+      g_mutex_unlock (&flatpak_cache_lock);
+    }
+
+  result = g_new0 (FlatpakAppInfoResult, 1);
+  result->metadata = g_key_file_new ();
+  result->installed_size = installed_size;
+
+  if (!g_key_file_load_from_data (result->metadata, metadata, -1, G_KEY_FILE_NONE, &error))
+    {
+      flatpak_app_info_result_free (result);
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_return_pointer (task, result, (GDestroyNotify) flatpak_app_info_result_free);
+}
+
+/**
+ * get_flatpak_app_info_async:
+ *
+ * Looks up the metadata and installed size of the Flatpak app @app_id in
+ * the user and system installations. The lookup is done in a thread, and
+ * fails with %G_IO_ERROR_NOT_FOUND if the app is not installed.
+ */
+void
+get_flatpak_app_info_async (const gchar         *app_id,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             data)
+{
+  g_autoptr(GTask) task = NULL;
 
-  val = g_ascii_strtod (data, NULL);
+  g_return_if_fail (app_id != NULL);
 
-  return (guint64)(val * factor);
+  task = g_task_new (NULL, cancellable, callback, data);
+  g_task_set_source_tag (task, get_flatpak_app_info_async);
+  g_task_set_task_data (task, g_strdup (app_id), g_free);
+  g_task_set_return_on_cancel (task, TRUE);
+  g_task_run_in_thread (task, flatpak_app_info_thread_func);
 }
 
-guint64
-get_snap_app_size (const gchar *snap_name)
+gboolean
+get_flatpak_app_info_finish (GAsyncResult  *result,
+                             GKeyFile     **metadata,
+                             guint64       *installed_size,
+                             GError       **error)
 {
+  FlatpakAppInfoResult *info;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  info = g_task_propagate_pointer (G_TASK (result), error);
+  if (info == NULL)
+    return FALSE;
+
+  if (metadata != NULL)
+    *metadata = g_steal_pointer (&info->metadata);
+  if (installed_size != NULL)
+    *installed_size = info->installed_size;
+
+  flatpak_app_info_result_free (info);
+
+  return TRUE;
+}
+
 #ifdef HAVE_SNAP
-  g_autoptr(CcSnapdClient) client = NULL;
+static void
+get_snap_cb (GObject      *source,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
   g_autoptr(JsonObject) snap = NULL;
-  g_autoptr(GError) error = NULL;
+  GError *error = NULL;
 
-  client = cc_snapd_client_new ();
-  snap = cc_snapd_client_get_snap_sync (client, snap_name, NULL, &error);
+  snap = cc_snapd_client_get_snap_finish (CC_SNAPD_CLIENT (source), res, &error);
   if (snap == NULL)
     {
-      g_warning ("Failed to get snap size: %s", error->message);
-      return 0;
+      g_task_return_error (task, error);
+      return;
     }
 
-  return json_object_get_int_member (snap, "installed-size");
+  g_task_return_int (task, json_object_get_int_member (snap, "installed-size"));
+}
+#endif
+
+void
+get_snap_app_size_async (const gchar         *snap_name,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             data)
+{
+  g_autoptr(GTask) task = NULL;
+#ifdef HAVE_SNAP
+  g_autoptr(CcSnapdClient) client = NULL;
+#endif
+
+  task = g_task_new (NULL, cancellable, callback, data);
+  g_task_set_source_tag (task, get_snap_app_size_async);
+
+#ifdef HAVE_SNAP
+  client = cc_snapd_client_get_default ();
+  cc_snapd_client_get_snap_async (client, snap_name, cancellable, get_snap_cb, g_steal_pointer (&task));
 #else
-  return 0;
+  g_task_return_int (task, 0);
 #endif
 }
 
+gboolean
+get_snap_app_size_finish (GAsyncResult  *result,
+                          guint64       *size,
+                          GError       **error)
+{
+  gssize ret;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  ret = g_task_propagate_int (G_TASK (result), error);
+  if (ret < 0)
+    return FALSE;
+
+  if (size != NULL)
+    *size = ret;
+
+  return TRUE;
+}
+
+static const gchar *
+get_sort_key (GAppInfo *info)
+{
+  static GQuark sort_key_quark = 0;
+  gchar *sort_key;
+
+  if (G_UNLIKELY (sort_key_quark == 0))
+    sort_key_quark = g_quark_from_static_string ("cc-applications-sort-key");
+
+  sort_key = g_object_get_qdata (G_OBJECT (info), sort_key_quark);
+  if (sort_key == NULL)
+    {
+      g_autofree gchar *casefolded = g_utf8_casefold (g_app_info_get_display_name (info), -1);
+
+      sort_key = g_utf8_collate_key (casefolded, -1);
+      g_object_set_qdata_full (G_OBJECT (info), sort_key_quark, sort_key, g_free);
+    }
+
+  return sort_key;
+}
+
+/* Sorted by display name, the ID only keeps the order stable */
+static gint
+compare_app_infos (GAppInfo *a,
+                   GAppInfo *b)
+{
+  gint ret;
+
+  ret = strcmp (get_sort_key (a), get_sort_key (b));
+  if (ret != 0)
+    return ret;
+
+  return g_strcmp0 (g_app_info_get_id (a), g_app_info_get_id (b));
+}
+
+static gint
+compare_app_info_ptrs (gconstpointer a,
+                       gconstpointer b)
+{
+  return compare_app_infos (*(GAppInfo **) a, *(GAppInfo **) b);
+}
+
+static gboolean
+desktop_strings_equal (GAppInfo    *old,
+                       GAppInfo    *new,
+                       const gchar *key)
+{
+  g_autofree gchar *old_value = NULL;
+  g_autofree gchar *new_value = NULL;
+
+  if (!G_IS_DESKTOP_APP_INFO (old) || !G_IS_DESKTOP_APP_INFO (new))
+    return G_IS_DESKTOP_APP_INFO (old) == G_IS_DESKTOP_APP_INFO (new);
+
+  old_value = g_desktop_app_info_get_string (G_DESKTOP_APP_INFO (old), key);
+  new_value = g_desktop_app_info_get_string (G_DESKTOP_APP_INFO (new), key);
+
+  return g_strcmp0 (old_value, new_value) == 0;
+}
+
+static gboolean
+supported_types_equal (GAppInfo *old,
+                       GAppInfo *new)
+{
+  const gchar **old_types = g_app_info_get_supported_types (old);
+  const gchar **new_types = g_app_info_get_supported_types (new);
+
+  if (old_types == NULL || new_types == NULL)
+    return old_types == new_types;
+
+  return g_strv_equal ((const gchar * const *) old_types, (const gchar * const *) new_types);
+}
+
+/*
+ * Whether the item for @old can be kept for @new, which is the case if
+ * everything the panel reads from them is the same, so that neither the
+ * row nor the selected app show anything stale.
+ */
+static gboolean
+app_info_unchanged (GAppInfo *old,
+                    GAppInfo *new)
+{
+  if (old == new)
+    return TRUE;
+
+  return g_strcmp0 (g_app_info_get_display_name (old), g_app_info_get_display_name (new)) == 0 &&
+         g_strcmp0 (g_app_info_get_name (old), g_app_info_get_name (new)) == 0 &&
+         g_icon_equal (g_app_info_get_icon (old), g_app_info_get_icon (new)) &&
+         g_strcmp0 (g_app_info_get_commandline (old), g_app_info_get_commandline (new)) == 0 &&
+         supported_types_equal (old, new) &&
+         desktop_strings_equal (old, new, "X-Flatpak") &&
+         desktop_strings_equal (old, new, "X-SnapInstanceName");
+}
+
+static void
+flush_app_list_changes (GListStore *store,
+                        guint      *position,
+                        guint      *n_removed,
+                        GPtrArray  *added)
+{
+  if (*n_removed == 0 && added->len == 0)
+    return;
+
+  g_list_store_splice (store, *position, *n_removed, added->pdata, added->len);
+
+  *position += added->len;
+  *n_removed = 0;
+  g_ptr_array_set_size (added, 0);
+}
+
+/**
+ * update_app_list:
+ * @store: a #GListStore of #GAppInfo, sorted by this function
+ * @infos: (element-type GAppInfo): the apps which should be listed
+ *
+ * Makes @store list @infos, sorted by name. Apps which are already in
+ * @store and did not change are kept, and consecutive changes are done
+ * in one go, so that filling an empty store emits a single
+ * #GListModel::items-changed.
+ */
+void
+update_app_list (GListStore *store,
+                 GPtrArray  *infos)
+{
+  g_autoptr(GPtrArray) old_infos = NULL;
+  g_autoptr(GPtrArray) new_infos = NULL;
+  g_autoptr(GPtrArray) added = NULL;
+  guint position = 0, n_removed = 0;
+  guint n_old, i = 0, j = 0;
+
+  g_return_if_fail (G_IS_LIST_STORE (store));
+  g_return_if_fail (infos != NULL);
+
+  n_old = g_list_model_get_n_items (G_LIST_MODEL (store));
+  old_infos = g_ptr_array_new_full (n_old, g_object_unref);
+  for (i = 0; i < n_old; i++)
+    g_ptr_array_add (old_infos, g_list_model_get_item (G_LIST_MODEL (store), i));
+
+  new_infos = g_ptr_array_copy (infos, NULL, NULL);
+  g_ptr_array_sort (new_infos, compare_app_info_ptrs);
+
+  added = g_ptr_array_new ();
+
+  i = 0;
+  while (i < old_infos->len || j < new_infos->len)
+    {
+      GAppInfo *old = i < old_infos->len ? g_ptr_array_index (old_infos, i) : NULL;
+      GAppInfo *new = j < new_infos->len ? g_ptr_array_index (new_infos, j) : NULL;
+      gint cmp;
+
+      if (old == NULL)
+        cmp = 1;
+      else if (new == NULL)
+        cmp = -1;
+      else
+        cmp = compare_app_infos (old, new);
+
+      if (cmp < 0)
+        {
+          n_removed++;
+          i++;
+        }
+      else if (cmp > 0)
+        {
+          g_ptr_array_add (added, new);
+          j++;
+        }
+      else if (app_info_unchanged (old, new))
+        {
+          flush_app_list_changes (store, &position, &n_removed, added);
+          position++;
+          i++;
+          j++;
+        }
+      else
+        {
+          n_removed++;
+          g_ptr_array_add (added, new);
+          i++;
+          j++;
+        }
+    }
+
+  flush_app_list_changes (store, &position, &n_removed, added);
+}
+
 char *
 get_app_id (GAppInfo *info)
 {
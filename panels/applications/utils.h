@@ -44,12 +44,28 @@ gboolean  file_size_finish     (GFile               *file,
                                 guint64             *size,
                                 GError             **error);
 
-GKeyFile* get_flatpak_metadata (const gchar         *app_id);
+void      get_flatpak_app_info_async  (const gchar         *app_id,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             data);
 
-guint64   get_flatpak_app_size (const gchar         *app_id);
+gboolean  get_flatpak_app_info_finish (GAsyncResult        *result,
+                                       GKeyFile           **metadata,
+                                       guint64             *installed_size,
+                                       GError             **error);
 
-guint64   get_snap_app_size    (const gchar         *snap_name);
+void      get_snap_app_size_async  (const gchar         *snap_name,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             data);
+
+gboolean  get_snap_app_size_finish (GAsyncResult        *result,
+                                    guint64             *size,
+                                    GError             **error);
 
 gchar*    get_app_id           (GAppInfo            *info);
 
+void      update_app_list      (GListStore          *store,
+                                GPtrArray           *infos);
+
 G_END_DECLS
@@ -0,0 +1,630 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* cc-permission-store.c
+ *
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "cc-permission-store"
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "cc-permission-store.h"
+#include "shell/cc-object-storage.h"
+
+#define PERMISSION_STORE_BUS_NAME "org.freedesktop.impl.portal.PermissionStore"
+#define PERMISSION_STORE_OBJECT_PATH "/org/freedesktop/impl/portal/PermissionStore"
+#define PERMISSION_STORE_NOT_FOUND "org.freedesktop.portal.Error.NotFound"
+
+/*
+ * A snapshot of the tables of the xdg-desktop-portal permission store,
+ * shared by the panels.
+ *
+ * Each table is looked up once, when first loaded, then kept up to date
+ * from the Changed signal of the store, so that the permissions of an
+ * app are read from memory. The snapshot is only ever updated from what
+ * the store says, changes made through this object included.
+ */
+
+typedef struct
+{
+  CcPermissionStore *self;
+
+  gchar     *table;
+  gchar     *id;
+
+  /* a{sas} and the data, NULL until loaded */
+  GVariant  *permissions;
+  GVariant  *data;
+
+  gboolean   loading;
+  GPtrArray *waiters;
+} Table;
+
+typedef struct
+{
+  guint   n_pending;
+  GError *error;
+} LoadData;
+
+struct _CcPermissionStore
+{
+  GObject     parent_instance;
+
+  GDBusProxy *proxy;
+  GError     *proxy_error;
+
+  /* "table\nid" → Table */
+  GHashTable *tables;
+};
+
+G_DEFINE_TYPE (CcPermissionStore, cc_permission_store, G_TYPE_OBJECT)
+
+enum
+{
+  CHANGED,
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+static void
+table_free (Table *table)
+{
+  g_free (table->table);
+  g_free (table->id);
+  g_clear_pointer (&table->permissions, g_variant_unref);
+  g_clear_pointer (&table->data, g_variant_unref);
+  g_ptr_array_unref (table->waiters);
+  g_free (table);
+}
+
+static void
+load_data_free (LoadData *data)
+{
+  g_clear_error (&data->error);
+  g_free (data);
+}
+
+static gchar *
+get_table_key (const gchar *table,
+               const gchar *id)
+{
+  return g_strconcat (table, "\n", id, NULL);
+}
+
+static Table *
+lookup_table (CcPermissionStore *self,
+              const gchar       *table,
+              const gchar       *id)
+{
+  g_autofree gchar *key = get_table_key (table, id);
+
+  return g_hash_table_lookup (self->tables, key);
+}
+
+static void
+table_set_contents (Table    *table,
+                    GVariant *permissions,
+                    GVariant *data)
+{
+  g_clear_pointer (&table->permissions, g_variant_unref);
+  table->permissions = g_variant_ref_sink (permissions);
+
+  g_clear_pointer (&table->data, g_variant_unref);
+  table->data = g_variant_ref_sink (data);
+}
+
+/* Complete the loads waiting for @table, with @error if it failed */
+static void
+table_loaded (Table        *table,
+              const GError *error)
+{
+  g_autoptr(GPtrArray) waiters = NULL;
+  guint i;
+
+  table->loading = FALSE;
+  waiters = g_steal_pointer (&table->waiters);
+  table->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < waiters->len; i++)
+    {
+      GTask *task = g_ptr_array_index (waiters, i);
+      LoadData *data = g_task_get_task_data (task);
+
+      if (error != NULL && data->error == NULL)
+        data->error = g_error_copy (error);
+
+      if (--data->n_pending > 0)
+        continue;
+
+      if (data->error != NULL)
+        g_task_return_error (task, g_steal_pointer (&data->error));
+      else
+        g_task_return_boolean (task, TRUE);
+    }
+}
+
+static void
+on_lookup_done (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  Table *table = user_data;
+  g_autoptr(CcPermissionStore) self = table->self;
+  g_autoptr(GVariant) ret = NULL;
+  g_autoptr(GVariant) permissions = NULL;
+  g_autoptr(GVariant) data = NULL;
+  g_autoptr(GError) error = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (ret != NULL)
+    {
+      g_variant_get (ret, "(@a{sas}v)", &permissions, &data);
+      table_set_contents (table, permissions, data);
+    }
+  else if (g_strcmp0 (g_dbus_error_get_remote_error (error), PERMISSION_STORE_NOT_FOUND) == 0)
+    {
+      /* Nothing was ever stored for this resource */
+      table_set_contents (table,
+                          g_variant_new_array (G_VARIANT_TYPE ("{sas}"), NULL, 0),
+                          g_variant_new_byte (0));
+      g_clear_error (&error);
+    }
+  else
+    {
+      g_dbus_error_strip_remote_error (error);
+    }
+
+  table_loaded (table, error);
+}
+
+static void
+table_lookup (CcPermissionStore *self,
+              Table             *table)
+{
+  table->loading = TRUE;
+
+  /* Tables live as long as the store, which the reference keeps alive */
+  g_object_ref (self);
+
+  g_dbus_proxy_call (self->proxy,
+                     "Lookup",
+                     g_variant_new ("(ss)", table->table, table->id),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     on_lookup_done,
+                     table);
+}
+
+static void
+on_changed (GDBusProxy *proxy,
+            gchar      *sender_name,
+            gchar      *signal_name,
+            GVariant   *parameters,
+            gpointer    user_data)
+{
+  CcPermissionStore *self = user_data;
+  g_autoptr(GVariant) permissions = NULL;
+  g_autoptr(GVariant) data = NULL;
+  const gchar *table_name, *id;
+  gboolean deleted;
+  Table *table;
+
+  if (g_strcmp0 (signal_name, "Changed") != 0)
+    return;
+
+  g_variant_get (parameters, "(&s&sbv@a{sas})", &table_name, &id, &deleted, &data, &permissions);
+
+  /* Loads in flight will get the new contents with their reply */
+  table = lookup_table (self, table_name, id);
+  if (table == NULL || table->permissions == NULL)
+    return;
+
+  if (deleted)
+    {
+      g_clear_pointer (&permissions, g_variant_unref);
+      permissions = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("{sas}"), NULL, 0));
+    }
+
+  table_set_contents (table, permissions, data);
+
+  g_signal_emit (self, signals[CHANGED], 0, table_name, id);
+}
+
+static void
+on_proxy_ready (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  g_autoptr(CcPermissionStore) self = user_data;
+  g_autoptr(GError) error = NULL;
+  GHashTableIter iter;
+  Table *table;
+
+  self->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+
+  if (self->proxy != NULL)
+    g_signal_connect_object (self->proxy, "g-signal", G_CALLBACK (on_changed), self, 0);
+  else
+    self->proxy_error = g_steal_pointer (&error);
+
+  g_hash_table_iter_init (&iter, self->tables);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &table))
+    {
+      if (table->waiters->len == 0)
+        continue;
+
+      if (self->proxy != NULL)
+        table_lookup (self, table);
+      else
+        table_loaded (table, self->proxy_error);
+    }
+}
+
+static void
+cc_permission_store_finalize (GObject *object)
+{
+  CcPermissionStore *self = CC_PERMISSION_STORE (object);
+
+  g_clear_object (&self->proxy);
+  g_clear_error (&self->proxy_error);
+  g_clear_pointer (&self->tables, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_permission_store_parent_class)->finalize (object);
+}
+
+static void
+cc_permission_store_constructed (GObject *object)
+{
+  CcPermissionStore *self = CC_PERMISSION_STORE (object);
+
+  G_OBJECT_CLASS (cc_permission_store_parent_class)->constructed (object);
+
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+                            NULL,
+                            PERMISSION_STORE_BUS_NAME,
+                            PERMISSION_STORE_OBJECT_PATH,
+                            PERMISSION_STORE_BUS_NAME,
+                            NULL,
+                            on_proxy_ready,
+                            g_object_ref (self));
+}
+
+static void
+cc_permission_store_class_init (CcPermissionStoreClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = cc_permission_store_constructed;
+  object_class->finalize = cc_permission_store_finalize;
+
+  /**
+   * CcPermissionStore::changed:
+   * @table: the name of the table
+   * @id: the id of the resource in the table
+   *
+   * Emitted when the permissions of a loaded resource changed.
+   */
+  signals[CHANGED] =
+    g_signal_new ("changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_STRING,
+                  G_TYPE_STRING);
+}
+
+static void
+cc_permission_store_init (CcPermissionStore *self)
+{
+  self->tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) table_free);
+}
+
+/**
+ * cc_permission_store_get_default:
+ *
+ * Returns: (transfer none): the permission store shared by the panels
+ */
+CcPermissionStore *
+cc_permission_store_get_default (void)
+{
+  g_autoptr(CcPermissionStore) self = NULL;
+
+  if (cc_object_storage_has_object (CC_OBJECT_PERMISSION_STORE))
+    {
+      self = cc_object_storage_get_object (CC_OBJECT_PERMISSION_STORE);
+    }
+  else
+    {
+      self = g_object_new (CC_TYPE_PERMISSION_STORE, NULL);
+      cc_object_storage_add_object (CC_OBJECT_PERMISSION_STORE, self);
+    }
+
+  return self;
+}
+
+/**
+ * cc_permission_store_load_async:
+ * @self: a #CcPermissionStore
+ * @tables: pairs of table and resource id, %NULL-terminated
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called once all the tables are loaded
+ * @user_data: data for @callback
+ *
+ * Loads the permissions of the given resources, the ones already
+ * loaded are not looked up again.
+ *
+ * If a resource fails to load, the load fails with the first such
+ * error once all the lookups are done. The other resources are loaded
+ * all the same, and the failed ones are looked up again by the next load.
+ */
+void
+cc_permission_store_load_async (CcPermissionStore    *self,
+                                const gchar * const  *tables,
+                                GCancellable         *cancellable,
+                                GAsyncReadyCallback   callback,
+                                gpointer              user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  LoadData *data;
+  guint i;
+
+  g_return_if_fail (CC_IS_PERMISSION_STORE (self));
+  g_return_if_fail (tables != NULL);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_permission_store_load_async);
+
+  data = g_new0 (LoadData, 1);
+  g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+
+  if (self->proxy_error != NULL)
+    {
+      g_task_return_error (task, g_error_copy (self->proxy_error));
+      return;
+    }
+
+  for (i = 0; tables[i] != NULL && tables[i + 1] != NULL; i += 2)
+    {
+      Table *table = lookup_table (self, tables[i], tables[i + 1]);
+
+      if (table == NULL)
+        {
+          table = g_new0 (Table, 1);
+          table->self = self;
+          table->table = g_strdup (tables[i]);
+          table->id = g_strdup (tables[i + 1]);
+          table->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+          g_hash_table_insert (self->tables, get_table_key (tables[i], tables[i + 1]), table);
+        }
+
+      if (table->permissions != NULL)
+        continue;
+
+      data->n_pending++;
+      g_ptr_array_add (table->waiters, g_object_ref (task));
+
+      /* Shared with the loads already asking for it */
+      if (self->proxy != NULL && !table->loading)
+        table_lookup (self, table);
+    }
+
+  if (data->n_pending == 0)
+    g_task_return_boolean (task, TRUE);
+}
+
+gboolean
+cc_permission_store_load_finish (CcPermissionStore  *self,
+                                 GAsyncResult       *result,
+                                 GError            **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * cc_permission_store_get_table:
+ * @self: a #CcPermissionStore
+ * @table: the name of the table
+ * @id: the id of the resource
+ * @data: (out) (optional) (transfer full): the data of the resource
+ *
+ * Returns: (transfer full) (nullable): the permissions of all the apps
+ *   for the resource, as `a{sas}`, or %NULL if it isn't loaded
+ */
+GVariant *
+cc_permission_store_get_table (CcPermissionStore  *self,
+                               const gchar        *table,
+                               const gchar        *id,
+                               GVariant          **data)
+{
+  Table *t;
+
+  g_return_val_if_fail (CC_IS_PERMISSION_STORE (self), NULL);
+
+  t = lookup_table (self, table, id);
+  if (t == NULL || t->permissions == NULL)
+    return NULL;
+
+  if (data != NULL)
+    *data = g_variant_ref (t->data);
+
+  return g_variant_ref (t->permissions);
+}
+
+/**
+ * cc_permission_store_get_permissions:
+ * @self: a #CcPermissionStore
+ * @table: the name of the table
+ * @id: the id of the resource
+ * @app_id: the app
+ *
+ * Returns: (transfer full) (nullable): the permissions of @app_id for
+ *   the resource, or %NULL if there are none
+ */
+GStrv
+cc_permission_store_get_permissions (CcPermissionStore *self,
+                                     const gchar       *table,
+                                     const gchar       *id,
+                                     const gchar       *app_id)
+{
+  g_autoptr(GVariant) permissions = NULL;
+  GStrv result = NULL;
+
+  g_return_val_if_fail (CC_IS_PERMISSION_STORE (self), NULL);
+
+  permissions = cc_permission_store_get_table (self, table, id, NULL);
+  if (permissions != NULL)
+    g_variant_lookup (permissions, app_id, "^as", &result);
+
+  return result;
+}
+
+static void
+on_set_permission_done (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  g_autoptr(GVariant) ret = NULL;
+  g_autoptr(GError) error = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (ret == NULL)
+    g_warning ("Error setting portal permissions: %s", error->message);
+}
+
+/**
+ * cc_permission_store_set_permission:
+ * @self: a #CcPermissionStore
+ * @table: the name of the table
+ * @id: the id of the resource
+ * @app_id: the app
+ * @permissions: the new permissions of @app_id
+ *
+ * Sets the permissions of an app for a resource, creating the table and
+ * the resource if needed. Errors are only logged.
+ */
+void
+cc_permission_store_set_permission (CcPermissionStore   *self,
+                                    const gchar         *table,
+                                    const gchar         *id,
+                                    const gchar         *app_id,
+                                    const gchar * const *permissions)
+{
+  g_return_if_fail (CC_IS_PERMISSION_STORE (self));
+
+  if (self->proxy == NULL)
+    {
+      g_warning ("Error setting portal permissions: not connected to the permission store");
+      return;
+    }
+
+  g_dbus_proxy_call (self->proxy,
+                     "SetPermission",
+                     g_variant_new ("(sbss^as)", table, TRUE, id, app_id, permissions),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     on_set_permission_done,
+                     NULL);
+}
+
+static void
+on_set_done (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GVariant) ret = NULL;
+  GError *error = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (ret == NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * cc_permission_store_set_async:
+ * @self: a #CcPermissionStore
+ * @table: the name of the table
+ * @id: the id of the resource
+ * @permissions: the permissions of all the apps, as `a{sas}`
+ * @data: the data of the resource
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called once the permissions are stored
+ * @user_data: data for @callback
+ *
+ * Replaces all the permissions of a resource.
+ */
+void
+cc_permission_store_set_async (CcPermissionStore   *self,
+                               const gchar         *table,
+                               const gchar         *id,
+                               GVariant            *permissions,
+                               GVariant            *data,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (CC_IS_PERMISSION_STORE (self));
+  g_return_if_fail (g_variant_is_of_type (permissions, G_VARIANT_TYPE ("a{sas}")));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_permission_store_set_async);
+
+  if (self->proxy == NULL)
+    {
+      /* Consumed like by g_variant_new() */
+      g_variant_unref (g_variant_ref_sink (permissions));
+      g_variant_unref (g_variant_ref_sink (data));
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                               "Not connected to the permission store");
+      return;
+    }
+
+  g_dbus_proxy_call (self->proxy,
+                     "Set",
+                     g_variant_new ("(sbs@a{sas}v)", table, TRUE, id, permissions, data),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     cancellable,
+                     on_set_done,
+                     g_steal_pointer (&task));
+}
+
+gboolean
+cc_permission_store_set_finish (CcPermissionStore  *self,
+                                GAsyncResult       *result,
+                                GError            **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
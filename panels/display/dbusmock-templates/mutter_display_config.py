@@ -0,0 +1,297 @@
+'''mutter DisplayConfig mock template
+
+This creates the expected methods, properties and signals of the main
+org.gnome.Mutter.DisplayConfig object, backed by a configurable set of
+virtual monitors.
+
+Parameters:
+  monitors:   number of connected monitors (default: 2)
+  modes:      number of modes per monitor (default: 8)
+  scales:     list of supported scales, may be fractional
+              (default: [1.0, 1.25, 1.5, 1.75, 2.0])
+  latency:    artificial delay in milliseconds added to every
+              GetCurrentState and ApplyMonitorsConfig call (default: 0)
+  layout-mode: 1 for logical, 2 for physical layout (default: 1)
+  builtin:    whether the first monitor is a built-in panel (default: True)
+'''
+
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU Lesser General Public License as published by the Free
+# Software Foundation; either version 3 of the License, or (at your option) any
+# later version.  See http://www.gnu.org/copyleft/lgpl.html for the full text
+# of the license.
+
+__copyright__ = '(c) 2024, GNOME Settings contributors'
+
+import time
+
+import dbus
+from dbusmock import MOCK_IFACE
+
+BUS_NAME = 'org.gnome.Mutter.DisplayConfig'
+MAIN_OBJ = '/org/gnome/Mutter/DisplayConfig'
+MAIN_IFACE = 'org.gnome.Mutter.DisplayConfig'
+SYSTEM_BUS = False
+
+METHOD_VERIFY = 0
+METHOD_TEMPORARY = 1
+METHOD_PERSISTENT = 2
+
+LAYOUT_MODE_LOGICAL = 1
+LAYOUT_MODE_PHYSICAL = 2
+
+RESOLUTIONS = [
+    (7680, 4320), (5120, 2880), (3840, 2160), (3440, 1440), (2880, 1800),
+    (2560, 1600), (2560, 1440), (2048, 1536), (1920, 1200), (1920, 1080),
+    (1680, 1050), (1600, 1200), (1440, 900), (1366, 768), (1280, 1024),
+    (1280, 800), (1280, 720), (1024, 768), (800, 600),
+]
+
+REFRESH_RATES = [240.0, 165.0, 144.0, 120.0, 75.0, 60.0, 59.94, 50.0]
+
+
+def mode_id(width, height, refresh):
+    return '%dx%d@%.3f' % (width, height, refresh)
+
+
+def supported_scales(width, height, scales):
+    # Only offer scales leaving a usable logical size, like mutter does
+    return [s for s in scales if width / s >= 800 and height / s >= 480]
+
+
+def generate_monitor(index, n_modes, scales, builtin):
+    connector = ('eDP-%d' if builtin else 'DP-%d') % (index + 1)
+    spec = (connector, 'MCK', 'Mock Monitor %d' % index, '%08d' % index)
+
+    modes = []
+    for i in range(n_modes):
+        width, height = RESOLUTIONS[(i // len(REFRESH_RATES)) % len(RESOLUTIONS)]
+        refresh = REFRESH_RATES[i % len(REFRESH_RATES)]
+        mode_scales = supported_scales(width, height, scales) or [1.0]
+        modes.append({
+            'id': mode_id(width, height, refresh),
+            'width': width,
+            'height': height,
+            'refresh': refresh,
+            'preferred-scale': mode_scales[0],
+            'scales': mode_scales,
+            'is-preferred': i == 0,
+        })
+
+    return {
+        'spec': spec,
+        'modes': modes,
+        'builtin': builtin,
+        'display-name': 'Built-in display' if builtin else 'Mock Display %d' % index,
+    }
+
+
+def default_logical_monitors(monitors):
+    logical_monitors = []
+    x = 0
+    for i, monitor in enumerate(monitors):
+        mode = monitor['modes'][0]
+        logical_monitors.append({
+            'x': x,
+            'y': 0,
+            'scale': mode['preferred-scale'],
+            'transform': 0,
+            'primary': i == 0,
+            'monitors': [(monitor['spec'][0], mode['id'])],
+        })
+        x += int(mode['width'] / mode['preferred-scale'])
+    return logical_monitors
+
+
+def find_monitor(mock, connector):
+    for monitor in mock.monitors:
+        if monitor['spec'][0] == connector:
+            return monitor
+    return None
+
+
+def find_mode(monitor, mode_id):
+    for mode in monitor['modes']:
+        if mode['id'] == mode_id:
+            return mode
+    return None
+
+
+def simulate_latency(mock):
+    if mock.latency > 0:
+        time.sleep(mock.latency / 1000.0)
+
+
+def build_current_modes(mock):
+    current = {}
+    for logical_monitor in mock.logical_monitors:
+        for connector, mode in logical_monitor['monitors']:
+            current[connector] = mode
+    return current
+
+
+def load(mock, parameters):
+    mock.latency = float(parameters.get('latency', 0))
+    mock.layout_mode = int(parameters.get('layout-mode', LAYOUT_MODE_LOGICAL))
+    mock.serial = 1
+
+    n_monitors = int(parameters.get('monitors', 2))
+    n_modes = int(parameters.get('modes', 8))
+    scales = [float(s) for s in parameters.get('scales', [1.0, 1.25, 1.5, 1.75, 2.0])]
+    builtin = bool(parameters.get('builtin', True))
+
+    mock.monitors = [generate_monitor(i, n_modes, scales, builtin and i == 0)
+                     for i in range(n_monitors)]
+    mock.logical_monitors = default_logical_monitors(mock.monitors)
+
+    mock.AddProperties(MAIN_IFACE, dbus.Dictionary({
+        'PowerSaveMode': dbus.Int32(0),
+        'PanelOrientationManaged': dbus.Boolean(False),
+        'ApplyMonitorsConfigAllowed': dbus.Boolean(True),
+        'NightLightSupported': dbus.Boolean(True),
+    }, signature='sv'))
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='',
+                     out_signature='ua((ssss)a(siiddada{sv})a{sv})a(iiduba(ssss)a{sv})a{sv}')
+def GetCurrentState(self):
+    simulate_latency(self)
+
+    current = build_current_modes(self)
+
+    monitors = []
+    for monitor in self.monitors:
+        connector = monitor['spec'][0]
+        modes = []
+        for mode in monitor['modes']:
+            props = {}
+            if mode['is-preferred']:
+                props['is-preferred'] = dbus.Boolean(True)
+            if current.get(connector) == mode['id']:
+                props['is-current'] = dbus.Boolean(True)
+            modes.append(dbus.Struct((mode['id'],
+                                      dbus.Int32(mode['width']),
+                                      dbus.Int32(mode['height']),
+                                      dbus.Double(mode['refresh']),
+                                      dbus.Double(mode['preferred-scale']),
+                                      dbus.Array(mode['scales'], signature='d'),
+                                      dbus.Dictionary(props, signature='sv'))))
+        monitors.append(dbus.Struct((dbus.Struct(monitor['spec']),
+                                     dbus.Array(modes, signature='(siiddada{sv})'),
+                                     dbus.Dictionary({
+                                         'is-builtin': dbus.Boolean(monitor['builtin']),
+                                         'display-name': dbus.String(monitor['display-name']),
+                                         'width-mm': dbus.Int32(600),
+                                         'height-mm': dbus.Int32(340),
+                                     }, signature='sv'))))
+
+    logical_monitors = []
+    for logical_monitor in self.logical_monitors:
+        specs = [dbus.Struct(find_monitor(self, connector)['spec'])
+                 for connector, _ in logical_monitor['monitors']]
+        logical_monitors.append(dbus.Struct((dbus.Int32(logical_monitor['x']),
+                                             dbus.Int32(logical_monitor['y']),
+                                             dbus.Double(logical_monitor['scale']),
+                                             dbus.UInt32(logical_monitor['transform']),
+                                             dbus.Boolean(logical_monitor['primary']),
+                                             dbus.Array(specs, signature='(ssss)'),
+                                             dbus.Dictionary({}, signature='sv'))))
+
+    props = {
+        'layout-mode': dbus.UInt32(self.layout_mode),
+        'supports-changing-layout-mode': dbus.Boolean(True),
+        'supports-mirroring': dbus.Boolean(True),
+        'global-scale-required': dbus.Boolean(False),
+    }
+
+    return (dbus.UInt32(self.serial),
+            dbus.Array(monitors, signature='((ssss)a(siiddada{sv})a{sv})'),
+            dbus.Array(logical_monitors, signature='(iiduba(ssss)a{sv})'),
+            dbus.Dictionary(props, signature='sv'))
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='uua(iiduba(ssa{sv}))a{sv}', out_signature='')
+def ApplyMonitorsConfig(self, serial, method, logical_monitors, properties):
+    simulate_latency(self)
+
+    if serial != self.serial:
+        raise dbus.exceptions.DBusException('The requested configuration is based on stale information',
+                                            name='org.freedesktop.DBus.Error.AccessDenied')
+
+    if method not in (METHOD_VERIFY, METHOD_TEMPORARY, METHOD_PERSISTENT):
+        raise dbus.exceptions.DBusException('Invalid method',
+                                            name='org.freedesktop.DBus.Error.InvalidArgs')
+
+    new_logical_monitors = []
+    has_primary = False
+    for (x, y, scale, transform, primary, monitors) in [lm[:6] for lm in logical_monitors]:
+        if not monitors:
+            raise dbus.exceptions.DBusException('Empty logical monitor',
+                                                name='org.freedesktop.DBus.Error.InvalidArgs')
+        assigned = []
+        for (connector, mode_id_, _props) in monitors:
+            monitor = find_monitor(self, str(connector))
+            if monitor is None:
+                raise dbus.exceptions.DBusException('Invalid connector %s' % connector,
+                                                    name='org.freedesktop.DBus.Error.InvalidArgs')
+            mode = find_mode(monitor, str(mode_id_))
+            if mode is None:
+                raise dbus.exceptions.DBusException('Invalid mode %s for %s' % (mode_id_, connector),
+                                                    name='org.freedesktop.DBus.Error.InvalidArgs')
+            if not any(abs(s - scale) < 1e-4 for s in mode['scales']):
+                raise dbus.exceptions.DBusException('Scale %f not valid for %s' % (scale, mode_id_),
+                                                    name='org.freedesktop.DBus.Error.InvalidArgs')
+            assigned.append((str(connector), str(mode_id_)))
+
+        has_primary = has_primary or bool(primary)
+        new_logical_monitors.append({
+            'x': int(x),
+            'y': int(y),
+            'scale': float(scale),
+            'transform': int(transform),
+            'primary': bool(primary),
+            'monitors': assigned,
+        })
+
+    if new_logical_monitors and not has_primary:
+        raise dbus.exceptions.DBusException('No primary monitor',
+                                            name='org.freedesktop.DBus.Error.InvalidArgs')
+
+    if method == METHOD_VERIFY:
+        return
+
+    if 'layout-mode' in properties:
+        self.layout_mode = int(properties['layout-mode'])
+
+    self.logical_monitors = new_logical_monitors
+    self.serial += 1
+    self.EmitSignal(MAIN_IFACE, 'MonitorsChanged', '', [])
+
+
+@dbus.service.method(MOCK_IFACE, in_signature='d', out_signature='')
+def SetLatency(self, latency):
+    '''Set the artificial delay in milliseconds of each DisplayConfig call'''
+    self.latency = latency
+
+
+@dbus.service.method(MOCK_IFACE, in_signature='uu', out_signature='')
+def SetMonitors(self, n_monitors, n_modes):
+    '''Replace all monitors, as if they had been hotplugged
+
+    Resets the layout to a horizontal row and emits MonitorsChanged.
+    '''
+    scales = sorted({s for m in self.monitors for mode in m['modes'] for s in mode['scales']}) or [1.0]
+    builtin = bool(self.monitors and self.monitors[0]['builtin'])
+
+    self.monitors = [generate_monitor(i, n_modes, scales, builtin and i == 0)
+                     for i in range(n_monitors)]
+    self.logical_monitors = default_logical_monitors(self.monitors)
+    self.serial += 1
+    self.EmitSignal(MAIN_IFACE, 'MonitorsChanged', '', [])
+
+
+@dbus.service.method(MOCK_IFACE, in_signature='', out_signature='')
+def EmitMonitorsChanged(self):
+    '''Emit MonitorsChanged without altering the configuration'''
+    self.serial += 1
+    self.EmitSignal(MAIN_IFACE, 'MonitorsChanged', '', [])
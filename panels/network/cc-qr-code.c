@@ -43,22 +43,119 @@
 
 #define BYTES_PER_R8G8B8 3
 
+/* Recently shown codes, so that reopening a dialog doesn't encode again */
+#define TEXTURE_CACHE_SIZE 4
+
 struct _CcQrCode
+{
+  GObject       parent_instance;
+
+  gchar        *text;
+  /* One pixel per module, scaled up when drawn */
+  GdkTexture   *texture;
+  GdkPaintable *paintable;
+  gint          size;
+};
+
+G_DEFINE_TYPE (CcQrCode, cc_qr_code, G_TYPE_OBJECT)
+
+/*
+ * Draws the module texture scaled by a whole number, without smoothing
+ * the edges of the modules.
+ */
+#define CC_TYPE_QR_CODE_PAINTABLE (cc_qr_code_paintable_get_type ())
+G_DECLARE_FINAL_TYPE (CcQrCodePaintable, cc_qr_code_paintable, CC, QR_CODE_PAINTABLE, GObject)
+
+struct _CcQrCodePaintable
 {
   GObject     parent_instance;
 
-  gchar      *text;
   GdkTexture *texture;
   gint        size;
 };
 
-G_DEFINE_TYPE (CcQrCode, cc_qr_code, G_TYPE_OBJECT)
+static void cc_qr_code_paintable_iface_init (GdkPaintableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (CcQrCodePaintable, cc_qr_code_paintable, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE, cc_qr_code_paintable_iface_init))
+
+static void
+cc_qr_code_paintable_snapshot (GdkPaintable *paintable,
+                               GdkSnapshot  *snapshot,
+                               gdouble       width,
+                               gdouble       height)
+{
+  CcQrCodePaintable *self = CC_QR_CODE_PAINTABLE (paintable);
+
+  gtk_snapshot_append_scaled_texture (GTK_SNAPSHOT (snapshot),
+                                      self->texture,
+                                      GSK_SCALING_FILTER_NEAREST,
+                                      &GRAPHENE_RECT_INIT (0, 0, width, height));
+}
+
+static gint
+cc_qr_code_paintable_get_intrinsic_size (GdkPaintable *paintable)
+{
+  return CC_QR_CODE_PAINTABLE (paintable)->size;
+}
+
+static GdkPaintableFlags
+cc_qr_code_paintable_get_flags (GdkPaintable *paintable)
+{
+  return GDK_PAINTABLE_STATIC_SIZE | GDK_PAINTABLE_STATIC_CONTENTS;
+}
+
+static void
+cc_qr_code_paintable_iface_init (GdkPaintableInterface *iface)
+{
+  iface->snapshot = cc_qr_code_paintable_snapshot;
+  iface->get_intrinsic_width = cc_qr_code_paintable_get_intrinsic_size;
+  iface->get_intrinsic_height = cc_qr_code_paintable_get_intrinsic_size;
+  iface->get_flags = cc_qr_code_paintable_get_flags;
+}
+
+static void
+cc_qr_code_paintable_finalize (GObject *object)
+{
+  CcQrCodePaintable *self = CC_QR_CODE_PAINTABLE (object);
+
+  g_clear_object (&self->texture);
+
+  G_OBJECT_CLASS (cc_qr_code_paintable_parent_class)->finalize (object);
+}
+
+static void
+cc_qr_code_paintable_class_init (CcQrCodePaintableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_qr_code_paintable_finalize;
+}
+
+static void
+cc_qr_code_paintable_init (CcQrCodePaintable *self)
+{
+}
+
+static GdkPaintable *
+cc_qr_code_paintable_new (GdkTexture *texture,
+                          gint        size)
+{
+  CcQrCodePaintable *self;
+
+  self = g_object_new (CC_TYPE_QR_CODE_PAINTABLE, NULL);
+  self->texture = g_object_ref (texture);
+  self->size = size;
+
+  return GDK_PAINTABLE (self);
+}
 
 static void
 cc_qr_code_finalize (GObject *object)
 {
   CcQrCode *self = (CcQrCode *) object;
 
+  g_clear_object (&self->paintable);
   g_clear_object (&self->texture);
   g_clear_pointer (&self->text, g_free);
 
@@ -94,6 +191,7 @@ cc_qr_code_set_text (CcQrCode    *self,
   if (g_strcmp0 (text, self->text) == 0)
     return FALSE;
 
+  g_clear_object (&self->paintable);
   g_clear_object (&self->texture);
   g_free (self->text);
   self->text = g_strdup (text);
@@ -101,32 +199,98 @@ cc_qr_code_set_text (CcQrCode    *self,
   return TRUE;
 }
 
-static void
-cc_fill_pixel (GByteArray *array,
-               guint8     value,
-               int        pixel_size)
+static GdkTexture *
+render_modules (const uint8_t *qr_code)
+{
+  g_autoptr(GBytes) bytes = NULL;
+  guint8 *pixels;
+  gint qr_size, stride;
+  gint x, y;
+
+  qr_size = qrcodegen_getSize (qr_code);
+  stride = qr_size * BYTES_PER_R8G8B8;
+  pixels = g_malloc (stride * qr_size);
+
+  for (y = 0; y < qr_size; y++)
+    {
+      guint8 *row = pixels + y * stride;
+
+      memset (row, 0xff, stride);
+      for (x = 0; x < qr_size; x++)
+        {
+          if (qrcodegen_getModule (qr_code, x, y))
+            memset (row + x * BYTES_PER_R8G8B8, 0x00, BYTES_PER_R8G8B8);
+        }
+    }
+
+  bytes = g_bytes_new_take (pixels, stride * qr_size);
+
+  return gdk_memory_texture_new (qr_size, qr_size, GDK_MEMORY_R8G8B8, bytes, stride);
+}
+
+static GdkTexture *
+encode_text (const gchar *text)
+{
+  uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+  uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+
+  if (!qrcodegen_encodeText (text,
+                             temp_buf,
+                             qr_code,
+                             qrcodegen_Ecc_LOW,
+                             qrcodegen_VERSION_MIN,
+                             qrcodegen_VERSION_MAX,
+                             qrcodegen_Mask_AUTO,
+                             FALSE))
+    return NULL;
+
+  return render_modules (qr_code);
+}
+
+static GdkTexture *
+lookup_texture (const gchar *text)
 {
-  guint i;
+  static GHashTable *cache = NULL;
+  static GQueue recent = G_QUEUE_INIT;
+  g_autofree gchar *key = NULL;
+  GdkTexture *texture;
+  GList *link;
 
-  for (i = 0; i < pixel_size; i++)
+  if (!cache)
+    cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+  /* The payload may hold a Wi-Fi password, so only keep its checksum */
+  key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, text, -1);
+
+  texture = g_hash_table_lookup (cache, key);
+  if (texture)
     {
-      g_byte_array_append (array, &value, 1); /* R */
-      g_byte_array_append (array, &value, 1); /* G */
-      g_byte_array_append (array, &value, 1); /* B */
+      link = g_queue_find_custom (&recent, key, (GCompareFunc) g_strcmp0);
+      g_queue_unlink (&recent, link);
+      g_queue_push_head_link (&recent, link);
+      return g_object_ref (texture);
     }
+
+  texture = encode_text (text);
+  if (!texture)
+    return NULL;
+
+  if (g_queue_get_length (&recent) == TEXTURE_CACHE_SIZE)
+    g_hash_table_remove (cache, g_queue_pop_tail (&recent));
+
+  link = g_list_alloc ();
+  link->data = g_steal_pointer (&key);
+  g_queue_push_head_link (&recent, link);
+  g_hash_table_insert (cache, link->data, g_object_ref (texture));
+
+  return texture;
 }
 
 GdkPaintable *
 cc_qr_code_get_paintable (CcQrCode *self,
                           gint      size)
 {
-  uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
-  uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
-  g_autoptr (GBytes) bytes = NULL;
-  GByteArray *qr_matrix;
-  gint pixel_size, qr_size, total_size;
-  gint column, row, i;
-  gboolean success = FALSE;
+  gint pixel_size, qr_size;
 
   g_return_val_if_fail (CC_IS_QR_CODE (self), NULL);
   g_return_val_if_fail (size > 0, NULL);
@@ -137,52 +301,24 @@ cc_qr_code_get_paintable (CcQrCode *self,
       cc_qr_code_set_text (self, "invalid text");
     }
 
-  if (self->texture && self->size == size)
-    return GDK_PAINTABLE (self->texture);
+  if (self->paintable && self->size == size)
+    return self->paintable;
 
-  self->size = size;
-
-  success = qrcodegen_encodeText (self->text,
-                                  temp_buf,
-                                  qr_code,
-                                  qrcodegen_Ecc_LOW,
-                                  qrcodegen_VERSION_MIN,
-                                  qrcodegen_VERSION_MAX,
-                                  qrcodegen_Mask_AUTO,
-                                  FALSE);
+  if (!self->texture)
+    self->texture = lookup_texture (self->text);
 
-  if (!success)
+  if (!self->texture)
     return NULL;
 
-  qr_size = qrcodegen_getSize (qr_code);
-  pixel_size = MAX (1, size / (qr_size));
-  total_size = qr_size * pixel_size;
-  qr_matrix = g_byte_array_sized_new (total_size * total_size * pixel_size * BYTES_PER_R8G8B8);
+  /* Only whole pixels per module keep the code sharp */
+  qr_size = gdk_texture_get_width (self->texture);
+  pixel_size = MAX (1, size / qr_size);
 
-  for (column = 0; column < total_size; column++)
-    {
-      for (i = 0; i < pixel_size; i++)
-        {
-          for (row = 0; row < total_size / pixel_size; row++)
-            {
-              if (qrcodegen_getModule (qr_code, column, row))
-                cc_fill_pixel (qr_matrix, 0x00, pixel_size);
-              else
-                cc_fill_pixel (qr_matrix, 0xff, pixel_size);
-            }
-        }
-    }
-
-  bytes = g_byte_array_free_to_bytes (qr_matrix);
-
-  g_clear_object (&self->texture);
-  self->texture = gdk_memory_texture_new (total_size,
-                                          total_size,
-                                          GDK_MEMORY_R8G8B8,
-                                          bytes,
-                                          total_size * BYTES_PER_R8G8B8);
+  self->size = size;
+  g_clear_object (&self->paintable);
+  self->paintable = cc_qr_code_paintable_new (self->texture, qr_size * pixel_size);
 
-  return GDK_PAINTABLE (self->texture);
+  return self->paintable;
 }
 
 static gchar *
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "cc-wifi-connection-index.h"
+
+/*
+ * Connections are bucketed by their SSID and the kind of security they
+ * use, so that only the few connections an AP could possibly be used
+ * with need to go through nm_access_point_connection_valid().
+ *
+ * The security of an AP is mapped generously, the final check is still
+ * done by libnm, so a bucket too many only costs a lookup.
+ */
+
+typedef enum
+{
+  SECURITY_UNKNOWN    = 1 << 0,
+  SECURITY_NONE       = 1 << 1,
+  SECURITY_WEP        = 1 << 2,
+  SECURITY_PSK        = 1 << 3,
+  SECURITY_SAE        = 1 << 4,
+  SECURITY_ENTERPRISE = 1 << 5,
+  SECURITY_OWE        = 1 << 6,
+} Security;
+
+#define SECURITY_WPA_ANY (SECURITY_PSK | SECURITY_SAE | SECURITY_ENTERPRISE | SECURITY_OWE)
+
+struct _CcWifiConnectionIndex
+{
+  /* Key → GPtrArray of NMConnection, not owning the connections */
+  GHashTable *buckets;
+  /* NMConnection → key, NULL for connections without an SSID */
+  GHashTable *keys;
+};
+
+static Security
+get_connection_security (NMConnection *connection)
+{
+  NMSettingWirelessSecurity *s_wsec;
+  const gchar *key_mgmt;
+
+  s_wsec = nm_connection_get_setting_wireless_security (connection);
+  if (!s_wsec)
+    return SECURITY_NONE;
+
+  key_mgmt = nm_setting_wireless_security_get_key_mgmt (s_wsec);
+
+  /* Static and dynamic WEP */
+  if (g_strcmp0 (key_mgmt, "none") == 0 ||
+      g_strcmp0 (key_mgmt, "ieee8021x") == 0)
+    return SECURITY_WEP;
+  if (g_strcmp0 (key_mgmt, "wpa-psk") == 0)
+    return SECURITY_PSK;
+  if (g_strcmp0 (key_mgmt, "sae") == 0)
+    return SECURITY_SAE;
+  if (g_strcmp0 (key_mgmt, "wpa-eap") == 0 ||
+      g_strcmp0 (key_mgmt, "wpa-eap-suite-b-192") == 0)
+    return SECURITY_ENTERPRISE;
+  if (g_strcmp0 (key_mgmt, "owe") == 0)
+    return SECURITY_OWE;
+
+  return SECURITY_UNKNOWN;
+}
+
+static Security
+get_access_point_security (NMAccessPoint *ap)
+{
+  NM80211ApFlags flags = nm_access_point_get_flags (ap);
+  NM80211ApSecurityFlags key_flags;
+  Security security = SECURITY_UNKNOWN;
+
+  key_flags = nm_access_point_get_wpa_flags (ap) | nm_access_point_get_rsn_flags (ap);
+
+  if (key_flags == NM_802_11_AP_SEC_NONE)
+    return security | ((flags & NM_802_11_AP_FLAGS_PRIVACY) ? SECURITY_WEP : SECURITY_NONE);
+
+  /* Some WPA APs still allow WEP */
+  if (flags & NM_802_11_AP_FLAGS_PRIVACY)
+    security |= SECURITY_WEP;
+
+  if (key_flags & NM_802_11_AP_SEC_KEY_MGMT_PSK)
+    security |= SECURITY_PSK;
+  if (key_flags & NM_802_11_AP_SEC_KEY_MGMT_SAE)
+    security |= SECURITY_SAE;
+  if (key_flags & (NM_802_11_AP_SEC_KEY_MGMT_802_1X | NM_802_11_AP_SEC_KEY_MGMT_EAP_SUITE_B_192))
+    security |= SECURITY_ENTERPRISE;
+  if (key_flags & NM_802_11_AP_SEC_KEY_MGMT_OWE)
+    security |= SECURITY_OWE;
+  if (key_flags & NM_802_11_AP_SEC_KEY_MGMT_OWE_TM)
+    security |= SECURITY_OWE | SECURITY_NONE;
+
+  /* Only ciphers, no key management we know about */
+  if ((security & SECURITY_WPA_ANY) == 0)
+    security |= SECURITY_WPA_ANY;
+
+  return security;
+}
+
+static GBytes *
+make_key (Security  security,
+          GBytes   *ssid)
+{
+  const guint8 *data;
+  guint8 *key;
+  gsize size;
+
+  data = g_bytes_get_data (ssid, &size);
+
+  key = g_malloc (size + 1);
+  key[0] = (guint8) g_bit_nth_lsf (security, -1);
+  memcpy (key + 1, data, size);
+
+  return g_bytes_new_take (key, size + 1);
+}
+
+static GBytes *
+get_connection_key (NMConnection *connection)
+{
+  NMSettingWireless *s_wifi;
+  GBytes *ssid;
+
+  s_wifi = nm_connection_get_setting_wireless (connection);
+  if (!s_wifi)
+    return NULL;
+
+  /* Such a connection can't match any AP */
+  ssid = nm_setting_wireless_get_ssid (s_wifi);
+  if (!ssid)
+    return NULL;
+
+  return make_key (get_connection_security (connection), ssid);
+}
+
+static void
+insert (CcWifiConnectionIndex *self,
+        NMConnection          *connection,
+        GBytes                *key)
+{
+  GPtrArray *bucket;
+
+  g_hash_table_insert (self->keys, g_object_ref (connection), key ? g_bytes_ref (key) : NULL);
+
+  if (!key)
+    return;
+
+  bucket = g_hash_table_lookup (self->buckets, key);
+  if (!bucket)
+    {
+      bucket = g_ptr_array_new ();
+      g_hash_table_insert (self->buckets, g_bytes_ref (key), bucket);
+    }
+
+  g_ptr_array_add (bucket, connection);
+}
+
+static void
+remove_from_bucket (CcWifiConnectionIndex *self,
+                    NMConnection          *connection,
+                    GBytes                *key)
+{
+  GPtrArray *bucket;
+
+  if (!key)
+    return;
+
+  bucket = g_hash_table_lookup (self->buckets, key);
+  g_assert (bucket != NULL);
+
+  g_ptr_array_remove_fast (bucket, connection);
+  if (bucket->len == 0)
+    g_hash_table_remove (self->buckets, key);
+}
+
+CcWifiConnectionIndex *
+cc_wifi_connection_index_new (void)
+{
+  CcWifiConnectionIndex *self;
+
+  self = g_new0 (CcWifiConnectionIndex, 1);
+  self->buckets = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                         (GDestroyNotify) g_bytes_unref,
+                                         (GDestroyNotify) g_ptr_array_unref);
+  self->keys = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                      g_object_unref,
+                                      (GDestroyNotify) g_bytes_unref);
+
+  return self;
+}
+
+void
+cc_wifi_connection_index_free (CcWifiConnectionIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_clear_pointer (&self->buckets, g_hash_table_unref);
+  g_clear_pointer (&self->keys, g_hash_table_unref);
+  g_free (self);
+}
+
+void
+cc_wifi_connection_index_add (CcWifiConnectionIndex *self,
+                              NMConnection          *connection)
+{
+  g_autoptr(GBytes) key = NULL;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (NM_IS_CONNECTION (connection));
+
+  if (g_hash_table_contains (self->keys, connection))
+    return;
+
+  key = get_connection_key (connection);
+  insert (self, connection, key);
+}
+
+void
+cc_wifi_connection_index_remove (CcWifiConnectionIndex *self,
+                                 NMConnection          *connection)
+{
+  GBytes *key;
+
+  g_return_if_fail (self != NULL);
+
+  if (!g_hash_table_lookup_extended (self->keys, connection, NULL, (gpointer*) &key))
+    return;
+
+  remove_from_bucket (self, connection, key);
+  g_hash_table_remove (self->keys, connection);
+}
+
+/**
+ * cc_wifi_connection_index_update:
+ *
+ * Re-indexes @connection after its settings changed.
+ *
+ * Returns: %TRUE if the SSID or security of @connection changed, in
+ *   which case the APs it matches may have changed as well.
+ */
+gboolean
+cc_wifi_connection_index_update (CcWifiConnectionIndex *self,
+                                 NMConnection          *connection)
+{
+  g_autoptr(GBytes) key = NULL;
+  GBytes *old_key;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+
+  if (!g_hash_table_lookup_extended (self->keys, connection, NULL, (gpointer*) &old_key))
+    return FALSE;
+
+  key = get_connection_key (connection);
+  if (key == old_key || (key && old_key && g_bytes_equal (key, old_key)))
+    return FALSE;
+
+  remove_from_bucket (self, connection, old_key);
+  insert (self, connection, key);
+
+  return TRUE;
+}
+
+void
+cc_wifi_connection_index_remove_all (CcWifiConnectionIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_hash_table_remove_all (self->buckets);
+  g_hash_table_remove_all (self->keys);
+}
+
+/**
+ * cc_wifi_connection_index_lookup:
+ *
+ * Finds the connections which are valid for @ap, like
+ * nm_access_point_filter_connections() does for a list of connections.
+ *
+ * Returns: (transfer full): the connections matching @ap
+ */
+GPtrArray *
+cc_wifi_connection_index_lookup (CcWifiConnectionIndex *self,
+                                 NMAccessPoint         *ap)
+{
+  GPtrArray *result;
+  GBytes *ssid;
+  Security security;
+  guint bit;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (NM_IS_ACCESS_POINT (ap), NULL);
+
+  result = g_ptr_array_new_with_free_func (g_object_unref);
+
+  ssid = nm_access_point_get_ssid (ap);
+  if (!ssid)
+    return result;
+
+  security = get_access_point_security (ap);
+
+  for (bit = 0; (1u << bit) <= security; bit++)
+    {
+      g_autoptr(GBytes) key = NULL;
+      GPtrArray *bucket;
+
+      if (!(security & (1u << bit)))
+        continue;
+
+      key = make_key (1u << bit, ssid);
+      bucket = g_hash_table_lookup (self->buckets, key);
+      if (!bucket)
+        continue;
+
+      for (i = 0; i < bucket->len; i++)
+        {
+          NMConnection *connection = g_ptr_array_index (bucket, i);
+
+          if (nm_access_point_connection_valid (ap, connection))
+            g_ptr_array_add (result, g_object_ref (connection));
+        }
+    }
+
+  return result;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <NetworkManager.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcWifiConnectionIndex CcWifiConnectionIndex;
+
+CcWifiConnectionIndex *cc_wifi_connection_index_new        (void);
+void                   cc_wifi_connection_index_free       (CcWifiConnectionIndex *self);
+
+void                   cc_wifi_connection_index_add        (CcWifiConnectionIndex *self,
+                                                            NMConnection          *connection);
+void                   cc_wifi_connection_index_remove     (CcWifiConnectionIndex *self,
+                                                            NMConnection          *connection);
+gboolean               cc_wifi_connection_index_update     (CcWifiConnectionIndex *self,
+                                                            NMConnection          *connection);
+void                   cc_wifi_connection_index_remove_all (CcWifiConnectionIndex *self);
+
+GPtrArray             *cc_wifi_connection_index_lookup     (CcWifiConnectionIndex *self,
+                                                            NMAccessPoint         *ap);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcWifiConnectionIndex, cc_wifi_connection_index_free)
+
+G_END_DECLS
@@ -15,6 +15,7 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "cc-wifi-connection-index.h"
 #include "cc-wifi-connection-list.h"
 #include "cc-wifi-connection-row.h"
 
@@ -40,6 +41,9 @@ struct _CcWifiConnectionList
   GPtrArray     *connections;
   GPtrArray     *connections_row;
 
+  /* Connections by SSID and security, to find the ones matching an AP */
+  CcWifiConnectionIndex *connections_index;
+
   /* AP SSID cache stores the APs SSID used for assigning it to a row.
    * This is necessary to efficiently remove it when its SSID changes.
    *
@@ -51,6 +55,10 @@ struct _CcWifiConnectionList
    */
   GHashTable    *ap_ssid_cache;
   GHashTable    *ssid_to_row;
+
+  /* Rows with APs whose strength changed, updated once per frame */
+  GHashTable    *strength_changed;
+  guint          strength_tick_id;
 };
 
 static void on_device_ap_added_cb   (CcWifiConnectionList *self,
@@ -59,6 +67,12 @@ static void on_device_ap_added_cb   (CcWifiConnectionList *self,
 static void on_device_ap_removed_cb (CcWifiConnectionList *self,
                                      NMAccessPoint        *ap,
                                      NMDeviceWifi         *device);
+static void assign_access_point     (CcWifiConnectionList *self,
+                                     NMAccessPoint        *ap);
+static void unassign_access_point   (CcWifiConnectionList *self,
+                                     NMAccessPoint        *ap);
+static void on_connection_changed_cb (CcWifiConnectionList *self,
+                                     NMConnection         *connection);
 static void on_row_configured_cb    (CcWifiConnectionList *self,
                                      CcWifiConnectionRow  *row);
 static void on_row_forget_cb        (CcWifiConnectionList *self,
@@ -183,7 +197,12 @@ clear_widget (CcWifiConnectionList *self)
       gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
     }
 
+  for (i = 0; i < self->connections->len; i++)
+    g_signal_handlers_disconnect_by_data (g_ptr_array_index (self->connections, i), self);
+
   /* Reset the internal state */
+  g_hash_table_remove_all (self->strength_changed);
+  cc_wifi_connection_index_remove_all (self->connections_index);
   g_ptr_array_set_size (self->connections, 0);
   g_ptr_array_set_size (self->connections_row, 0);
   g_hash_table_remove_all (self->ssid_to_row);
@@ -191,16 +210,167 @@ clear_widget (CcWifiConnectionList *self)
 }
 
 static void
-update_connections (CcWifiConnectionList *self)
+remove_row (CcWifiConnectionList *self,
+            CcWifiConnectionRow  *row)
+{
+  g_hash_table_remove (self->strength_changed, row);
+  g_signal_emit_by_name (self, "remove-row", row);
+  gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+}
+
+static NMConnection *
+get_active_connection (CcWifiConnectionList *self)
+{
+  NMActiveConnection *ac;
+
+  ac = nm_device_get_active_connection (NM_DEVICE (self->device));
+  if (!ac)
+    return NULL;
+
+  return NM_CONNECTION (nm_active_connection_get_connection (ac));
+}
+
+static gboolean
+ap_matches_connection (CcWifiConnectionList *self,
+                       NMAccessPoint        *ap,
+                       NMConnection         *connection,
+                       NMConnection         *ac_con)
+{
+  /* See assign_access_point() for why the active AP is special */
+  if (connection == ac_con && ap == nm_device_wifi_get_active_access_point (self->device))
+    return TRUE;
+
+  return nm_access_point_connection_valid (ap, connection);
+}
+
+/* Adds a connection, moving the APs it matches from their SSID rows to it */
+static void
+add_connection (CcWifiConnectionList *self,
+                NMConnection         *connection,
+                NMConnection         *ac_con)
 {
   const GPtrArray *aps;
+  CcWifiConnectionRow *row = NULL;
+  guint idx;
+  guint i;
+
+  if (!self->hide_unavailable || connection == ac_con)
+    row = cc_wifi_connection_list_row_add (self, connection, NULL, TRUE);
+
+  idx = self->connections->len;
+  g_ptr_array_add (self->connections, g_object_ref (connection));
+  g_ptr_array_add (self->connections_row, row);
+  cc_wifi_connection_index_add (self->connections_index, connection);
+
+  if (NM_IS_REMOTE_CONNECTION (connection))
+    g_signal_connect_object (connection, "changed",
+                             G_CALLBACK (on_connection_changed_cb),
+                             self, G_CONNECT_SWAPPED);
+
+  aps = nm_device_wifi_get_access_points (self->device);
+  for (i = 0; i < aps->len; i++)
+    {
+      NMAccessPoint *ap = g_ptr_array_index (aps, i);
+      g_autoptr(GBytes) ssid = NULL;
+
+      if (!ap_matches_connection (self, ap, connection, ac_con))
+        continue;
+
+      /* The AP was shown by SSID as long as it had no connection */
+      if (g_hash_table_steal_extended (self->ap_ssid_cache, ap, NULL, (gpointer*) &ssid))
+        {
+          CcWifiConnectionRow *ssid_row = g_hash_table_lookup (self->ssid_to_row, ssid);
+
+          if (ssid_row && cc_wifi_connection_row_remove_access_point (ssid_row, ap))
+            {
+              g_hash_table_remove (self->ssid_to_row, ssid);
+              remove_row (self, ssid_row);
+            }
+        }
+
+      row = g_ptr_array_index (self->connections_row, idx);
+      if (!row)
+        {
+          row = cc_wifi_connection_list_row_add (self, connection, NULL, TRUE);
+          g_ptr_array_index (self->connections_row, idx) = row;
+        }
+      cc_wifi_connection_row_add_access_point (row, ap);
+    }
+}
+
+static gboolean
+ap_has_connection_row (CcWifiConnectionList *self,
+                       NMAccessPoint        *ap)
+{
+  guint i;
+
+  for (i = 0; i < self->connections_row->len; i++)
+    {
+      CcWifiConnectionRow *row = g_ptr_array_index (self->connections_row, i);
+
+      if (row && cc_wifi_connection_row_has_access_point (row, ap))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Removes a connection, APs only it matched go back to their SSID rows */
+static void
+remove_connection (CcWifiConnectionList *self,
+                   guint                 idx)
+{
+  g_autoptr(GPtrArray) orphans = NULL;
+  NMConnection *connection;
+  const GPtrArray *aps;
+  CcWifiConnectionRow *row;
+  guint i;
+
+  row = g_ptr_array_index (self->connections_row, idx);
+  connection = g_ptr_array_index (self->connections, idx);
+
+  g_signal_handlers_disconnect_by_data (connection, self);
+  cc_wifi_connection_index_remove (self->connections_index, connection);
+
+  g_ptr_array_remove_index (self->connections_row, idx);
+  g_ptr_array_remove_index (self->connections, idx);
+
+  if (!row)
+    return;
+
+  aps = cc_wifi_connection_row_get_access_points (row);
+  orphans = g_ptr_array_new_full (aps->len, g_object_unref);
+  for (i = 0; i < aps->len; i++)
+    g_ptr_array_add (orphans, g_object_ref (g_ptr_array_index (aps, i)));
+
+  remove_row (self, row);
+
+  for (i = 0; i < orphans->len; i++)
+    {
+      NMAccessPoint *ap = g_ptr_array_index (orphans, i);
+
+      if (!ap_has_connection_row (self, ap))
+        assign_access_point (self, ap);
+    }
+}
+
+/*
+ * Brings the rows in line with the connections of the client and the
+ * active connection. Only rows of connections which were added or
+ * removed are created or destroyed, and only the APs they match are
+ * moved, so that the remaining rows keep their state.
+ */
+static void
+update_connections (CcWifiConnectionList *self)
+{
   const GPtrArray *acs_client;
-  g_autoptr(GPtrArray) acs = NULL;
-  NMActiveConnection *ac;
-  NMConnection *ac_con = NULL;
+  g_autoptr(GHashTable) wanted = NULL;
+  NMConnection *ac_con;
+  NMAccessPoint *active_ap;
+  guint idx;
   gint i;
 
-  /* We don't want full UI rebuilds during some UI interactions, so allow freezing the list. */
+  /* We don't want UI changes during some UI interactions, so allow freezing the list. */
   if (self->freeze_count > 0)
     return;
 
@@ -209,47 +379,79 @@ update_connections (CcWifiConnectionList *self)
     return;
   self->updating = TRUE;
 
-  clear_widget (self);
+  ac_con = get_active_connection (self);
 
-  /* Copy the new connections; also create a row if we show unavailable
-   * connections */
+  /* The connections we want rows for, including the active connection
+   * even if it is not known to the client (yet) */
+  wanted = g_hash_table_new (NULL, NULL);
   acs_client = nm_client_get_connections (self->client);
-
-  acs = g_ptr_array_new_full (acs_client->len + 1, NULL);
   for (i = 0; i < acs_client->len; i++)
-    g_ptr_array_add (acs, g_ptr_array_index (acs_client, i));
+    {
+      NMConnection *con = g_ptr_array_index (acs_client, i);
 
-  ac = nm_device_get_active_connection (NM_DEVICE (self->device));
-  if (ac)
-    ac_con = NM_CONNECTION (nm_active_connection_get_connection (ac));
+      if (!connection_ignored (con))
+        g_hash_table_add (wanted, con);
+    }
+
+  if (ac_con && !connection_ignored (ac_con))
+    g_hash_table_add (wanted, ac_con);
 
-  if (ac_con && !g_ptr_array_find (acs, ac_con, NULL))
+  /* Connections which are gone; drop them from the set of wanted
+   * connections as they are found so that only new ones remain */
+  for (i = self->connections->len - 1; i >= 0; i--)
     {
-      g_debug ("Adding remote connection for active connection");
-      g_ptr_array_add (acs, g_object_ref (ac_con));
+      NMConnection *con = g_ptr_array_index (self->connections, i);
+
+      if (!g_hash_table_remove (wanted, con))
+        remove_connection (self, i);
     }
 
-  for (i = 0; i < acs->len; i++)
+  /* Only the active connection has a row without APs when hiding unavailable ones */
+  for (i = 0; i < self->connections->len; i++)
     {
-      NMConnection *con;
+      NMConnection *con = g_ptr_array_index (self->connections, i);
+      CcWifiConnectionRow *row = g_ptr_array_index (self->connections_row, i);
+      gboolean want_row = !self->hide_unavailable || con == ac_con;
 
-      con = g_ptr_array_index (acs, i);
-      if (connection_ignored (con))
-        continue;
+      if (!row && want_row)
+        {
+          g_ptr_array_index (self->connections_row, i) =
+            cc_wifi_connection_list_row_add (self, con, NULL, TRUE);
+        }
+      else if (row && !want_row && cc_wifi_connection_row_get_access_points (row)->len == 0)
+        {
+          g_ptr_array_index (self->connections_row, i) = NULL;
+          remove_row (self, row);
+        }
+    }
+
+  /* New connections, in the order of the client */
+  for (i = 0; i < acs_client->len; i++)
+    {
+      NMConnection *con = g_ptr_array_index (acs_client, i);
 
-      g_ptr_array_add (self->connections, g_object_ref (con));
-      if (self->hide_unavailable && con != ac_con)
-        g_ptr_array_add (self->connections_row, NULL);
-      else
-        g_ptr_array_add (self->connections_row,
-                         cc_wifi_connection_list_row_add (self, con,
-                         NULL, TRUE));
+      if (g_hash_table_remove (wanted, con))
+        add_connection (self, con, ac_con);
     }
 
-  /* Coldplug all known APs again */
-  aps = nm_device_wifi_get_access_points (self->device);
-  for (i = 0; i < aps->len; i++)
-    on_device_ap_added_cb (self, g_ptr_array_index (aps, i), self->device);
+  if (ac_con && g_hash_table_remove (wanted, ac_con))
+    {
+      g_debug ("Adding remote connection for active connection");
+      add_connection (self, ac_con, ac_con);
+    }
+
+  /* The active AP is always grouped with the active connection */
+  active_ap = nm_device_wifi_get_active_access_point (self->device);
+  if (active_ap && ac_con && g_ptr_array_find (self->connections, ac_con, &idx))
+    {
+      CcWifiConnectionRow *row = g_ptr_array_index (self->connections_row, idx);
+
+      if (!row || !cc_wifi_connection_row_has_access_point (row, active_ap))
+        {
+          unassign_access_point (self, active_ap);
+          assign_access_point (self, active_ap);
+        }
+    }
 
   self->updating = FALSE;
 }
@@ -272,6 +474,51 @@ on_row_show_qr_code_cb (CcWifiConnectionList *self, CcWifiConnectionRow *row)
   g_signal_emit_by_name (self, "show_qr_code", row);
 }
 
+static gboolean
+on_strength_tick_cb (GtkWidget     *widget,
+                     GdkFrameClock *frame_clock,
+                     gpointer       user_data)
+{
+  CcWifiConnectionList *self = CC_WIFI_CONNECTION_LIST (user_data);
+  GHashTableIter iter;
+  CcWifiConnectionRow *row;
+  gboolean resort = FALSE;
+
+  g_hash_table_iter_init (&iter, self->strength_changed);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &row, NULL))
+    resort |= cc_wifi_connection_row_update_strength (row);
+
+  g_hash_table_remove_all (self->strength_changed);
+  self->strength_tick_id = 0;
+
+  /* One pass over the sort keys cached in the rows */
+  if (resort)
+    gtk_list_box_invalidate_sort (self->listbox);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+update_row (CcWifiConnectionList *self,
+            CcWifiConnectionRow  *row,
+            gboolean              strength_only)
+{
+  if (!strength_only)
+    {
+      g_hash_table_remove (self->strength_changed, row);
+      cc_wifi_connection_row_update (row);
+      return;
+    }
+
+  /* APs report their strength all the time while scanning, only
+   * update the rows once per frame */
+  g_hash_table_add (self->strength_changed, row);
+  if (self->strength_tick_id == 0)
+    self->strength_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self->listbox),
+                                                           on_strength_tick_cb,
+                                                           self, NULL);
+}
+
 static void
 on_access_point_property_changed (CcWifiConnectionList *self,
                                   GParamSpec           *pspec,
@@ -280,6 +527,7 @@ on_access_point_property_changed (CcWifiConnectionList *self,
   CcWifiConnectionRow *row;
   GBytes *ssid;
   gboolean has_connection = FALSE;
+  gboolean strength_only;
   gint i;
 
   /* If the SSID changed then the AP needs to be added/removed from rows.
@@ -287,11 +535,13 @@ on_access_point_property_changed (CcWifiConnectionList *self,
   if (g_str_equal (pspec->name, NM_ACCESS_POINT_SSID))
     {
       g_debug ("Simulating add/remove for SSID change");
-      on_device_ap_removed_cb (self, ap, self->device);
-      on_device_ap_added_cb (self, ap, self->device);
+      unassign_access_point (self, ap);
+      assign_access_point (self, ap);
       return;
     }
 
+  strength_only = g_str_equal (pspec->name, NM_ACCESS_POINT_STRENGTH);
+
   /* Otherwise, find all rows that contain the AP and update it. Do this by
    * first searching all rows with connections, and then looking it up in the
    * SSID rows if not found. */
@@ -300,7 +550,7 @@ on_access_point_property_changed (CcWifiConnectionList *self,
       row = g_ptr_array_index (self->connections_row, i);
       if (row && cc_wifi_connection_row_has_access_point (row, ap))
         {
-          cc_wifi_connection_row_update (row);
+          update_row (self, row, strength_only);
           has_connection = TRUE;
         }
     }
@@ -316,14 +566,15 @@ on_access_point_property_changed (CcWifiConnectionList *self,
   if (!row)
     g_assert_not_reached ();
   else
-    cc_wifi_connection_row_update (row);
+    update_row (self, row, strength_only);
 }
 
+/* Adds the AP to the rows of the connections it matches, or to the row of its SSID */
 static void
-on_device_ap_added_cb (CcWifiConnectionList *self,
-                       NMAccessPoint        *ap,
-                       NMDeviceWifi         *device)
+assign_access_point (CcWifiConnectionList *self,
+                     NMAccessPoint        *ap)
 {
+  NMDeviceWifi *device = self->device;
   g_autoptr(GPtrArray) connections = NULL;
   NM80211ApSecurityFlags rsn_flags;
   CcWifiConnectionRow *row;
@@ -331,14 +582,10 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
   g_autoptr(GBytes) ssid = NULL;
   guint i, j;
 
-  g_signal_connect_object (ap, "notify",
-                           G_CALLBACK (on_access_point_property_changed),
-                           self, G_CONNECT_SWAPPED);
-
-  connections = nm_access_point_filter_connections (ap, self->connections);
+  connections = cc_wifi_connection_index_lookup (self->connections_index, ap);
 
   /* If this is the active AP, then add the active connection to the list. This
-   * is a workaround because nm_access_pointer_filter_connections() will not
+   * is a workaround because nm_access_point_connection_valid() will not
    * include it otherwise.
    * So it seems like the dummy AP entry that NM creates internally is not actually
    * compatible with the connection that is being activated.
@@ -416,17 +663,27 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
 }
 
 static void
-on_device_ap_removed_cb (CcWifiConnectionList *self,
-                         NMAccessPoint        *ap,
-                         NMDeviceWifi         *device)
+on_device_ap_added_cb (CcWifiConnectionList *self,
+                       NMAccessPoint        *ap,
+                       NMDeviceWifi         *device)
+{
+  g_signal_connect_object (ap, "notify",
+                           G_CALLBACK (on_access_point_property_changed),
+                           self, G_CONNECT_SWAPPED);
+
+  assign_access_point (self, ap);
+}
+
+/* Removes the AP from all rows, removing rows which are left without reason to be shown */
+static void
+unassign_access_point (CcWifiConnectionList *self,
+                       NMAccessPoint        *ap)
 {
   CcWifiConnectionRow *row;
   g_autoptr(GBytes) ssid = NULL;
   gboolean found = FALSE;
   gint i;
 
-  g_signal_handlers_disconnect_by_data (ap, self);
-
   /* Find any connection related row with the AP and remove the AP from it. Remove the
    * row if it was the last AP and we are hiding unavailable connections. */
   for (i = 0; i < self->connections_row->len; i++)
@@ -439,8 +696,7 @@ on_device_ap_removed_cb (CcWifiConnectionList *self,
           if (self->hide_unavailable)
             {
               g_ptr_array_index (self->connections_row, i) = NULL;
-              g_signal_emit_by_name (self, "remove-row", row);
-              gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+              remove_row (self, row);
             }
         }
     }
@@ -461,11 +717,42 @@ on_device_ap_removed_cb (CcWifiConnectionList *self,
   if (cc_wifi_connection_row_remove_access_point (row, ap))
     {
       g_hash_table_remove (self->ssid_to_row, ssid);
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+      remove_row (self, row);
     }
 }
 
+static void
+on_device_ap_removed_cb (CcWifiConnectionList *self,
+                         NMAccessPoint        *ap,
+                         NMDeviceWifi         *device)
+{
+  g_signal_handlers_disconnect_by_data (ap, self);
+
+  unassign_access_point (self, ap);
+}
+
+static void
+on_connection_changed_cb (CcWifiConnectionList *self,
+                          NMConnection         *connection)
+{
+  guint idx;
+
+  /* Other changes don't affect which APs the connection is shown with */
+  if (!cc_wifi_connection_index_update (self->connections_index, connection))
+    return;
+
+  if (self->updating || !g_ptr_array_find (self->connections, connection, &idx))
+    return;
+
+  g_debug ("Re-adding connection after its SSID or security changed");
+
+  self->updating = TRUE;
+  remove_connection (self, idx);
+  if (!connection_ignored (connection))
+    add_connection (self, connection, get_active_connection (self));
+  self->updating = FALSE;
+}
+
 static void
 on_client_connection_added_cb (CcWifiConnectionList *self,
                                NMConnection         *connection,
@@ -477,10 +764,17 @@ on_client_connection_added_cb (CcWifiConnectionList *self,
   if (connection_ignored (connection))
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
-  update_connections (self);
+  if (self->freeze_count > 0 || self->updating)
+    return;
+
+  /* The active connection may already be listed */
+  if (g_ptr_array_find (self->connections, connection, NULL))
+    return;
+
+  /* Only the new connection gets a row, the others are left alone */
+  self->updating = TRUE;
+  add_connection (self, connection, get_active_connection (self));
+  self->updating = FALSE;
 }
 
 static void
@@ -488,13 +782,35 @@ on_client_connection_removed_cb (CcWifiConnectionList *self,
                                  NMConnection         *connection,
                                  NMClient             *client)
 {
-  if (!g_ptr_array_find (self->connections, connection, NULL))
+  guint idx;
+
+  if (!g_ptr_array_find (self->connections, connection, &idx))
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
-  update_connections (self);
+  if (self->freeze_count > 0 || self->updating)
+    return;
+
+  /* The active connection stays listed until the device lets go of it */
+  if (connection == get_active_connection (self))
+    return;
+
+  self->updating = TRUE;
+  remove_connection (self, idx);
+  self->updating = FALSE;
+}
+
+static void
+update_connection_row (CcWifiConnectionList *self,
+                       NMConnection         *connection)
+{
+  guint idx;
+
+  if (connection &&
+      g_ptr_array_find (self->connections, connection, &idx) &&
+      g_ptr_array_index (self->connections_row, idx))
+    {
+      update_row (self, g_ptr_array_index (self->connections_row, idx), FALSE);
+    }
 }
 
 static void
@@ -521,6 +837,10 @@ on_device_state_changed_cb (CcWifiConnectionList *self,
 
   /* Give up and do a full update. */
   update_connections (self);
+
+  /* Rows are kept, so the previously active one needs updating as well */
+  update_connection_row (self, self->last_active);
+  update_connection_row (self, connection);
   self->last_active = connection;
 }
 
@@ -539,8 +859,8 @@ on_device_active_ap_changed_cb (CcWifiConnectionList *self,
   if (ap)
     {
       g_debug ("Simulating add/remove for active AP change");
-      on_device_ap_removed_cb (self, ap, self->device);
-      on_device_ap_added_cb (self, ap, self->device);
+      unassign_access_point (self, ap);
+      assign_access_point (self, ap);
     }
 }
 
@@ -553,6 +873,12 @@ cc_wifi_connection_list_dispose (GObject *object)
    * through updates_connections */
   self->updating = TRUE;
 
+  if (self->strength_tick_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self->listbox), self->strength_tick_id);
+      self->strength_tick_id = 0;
+    }
+
   /* Drop all external references */
   clear_widget (self);
 
@@ -569,8 +895,10 @@ cc_wifi_connection_list_finalize (GObject *object)
 
   g_clear_pointer (&self->connections, g_ptr_array_unref);
   g_clear_pointer (&self->connections_row, g_ptr_array_unref);
+  g_clear_pointer (&self->connections_index, cc_wifi_connection_index_free);
   g_clear_pointer (&self->ssid_to_row, g_hash_table_unref);
   g_clear_pointer (&self->ap_ssid_cache, g_hash_table_unref);
+  g_clear_pointer (&self->strength_changed, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_wifi_connection_list_parent_class)->finalize (object);
 }
@@ -579,6 +907,8 @@ static void
 cc_wifi_connection_list_constructed (GObject *object)
 {
   CcWifiConnectionList *self = (CcWifiConnectionList *)object;
+  const GPtrArray *aps;
+  guint i;
 
   G_OBJECT_CLASS (cc_wifi_connection_list_parent_class)->constructed (object);
 
@@ -608,12 +938,24 @@ cc_wifi_connection_list_constructed (GObject *object)
   g_signal_connect_object (self->device, "notify::active-access-point",
                            G_CALLBACK (on_device_active_ap_changed_cb),
                            self, G_CONNECT_SWAPPED);
+
+  aps = nm_device_wifi_get_access_points (self->device);
+  for (i = 0; i < aps->len; i++)
+    g_signal_connect_object (g_ptr_array_index (aps, i), "notify",
+                             G_CALLBACK (on_access_point_property_changed),
+                             self, G_CONNECT_SWAPPED);
+
+  /* Adding the connections also picks up the APs they match */
   on_device_state_changed_cb (self, NULL, self->device);
 
-  /* Simulate a change notification on the available connections.
-   * This uses the implementation detail that the list is rebuild
-   * completely in this case. */
-  update_connections (self);
+  /* Coldplug the remaining APs into their SSID rows */
+  for (i = 0; i < aps->len; i++)
+    {
+      NMAccessPoint *ap = g_ptr_array_index (aps, i);
+
+      if (!ap_has_connection_row (self, ap))
+        assign_access_point (self, ap);
+    }
 }
 
 static void
@@ -785,10 +1127,12 @@ cc_wifi_connection_list_init (CcWifiConnectionList *self)
 
   self->connections = g_ptr_array_new_with_free_func (g_object_unref);
   self->connections_row = g_ptr_array_new ();
+  self->connections_index = cc_wifi_connection_index_new ();
   self->ssid_to_row = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
                                              (GDestroyNotify) g_bytes_unref, NULL);
   self->ap_ssid_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                                NULL, (GDestroyNotify) g_bytes_unref);
+  self->strength_changed = g_hash_table_new (NULL, NULL);
 }
 
 CcWifiConnectionList *
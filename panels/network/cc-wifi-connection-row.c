@@ -43,8 +43,28 @@ struct _CcWifiConnectionRow
   GtkButton       *forget_button;
   GtkButton       *qr_code_button;
   GtkImage        *strength_icon;
+
+  /* Sort keys, see cc_wifi_connection_row_compare() */
+  gboolean         sort_active;
+  guint            strength_bucket;
+  GBytes          *sort_ssid;
+  gchar           *sort_ssid_key;
+};
+
+/* Lower bounds of the signal strength icons */
+static const guint8 strength_thresholds[] = { 20, 40, 50, 80 };
+static const gchar * const strength_icons[] = {
+  "network-wireless-signal-none-symbolic",
+  "network-wireless-signal-weak-symbolic",
+  "network-wireless-signal-ok-symbolic",
+  "network-wireless-signal-good-symbolic",
+  "network-wireless-signal-excellent-symbolic",
 };
 
+/* How far the strength has to go past a threshold to change the bucket */
+#define STRENGTH_HYSTERESIS 5
+#define STRENGTH_BUCKET_NONE G_MAXUINT
+
 enum
 {
   PROP_0,
@@ -166,6 +186,47 @@ get_connection_security (NMConnection *con)
     return NM_AP_SEC_UNKNOWN;
 }
 
+static guint
+get_strength_bucket (guint8 strength,
+                     guint  current)
+{
+  guint bucket = 0;
+
+  while (bucket < G_N_ELEMENTS (strength_thresholds) && strength >= strength_thresholds[bucket])
+    bucket++;
+
+  if (current == STRENGTH_BUCKET_NONE || bucket == current)
+    return bucket;
+
+  /* Stay in the current bucket while hovering around its edges */
+  if (bucket > current && strength < strength_thresholds[bucket - 1] + STRENGTH_HYSTERESIS)
+    bucket--;
+  else if (bucket < current && strength + STRENGTH_HYSTERESIS >= strength_thresholds[bucket])
+    bucket++;
+
+  return bucket;
+}
+
+static void
+update_sort_ssid (CcWifiConnectionRow *self,
+                  GBytes              *ssid)
+{
+  g_autofree gchar *ssid_str = NULL;
+
+  if (self->sort_ssid && ssid && g_bytes_equal (self->sort_ssid, ssid))
+    return;
+
+  g_clear_pointer (&self->sort_ssid, g_bytes_unref);
+  g_clear_pointer (&self->sort_ssid_key, g_free);
+
+  if (!ssid)
+    return;
+
+  self->sort_ssid = g_bytes_ref (ssid);
+  ssid_str = nm_utils_ssid_to_utf8 (g_bytes_get_data (ssid, NULL), g_bytes_get_size (ssid));
+  self->sort_ssid_key = g_utf8_collate_key (ssid_str, -1);
+}
+
 static void
 update_ui (CcWifiConnectionRow *self)
 {
@@ -177,6 +238,7 @@ update_ui (CcWifiConnectionRow *self)
   NMAccessPointSecurity security = NM_AP_SEC_UNKNOWN;
   NMAccessPoint *best_ap;
   guint8 strength = 0;
+  guint strength_bucket;
   NMActiveConnectionState state;
 
   g_assert (self->device);
@@ -192,6 +254,8 @@ update_ui (CcWifiConnectionRow *self)
         active_connection = NULL;
     }
 
+  self->sort_active = active_connection != NULL;
+
   if (self->connection)
     {
       NMSettingWireless *sw;
@@ -236,6 +300,8 @@ update_ui (CcWifiConnectionRow *self)
       adw_preferences_row_set_title (ADW_PREFERENCES_ROW (self), title_escaped);
     }
 
+  update_sort_ssid (self, ssid);
+
   if (active_connection)
     {
       state = nm_active_connection_get_state (active_connection);
@@ -309,20 +375,13 @@ update_ui (CcWifiConnectionRow *self)
   if (best_ap)
     {
       g_autofree char *description = NULL;
-      gchar *icon_name;
-
-      if (strength < 20)
-        icon_name = "network-wireless-signal-none-symbolic";
-      else if (strength < 40)
-        icon_name = "network-wireless-signal-weak-symbolic";
-      else if (strength < 50)
-        icon_name = "network-wireless-signal-ok-symbolic";
-      else if (strength < 80)
-        icon_name = "network-wireless-signal-good-symbolic";
-      else
-        icon_name = "network-wireless-signal-excellent-symbolic";
 
-      g_object_set (self->strength_icon, "icon-name", icon_name, NULL);
+      strength_bucket = get_strength_bucket (strength, self->strength_bucket);
+      if (strength_bucket != self->strength_bucket)
+        {
+          self->strength_bucket = strength_bucket;
+          g_object_set (self->strength_icon, "icon-name", strength_icons[strength_bucket], NULL);
+        }
       gtk_widget_set_child_visible (GTK_WIDGET (self->strength_icon), TRUE);
 
       description = g_strdup_printf(_("Signal strength %d%%"), strength);
@@ -334,6 +393,7 @@ update_ui (CcWifiConnectionRow *self)
     }
   else
     {
+      self->strength_bucket = STRENGTH_BUCKET_NONE;
       gtk_widget_set_child_visible (GTK_WIDGET (self->strength_icon), FALSE);
       gtk_accessible_reset_property (GTK_ACCESSIBLE (self->strength_icon), GTK_ACCESSIBLE_PROPERTY_DESCRIPTION);
     }
@@ -463,6 +523,8 @@ cc_wifi_connection_row_finalize (GObject *object)
   g_clear_object (&self->device);
   g_clear_pointer (&self->aps, g_ptr_array_unref);
   g_clear_object (&self->connection);
+  g_clear_pointer (&self->sort_ssid, g_bytes_unref);
+  g_clear_pointer (&self->sort_ssid_key, g_free);
 
   G_OBJECT_CLASS (cc_wifi_connection_row_parent_class)->finalize (object);
 }
@@ -574,6 +636,7 @@ cc_wifi_connection_row_init (CcWifiConnectionRow *self)
   gtk_widget_init_template (GTK_WIDGET (self));
 
   self->aps = g_ptr_array_new_with_free_func (g_object_unref);
+  self->strength_bucket = STRENGTH_BUCKET_NONE;
 
   g_object_bind_property (self, "checked",
                           self->checkbutton, "active",
@@ -746,3 +809,55 @@ cc_wifi_connection_row_update (CcWifiConnectionRow *self)
 
 }
 
+/**
+ * cc_wifi_connection_row_update_strength:
+ *
+ * Updates the row after the strength of its APs changed, without
+ * re-sorting it.
+ *
+ * Returns: %TRUE if the sort keys of the row changed
+ */
+gboolean
+cc_wifi_connection_row_update_strength (CcWifiConnectionRow *self)
+{
+  guint strength_bucket;
+  gboolean sort_active;
+
+  g_return_val_if_fail (CC_WIFI_CONNECTION_ROW (self), FALSE);
+
+  strength_bucket = self->strength_bucket;
+  sort_active = self->sort_active;
+
+  update_ui (self);
+
+  return strength_bucket != self->strength_bucket || sort_active != self->sort_active;
+}
+
+/**
+ * cc_wifi_connection_row_compare:
+ *
+ * Orders rows by the keys cached in the last update: the active
+ * connection first, then saved networks, then by signal strength and
+ * finally by SSID. Signal strength only counts in steps, so small
+ * fluctuations don't reorder the list.
+ */
+gint
+cc_wifi_connection_row_compare (CcWifiConnectionRow *a,
+                                CcWifiConnectionRow *b)
+{
+  gint strength_a, strength_b;
+
+  if (a->sort_active != b->sort_active)
+    return a->sort_active ? -1 : 1;
+
+  if ((a->connection != NULL) != (b->connection != NULL))
+    return a->connection ? -1 : 1;
+
+  strength_a = a->strength_bucket == STRENGTH_BUCKET_NONE ? -1 : (gint) a->strength_bucket;
+  strength_b = b->strength_bucket == STRENGTH_BUCKET_NONE ? -1 : (gint) b->strength_bucket;
+  if (strength_a != strength_b)
+    return strength_b - strength_a;
+
+  return g_strcmp0 (a->sort_ssid_key, b->sort_ssid_key);
+}
+
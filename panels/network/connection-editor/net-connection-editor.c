@@ -70,6 +70,8 @@ struct _NetConnectionEditor
         NMAccessPoint    *ap;
         GCancellable     *cancellable;
 
+        /* EditorPage for each tab of the notebook */
+        GPtrArray        *pages;
         GSList *initializing_pages;
 
         NMClientPermissionResult can_modify;
@@ -79,6 +81,31 @@ struct _NetConnectionEditor
 
 G_DEFINE_TYPE (NetConnectionEditor, net_connection_editor, ADW_TYPE_WINDOW)
 
+typedef CEPage *(*PageNewFunc) (NetConnectionEditor *self);
+
+/*
+ * Pages are only built when their tab is first shown, most people never
+ * look past the details page. For a new connection, the pages holding
+ * what only they can check, the VPN plugin data or the secrets, are built
+ * right away, so that nothing incomplete can be added.
+ */
+typedef struct {
+        const gchar *title;
+        PageNewFunc  new_func;
+        /* Checked instead of the page as long as it wasn't built */
+        const gchar *settings[2];
+        gboolean     needs_page;
+        AdwBin      *bin;
+        CEPage      *page;
+} EditorPage;
+
+static void
+editor_page_free (EditorPage *editor_page)
+{
+        g_clear_object (&editor_page->page);
+        g_free (editor_page);
+}
+
 /* Used as both GSettings keys and GObject data tags */
 #define IGNORE_CA_CERT_TAG "ignore-ca-cert"
 #define IGNORE_PHASE2_CA_CERT_TAG "ignore-phase2-ca-cert"
@@ -307,6 +334,8 @@ static void
 net_connection_editor_init (NetConnectionEditor *self)
 {
         gtk_widget_init_template (GTK_WIDGET (self));
+
+        self->pages = g_ptr_array_new_with_free_func ((GDestroyNotify) editor_page_free);
 }
 
 static void
@@ -319,6 +348,7 @@ net_connection_editor_finalize (GObject *object)
         g_clear_object (&self->device);
         g_clear_object (&self->client);
         g_clear_object (&self->ap);
+        g_clear_pointer (&self->pages, g_ptr_array_unref);
         g_cancellable_cancel (self->cancellable);
         g_clear_object (&self->cancellable);
 
@@ -479,28 +509,50 @@ update_sensitivity (NetConnectionEditor *self)
         }
 }
 
+static gboolean
+validate_page (NetConnectionEditor  *self,
+               EditorPage           *editor_page,
+               GError              **error)
+{
+        guint i;
+
+        if (editor_page->page)
+                return ce_page_validate (editor_page->page, self->connection, error);
+
+        /* Nothing was edited on it, so only the connection can be wrong */
+        for (i = 0; i < G_N_ELEMENTS (editor_page->settings) && editor_page->settings[i]; i++) {
+                NMSetting *setting;
+
+                setting = nm_connection_get_setting_by_name (self->connection, editor_page->settings[i]);
+                if (setting && !nm_setting_verify (setting, self->connection, error))
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
 static void
 validate (NetConnectionEditor *self)
 {
         gboolean valid = FALSE;
         g_autofree gchar *apply_tooltip = NULL;
-        gint i;
+        guint i;
 
         if (!editor_is_initialized (self))
                 goto done;
 
         valid = TRUE;
-        for (i = 0; i < gtk_notebook_get_n_pages (self->notebook); i++) {
-                CEPage *page = CE_PAGE (gtk_notebook_get_nth_page (self->notebook, i));
+        for (i = 0; i < self->pages->len; i++) {
+                EditorPage *editor_page = g_ptr_array_index (self->pages, i);
                 g_autoptr(GError) error = NULL;
 
-                if (!ce_page_validate (page, self->connection, &error)) {
+                if (!validate_page (self, editor_page, &error)) {
                         valid = FALSE;
                         if (error) {
-                                apply_tooltip = g_strdup_printf (_("Invalid setting %s: %s"), ce_page_get_title (page), error->message);
+                                apply_tooltip = g_strdup_printf (_("Invalid setting %s: %s"), editor_page->title, error->message);
                                 g_debug ("%s", apply_tooltip);
                         } else {
-                                apply_tooltip = g_strdup_printf (_("Invalid setting %s"), ce_page_get_title (page));
+                                apply_tooltip = g_strdup_printf (_("Invalid setting %s"), editor_page->title);
                                 g_debug ("%s", apply_tooltip);
                         }
                 }
@@ -536,8 +588,11 @@ recheck_initialization (NetConnectionEditor *self)
         if (!editor_is_initialized (self))
                 return;
 
-        gtk_stack_set_visible_child (self->toplevel_stack, GTK_WIDGET (self->notebook));
-        gtk_notebook_set_current_page (self->notebook, 0);
+        /* Pages built later on only replace the spinner on their own tab */
+        if (gtk_stack_get_visible_child (self->toplevel_stack) != GTK_WIDGET (self->notebook)) {
+                gtk_stack_set_visible_child (self->toplevel_stack, GTK_WIDGET (self->notebook));
+                gtk_notebook_set_current_page (self->notebook, 0);
+        }
 
         g_idle_add (idle_validate, self);
 
@@ -549,23 +604,17 @@ recheck_initialization (NetConnectionEditor *self)
 static void
 page_initialized (NetConnectionEditor *self, GError *error, CEPage *page)
 {
-        GtkWidget *label;
-        gint position;
-        gint i;
+        guint i;
 
-        position = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (page), "position"));
-        g_object_set_data (G_OBJECT (page), "position", GINT_TO_POINTER (position));
-        for (i = 0; i < gtk_notebook_get_n_pages (self->notebook); i++) {
-                GtkWidget *page = gtk_notebook_get_nth_page (self->notebook, i);
-                gint pos = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (page), "position"));
-                if (pos > position)
+        for (i = 0; i < self->pages->len; i++) {
+                EditorPage *editor_page = g_ptr_array_index (self->pages, i);
+
+                if (editor_page->page == page) {
+                        adw_bin_set_child (editor_page->bin, GTK_WIDGET (page));
                         break;
+                }
         }
 
-        label = gtk_label_new (ce_page_get_title (page));
-
-        gtk_notebook_insert_page (self->notebook, GTK_WIDGET (page), label, i);
-
         self->initializing_pages = g_slist_remove (self->initializing_pages, page);
 
         recheck_initialization (self);
@@ -619,25 +668,134 @@ get_secrets_for_page (NetConnectionEditor *self,
                                                 info);
 }
 
+static CEPage *
+details_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_details_new (self->connection, self->device, self->ap, self, self->is_new_connection));
+}
+
+static CEPage *
+wifi_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_wifi_new (self->connection, self->client));
+}
+
+static CEPage *
+ethernet_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_ethernet_new (self->connection, self->client));
+}
+
+static CEPage *
+vpn_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_vpn_new (self->connection));
+}
+
+static CEPage *
+wireguard_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_wireguard_new (self->connection));
+}
+
+static CEPage *
+bluetooth_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_bluetooth_new (self->connection));
+}
+
+static CEPage *
+ip4_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_ip4_new (self->connection, self->client));
+}
+
+static CEPage *
+ip6_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_ip6_new (self->connection, self->client));
+}
+
+static CEPage *
+security_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_security_new (self->connection));
+}
+
+static CEPage *
+ethernet_security_page_new (NetConnectionEditor *self)
+{
+        return CE_PAGE (ce_page_8021x_security_new (self->connection));
+}
+
 static void
-add_page (NetConnectionEditor *self, CEPage *page)
+add_page (NetConnectionEditor *self,
+          const gchar         *title,
+          PageNewFunc          new_func,
+          const gchar         *setting,
+          const gchar         *other_setting,
+          gboolean             needs_page)
 {
-        gint position;
+        EditorPage *editor_page;
+        GtkWidget *spinner;
+
+        editor_page = g_new0 (EditorPage, 1);
+        editor_page->title = title;
+        editor_page->new_func = new_func;
+        editor_page->settings[0] = setting;
+        editor_page->settings[1] = other_setting;
+        editor_page->needs_page = needs_page;
+        editor_page->bin = ADW_BIN (adw_bin_new ());
+
+        spinner = gtk_spinner_new ();
+        gtk_widget_set_halign (spinner, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign (spinner, GTK_ALIGN_CENTER);
+        gtk_spinner_start (GTK_SPINNER (spinner));
+        adw_bin_set_child (editor_page->bin, spinner);
+
+        g_ptr_array_add (self->pages, editor_page);
+        gtk_notebook_append_page (self->notebook, GTK_WIDGET (editor_page->bin), gtk_label_new (title));
+}
+
+static void
+build_page (NetConnectionEditor *self,
+            EditorPage          *editor_page)
+{
+        CEPage *page;
+        const gchar *security_setting;
+
+        if (editor_page->page)
+                return;
 
-        position = g_slist_length (self->initializing_pages);
-        g_object_set_data (G_OBJECT (page), "position", GINT_TO_POINTER (position));
+        page = editor_page->new_func (self);
+        editor_page->page = g_object_ref_sink (page);
 
         self->initializing_pages = g_slist_append (self->initializing_pages, page);
 
         g_signal_connect_object (page, "changed", G_CALLBACK (page_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (page, "initialized", G_CALLBACK (page_initialized), self, G_CONNECT_SWAPPED);
+
+        security_setting = ce_page_get_security_setting (page);
+        if (!security_setting || self->is_new_connection) {
+                ce_page_complete_init (page, NULL, NULL, NULL, NULL);
+        } else {
+                get_secrets_for_page (self, page, security_setting);
+        }
+}
+
+static void
+switch_page_cb (NetConnectionEditor *self,
+                GtkWidget           *child,
+                guint                page_num)
+{
+        if (page_num < self->pages->len)
+                build_page (self, g_ptr_array_index (self->pages, page_num));
 }
 
 static void
 net_connection_editor_set_connection (NetConnectionEditor *self,
                                       NMConnection        *connection)
 {
-        GSList *pages, *l;
         NMSettingConnection *sc;
         const gchar *type;
         gboolean is_wired;
@@ -670,45 +828,49 @@ net_connection_editor_set_connection (NetConnectionEditor *self,
         is_wireguard = g_str_equal (type, NM_SETTING_WIREGUARD_SETTING_NAME);
         is_bluetooth = g_str_equal (type, NM_SETTING_BLUETOOTH_SETTING_NAME);
 
-        add_page (self, CE_PAGE (ce_page_details_new (self->connection, self->device, self->ap, self, self->is_new_connection)));
+        if (!is_wifi && !is_wired && !is_vpn && !is_wireguard && !is_bluetooth) {
+                /* Unsupported type */
+                net_connection_editor_do_fallback (self, type);
+                return;
+        }
+
+        add_page (self, _("Details"), details_page_new, NM_SETTING_CONNECTION_SETTING_NAME, NULL, FALSE);
 
         if (is_wifi)
-                add_page (self, CE_PAGE (ce_page_wifi_new (self->connection, self->client)));
+                add_page (self, _("Identity"), wifi_page_new, NM_SETTING_WIRELESS_SETTING_NAME, NULL, FALSE);
         else if (is_wired)
-                add_page (self, CE_PAGE (ce_page_ethernet_new (self->connection, self->client)));
+                add_page (self, _("Identity"), ethernet_page_new, NM_SETTING_WIRED_SETTING_NAME, NULL, FALSE);
         else if (is_vpn)
-                add_page (self, CE_PAGE (ce_page_vpn_new (self->connection)));
+                add_page (self, _("Identity"), vpn_page_new, NM_SETTING_VPN_SETTING_NAME, NULL, TRUE);
         else if (is_wireguard)
-                add_page (self, CE_PAGE (ce_page_wireguard_new (self->connection)));
+                add_page (self, _("WireGuard"), wireguard_page_new, NM_SETTING_WIREGUARD_SETTING_NAME, NULL, TRUE);
         else if (is_bluetooth)
-                add_page (self, CE_PAGE (ce_page_bluetooth_new (self->connection)));
-        else {
-                /* Unsupported type */
-                net_connection_editor_do_fallback (self, type);
-                return;
-        }
+                add_page (self, _("Identity"), bluetooth_page_new, NM_SETTING_BLUETOOTH_SETTING_NAME, NULL, FALSE);
 
-        add_page (self, CE_PAGE (ce_page_ip4_new (self->connection, self->client)));
-        add_page (self, CE_PAGE (ce_page_ip6_new (self->connection, self->client)));
+        add_page (self, _("IPv4"), ip4_page_new, NM_SETTING_IP4_CONFIG_SETTING_NAME, NULL, FALSE);
+        add_page (self, _("IPv6"), ip6_page_new, NM_SETTING_IP6_CONFIG_SETTING_NAME, NULL, FALSE);
 
         if (is_wifi)
-                add_page (self, CE_PAGE (ce_page_security_new (self->connection)));
+                add_page (self, _("Security"), security_page_new,
+                          NM_SETTING_WIRELESS_SECURITY_SETTING_NAME, NM_SETTING_802_1X_SETTING_NAME, TRUE);
         else if (is_wired)
-                add_page (self, CE_PAGE (ce_page_8021x_security_new (self->connection)));
+                add_page (self, _("Security"), ethernet_security_page_new, NM_SETTING_802_1X_SETTING_NAME, NULL, TRUE);
 
-        pages = g_slist_copy (self->initializing_pages);
-        for (l = pages; l; l = l->next) {
-                CEPage *page = l->data;
-                const gchar *security_setting;
+        g_signal_connect_object (self->notebook, "switch-page",
+                                 G_CALLBACK (switch_page_cb), self, G_CONNECT_SWAPPED);
 
-                security_setting = ce_page_get_security_setting (page);
-                if (!security_setting || self->is_new_connection) {
-                        ce_page_complete_init (page, NULL, NULL, NULL, NULL);
-                } else {
-                        get_secrets_for_page (self, page, security_setting);
+        build_page (self, g_ptr_array_index (self->pages, 0));
+
+        if (self->is_new_connection) {
+                guint i;
+
+                for (i = 1; i < self->pages->len; i++) {
+                        EditorPage *editor_page = g_ptr_array_index (self->pages, i);
+
+                        if (editor_page->needs_page)
+                                build_page (self, editor_page);
                 }
         }
-        g_slist_free (pages);
 }
 
 static NMConnection *
@@ -56,10 +56,16 @@ GSList *
 vpn_get_plugins (void)
 {
 	static GSList *plugins = NULL;
+	static gboolean plugins_loaded = FALSE;
 	GSList *p;
 
+	/* Loading the plugins means reading every .name file and dlopen()ing
+	 * their editors, which doesn't change for the lifetime of the process. */
+	if (G_LIKELY (plugins_loaded))
+		return plugins;
+	plugins_loaded = TRUE;
+
 	p = nm_vpn_plugin_info_list_load ();
-	plugins = NULL;
 	while (p) {
 		g_autoptr(NMVpnPluginInfo) plugin_info = NM_VPN_PLUGIN_INFO (p->data);
 		g_autoptr(GError) error = NULL;
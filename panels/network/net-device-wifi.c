@@ -937,51 +937,10 @@ history_sort (gconstpointer a, gconstpointer b, gpointer data)
 static gint
 ap_sort (gconstpointer a, gconstpointer b, gpointer data)
 {
-        NetDeviceWifi *self = data;
-        CcWifiConnectionRow *a_row = CC_WIFI_CONNECTION_ROW ((gpointer) a);
-        CcWifiConnectionRow *b_row = CC_WIFI_CONNECTION_ROW ((gpointer) b);
-        NMActiveConnection *active_connection;
-        gboolean a_configured, b_configured;
-        NMAccessPoint *apa, *apb;
-        guint sa, sb;
-
-        /* Show the connected AP first */
-        active_connection = nm_device_get_active_connection (NM_DEVICE (self->device));
-        if (active_connection != NULL) {
-                NMConnection *connection = NM_CONNECTION (nm_active_connection_get_connection (active_connection));
-                if (connection == cc_wifi_connection_row_get_connection (a_row))
-                        return -1;
-                else if (connection == cc_wifi_connection_row_get_connection (b_row))
-                        return 1;
-        }
-
-        /* Show configured networks before non-configured */
-        a_configured = cc_wifi_connection_row_get_connection (a_row) != NULL;
-        b_configured = cc_wifi_connection_row_get_connection (b_row) != NULL;
-        if (a_configured != b_configured) {
-                if (a_configured) return -1;
-                if (b_configured) return 1;
-        }
-
-        /* Show higher strength networks above lower strength ones */
-
-        apa = cc_wifi_connection_row_best_access_point (a_row);
-        apb = cc_wifi_connection_row_best_access_point (b_row);
-
-        if (apa)
-                sa = nm_access_point_get_strength (apa);
-        else
-                sa = 0;
-
-        if (apb)
-                sb = nm_access_point_get_strength (apb);
-        else
-                sb = 0;
-
-        if (sa > sb) return -1;
-        if (sb > sa) return 1;
-
-        return 0;
+        /* The rows cache whether they are active, saved, their signal
+         * strength and SSID, so sorting does not have to ask NM */
+        return cc_wifi_connection_row_compare (CC_WIFI_CONNECTION_ROW ((gpointer) a),
+                                               CC_WIFI_CONNECTION_ROW ((gpointer) b));
 }
 
 static void
@@ -1169,7 +1128,7 @@ net_device_wifi_new (CcPanel *panel, NMClient *client, NMDevice *device)
         gtk_box_append (self->listbox_box, GTK_WIDGET (list));
 
         listbox = cc_wifi_connection_list_get_list_box (list);
-        gtk_list_box_set_sort_func (listbox, (GtkListBoxSortFunc)ap_sort, self, NULL);
+        gtk_list_box_set_sort_func (listbox, (GtkListBoxSortFunc)ap_sort, NULL, NULL);
 
         g_signal_connect_object (listbox, "row-activated",
                                  G_CALLBACK (ap_activated), self, G_CONNECT_SWAPPED);
@@ -55,6 +55,9 @@
 
 #define CUPS_STATUS_CHECK_INTERVAL 5
 
+/* Time in ms to collect notifications before updating printers */
+#define NOTIFICATION_COALESCE_TIMEOUT 200
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -100,6 +103,10 @@ struct _CcPrintersPanel
   guint            cups_status_check_id;
   guint            dbus_subscription_id;
   guint            remove_printer_timeout_id;
+  guint            notification_timeout_id;
+
+  GHashTable      *changed_printers;
+  gboolean         printers_list_changed;
 
   PPDList      *all_ppds_list;
 
@@ -113,6 +120,9 @@ struct _CcPrintersPanel
 
   GHashTable *printer_entries;
   gboolean    entries_filled;
+
+  /* Active jobs of the user, job id -> printer name */
+  GHashTable *jobs;
   GVariant   *action;
 
   GtkSizeGroup *size_group;
@@ -316,9 +326,12 @@ cc_printers_panel_dispose (GObject *object)
   g_clear_object (&self->permission);
   g_clear_handle_id (&self->cups_status_check_id, g_source_remove);
   g_clear_handle_id (&self->remove_printer_timeout_id, g_source_remove);
+  g_clear_handle_id (&self->notification_timeout_id, g_source_remove);
+  g_clear_pointer (&self->changed_printers, g_hash_table_destroy);
   g_clear_pointer (&self->deleted_printer_name, g_free);
   g_clear_pointer (&self->action, g_variant_unref);
   g_clear_pointer (&self->printer_entries, g_hash_table_destroy);
+  g_clear_pointer (&self->jobs, g_hash_table_destroy);
   g_clear_pointer (&self->all_ppds_list, ppd_list_free);
   free_dests (self);
   g_list_free_full (self->deleted_printers, g_free);
@@ -336,6 +349,82 @@ cc_printers_panel_get_help_uri (CcPanel *panel)
   return "help:gnome-help/printing";
 }
 
+static void
+update_jobs_count (CcPrintersPanel *self,
+                   const gchar     *printer_name)
+{
+  PpPrinterEntry *entry;
+  GHashTableIter  iter;
+  gpointer        value;
+  guint           jobs_count = 0;
+
+  entry = g_hash_table_lookup (self->printer_entries, printer_name);
+  if (entry == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, self->jobs);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    if (g_strcmp0 (value, printer_name) == 0)
+      jobs_count++;
+
+  pp_printer_entry_set_jobs_count (entry, jobs_count);
+}
+
+static void
+get_jobs_cb (GObject      *source_object,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  g_autoptr(GHashTable)   jobs = NULL;
+  g_autoptr(GError)       error = NULL;
+  GHashTableIter          iter;
+  gpointer                key, value;
+  GHashTable             *counts;
+
+  jobs = pp_cups_get_jobs_finish (PP_CUPS (source_object), result, &error);
+
+  if (jobs == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not get jobs: %s", error->message);
+
+      return;
+    }
+
+  g_hash_table_remove_all (self->jobs);
+
+  counts = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_iter_init (&iter, jobs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_hash_table_insert (self->jobs, key, g_strdup (value));
+      g_hash_table_insert (counts, value,
+                           GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (counts, value)) + 1));
+    }
+
+  g_hash_table_iter_init (&iter, self->printer_entries);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    pp_printer_entry_set_jobs_count (PP_PRINTER_ENTRY (value),
+                                     GPOINTER_TO_UINT (g_hash_table_lookup (counts, key)));
+
+  g_hash_table_destroy (counts);
+}
+
+/*
+ * Fetches active jobs of all printers at once. The table
+ * is then kept up to date by job notifications.
+ */
+static void
+get_jobs (CcPrintersPanel *self)
+{
+  pp_cups_get_jobs_async (self->cups,
+                          cc_panel_get_cancellable (CC_PANEL (self)),
+                          get_jobs_cb,
+                          self);
+}
+
 static void
 on_get_job_attributes_cb (GObject      *source_object,
                           GAsyncResult *res,
@@ -367,19 +456,139 @@ on_get_job_attributes_cb (GObject      *source_object,
                   g_strrstr (job_printer_uri, "/") != 0 &&
                   self->dests != NULL)
                 {
-                  PpPrinterEntry *printer_entry;
                   gchar *printer_name;
 
                   printer_name = g_strrstr (job_printer_uri, "/") + 1;
-                  printer_entry = PP_PRINTER_ENTRY (g_hash_table_lookup (self->printer_entries, printer_name));
+                  g_hash_table_insert (self->jobs,
+                                       GINT_TO_POINTER (pp_job_get_id (PP_JOB (source_object))),
+                                       g_strdup (printer_name));
 
-                  pp_printer_entry_update_jobs_count (printer_entry);
+                  update_jobs_count (self, printer_name);
                 }
             }
         }
     }
 }
 
+static void
+replace_dest (CcPrintersPanel *self,
+              cups_dest_t     *dest)
+{
+  cups_dest_t *new_dest;
+  gint         i;
+
+  self->num_dests = cupsRemoveDest (dest->name, dest->instance, self->num_dests, &self->dests);
+  self->num_dests = cupsAddDest (dest->name, dest->instance, self->num_dests, &self->dests);
+
+  new_dest = cupsGetDest (dest->name, dest->instance, self->num_dests, self->dests);
+  new_dest->is_default = dest->is_default;
+  for (i = 0; i < dest->num_options; i++)
+    new_dest->num_options = cupsAddOption (dest->options[i].name,
+                                           dest->options[i].value,
+                                           new_dest->num_options,
+                                           &new_dest->options);
+}
+
+static void
+update_changed_printers_cb (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  g_autoptr(GPtrArray)    dests = NULL;
+  g_autoptr(GError)       error = NULL;
+  gchar                 **names;
+  guint                   i;
+
+  dests = pp_cups_get_named_dests_finish (PP_CUPS (source_object), result, &error);
+
+  if (dests == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not get dests: %s", error->message);
+
+      return;
+    }
+
+  names = g_task_get_task_data (G_TASK (result));
+
+  /* A queue disappeared in the meantime */
+  if (dests->len != g_strv_length (names))
+    {
+      actualize_printers_list (self);
+      return;
+    }
+
+  for (i = 0; i < dests->len; i++)
+    {
+      cups_dest_t    *dest = g_ptr_array_index (dests, i);
+      PpPrinterEntry *entry;
+
+      entry = g_hash_table_lookup (self->printer_entries, dest->name);
+      if (entry == NULL ||
+          cupsGetDest (dest->name, NULL, self->num_dests, self->dests) == NULL)
+        {
+          actualize_printers_list (self);
+          return;
+        }
+
+      replace_dest (self, dest);
+      pp_printer_entry_update (entry,
+                               *cupsGetDest (dest->name, NULL, self->num_dests, self->dests),
+                               self->is_authorized);
+    }
+}
+
+static gboolean
+process_notifications_cb (gpointer user_data)
+{
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  g_autofree gchar      **names = NULL;
+
+  self->notification_timeout_id = 0;
+
+  if (self->printers_list_changed ||
+      self->dests == NULL ||
+      self->renamed_printer_name != NULL)
+    {
+      actualize_printers_list (self);
+    }
+  else if (g_hash_table_size (self->changed_printers) > 0)
+    {
+      names = (gchar **) g_hash_table_get_keys_as_array (self->changed_printers, NULL);
+      pp_cups_get_named_dests_async (self->cups,
+                                     (const gchar * const *) names,
+                                     cc_panel_get_cancellable (CC_PANEL (self)),
+                                     update_changed_printers_cb,
+                                     self);
+    }
+
+  g_hash_table_remove_all (self->changed_printers);
+  self->printers_list_changed = FALSE;
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Busy print servers send bursts of notifications. Remember which
+ * printers they concern and update just those once the burst is over.
+ */
+static void
+queue_printer_update (CcPrintersPanel *self,
+                      const gchar     *printer_name)
+{
+  if (printer_name == NULL || printer_name[0] == '\0' ||
+      !g_hash_table_contains (self->printer_entries, printer_name))
+    self->printers_list_changed = TRUE;
+  else
+    g_hash_table_add (self->changed_printers, g_strdup (printer_name));
+
+  if (self->notification_timeout_id == 0)
+    self->notification_timeout_id = g_timeout_add (NOTIFICATION_COALESCE_TIMEOUT,
+                                                   process_notifications_cb,
+                                                   self);
+}
+
 static void
 on_cups_notification (GDBusConnection *connection,
                       const char      *sender_name,
@@ -443,12 +652,20 @@ on_cups_notification (GDBusConnection *connection,
     }
 
   if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
-      g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStopped") == 0)
-    actualize_printers_list (self);
-  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
-           g_strcmp0 (signal_name, "JobCompleted") == 0)
+      g_strcmp0 (signal_name, "PrinterDeleted") == 0)
+    queue_printer_update (self, NULL);
+  else if (g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
+           g_strcmp0 (signal_name, "PrinterStopped") == 0)
+    queue_printer_update (self, printer_name);
+  else if (g_strcmp0 (signal_name, "JobCompleted") == 0)
+    {
+      g_autofree gchar *job_printer_name = NULL;
+
+      /* Only jobs of the user are in the table */
+      if (g_hash_table_steal_extended (self->jobs, GINT_TO_POINTER (job_id), NULL, (gpointer *) &job_printer_name))
+        update_jobs_count (self, job_printer_name);
+    }
+  else if (g_strcmp0 (signal_name, "JobCreated") == 0)
     {
       g_autoptr(PpJob) job = NULL;
 
@@ -860,6 +1077,8 @@ actualize_printers_list_cb (GObject      *source_object,
 
   update_sensitivity (user_data);
 
+  get_jobs (self);
+
   if (self->new_printer_name != NULL)
     {
       GtkAllocation           allocation;
@@ -1250,6 +1469,16 @@ cc_printers_panel_init (CcPrintersPanel *self)
                                                  g_free,
                                                  NULL);
 
+  self->jobs = g_hash_table_new_full (g_direct_hash,
+                                      g_direct_equal,
+                                      NULL,
+                                      g_free);
+
+  self->changed_printers = g_hash_table_new_full (g_str_hash,
+                                                  g_str_equal,
+                                                  g_free,
+                                                  NULL);
+
   g_type_ensure (CC_TYPE_PERMISSION_INFOBAR);
 
   g_object_set_data_full (self->reference, "self", self, NULL);
@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include "pp-cups.h"
+#include "pp-ipp-pool.h"
 
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
@@ -91,7 +92,7 @@ pp_cups_get_dests_async (PpCups              *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, (GTaskThreadFunc) _pp_cups_get_dests_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, (GTaskThreadFunc) _pp_cups_get_dests_thread);
 }
 
 PpCupsDests *
@@ -104,6 +105,184 @@ pp_cups_get_dests_finish (PpCups        *self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+static void
+pp_cups_dest_free (cups_dest_t *dest)
+{
+  cupsFreeDests (1, dest);
+}
+
+/*
+ * Asks CUPS for the current attributes of just the given queues
+ * instead of enumerating all of them. Queues which do not exist
+ * anymore are left out of the result.
+ */
+static void
+get_named_dests_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  GPtrArray *dests;
+  gchar    **names = task_data;
+  gint       i;
+
+  dests = g_ptr_array_new_with_free_func ((GDestroyNotify) pp_cups_dest_free);
+
+  for (i = 0; names[i] != NULL && !g_cancellable_is_cancelled (cancellable); i++)
+    {
+      cups_dest_t *dest;
+
+      dest = cupsGetNamedDest (CUPS_HTTP_DEFAULT, names[i], NULL);
+      if (dest != NULL)
+        g_ptr_array_add (dests, dest);
+    }
+
+  if (g_task_set_return_on_cancel (task, FALSE))
+    {
+      g_task_return_pointer (task, dests, (GDestroyNotify) g_ptr_array_unref);
+    }
+  else
+    {
+      g_ptr_array_unref (dests);
+    }
+}
+
+void
+pp_cups_get_named_dests_async (PpCups              *self,
+                               const gchar * const *names,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, g_strdupv ((gchar **) names), (GDestroyNotify) g_strfreev);
+  g_task_set_return_on_cancel (task, TRUE);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, get_named_dests_thread);
+}
+
+/*
+ * Returns array of cups_dest_t pointers.
+ */
+GPtrArray *
+pp_cups_get_named_dests_finish (PpCups        *self,
+                                GAsyncResult  *result,
+                                GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+add_job (GHashTable  *jobs,
+         gint         job_id,
+         const gchar *printer_uri)
+{
+  const gchar *printer_name;
+
+  if (job_id <= 0 || printer_uri == NULL)
+    return;
+
+  printer_name = g_strrstr (printer_uri, "/");
+  if (printer_name != NULL)
+    g_hash_table_insert (jobs, GINT_TO_POINTER (job_id), g_strdup (printer_name + 1));
+}
+
+/*
+ * Gets active jobs of the current user on all queues with
+ * a single Get-Jobs request asking just for what we need.
+ */
+static void
+get_jobs_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+  static const char * const  requested_attrs[] = { "job-id", "job-printer-uri" };
+  g_autoptr(GHashTable)      jobs = NULL;
+  ipp_attribute_t           *attr;
+  const gchar               *printer_uri = NULL;
+  ipp_t                     *request;
+  ipp_t                     *response;
+  gint                       job_id = 0;
+
+  request = ippNewRequest (IPP_GET_JOBS);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, "ipp://localhost/");
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddBoolean (request, IPP_TAG_OPERATION, "my-jobs", 1);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                "which-jobs", NULL, "not-completed");
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (requested_attrs), NULL, requested_attrs);
+  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+
+  if (response == NULL || ippGetStatusCode (response) > IPP_OK_CONFLICT)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "%s", cupsLastErrorString ());
+      ippDelete (response);
+      return;
+    }
+
+  jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+  /* Attributes of individual jobs are separated by a group without a tag */
+  for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
+    {
+      if (ippGetGroupTag (attr) != IPP_TAG_JOB)
+        {
+          add_job (jobs, job_id, printer_uri);
+          job_id = 0;
+          printer_uri = NULL;
+        }
+      else if (g_strcmp0 (ippGetName (attr), "job-id") == 0 &&
+               ippGetValueTag (attr) == IPP_TAG_INTEGER)
+        {
+          job_id = ippGetInteger (attr, 0);
+        }
+      else if (g_strcmp0 (ippGetName (attr), "job-printer-uri") == 0 &&
+               ippGetValueTag (attr) == IPP_TAG_URI)
+        {
+          printer_uri = ippGetString (attr, 0, NULL);
+        }
+    }
+
+  add_job (jobs, job_id, printer_uri);
+
+  ippDelete (response);
+
+  g_task_return_pointer (task, g_steal_pointer (&jobs), (GDestroyNotify) g_hash_table_unref);
+}
+
+void
+pp_cups_get_jobs_async (PpCups              *self,
+                        GCancellable        *cancellable,
+                        GAsyncReadyCallback  callback,
+                        gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_NORMAL, get_jobs_thread);
+}
+
+/*
+ * Returns table mapping job ids to names of their printers.
+ */
+GHashTable *
+pp_cups_get_jobs_finish (PpCups        *self,
+                         GAsyncResult  *result,
+                         GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static void
 connection_test_thread (GTask        *task,
                         gpointer      source_object,
@@ -187,7 +366,7 @@ pp_cups_cancel_subscription_async (PpCups              *self,
 
   task = g_task_new (self, NULL, callback, user_data);
   g_task_set_task_data (task, GINT_TO_POINTER (subscription_id), NULL);
-  g_task_run_in_thread (task, cancel_subscription_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_LOW, cancel_subscription_thread);
 }
 
 gboolean
@@ -299,7 +478,7 @@ pp_cups_renew_subscription_async  (PpCups               *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, subscription_data, (GDestroyNotify) crs_data_free);
-  g_task_run_in_thread (task, renew_subscription_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_LOW, renew_subscription_thread);
 }
 
 /* Returns id of renewed subscription or new id */
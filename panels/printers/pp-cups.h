@@ -45,6 +45,25 @@ PpCupsDests *pp_cups_get_dests_finish (PpCups               *cups,
                                        GAsyncResult         *result,
                                        GError              **error);
 
+void         pp_cups_get_named_dests_async  (PpCups              *cups,
+                                             const gchar * const *names,
+                                             GCancellable        *cancellable,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+
+GPtrArray   *pp_cups_get_named_dests_finish (PpCups              *cups,
+                                             GAsyncResult        *result,
+                                             GError             **error);
+
+void         pp_cups_get_jobs_async  (PpCups              *cups,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+
+GHashTable  *pp_cups_get_jobs_finish (PpCups              *cups,
+                                      GAsyncResult        *result,
+                                      GError             **error);
+
 void         pp_cups_connection_test_async (PpCups              *cups,
                                             GCancellable        *cancellable,
                                             GAsyncReadyCallback  callback,
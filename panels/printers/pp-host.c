@@ -22,10 +22,14 @@
 
 #include "pp-host.h"
 
+#include <string.h>
 #include <glib/gi18n.h>
 
 #define BUFFER_LENGTH 1024
 
+/* Seconds to wait for an LPD server to answer */
+#define LPD_TIMEOUT 2
+
 typedef struct
 {
   gchar *hostname;
@@ -240,38 +244,28 @@ line_split (gchar *line)
 }
 
 static void
-_pp_host_get_snmp_devices_thread (GTask        *task,
-                                  gpointer      source_object,
-                                  gpointer      task_data,
-                                  GCancellable *cancellable)
+snmp_communicate_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
 {
-  PpHost           *self = source_object;
-  PpHostPrivate    *priv = pp_host_get_instance_private (self);
+  GSubprocess         *subprocess = G_SUBPROCESS (source_object);
+  g_autoptr(GTask)     task = user_data;
   g_autoptr(GPtrArray) devices = NULL;
-  g_autoptr(GError) error = NULL;
-  g_auto(GStrv)     argv = NULL;
-  g_autofree gchar *stdout_string = NULL;
-  gint              exit_status;
+  g_autoptr(GError)    error = NULL;
+  g_autofree gchar    *stdout_string = NULL;
 
-  devices = g_ptr_array_new_with_free_func (g_object_unref);
+  if (!g_subprocess_communicate_utf8_finish (subprocess, result, &stdout_string, NULL, &error))
+    {
+      g_subprocess_force_exit (subprocess);
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
 
-  argv = g_new0 (gchar *, 3);
-  argv[0] = g_strdup ("/usr/lib/cups/backend/snmp");
-  argv[1] = g_strdup (priv->hostname);
+  devices = g_ptr_array_new_with_free_func (g_object_unref);
 
-  /* Use SNMP to get printer's informations */
-  g_spawn_sync (NULL,
-                argv,
-                NULL,
-                G_SPAWN_STDERR_TO_DEV_NULL,
-                NULL,
-                NULL,
-                &stdout_string,
-                NULL,
-                &exit_status,
-                &error);
-
-  if (exit_status == 0 && stdout_string)
+  if (g_subprocess_get_if_exited (subprocess) &&
+      g_subprocess_get_exit_status (subprocess) == 0 &&
+      stdout_string != NULL)
     {
       g_auto(GStrv)     printer_informations = NULL;
       gint              length;
@@ -308,7 +302,7 @@ _pp_host_get_snmp_devices_thread (GTask        *task,
         }
     }
 
-  g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+  g_task_return_pointer (task, g_steal_pointer (&devices), (GDestroyNotify) g_ptr_array_unref);
 }
 
 void
@@ -317,10 +311,35 @@ pp_host_get_snmp_devices_async (PpHost              *self,
                                 GAsyncReadyCallback  callback,
                                 gpointer             user_data)
 {
-  g_autoptr(GTask) task = NULL;
+  PpHostPrivate          *priv = pp_host_get_instance_private (self);
+  g_autoptr(GSubprocess)  subprocess = NULL;
+  g_autoptr(GTask)        task = NULL;
+  g_autoptr(GError)       error = NULL;
 
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_run_in_thread (task, _pp_host_get_snmp_devices_thread);
+  g_task_set_source_tag (task, pp_host_get_snmp_devices_async);
+
+  /* Use SNMP to get printer's informations */
+  subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+                                 G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                 &error,
+                                 "/usr/lib/cups/backend/snmp",
+                                 priv->hostname,
+                                 NULL);
+  if (subprocess == NULL)
+    {
+      g_debug ("Could not run the SNMP backend: %s", error->message);
+      g_task_return_pointer (task,
+                             g_ptr_array_new_with_free_func (g_object_unref),
+                             (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
+  g_subprocess_communicate_utf8_async (subprocess,
+                                       NULL,
+                                       cancellable,
+                                       snmp_communicate_cb,
+                                       g_steal_pointer (&task));
 }
 
 GPtrArray *
@@ -333,6 +352,13 @@ pp_host_get_snmp_devices_finish (PpHost        *self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+static void
+set_cancel_flag (GCancellable *cancellable,
+                 gint         *cancel)
+{
+  g_atomic_int_set (cancel, 1);
+}
+
 static void
 _pp_host_get_remote_cups_devices_thread (GTask        *task,
                                          gpointer      source_object,
@@ -344,7 +370,9 @@ _pp_host_get_remote_cups_devices_thread (GTask        *task,
   PpHostPrivate *priv = pp_host_get_instance_private (self);
   g_autoptr(GPtrArray) devices = NULL;
   http_t        *http;
+  gulong         cancelled_id;
   gint           num_of_devices = 0;
+  gint           cancel = 0;
   gint           port;
   gint           i;
 
@@ -355,14 +383,22 @@ _pp_host_get_remote_cups_devices_thread (GTask        *task,
   else
     port = priv->port;
 
+  cancelled_id = g_cancellable_connect (cancellable,
+                                       G_CALLBACK (set_cancel_flag),
+                                       &cancel,
+                                       NULL);
+
   /* Connect to remote CUPS server and get its devices */
 #ifdef HAVE_CUPS_HTTPCONNECT2
   http = httpConnect2 (priv->hostname, port, NULL, AF_UNSPEC,
-                       HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL);
+                       HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, &cancel);
 #else
   http = httpConnect (priv->hostname, port);
 #endif
-  if (http)
+
+  g_cancellable_disconnect (cancellable, cancelled_id);
+
+  if (http && !g_cancellable_is_cancelled (cancellable))
     {
       num_of_devices = cupsGetDests2 (http, &dests);
       if (num_of_devices > 0)
@@ -395,9 +431,14 @@ _pp_host_get_remote_cups_devices_thread (GTask        *task,
             }
         }
 
-      httpClose (http);
+      cupsFreeDests (num_of_devices, dests);
     }
 
+  httpClose (http);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
   g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
 }
 
@@ -410,6 +451,7 @@ pp_host_get_remote_cups_devices_async (PpHost              *self,
   g_autoptr(GTask) task = NULL;
 
   task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pp_host_get_remote_cups_devices_async);
   g_task_run_in_thread (task, _pp_host_get_remote_cups_devices_thread);
 }
 
@@ -509,6 +551,7 @@ pp_host_get_jetdirect_devices_async (PpHost              *self,
     data->port = priv->port;
 
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
+  g_task_set_source_tag (task, pp_host_get_jetdirect_devices_async);
   g_task_set_task_data (task, data, (GDestroyNotify) jetdirect_data_free);
 
   address = g_strdup_printf ("%s:%d", priv->hostname, data->port);
@@ -578,7 +621,7 @@ test_lpd_queue (GSocketClient *client,
           bytes_written = g_output_stream_write (output,
                                                  buffer,
                                                  length,
-                                                 NULL,
+                                                 cancellable,
                                                  &error);
 
           if (bytes_written != -1)
@@ -586,7 +629,7 @@ test_lpd_queue (GSocketClient *client,
               bytes_read = g_input_stream_read (input,
                                                 buffer,
                                                 BUFFER_LENGTH,
-                                                NULL,
+                                                cancellable,
                                                 &error);
 
               if (bytes_read != -1)
@@ -599,7 +642,7 @@ test_lpd_queue (GSocketClient *client,
                       bytes_written = g_output_stream_write (output,
                                                              buffer,
                                                              length,
-                                                             NULL,
+                                                             cancellable,
                                                              &error);
 
                       result = TRUE;
@@ -649,6 +692,7 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
     }
 
   client = g_socket_client_new ();
+  g_socket_client_set_timeout (client, LPD_TIMEOUT);
 
   connection = g_socket_client_connect_to_host (client,
                                                 address,
@@ -681,7 +725,7 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
       for (i = 0; i < 50; i++)
         candidates = g_list_append (candidates, g_strdup_printf ("pr%d", i));
 
-      for (iter = candidates; iter != NULL; iter = iter->next)
+      for (iter = candidates; iter != NULL && !g_cancellable_is_cancelled (cancellable); iter = iter->next)
         {
           candidate = (gchar *) iter->data;
 
@@ -721,6 +765,9 @@ _pp_host_get_lpd_devices_thread (GTask        *task,
       g_list_free_full (candidates, g_free);
     }
 
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
   g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
 }
 
@@ -733,6 +780,7 @@ pp_host_get_lpd_devices_async (PpHost              *self,
   g_autoptr(GTask) task = NULL;
 
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
+  g_task_set_source_tag (task, pp_host_get_lpd_devices_async);
   g_task_run_in_thread (task, _pp_host_get_lpd_devices_thread);
 }
 
@@ -745,3 +793,330 @@ pp_host_get_lpd_devices_finish (PpHost        *self,
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
   return g_task_propagate_pointer (G_TASK (res), error);
 }
+
+typedef struct
+{
+  PpHostProbes           pending;
+  GCancellable          *cancellable;
+  GCancellable          *parent_cancellable;
+  gulong                 cancelled_id;
+  guint                  timeout_id;
+  PpHostDevicesCallback  devices_callback;
+  gpointer               devices_user_data;
+} GetDevicesData;
+
+static void
+get_devices_data_free (GetDevicesData *data)
+{
+  g_cancellable_disconnect (data->parent_cancellable, data->cancelled_id);
+  g_clear_handle_id (&data->timeout_id, g_source_remove);
+  g_clear_object (&data->parent_cancellable);
+  g_clear_object (&data->cancellable);
+  g_free (data);
+}
+
+static void
+cancel_probes (GCancellable *parent_cancellable,
+               GCancellable *cancellable)
+{
+  g_cancellable_cancel (cancellable);
+}
+
+static gboolean
+get_devices_timeout_cb (gpointer user_data)
+{
+  GetDevicesData *data = user_data;
+
+  data->timeout_id = 0;
+  g_cancellable_cancel (data->cancellable);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+get_devices_probe_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  g_autoptr(GTask)     task = user_data;
+  GetDevicesData      *data = g_task_get_task_data (task);
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError)    error = NULL;
+  gpointer             source_tag;
+  PpHostProbes         probe;
+
+  source_tag = g_task_get_source_tag (G_TASK (result));
+  if (source_tag == pp_host_get_snmp_devices_async)
+    probe = PP_HOST_PROBE_SNMP;
+  else if (source_tag == pp_host_get_remote_cups_devices_async)
+    probe = PP_HOST_PROBE_REMOTE_CUPS;
+  else if (source_tag == pp_host_get_jetdirect_devices_async)
+    probe = PP_HOST_PROBE_JETDIRECT;
+  else
+    probe = PP_HOST_PROBE_LPD;
+
+  data->pending &= ~probe;
+
+  devices = g_task_propagate_pointer (G_TASK (result), &error);
+  if (devices == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+    }
+  /* Also cancelled with the caller's cancellable, on the deadline and
+   * once a better probe found the printer */
+  else if (devices->len > 0 &&
+           !g_cancellable_is_cancelled (data->cancellable))
+    {
+      data->devices_callback (devices, data->devices_user_data);
+
+      /* SNMP and CUPS describe the printer better than
+       * an open JetDirect or LPD port, stop guessing.
+       */
+      if (probe == PP_HOST_PROBE_SNMP || probe == PP_HOST_PROBE_REMOTE_CUPS)
+        g_cancellable_cancel (data->cancellable);
+    }
+
+  if (data->pending == 0 && !g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Runs the selected probes on the host concurrently. Devices are passed
+ * to devices_callback as soon as a probe finds them. Probes which did not
+ * finish within timeout milliseconds (0 for no limit), or which became
+ * superfluous because SNMP or the remote CUPS server identified the
+ * printer, are cancelled. Reaching the timeout is not an error.
+ */
+void
+pp_host_get_devices_async (PpHost                *self,
+                           PpHostProbes           probes,
+                           guint                  timeout,
+                           GCancellable          *cancellable,
+                           PpHostDevicesCallback  devices_callback,
+                           gpointer               devices_user_data,
+                           GAsyncReadyCallback    callback,
+                           gpointer               user_data)
+{
+  GetDevicesData   *data;
+  g_autoptr(GTask)  task = NULL;
+
+  g_return_if_fail (PP_IS_HOST (self));
+  g_return_if_fail (devices_callback != NULL);
+
+  data = g_new0 (GetDevicesData, 1);
+  data->pending = probes;
+  data->cancellable = g_cancellable_new ();
+  data->devices_callback = devices_callback;
+  data->devices_user_data = devices_user_data;
+
+  if (cancellable != NULL)
+    {
+      data->parent_cancellable = g_object_ref (cancellable);
+      data->cancelled_id = g_cancellable_connect (cancellable,
+                                                  G_CALLBACK (cancel_probes),
+                                                  data->cancellable,
+                                                  NULL);
+    }
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pp_host_get_devices_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) get_devices_data_free);
+
+  if (probes == 0)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  if (timeout > 0)
+    data->timeout_id = g_timeout_add (timeout, get_devices_timeout_cb, data);
+
+  if (probes & PP_HOST_PROBE_SNMP)
+    pp_host_get_snmp_devices_async (self, data->cancellable, get_devices_probe_cb, g_object_ref (task));
+
+  if (probes & PP_HOST_PROBE_REMOTE_CUPS)
+    pp_host_get_remote_cups_devices_async (self, data->cancellable, get_devices_probe_cb, g_object_ref (task));
+
+  if (probes & PP_HOST_PROBE_JETDIRECT)
+    pp_host_get_jetdirect_devices_async (self, data->cancellable, get_devices_probe_cb, g_object_ref (task));
+
+  if (probes & PP_HOST_PROBE_LPD)
+    pp_host_get_lpd_devices_async (self, data->cancellable, get_devices_probe_cb, g_object_ref (task));
+}
+
+gboolean
+pp_host_get_devices_finish (PpHost        *self,
+                            GAsyncResult  *res,
+                            GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+typedef struct
+{
+  guint32                next_address;
+  guint32                last_address;
+  gint                   port;
+  PpHostProbes           probes;
+  guint                  timeout;
+  guint                  max_hosts;
+  guint                  running;
+  PpHostDevicesCallback  devices_callback;
+  gpointer               devices_user_data;
+} ScanNetworkData;
+
+static void scan_next_hosts (GTask *task);
+
+static void
+scan_host_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  g_autoptr(GTask)  task = user_data;
+  ScanNetworkData  *data = g_task_get_task_data (task);
+  g_autoptr(GError) error = NULL;
+
+  if (!pp_host_get_devices_finish (PP_HOST (source_object), result, &error) &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_warning ("%s", error->message);
+
+  data->running--;
+  scan_next_hosts (task);
+}
+
+static void
+scan_next_hosts (GTask *task)
+{
+  ScanNetworkData *data = g_task_get_task_data (task);
+
+  if (g_task_get_completed (task))
+    return;
+
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    {
+      if (data->running == 0)
+        g_task_return_error_if_cancelled (task);
+      return;
+    }
+
+  while (data->running < data->max_hosts &&
+         data->next_address <= data->last_address &&
+         data->next_address != 0)
+    {
+      g_autoptr(GInetAddress) inet_address = NULL;
+      g_autofree gchar       *address = NULL;
+      g_autoptr(PpHost)       host = NULL;
+      guint32                 bytes;
+
+      bytes = GUINT32_TO_BE (data->next_address);
+      inet_address = g_inet_address_new_from_bytes ((const guint8 *) &bytes, G_SOCKET_FAMILY_IPV4);
+      address = g_inet_address_to_string (inet_address);
+
+      /* Wraps to 0 after the last address */
+      data->next_address++;
+
+      host = pp_host_new (address);
+      if (data->port != PP_HOST_UNSET_PORT)
+        g_object_set (host, "port", data->port, NULL);
+
+      data->running++;
+      pp_host_get_devices_async (host,
+                                 data->probes,
+                                 data->timeout,
+                                 g_task_get_cancellable (task),
+                                 data->devices_callback,
+                                 data->devices_user_data,
+                                 scan_host_cb,
+                                 g_object_ref (task));
+    }
+
+  if (data->running == 0)
+    g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Probes every host of an IPv4 network given as "address/prefix-length",
+ * at most max_hosts of them at a time. Each host gets timeout milliseconds
+ * to answer, see pp_host_get_devices_async(). Networks larger than /16
+ * are refused.
+ */
+void
+pp_host_scan_network_async (const gchar           *network,
+                            gint                   port,
+                            PpHostProbes           probes,
+                            guint                  max_hosts,
+                            guint                  timeout,
+                            GCancellable          *cancellable,
+                            PpHostDevicesCallback  devices_callback,
+                            gpointer               devices_user_data,
+                            GAsyncReadyCallback    callback,
+                            gpointer               user_data)
+{
+  g_autoptr(GInetAddressMask) mask = NULL;
+  ScanNetworkData            *data;
+  g_autoptr(GTask)            task = NULL;
+  g_autoptr(GError)           error = NULL;
+  guint32                     address;
+  guint32                     netmask;
+  guint                       length;
+
+  g_return_if_fail (network != NULL);
+  g_return_if_fail (devices_callback != NULL);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pp_host_scan_network_async);
+
+  mask = g_inet_address_mask_new_from_string (network, &error);
+  if (mask == NULL)
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  length = g_inet_address_mask_get_length (mask);
+  if (g_inet_address_mask_get_family (mask) != G_SOCKET_FAMILY_IPV4 || length < 16)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               "Can not scan network %s", network);
+      return;
+    }
+
+  memcpy (&address,
+          g_inet_address_to_bytes (g_inet_address_mask_get_address (mask)),
+          sizeof (address));
+  address = GUINT32_FROM_BE (address);
+  netmask = length == 32 ? G_MAXUINT32 : ~(G_MAXUINT32 >> length);
+
+  data = g_new0 (ScanNetworkData, 1);
+  data->next_address = address & netmask;
+  data->last_address = address | ~netmask;
+  data->port = port;
+  data->probes = probes;
+  data->timeout = timeout;
+  data->max_hosts = MAX (max_hosts, 1);
+  data->devices_callback = devices_callback;
+  data->devices_user_data = devices_user_data;
+
+  /* Skip network and broadcast addresses */
+  if (length < 31)
+    {
+      data->next_address++;
+      data->last_address--;
+    }
+
+  g_task_set_task_data (task, data, g_free);
+
+  scan_next_hosts (task);
+}
+
+gboolean
+pp_host_scan_network_finish (GAsyncResult  *res,
+                             GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, NULL), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
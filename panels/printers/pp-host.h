@@ -39,6 +39,18 @@ struct _PpHostClass
 #define PP_HOST_DEFAULT_JETDIRECT_PORT 9100
 #define PP_HOST_DEFAULT_LPD_PORT        515
 
+typedef enum
+{
+  PP_HOST_PROBE_SNMP        = 1 << 0,
+  PP_HOST_PROBE_REMOTE_CUPS = 1 << 1,
+  PP_HOST_PROBE_JETDIRECT   = 1 << 2,
+  PP_HOST_PROBE_LPD         = 1 << 3,
+  PP_HOST_PROBE_ALL         = 0xf
+} PpHostProbes;
+
+typedef void (*PpHostDevicesCallback) (GPtrArray *devices,
+                                       gpointer   user_data);
+
 PpHost        *pp_host_new                            (const gchar          *hostname);
 
 void           pp_host_get_snmp_devices_async         (PpHost               *host,
@@ -77,4 +89,31 @@ GPtrArray     *pp_host_get_lpd_devices_finish         (PpHost               *hos
                                                        GAsyncResult         *result,
                                                        GError              **error);
 
+void           pp_host_get_devices_async              (PpHost                *host,
+                                                       PpHostProbes           probes,
+                                                       guint                  timeout,
+                                                       GCancellable          *cancellable,
+                                                       PpHostDevicesCallback  devices_callback,
+                                                       gpointer               devices_user_data,
+                                                       GAsyncReadyCallback    callback,
+                                                       gpointer               user_data);
+
+gboolean       pp_host_get_devices_finish             (PpHost                *host,
+                                                       GAsyncResult          *result,
+                                                       GError               **error);
+
+void           pp_host_scan_network_async             (const gchar           *network,
+                                                       gint                   port,
+                                                       PpHostProbes           probes,
+                                                       guint                  max_hosts,
+                                                       guint                  timeout,
+                                                       GCancellable          *cancellable,
+                                                       PpHostDevicesCallback  devices_callback,
+                                                       gpointer               devices_user_data,
+                                                       GAsyncReadyCallback    callback,
+                                                       gpointer               user_data);
+
+gboolean       pp_host_scan_network_finish            (GAsyncResult          *result,
+                                                       GError               **error);
+
 G_END_DECLS
@@ -0,0 +1,218 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "pp-ipp-pool.h"
+
+/*
+ * Shared pool of worker threads for blocking requests to the local CUPS
+ * server.
+ *
+ * libcups keeps the CUPS_HTTP_DEFAULT connection per thread, so running
+ * requests on a few long-living threads instead of a new thread for each
+ * of them reuses a small set of persistent connections. Requests queued
+ * while all workers are busy are served by priority and then in order
+ * of arrival.
+ */
+
+typedef struct
+{
+  GTask           *task;
+  GTaskThreadFunc  task_func;
+  GFunc            func;
+  gpointer         data;
+  PpIppPriority    priority;
+  guint64          sequence;
+  gint64           queued_time;
+} PoolJob;
+
+static GMutex         stats_mutex;
+static PpIppPoolStats stats;
+static guint64        next_sequence;
+
+static gint
+compare_jobs (gconstpointer a,
+              gconstpointer b,
+              gpointer      user_data)
+{
+  const PoolJob *job_a = a;
+  const PoolJob *job_b = b;
+
+  if (job_a->priority != job_b->priority)
+    return job_a->priority < job_b->priority ? -1 : 1;
+
+  return job_a->sequence < job_b->sequence ? -1 : 1;
+}
+
+static void
+run_job (gpointer job_data,
+         gpointer user_data)
+{
+  PoolJob  *job = job_data;
+  gboolean  cancelled = FALSE;
+  gint64    start_time;
+  gint64    wait_time;
+
+  start_time = g_get_monotonic_time ();
+  wait_time = start_time - job->queued_time;
+
+  g_mutex_lock (&stats_mutex);
+  stats.queued--;
+  stats.running++;
+  stats.total_wait_time += wait_time;
+  stats.max_wait_time = MAX (stats.max_wait_time, wait_time);
+  g_mutex_unlock (&stats_mutex);
+
+  if (job->task != NULL)
+    {
+      /* Don't bother the server with requests nobody waits for anymore */
+      if (g_task_return_error_if_cancelled (job->task))
+        cancelled = TRUE;
+      else
+        job->task_func (job->task,
+                        g_task_get_source_object (job->task),
+                        g_task_get_task_data (job->task),
+                        g_task_get_cancellable (job->task));
+
+      g_object_unref (job->task);
+    }
+  else
+    {
+      job->func (job->data, NULL);
+    }
+
+  g_mutex_lock (&stats_mutex);
+  stats.running--;
+  if (cancelled)
+    stats.cancelled++;
+  else
+    stats.completed++;
+  stats.total_run_time += g_get_monotonic_time () - start_time;
+  g_mutex_unlock (&stats_mutex);
+
+  g_free (job);
+}
+
+static GThreadPool *
+get_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize        initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      g_autoptr(GError) error = NULL;
+
+      pool = g_thread_pool_new (run_job, NULL, PP_IPP_POOL_MAX_WORKERS, TRUE, &error);
+      if (pool == NULL)
+        {
+          g_warning ("Could not start IPP workers: %s", error->message);
+          pool = g_thread_pool_new (run_job, NULL, PP_IPP_POOL_MAX_WORKERS, FALSE, NULL);
+        }
+
+      g_thread_pool_set_sort_function (pool, compare_jobs, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+static void
+push_job (PoolJob       *job,
+          PpIppPriority  priority)
+{
+  job->priority = priority;
+  job->queued_time = g_get_monotonic_time ();
+
+  g_mutex_lock (&stats_mutex);
+  job->sequence = next_sequence++;
+  stats.queued++;
+  g_mutex_unlock (&stats_mutex);
+
+  g_thread_pool_push (get_pool (), job, NULL);
+}
+
+/*
+ * Replacement of g_task_run_in_thread() for tasks talking to CUPS.
+ * Tasks cancelled while waiting in the queue return G_IO_ERROR_CANCELLED
+ * without running. Setting return-on-cancel has no effect here.
+ */
+void
+pp_ipp_pool_run_task (GTask           *task,
+                      PpIppPriority    priority,
+                      GTaskThreadFunc  task_func)
+{
+  PoolJob *job;
+
+  g_return_if_fail (G_IS_TASK (task));
+  g_return_if_fail (task_func != NULL);
+
+  job = g_new0 (PoolJob, 1);
+  job->task = g_object_ref (task);
+  job->task_func = task_func;
+
+  push_job (job, priority);
+}
+
+/*
+ * Runs given function with given data in the pool. The function
+ * is responsible for passing its result back to the main thread.
+ */
+void
+pp_ipp_pool_push (GFunc          func,
+                  gpointer       data,
+                  PpIppPriority  priority)
+{
+  PoolJob *job;
+
+  g_return_if_fail (func != NULL);
+
+  job = g_new0 (PoolJob, 1);
+  job->func = func;
+  job->data = data;
+
+  push_job (job, priority);
+}
+
+void
+pp_ipp_pool_get_stats (PpIppPoolStats *pool_stats)
+{
+  g_return_if_fail (pool_stats != NULL);
+
+  g_mutex_lock (&stats_mutex);
+  *pool_stats = stats;
+  g_mutex_unlock (&stats_mutex);
+}
+
+/*
+ * Resets the counters, except of the number of
+ * queued and running requests.
+ */
+void
+pp_ipp_pool_reset_stats (void)
+{
+  g_mutex_lock (&stats_mutex);
+  stats.completed = 0;
+  stats.cancelled = 0;
+  stats.total_wait_time = 0;
+  stats.max_wait_time = 0;
+  stats.total_run_time = 0;
+  g_mutex_unlock (&stats_mutex);
+}
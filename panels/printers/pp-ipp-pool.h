@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define PP_IPP_POOL_MAX_WORKERS 4
+
+typedef enum
+{
+  PP_IPP_PRIORITY_HIGH,
+  PP_IPP_PRIORITY_NORMAL,
+  PP_IPP_PRIORITY_LOW
+} PpIppPriority;
+
+typedef struct
+{
+  guint   queued;
+  guint   running;
+  guint64 completed;
+  guint64 cancelled;
+  gint64  total_wait_time;
+  gint64  max_wait_time;
+  gint64  total_run_time;
+} PpIppPoolStats;
+
+void pp_ipp_pool_run_task    (GTask           *task,
+                              PpIppPriority    priority,
+                              GTaskThreadFunc  task_func);
+
+void pp_ipp_pool_push        (GFunc            func,
+                              gpointer         data,
+                              PpIppPriority    priority);
+
+void pp_ipp_pool_get_stats   (PpIppPoolStats  *stats);
+
+void pp_ipp_pool_reset_stats (void);
+
+G_END_DECLS
@@ -23,6 +23,8 @@
 #include <gio/gio.h>
 #include <cups/cups.h>
 
+#include "pp-ipp-pool.h"
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -85,6 +87,13 @@ pp_job_new (gint id, const gchar *title, gint state, gint priority, GStrv auth_i
    return job;
 }
 
+gint
+pp_job_get_id (PpJob *self)
+{
+   g_return_val_if_fail (PP_IS_JOB(self), -1);
+   return self->id;
+}
+
 const gchar *
 pp_job_get_title (PpJob *self)
 {
@@ -353,7 +362,7 @@ pp_job_get_attributes_async (PpJob                *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, g_strdupv (attributes_names), (GDestroyNotify) g_strfreev);
-  g_task_run_in_thread (task, _pp_job_get_attributes_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_NORMAL, _pp_job_get_attributes_thread);
 }
 
 GVariant *
@@ -414,7 +423,7 @@ pp_job_authenticate_async (PpJob                *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, g_strdupv (auth_info), (GDestroyNotify) g_strfreev);
-  g_task_run_in_thread (task, _pp_job_authenticate_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, _pp_job_authenticate_thread);
 }
 
 gboolean
@@ -471,7 +480,7 @@ pp_job_set_priority_async (PpJob                *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, GINT_TO_POINTER (priority), NULL);
-  g_task_run_in_thread (task, pp_job_set_priority_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, pp_job_set_priority_thread);
 }
 
 gboolean
@@ -35,6 +35,8 @@ PpJob         *pp_job_new                        (gint                  id,
                                                   gint                  priority,
                                                   GStrv                 auth_info_required);
 
+gint           pp_job_get_id                     (PpJob                *job);
+
 const gchar   *pp_job_get_title                  (PpJob                *job);
 
 gint           pp_job_get_state                  (PpJob                *job);
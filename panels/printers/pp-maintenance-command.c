@@ -22,6 +22,7 @@
 
 #include "pp-maintenance-command.h"
 
+#include "pp-ipp-pool.h"
 #include "pp-utils.h"
 
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
@@ -276,7 +277,7 @@ pp_maintenance_command_execute_async (PpMaintenanceCommand *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_check_cancellable (task, TRUE);
-  g_task_run_in_thread (task, _pp_maintenance_command_execute_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, _pp_maintenance_command_execute_thread);
 }
 
 gboolean
@@ -376,7 +377,7 @@ pp_maintenance_command_is_supported_async  (PpMaintenanceCommand *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_check_cancellable (task, TRUE);
-  g_task_run_in_thread (task, _pp_maintenance_command_is_supported_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_NORMAL, _pp_maintenance_command_is_supported_thread);
 }
 
 gboolean
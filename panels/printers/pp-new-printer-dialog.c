@@ -51,6 +51,9 @@
  */
 #define HOST_SEARCH_DELAY (500 - 150)
 
+/* Time in ms after which probing of a remote host is given up */
+#define HOST_SEARCH_TIMEOUT 15000
+
 #define AUTHENTICATION_PAGE "authentication-page"
 #define ADDPRINTER_PAGE "addprinter-page"
 
@@ -146,10 +149,8 @@ struct _PpNewPrinterDialog
   GIcon *remote_printer_icon;
   GIcon *authenticated_server_icon;
 
-  PpHost  *snmp_host;
-  PpHost  *socket_host;
-  PpHost  *lpd_host;
-  PpHost  *remote_cups_host;
+  PpHost  *remote_host;
+  PpHost  *remote_default_ports_host;
   PpSamba *samba_host;
   guint    host_search_timeout_id;
 };
@@ -564,10 +565,8 @@ update_dialog_state (PpNewPrinterDialog *self)
   gboolean                   searching;
 
   searching = self->cups_searching ||
-              self->remote_cups_host != NULL ||
-              self->snmp_host != NULL ||
-              self->socket_host != NULL ||
-              self->lpd_host != NULL ||
+              self->remote_host != NULL ||
+              self->remote_default_ports_host != NULL ||
               self->samba_host != NULL ||
               self->samba_authenticated_searching ||
               self->samba_searching;
@@ -842,67 +841,37 @@ get_cups_devices_cb (GPtrArray *devices,
 }
 
 static void
-get_snmp_devices_cb (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
+remote_host_devices_found_cb (GPtrArray *devices,
+                              gpointer   user_data)
 {
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_snmp_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->snmp_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
+  PpNewPrinterDialog *self = user_data;
 
-          g_clear_object(&self->snmp_host);
+  add_devices_to_list (self, devices);
 
-          update_dialog_state (self);
-        }
-    }
+  update_dialog_state (self);
 }
 
 static void
-get_remote_cups_devices_cb (GObject      *source_object,
+get_remote_host_devices_cb (GObject      *source_object,
                             GAsyncResult *res,
                             gpointer      user_data)
 {
   PpNewPrinterDialog        *self = user_data;
   g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_remote_cups_devices_finish (PP_HOST (source_object), res, &error);
 
-  if (devices != NULL)
+  if (pp_host_get_devices_finish (PP_HOST (source_object), res, &error) ||
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      g_clear_object(&self->remote_cups_host);
+      if (error != NULL)
+        g_warning ("%s", error->message);
 
-      add_devices_to_list (self, devices);
+      if (PP_HOST (source_object) == self->remote_host)
+        g_clear_object (&self->remote_host);
+      else
+        g_clear_object (&self->remote_default_ports_host);
 
       update_dialog_state (self);
     }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->remote_cups_host);
-
-          update_dialog_state (self);
-        }
-    }
 }
 
 static void
@@ -969,70 +938,6 @@ get_samba_devices_cb (GObject      *source_object,
     }
 }
 
-static void
-get_jetdirect_devices_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_jetdirect_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->socket_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->socket_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
-static void
-get_lpd_devices_cb (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
-{
-  PpNewPrinterDialog        *self = user_data;
-  g_autoptr(GError)          error = NULL;
-  g_autoptr(GPtrArray)       devices = NULL;
-
-  devices = pp_host_get_lpd_devices_finish (PP_HOST (source_object), res, &error);
-
-  if (devices != NULL)
-    {
-      g_clear_object(&self->lpd_host);
-
-      add_devices_to_list (self, devices);
-
-      update_dialog_state (self);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("%s", error->message);
-
-          g_clear_object(&self->lpd_host);
-
-          update_dialog_state (self);
-        }
-    }
-}
-
 static void
 get_cups_devices (PpNewPrinterDialog *self)
 {
@@ -1114,57 +1019,61 @@ static gboolean
 search_for_remote_printers (THostSearchData *data)
 {
   PpNewPrinterDialog *self = data->dialog;
+  PpHostProbes        port_probes = PP_HOST_PROBE_ALL;
 
   g_cancellable_cancel (self->remote_host_cancellable);
   g_clear_object (&self->remote_host_cancellable);
 
   self->remote_host_cancellable = g_cancellable_new ();
 
-  self->remote_cups_host = pp_host_new (data->host_name);
-  self->snmp_host = pp_host_new (data->host_name);
-  self->socket_host = pp_host_new (data->host_name);
-  self->lpd_host = pp_host_new (data->host_name);
+  g_clear_object (&self->remote_host);
+  g_clear_object (&self->remote_default_ports_host);
+
+  self->remote_host = pp_host_new (data->host_name);
 
   if (data->host_port != PP_HOST_UNSET_PORT)
     {
-      g_object_set (self->remote_cups_host, "port", data->host_port, NULL);
-      g_object_set (self->snmp_host, "port", data->host_port, NULL);
+      g_object_set (self->remote_host, "port", data->host_port, NULL);
+
+      port_probes = PP_HOST_PROBE_SNMP | PP_HOST_PROBE_REMOTE_CUPS;
 
       /* Accept port different from the default one only if user specifies
        * scheme (for socket and lpd printers).
        */
       if (data->host_scheme != NULL &&
           g_ascii_strcasecmp (data->host_scheme, "socket") == 0)
-        g_object_set (self->socket_host, "port", data->host_port, NULL);
+        port_probes |= PP_HOST_PROBE_JETDIRECT;
 
       if (data->host_scheme != NULL &&
           g_ascii_strcasecmp (data->host_scheme, "lpd") == 0)
-        g_object_set (self->lpd_host, "port", data->host_port, NULL);
+        port_probes |= PP_HOST_PROBE_LPD;
+
+      self->remote_default_ports_host = pp_host_new (data->host_name);
     }
 
   self->samba_host = pp_samba_new (data->host_name);
 
   update_dialog_state (data->dialog);
 
-  pp_host_get_remote_cups_devices_async (self->remote_cups_host,
-                                         self->remote_host_cancellable,
-                                         get_remote_cups_devices_cb,
-                                         data->dialog);
-
-  pp_host_get_snmp_devices_async (self->snmp_host,
-                                  self->remote_host_cancellable,
-                                  get_snmp_devices_cb,
-                                  data->dialog);
-
-  pp_host_get_jetdirect_devices_async (self->socket_host,
-                                       self->remote_host_cancellable,
-                                       get_jetdirect_devices_cb,
-                                       data->dialog);
-
-  pp_host_get_lpd_devices_async (self->lpd_host,
-                                 self->remote_host_cancellable,
-                                 get_lpd_devices_cb,
-                                 data->dialog);
+  /* All probes of the host run at once, with a common deadline */
+  pp_host_get_devices_async (self->remote_host,
+                             port_probes,
+                             HOST_SEARCH_TIMEOUT,
+                             self->remote_host_cancellable,
+                             remote_host_devices_found_cb,
+                             data->dialog,
+                             get_remote_host_devices_cb,
+                             data->dialog);
+
+  if (self->remote_default_ports_host != NULL)
+    pp_host_get_devices_async (self->remote_default_ports_host,
+                               PP_HOST_PROBE_ALL & ~port_probes,
+                               HOST_SEARCH_TIMEOUT,
+                               self->remote_host_cancellable,
+                               remote_host_devices_found_cb,
+                               data->dialog,
+                               get_remote_host_devices_cb,
+                               data->dialog);
 
   pp_samba_get_devices_async (self->samba_host,
                               FALSE,
@@ -1816,10 +1725,8 @@ pp_new_printer_dialog_dispose (GObject *object)
   g_clear_object (&self->local_printer_icon);
   g_clear_object (&self->remote_printer_icon);
   g_clear_object (&self->authenticated_server_icon);
-  g_clear_object (&self->snmp_host);
-  g_clear_object (&self->socket_host);
-  g_clear_object (&self->lpd_host);
-  g_clear_object (&self->remote_cups_host);
+  g_clear_object (&self->remote_host);
+  g_clear_object (&self->remote_default_ports_host);
   g_clear_object (&self->samba_host);
 
   if (self->ppd_selection_dialog != NULL)
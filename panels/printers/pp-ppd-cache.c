@@ -0,0 +1,439 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <cups/cups.h>
+
+#include "pp-ppd-cache.h"
+
+/*
+ * On-disk cache of the normalized PPD catalogue returned by CUPS_GET_PPDS.
+ *
+ * The file is laid out so that it can be used straight from a mapping:
+ * a fixed header, a table of manufacturers sorted by normalized name,
+ * a table of PPDs grouped by manufacturer and a pool of NUL-terminated
+ * strings. Tables only contain offsets into the string pool.
+ */
+
+#define PPD_CACHE_MAGIC   "GCCPPDC"
+#define PPD_CACHE_VERSION 1
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 version;
+  guint32 n_manufacturers;
+  guint32 n_ppds;
+  guint32 strings_size;
+  guint64 stamp;
+} PpdCacheHeader;
+
+typedef struct
+{
+  guint32 name;
+  guint32 display_name;
+  guint32 first_ppd;
+  guint32 n_ppds;
+} PpdCacheManufacturer;
+
+typedef struct
+{
+  guint32 name;
+  guint32 display_name;
+} PpdCachePpd;
+
+G_STATIC_ASSERT (sizeof (PpdCacheHeader) == 32);
+G_STATIC_ASSERT (sizeof (PpdCacheManufacturer) == 16);
+G_STATIC_ASSERT (sizeof (PpdCachePpd) == 8);
+
+/* Directories cups-driverd looks for PPDs and driver programs in */
+static const gchar * const default_driver_directories[] = {
+  "/usr/share/cups/model",
+  "/usr/share/cups/drv",
+  "/usr/share/ppd",
+  "/usr/share/model",
+  "/usr/local/share/ppd",
+  "/opt/share/ppd",
+  "/usr/lib/cups/driver",
+  "/usr/libexec/cups/driver",
+  NULL
+};
+
+gchar *
+pp_ppd_cache_get_default_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           "printers",
+                           "ppds",
+                           NULL);
+}
+
+static void
+add_directory_to_checksum (GChecksum   *checksum,
+                           const gchar *path,
+                           gboolean     recurse)
+{
+  g_autoptr(GDir)  dir = NULL;
+  g_autofree gchar *line = NULL;
+  GStatBuf         buf;
+  const gchar     *name;
+
+  if (g_stat (path, &buf) != 0 || !S_ISDIR (buf.st_mode))
+    return;
+
+  line = g_strdup_printf ("%s:%" G_GINT64_FORMAT ".%ld\n",
+                          path,
+                          (gint64) buf.st_mtim.tv_sec,
+                          (long) buf.st_mtim.tv_nsec);
+  g_checksum_update (checksum, (const guchar *) line, -1);
+
+  if (!recurse)
+    return;
+
+  /*
+   * Drivers are usually installed into a subdirectory per vendor
+   * (e.g. /usr/share/ppd/gutenprint), so look one level deeper.
+   */
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *subdir = g_build_filename (path, name, NULL);
+
+      add_directory_to_checksum (checksum, subdir, FALSE);
+    }
+}
+
+/*
+ * Computes a stamp identifying the state of given driver directories.
+ * It changes whenever a driver is added to or removed from them.
+ */
+guint64
+pp_ppd_cache_compute_stamp (const gchar * const *directories)
+{
+  g_autoptr(GChecksum) checksum = NULL;
+  guint8               digest[32];
+  gsize                digest_len = sizeof (digest);
+  guint64              stamp = 0;
+  gint                 i;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) PPD_CACHE_MAGIC, -1);
+
+  for (i = 0; directories != NULL && directories[i] != NULL; i++)
+    add_directory_to_checksum (checksum, directories[i], TRUE);
+
+  g_checksum_get_digest (checksum, digest, &digest_len);
+  for (i = 0; i < sizeof (stamp); i++)
+    stamp = (stamp << 8) | digest[i];
+
+  /* 0 means "not cacheable" */
+  return stamp != 0 ? stamp : 1;
+}
+
+/*
+ * Returns stamp of the local CUPS driver directories or 0 if the catalogue
+ * should not be cached, e.g. because it comes from a remote server.
+ */
+guint64
+pp_ppd_cache_get_default_stamp (void)
+{
+  g_autoptr(GPtrArray) directories = NULL;
+  const gchar         *server;
+  const gchar         *env;
+  gint                 i;
+
+  server = cupsServer ();
+  if (server != NULL &&
+      server[0] != '/' &&
+      g_strcmp0 (server, "localhost") != 0 &&
+      !g_str_has_prefix (server, "localhost:") &&
+      !g_str_has_prefix (server, "127.0.0.1") &&
+      !g_str_has_prefix (server, "[::1]"))
+    return 0;
+
+  directories = g_ptr_array_new_with_free_func (g_free);
+
+  env = g_getenv ("CUPS_DATADIR");
+  if (env != NULL)
+    {
+      g_ptr_array_add (directories, g_build_filename (env, "model", NULL));
+      g_ptr_array_add (directories, g_build_filename (env, "drv", NULL));
+    }
+
+  env = g_getenv ("CUPS_SERVERBIN");
+  if (env != NULL)
+    g_ptr_array_add (directories, g_build_filename (env, "driver", NULL));
+
+  for (i = 0; default_driver_directories[i] != NULL; i++)
+    g_ptr_array_add (directories, g_strdup (default_driver_directories[i]));
+
+  g_ptr_array_add (directories, NULL);
+
+  return pp_ppd_cache_compute_stamp ((const gchar * const *) directories->pdata);
+}
+
+static const gchar *
+cache_string (const gchar *strings,
+              guint32      strings_size,
+              guint32      offset)
+{
+  if (offset >= strings_size)
+    return NULL;
+
+  return strings + offset;
+}
+
+/*
+ * Loads PPD catalogue from cache file at given path.
+ * Returns NULL if the cache is missing, corrupted or its stamp
+ * does not match.
+ */
+PPDList *
+pp_ppd_cache_load (const gchar *path,
+                   guint64      stamp)
+{
+  g_autoptr(GMappedFile)      file = NULL;
+  g_autoptr(GError)           error = NULL;
+  const PpdCacheHeader       *header;
+  const PpdCacheManufacturer *manufacturers;
+  const PpdCachePpd          *ppds;
+  const gchar                *contents;
+  const gchar                *strings;
+  PPDList                    *result;
+  gsize                       length;
+  gsize                       expected_length;
+  guint32                     i, j;
+
+  if (stamp == 0)
+    return NULL;
+
+  file = g_mapped_file_new (path, FALSE, &error);
+  if (file == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Could not open PPD cache '%s': %s", path, error->message);
+      return NULL;
+    }
+
+  contents = g_mapped_file_get_contents (file);
+  length = g_mapped_file_get_length (file);
+
+  if (length < sizeof (PpdCacheHeader))
+    return NULL;
+
+  header = (const PpdCacheHeader *) contents;
+  if (memcmp (header->magic, PPD_CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+      header->version != PPD_CACHE_VERSION ||
+      header->stamp != stamp)
+    return NULL;
+
+  expected_length = sizeof (PpdCacheHeader) +
+                    (gsize) header->n_manufacturers * sizeof (PpdCacheManufacturer) +
+                    (gsize) header->n_ppds * sizeof (PpdCachePpd) +
+                    header->strings_size;
+  if (length != expected_length ||
+      header->strings_size == 0)
+    return NULL;
+
+  manufacturers = (const PpdCacheManufacturer *) (contents + sizeof (PpdCacheHeader));
+  ppds = (const PpdCachePpd *) (manufacturers + header->n_manufacturers);
+  strings = (const gchar *) (ppds + header->n_ppds);
+
+  if (strings[header->strings_size - 1] != '\0')
+    return NULL;
+
+  result = g_new0 (PPDList, 1);
+  result->num_of_manufacturers = header->n_manufacturers;
+  result->manufacturers = g_new0 (PPDManufacturerItem *, header->n_manufacturers);
+
+  for (i = 0; i < header->n_manufacturers; i++)
+    {
+      const PpdCacheManufacturer *manufacturer = &manufacturers[i];
+      PPDManufacturerItem        *item;
+      const gchar                *name;
+      const gchar                *display_name;
+
+      name = cache_string (strings, header->strings_size, manufacturer->name);
+      display_name = cache_string (strings, header->strings_size, manufacturer->display_name);
+
+      if (name == NULL || display_name == NULL ||
+          manufacturer->first_ppd > header->n_ppds ||
+          manufacturer->n_ppds > header->n_ppds - manufacturer->first_ppd)
+        goto corrupted;
+
+      item = g_new0 (PPDManufacturerItem, 1);
+      item->manufacturer_name = g_strdup (name);
+      item->manufacturer_display_name = g_strdup (display_name);
+      item->num_of_ppds = manufacturer->n_ppds;
+      item->ppds = g_new0 (PPDName *, manufacturer->n_ppds);
+      result->manufacturers[i] = item;
+
+      for (j = 0; j < manufacturer->n_ppds; j++)
+        {
+          const PpdCachePpd *ppd = &ppds[manufacturer->first_ppd + j];
+          const gchar       *ppd_name;
+          const gchar       *ppd_display_name;
+
+          ppd_name = cache_string (strings, header->strings_size, ppd->name);
+          ppd_display_name = cache_string (strings, header->strings_size, ppd->display_name);
+          if (ppd_name == NULL || ppd_display_name == NULL)
+            goto corrupted;
+
+          item->ppds[j] = g_new0 (PPDName, 1);
+          item->ppds[j]->ppd_name = g_strdup (ppd_name);
+          item->ppds[j]->ppd_display_name = g_strdup (ppd_display_name);
+          item->ppds[j]->ppd_match_level = -1;
+        }
+    }
+
+  return result;
+
+corrupted:
+  g_debug ("PPD cache '%s' is corrupted", path);
+
+  /* Drop partially filled tail so that ppd_list_free() can handle it */
+  for (i = 0; i < result->num_of_manufacturers; i++)
+    {
+      if (result->manufacturers[i] == NULL)
+        break;
+
+      for (j = 0; j < result->manufacturers[i]->num_of_ppds; j++)
+        if (result->manufacturers[i]->ppds[j] == NULL)
+          break;
+      result->manufacturers[i]->num_of_ppds = j;
+    }
+  result->num_of_manufacturers = i;
+  ppd_list_free (result);
+
+  return NULL;
+}
+
+static guint32
+add_string (GByteArray  *strings,
+            GHashTable  *offsets,
+            const gchar *string)
+{
+  gpointer offset;
+
+  if (string == NULL)
+    string = "";
+
+  /* Model names repeat a lot across drivers, store each of them once */
+  if (g_hash_table_lookup_extended (offsets, string, NULL, &offset))
+    return GPOINTER_TO_UINT (offset);
+
+  offset = GUINT_TO_POINTER (strings->len);
+  g_byte_array_append (strings, (const guint8 *) string, strlen (string) + 1);
+  g_hash_table_insert (offsets, (gpointer) string, offset);
+
+  return GPOINTER_TO_UINT (offset);
+}
+
+/*
+ * Stores PPD catalogue to cache file at given path, atomically
+ * replacing previous content.
+ */
+gboolean
+pp_ppd_cache_save (const gchar  *path,
+                   guint64       stamp,
+                   PPDList      *list,
+                   GError      **error)
+{
+  g_autoptr(GByteArray) contents = NULL;
+  g_autoptr(GByteArray) strings = NULL;
+  g_autoptr(GHashTable) offsets = NULL;
+  g_autofree gchar     *dir = NULL;
+  PpdCacheHeader        header = { { 0 } };
+  PpdCacheManufacturer *manufacturers;
+  PpdCachePpd          *ppds;
+  gsize                 n_ppds = 0;
+  gsize                 ppd_index = 0;
+  gsize                 i, j;
+
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (list != NULL, FALSE);
+  g_return_val_if_fail (stamp != 0, FALSE);
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    n_ppds += list->manufacturers[i]->num_of_ppds;
+
+  manufacturers = g_new0 (PpdCacheManufacturer, list->num_of_manufacturers);
+  ppds = g_new0 (PpdCachePpd, n_ppds);
+  strings = g_byte_array_new ();
+  offsets = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item = list->manufacturers[i];
+
+      manufacturers[i].name = add_string (strings, offsets, item->manufacturer_name);
+      manufacturers[i].display_name = add_string (strings, offsets, item->manufacturer_display_name);
+      manufacturers[i].first_ppd = ppd_index;
+      manufacturers[i].n_ppds = item->num_of_ppds;
+
+      for (j = 0; j < item->num_of_ppds; j++, ppd_index++)
+        {
+          ppds[ppd_index].name = add_string (strings, offsets, item->ppds[j]->ppd_name);
+          ppds[ppd_index].display_name = add_string (strings, offsets, item->ppds[j]->ppd_display_name);
+        }
+    }
+
+  /* Keep at least one byte in the pool so that loading can validate it */
+  if (strings->len == 0)
+    add_string (strings, offsets, "");
+
+  memcpy (header.magic, PPD_CACHE_MAGIC, sizeof (header.magic));
+  header.version = PPD_CACHE_VERSION;
+  header.n_manufacturers = list->num_of_manufacturers;
+  header.n_ppds = n_ppds;
+  header.strings_size = strings->len;
+  header.stamp = stamp;
+
+  contents = g_byte_array_sized_new (sizeof (header) +
+                                     list->num_of_manufacturers * sizeof (PpdCacheManufacturer) +
+                                     n_ppds * sizeof (PpdCachePpd) +
+                                     strings->len);
+  g_byte_array_append (contents, (const guint8 *) &header, sizeof (header));
+  g_byte_array_append (contents, (const guint8 *) manufacturers,
+                       list->num_of_manufacturers * sizeof (PpdCacheManufacturer));
+  g_byte_array_append (contents, (const guint8 *) ppds, n_ppds * sizeof (PpdCachePpd));
+  g_byte_array_append (contents, strings->data, strings->len);
+
+  g_free (manufacturers);
+  g_free (ppds);
+
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+                   "Could not create directory '%s': %s", dir, g_strerror (errsv));
+      return FALSE;
+    }
+
+  return g_file_set_contents (path, (const gchar *) contents->data, contents->len, error);
+}
@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "pp-utils.h"
+
+G_BEGIN_DECLS
+
+gchar    *pp_ppd_cache_get_default_path  (void);
+
+guint64   pp_ppd_cache_compute_stamp     (const gchar * const *directories);
+
+guint64   pp_ppd_cache_get_default_stamp (void);
+
+PPDList  *pp_ppd_cache_load              (const gchar  *path,
+                                          guint64       stamp);
+
+gboolean  pp_ppd_cache_save              (const gchar  *path,
+                                          guint64       stamp,
+                                          PPDList      *list,
+                                          GError      **error);
+
+G_END_DECLS
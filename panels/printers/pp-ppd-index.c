@@ -0,0 +1,389 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "pp-ppd-index.h"
+
+/*
+ * Trigram index over manufacturer and model names of a PPDList.
+ *
+ * Every PPD is a document whose text is the normalized manufacturer name,
+ * all known variants of it (so that "hp" finds "Hewlett-Packard" and vice
+ * versa) and the normalized model name. Each word is padded with spaces
+ * and split into trigrams, which map to sorted lists of documents.
+ *
+ * A query matches documents sharing at least half of its trigrams, which
+ * tolerates typos and different spelling of model numbers. Matches are
+ * then ranked by shared trigrams and by whole word and prefix hits.
+ */
+
+#define SCORE_TRIGRAM      10
+#define SCORE_WORD_MATCH   50
+#define SCORE_PREFIX_MATCH 30
+#define SCORE_INFIX_MATCH  15
+
+typedef struct
+{
+  guint32 manufacturer;
+  guint32 ppd;
+  guint32 text;
+  guint32 text_len;
+} PpPPDIndexDocument;
+
+struct _PpPPDIndex
+{
+  PPDList    *list;
+  GArray     *documents;
+  GString    *texts;
+  GHashTable *trigrams;
+};
+
+/*
+ * Appends lowercase alphanumeric words of given string separated by single
+ * spaces. Letters and digits are split into separate words so that
+ * "LaserJet4250" and "laserjet 4250" are the same.
+ */
+static void
+append_normalized (GString     *out,
+                   const gchar *string)
+{
+  gchar previous = ' ';
+  gsize start = out->len;
+
+  if (string == NULL)
+    return;
+
+  for (; *string != '\0'; string++)
+    {
+      gchar c = g_ascii_tolower (*string);
+      gboolean is_word = g_ascii_isalnum (c) || (guchar) c >= 0x80;
+
+      if (is_word)
+        {
+          if (previous != ' ' &&
+              g_ascii_isdigit (previous) != g_ascii_isdigit (c))
+            g_string_append_c (out, ' ');
+
+          g_string_append_c (out, c);
+          previous = c;
+        }
+      else if (previous != ' ')
+        {
+          g_string_append_c (out, ' ');
+          previous = ' ';
+        }
+    }
+
+  if (out->len > start && out->str[out->len - 1] == ' ')
+    g_string_truncate (out, out->len - 1);
+}
+
+static inline guint32
+pack_trigram (guchar a,
+              guchar b,
+              guchar c)
+{
+  return ((guint32) a << 16) | ((guint32) b << 8) | c;
+}
+
+/*
+ * Calls given function for each trigram of each word in the text,
+ * with words padded by a space on both sides.
+ */
+static void
+foreach_trigram (const gchar *text,
+                 gsize        text_len,
+                 void       (*func) (guint32 trigram, gpointer user_data),
+                 gpointer     user_data)
+{
+  gsize i;
+
+  for (i = 0; i < text_len; i++)
+    {
+      guchar previous = (i == 0) ? ' ' : text[i - 1];
+      guchar current = text[i];
+      guchar next = (i + 1 < text_len) ? text[i + 1] : ' ';
+
+      if (current == ' ')
+        continue;
+
+      /* Start of a word */
+      if (previous == ' ')
+        func (pack_trigram (' ', current, next), user_data);
+
+      if (next != ' ')
+        {
+          guchar after = (i + 2 < text_len) ? text[i + 2] : ' ';
+
+          func (pack_trigram (current, next, after), user_data);
+        }
+    }
+}
+
+typedef struct
+{
+  GHashTable *trigrams;
+  guint32     document;
+} AddData;
+
+static void
+add_posting (guint32  trigram,
+             gpointer user_data)
+{
+  AddData *data = user_data;
+  GArray  *postings;
+
+  postings = g_hash_table_lookup (data->trigrams, GUINT_TO_POINTER (trigram));
+  if (postings == NULL)
+    {
+      postings = g_array_new (FALSE, FALSE, sizeof (guint32));
+      g_hash_table_insert (data->trigrams, GUINT_TO_POINTER (trigram), postings);
+    }
+
+  /* Documents are added in order, so this keeps the list sorted and unique */
+  if (postings->len == 0 ||
+      g_array_index (postings, guint32, postings->len - 1) != data->document)
+    g_array_append_val (postings, data->document);
+}
+
+/*
+ * Builds index of given list. The list has to outlive the index.
+ */
+PpPPDIndex *
+pp_ppd_index_new (PPDList *list)
+{
+  PpPPDIndex *index;
+  g_autoptr(GString) prefix = NULL;
+  gsize       i, j;
+
+  index = g_new0 (PpPPDIndex, 1);
+  index->list = list;
+  index->documents = g_array_new (FALSE, FALSE, sizeof (PpPPDIndexDocument));
+  index->texts = g_string_new (NULL);
+  index->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) g_array_unref);
+
+  if (list == NULL)
+    return index;
+
+  prefix = g_string_new (NULL);
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *manufacturer = list->manufacturers[i];
+      g_auto(GStrv)        aliases = NULL;
+
+      g_string_truncate (prefix, 0);
+      append_normalized (prefix, manufacturer->manufacturer_display_name);
+
+      aliases = get_manufacturers_aliases (manufacturer->manufacturer_display_name);
+      for (j = 0; aliases[j] != NULL; j++)
+        {
+          g_string_append_c (prefix, ' ');
+          append_normalized (prefix, aliases[j]);
+        }
+
+      for (j = 0; j < manufacturer->num_of_ppds; j++)
+        {
+          PpPPDIndexDocument document;
+          AddData            data;
+
+          document.manufacturer = i;
+          document.ppd = j;
+          document.text = index->texts->len;
+
+          g_string_append_len (index->texts, prefix->str, prefix->len);
+          g_string_append_c (index->texts, ' ');
+          append_normalized (index->texts, manufacturer->ppds[j]->ppd_display_name);
+
+          document.text_len = index->texts->len - document.text;
+          g_string_append_c (index->texts, '\0');
+
+          data.trigrams = index->trigrams;
+          data.document = index->documents->len;
+          foreach_trigram (index->texts->str + document.text, document.text_len,
+                           add_posting, &data);
+
+          g_array_append_val (index->documents, document);
+        }
+    }
+
+  return index;
+}
+
+void
+pp_ppd_index_free (PpPPDIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_array_unref (index->documents);
+  g_string_free (index->texts, TRUE);
+  g_hash_table_unref (index->trigrams);
+  g_free (index);
+}
+
+static void
+add_query_trigram (guint32  trigram,
+                   gpointer user_data)
+{
+  GArray *query_trigrams = user_data;
+  guint   i;
+
+  for (i = 0; i < query_trigrams->len; i++)
+    if (g_array_index (query_trigrams, guint32, i) == trigram)
+      return;
+
+  g_array_append_val (query_trigrams, trigram);
+}
+
+static gint
+score_word (const gchar *text,
+            const gchar *word,
+            gsize        word_len)
+{
+  const gchar *p;
+  gint         best = 0;
+
+  for (p = strstr (text, word); p != NULL; p = strstr (p + 1, word))
+    {
+      gboolean at_start = (p == text || p[-1] == ' ');
+      gboolean at_end = (p[word_len] == ' ' || p[word_len] == '\0');
+
+      if (at_start && at_end)
+        return SCORE_WORD_MATCH;
+      else if (at_start)
+        best = MAX (best, SCORE_PREFIX_MATCH);
+      else
+        best = MAX (best, SCORE_INFIX_MATCH);
+    }
+
+  return best;
+}
+
+typedef struct
+{
+  PpPPDIndexMatch  match;
+  const gchar     *text;
+} ScoredMatch;
+
+static gint
+compare_matches (gconstpointer a,
+                 gconstpointer b)
+{
+  const ScoredMatch *match_a = a;
+  const ScoredMatch *match_b = b;
+
+  if (match_a->match.score != match_b->match.score)
+    return match_b->match.score - match_a->match.score;
+
+  return strcmp (match_a->text, match_b->text);
+}
+
+/*
+ * Returns array of PpPPDIndexMatch ordered by relevance,
+ * with at most max_results items (0 for no limit).
+ */
+GArray *
+pp_ppd_index_search (PpPPDIndex  *index,
+                     const gchar *query,
+                     guint        max_results)
+{
+  g_autoptr(GString) normalized = NULL;
+  g_autoptr(GArray)  query_trigrams = NULL;
+  g_autoptr(GArray)  touched = NULL;
+  g_autoptr(GArray)  scored = NULL;
+  g_auto(GStrv)      words = NULL;
+  g_autofree guint16 *counts = NULL;
+  GArray            *result;
+  guint              min_count;
+  guint              i, j;
+
+  result = g_array_new (FALSE, FALSE, sizeof (PpPPDIndexMatch));
+
+  g_return_val_if_fail (index != NULL, result);
+
+  normalized = g_string_new (NULL);
+  append_normalized (normalized, query);
+  if (normalized->len == 0 || index->documents->len == 0)
+    return result;
+
+  query_trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+  foreach_trigram (normalized->str, normalized->len, add_query_trigram, query_trigrams);
+
+  /* Count shared trigrams of every document touched by the query */
+  counts = g_new0 (guint16, index->documents->len);
+  touched = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (i = 0; i < query_trigrams->len; i++)
+    {
+      GArray *postings;
+
+      postings = g_hash_table_lookup (index->trigrams,
+                                      GUINT_TO_POINTER (g_array_index (query_trigrams, guint32, i)));
+      if (postings == NULL)
+        continue;
+
+      for (j = 0; j < postings->len; j++)
+        {
+          guint32 document = g_array_index (postings, guint32, j);
+
+          if (counts[document]++ == 0)
+            g_array_append_val (touched, document);
+        }
+    }
+
+  min_count = MAX (1, (query_trigrams->len + 1) / 2);
+  words = g_strsplit (normalized->str, " ", -1);
+  scored = g_array_new (FALSE, FALSE, sizeof (ScoredMatch));
+
+  for (i = 0; i < touched->len; i++)
+    {
+      guint32             id = g_array_index (touched, guint32, i);
+      PpPPDIndexDocument *document;
+      ScoredMatch         match;
+
+      if (counts[id] < min_count)
+        continue;
+
+      document = &g_array_index (index->documents, PpPPDIndexDocument, id);
+
+      match.text = index->texts->str + document->text;
+      match.match.manufacturer = index->list->manufacturers[document->manufacturer];
+      match.match.ppd = match.match.manufacturer->ppds[document->ppd];
+      match.match.score = counts[id] * SCORE_TRIGRAM;
+
+      for (j = 0; words[j] != NULL; j++)
+        match.match.score += score_word (match.text, words[j], strlen (words[j]));
+
+      /* Prefer shorter names, they are usually the more generic driver */
+      match.match.score -= document->text_len / 8;
+
+      g_array_append_val (scored, match);
+    }
+
+  g_array_sort (scored, compare_matches);
+
+  for (i = 0; i < scored->len && (max_results == 0 || i < max_results); i++)
+    g_array_append_val (result, g_array_index (scored, ScoredMatch, i).match);
+
+  return result;
+}
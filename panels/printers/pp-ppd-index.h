@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2024  GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "pp-utils.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PpPPDIndex PpPPDIndex;
+
+typedef struct
+{
+  PPDManufacturerItem *manufacturer;
+  PPDName             *ppd;
+  gint                 score;
+} PpPPDIndexMatch;
+
+PpPPDIndex *pp_ppd_index_new    (PPDList     *list);
+
+void        pp_ppd_index_free   (PpPPDIndex  *index);
+
+GArray     *pp_ppd_index_search (PpPPDIndex  *index,
+                                 const gchar *query,
+                                 guint        max_results);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PpPPDIndex, pp_ppd_index_free)
+
+G_END_DECLS
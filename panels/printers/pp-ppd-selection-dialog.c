@@ -31,6 +31,9 @@
 #include <gtk/gtk.h>
 
 #include "pp-ppd-selection-dialog.h"
+#include "pp-ppd-index.h"
+
+#define MAX_SEARCH_RESULTS 200
 
 enum
 {
@@ -51,6 +54,7 @@ struct _PpPPDSelectionDialog {
   GtkButton   *ppd_selection_select_button;
   GtkSpinner  *ppd_spinner;
   GtkLabel    *progress_label;
+  GtkSearchEntry *ppd_selection_search_entry;
   GtkTreeView *ppd_selection_manufacturers_treeview;
   GtkTreeView *ppd_selection_models_treeview;
 
@@ -61,7 +65,8 @@ struct _PpPPDSelectionDialog {
   gchar           *ppd_display_name;
   gchar           *manufacturer;
 
-  PPDList *list;
+  PPDList    *list;
+  PpPPDIndex *index;
 };
 
 G_DEFINE_TYPE (PpPPDSelectionDialog, pp_ppd_selection_dialog, ADW_TYPE_WINDOW)
@@ -121,6 +126,52 @@ manufacturer_selection_changed_cb (PpPPDSelectionDialog *self)
     }
 }
 
+static void
+search_changed_cb (PpPPDSelectionDialog *self)
+{
+  g_autoptr(GtkListStore) store = NULL;
+  g_autoptr(GArray)       matches = NULL;
+  GtkTreeSelection       *selection;
+  GtkTreeIter             iter;
+  const gchar            *query;
+  guint                   i;
+
+  if (self->list == NULL)
+    return;
+
+  selection = gtk_tree_view_get_selection (self->ppd_selection_manufacturers_treeview);
+
+  query = gtk_editable_get_text (GTK_EDITABLE (self->ppd_selection_search_entry));
+  if (query == NULL || query[0] == '\0')
+    {
+      /* The search left no manufacturer selected, so no models to show */
+      gtk_tree_view_set_model (self->ppd_selection_models_treeview, NULL);
+      gtk_widget_set_sensitive (GTK_WIDGET (self->ppd_selection_manufacturers_treeview), TRUE);
+      manufacturer_selection_changed_cb (self);
+      return;
+    }
+
+  /* Matches come from all manufacturers */
+  gtk_tree_selection_unselect_all (selection);
+  gtk_widget_set_sensitive (GTK_WIDGET (self->ppd_selection_manufacturers_treeview), FALSE);
+
+  matches = pp_ppd_index_search (self->index, query, MAX_SEARCH_RESULTS);
+
+  store = gtk_list_store_new (2, G_TYPE_STRING, G_TYPE_STRING);
+  for (i = 0; i < matches->len; i++)
+    {
+      PpPPDIndexMatch *match = &g_array_index (matches, PpPPDIndexMatch, i);
+
+      gtk_list_store_insert_with_values (store, &iter, -1,
+                                         PPD_NAMES_COLUMN, match->ppd->ppd_name,
+                                         PPD_DISPLAY_NAMES_COLUMN, match->ppd->ppd_display_name,
+                                         -1);
+    }
+
+  gtk_tree_view_set_model (self->ppd_selection_models_treeview, GTK_TREE_MODEL (store));
+  gtk_tree_view_columns_autosize (self->ppd_selection_models_treeview);
+}
+
 static void
 model_selection_changed_cb (PpPPDSelectionDialog *self)
 {
@@ -311,6 +362,8 @@ pp_ppd_selection_dialog_new (PPDList              *ppd_list,
   self->user_data = user_data;
 
   self->list = ppd_list_copy (ppd_list);
+  if (self->list != NULL)
+    self->index = pp_ppd_index_new (self->list);
 
   self->manufacturer = get_standard_manufacturers_name (manufacturer);
 
@@ -339,6 +392,7 @@ pp_ppd_selection_dialog_dispose (GObject *object)
   g_clear_pointer (&self->ppd_name, g_free);
   g_clear_pointer (&self->ppd_display_name, g_free);
   g_clear_pointer (&self->manufacturer, g_free);
+  g_clear_pointer (&self->index, pp_ppd_index_free);
 
   G_OBJECT_CLASS (pp_ppd_selection_dialog_parent_class)->dispose (object);
 }
@@ -354,9 +408,11 @@ pp_ppd_selection_dialog_class_init (PpPPDSelectionDialogClass *klass)
   gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, ppd_selection_select_button);
   gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, ppd_spinner);
   gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, progress_label);
+  gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, ppd_selection_search_entry);
   gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, ppd_selection_manufacturers_treeview);
   gtk_widget_class_bind_template_child (widget_class, PpPPDSelectionDialog, ppd_selection_models_treeview);
 
+  gtk_widget_class_bind_template_callback (widget_class, search_changed_cb);
   gtk_widget_class_bind_template_callback (widget_class, select_cb);
   gtk_widget_class_bind_template_callback (widget_class, cancel_cb);
 
@@ -388,6 +444,10 @@ void
 pp_ppd_selection_dialog_set_ppd_list (PpPPDSelectionDialog *self,
                                       PPDList              *list)
 {
+  g_clear_pointer (&self->index, pp_ppd_index_free);
   self->list = list;
+  if (self->list != NULL)
+    self->index = pp_ppd_index_new (self->list);
   fill_ppds_list (self);
+  search_changed_cb (self);
 }
@@ -78,8 +78,6 @@ struct _PpPrinterEntry
 
   /* Dialogs */
   PpJobsDialog    *pp_jobs_dialog;
-
-  GCancellable *get_jobs_cancellable;
 };
 
 struct _PpPrinterEntryClass
@@ -507,29 +505,13 @@ printer_remove_cb (PpPrinterEntry *self)
   g_signal_emit_by_name (self, "printer-delete");
 }
 
-static void
-get_jobs_cb (GObject      *source_object,
-             GAsyncResult *result,
-             gpointer      user_data)
+void
+pp_printer_entry_set_jobs_count (PpPrinterEntry *self,
+                                 guint           jobs_count)
 {
-  PpPrinterEntry      *self = user_data;
-  g_autoptr(GError)    error = NULL;
-  g_autoptr(GPtrArray) jobs = NULL;
-  g_autofree gchar    *button_label = NULL;
+  g_autofree gchar *button_label = NULL;
 
-  jobs = pp_printer_get_jobs_finish (PP_PRINTER (source_object), result, &error);
-
-  if (error != NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          g_warning ("Could not get jobs: %s", error->message);
-        }
-
-      return;
-    }
-
-  if (jobs->len == 0)
+  if (jobs_count == 0)
     {
       /* Translators: This is the label of the button that opens the Jobs Dialog. */
       button_label = g_strdup (_("No Active Jobs"));
@@ -537,37 +519,16 @@ get_jobs_cb (GObject      *source_object,
   else
     {
       /* Translators: This is the label of the button that opens the Jobs Dialog. */
-      button_label = g_strdup_printf (ngettext ("%u Job", "%u Jobs", jobs->len), jobs->len);
+      button_label = g_strdup_printf (ngettext ("%u Job", "%u Jobs", jobs_count), jobs_count);
     }
 
   gtk_button_set_label (GTK_BUTTON (self->show_jobs_dialog_button), button_label);
-  gtk_widget_set_sensitive (self->show_jobs_dialog_button, jobs->len > 0);
+  gtk_widget_set_sensitive (self->show_jobs_dialog_button, jobs_count > 0);
 
   if (self->pp_jobs_dialog != NULL)
     {
       pp_jobs_dialog_update (self->pp_jobs_dialog);
     }
-
-  g_clear_object (&self->get_jobs_cancellable);
-}
-
-void
-pp_printer_entry_update_jobs_count (PpPrinterEntry *self)
-{
-  g_autoptr(PpPrinter) printer = NULL;
-
-  g_cancellable_cancel (self->get_jobs_cancellable);
-  g_clear_object (&self->get_jobs_cancellable);
-
-  self->get_jobs_cancellable = g_cancellable_new ();
-
-  printer = pp_printer_new (self->printer_name);
-  pp_printer_get_jobs_async (printer,
-                             TRUE,
-                             CUPS_WHICHJOBS_ACTIVE,
-                             self->get_jobs_cancellable,
-                             get_jobs_cb,
-                             self);
 }
 
 static gboolean
@@ -932,7 +893,9 @@ pp_printer_entry_update (PpPrinterEntry *self,
   gtk_widget_set_visible (GTK_WIDGET (self->printer_inklevel_label), !ink_supply_is_empty);
   gtk_widget_set_visible (GTK_WIDGET (self->supply_frame), !ink_supply_is_empty);
 
-  pp_printer_entry_update_jobs_count (self);
+  /* Job states are reported as printer state changes */
+  if (self->pp_jobs_dialog != NULL)
+    pp_jobs_dialog_update (self->pp_jobs_dialog);
 
   gtk_widget_action_set_enabled (GTK_WIDGET (self), "printer.default", self->is_authorized);
   gtk_widget_action_set_enabled (GTK_WIDGET (self), "printer.remove", self->is_authorized);
@@ -960,7 +923,6 @@ pp_printer_entry_dispose (GObject *object)
 {
   PpPrinterEntry *self = PP_PRINTER_ENTRY (object);
 
-  g_cancellable_cancel (self->get_jobs_cancellable);
   g_cancellable_cancel (self->check_clean_heads_cancellable);
 
   g_clear_pointer (&self->printer_name, g_free);
@@ -968,7 +930,6 @@ pp_printer_entry_dispose (GObject *object)
   g_clear_pointer (&self->printer_make_and_model, g_free);
   g_clear_pointer (&self->printer_hostname, g_free);
   g_clear_pointer (&self->inklevel, ink_level_data_free);
-  g_clear_object (&self->get_jobs_cancellable);
   g_clear_object (&self->check_clean_heads_cancellable);
   g_clear_object (&self->clean_command);
 
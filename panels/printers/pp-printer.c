@@ -20,6 +20,7 @@
 
 #include "pp-printer.h"
 
+#include "pp-ipp-pool.h"
 #include "pp-job.h"
 
 #if (CUPS_VERSION_MAJOR == 1) && (CUPS_VERSION_MINOR <= 6)
@@ -138,7 +139,7 @@ printer_rename_dbus_cb (GObject      *source_object,
         {
           g_warning ("Update cups-pk-helper to at least 0.2.6 please to be able to use PrinterRename method.");
 
-          g_task_run_in_thread (task, printer_rename_thread);
+          pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, printer_rename_thread);
         }
       else
         {
@@ -335,7 +336,7 @@ pp_printer_get_jobs_async (PpPrinter           *self,
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
   g_task_set_task_data (task, get_jobs_data, g_free);
   g_task_set_return_on_cancel (task, TRUE);
-  g_task_run_in_thread (task, get_jobs_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_NORMAL, get_jobs_thread);
 }
 
 GPtrArray *
@@ -565,7 +566,7 @@ pp_printer_print_file_async (PpPrinter           *self,
   g_task_set_return_on_cancel (task, TRUE);
   g_task_set_task_data (task, print_file_data, (GDestroyNotify) print_file_data_free);
 
-  g_task_run_in_thread (task, print_file_thread);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_HIGH, print_file_thread);
 }
 
 gboolean
@@ -27,6 +27,8 @@
 #include <cups/ppd.h>
 
 #include "pp-utils.h"
+#include "pp-ipp-pool.h"
+#include "pp-ppd-cache.h"
 
 #define DBUS_TIMEOUT      120000
 #define DBUS_TIMEOUT_LONG 600000
@@ -78,27 +80,33 @@ ippNextAttribute (ipp_t *ipp)
 gchar *
 get_tag_value (const gchar *tag_string, const gchar *tag_name)
 {
-  gchar **tag_string_splitted = NULL;
-  gchar  *tag_value = NULL;
-  gint    tag_name_length;
-  gint    i;
+  const gchar *field;
+  const gchar *value = NULL;
+  gsize        value_length = 0;
+  gsize        tag_name_length;
 
-  if (tag_string && tag_name)
+  if (tag_string == NULL || tag_name == NULL)
+    return NULL;
+
+  tag_name_length = strlen (tag_name);
+
+  /* Walk the fields in place, the last matching one wins */
+  for (field = tag_string; field != NULL; )
     {
-      tag_name_length = strlen (tag_name);
-      tag_string_splitted = g_strsplit (tag_string, ";", 0);
-      if (tag_string_splitted)
-        {
-          for (i = 0; i < g_strv_length (tag_string_splitted); i++)
-            if (g_ascii_strncasecmp (tag_string_splitted[i], tag_name, tag_name_length) == 0)
-              if (strlen (tag_string_splitted[i]) > tag_name_length + 1)
-                tag_value = g_strdup (tag_string_splitted[i] + tag_name_length + 1);
+      const gchar *field_end = strchr (field, ';');
+      gsize        field_length = field_end != NULL ? (gsize) (field_end - field) : strlen (field);
 
-          g_strfreev (tag_string_splitted);
+      if (field_length > tag_name_length + 1 &&
+          g_ascii_strncasecmp (field, tag_name, tag_name_length) == 0)
+        {
+          value = field + tag_name_length + 1;
+          value_length = field_length - tag_name_length - 1;
         }
+
+      field = field_end != NULL ? field_end + 1 : NULL;
     }
 
-  return tag_value;
+  return value != NULL ? g_strndup (value, value_length) : NULL;
 }
 
 
@@ -108,53 +116,52 @@ get_tag_value (const gchar *tag_string, const gchar *tag_name)
  * neighbour with alphabetic.
  * (see cupshelpers/ppds.py from system-config-printer)
  */
-static gchar *
-normalize (const gchar *input_string)
+gchar *
+normalize_name (const gchar *input_string)
 {
-  gchar *result = NULL;
-  gint   i, j = 0, k = -1;
+  const gchar *start;
+  const gchar *end;
+  const gchar *p;
+  gchar       *result;
+  gsize        j = 0;
 
-  if (input_string)
-    {
-      g_autofree gchar *tmp = g_strstrip (g_ascii_strdown (input_string, -1));
-      if (tmp)
-        {
-          g_autofree gchar *res = g_new (gchar, 2 * strlen (tmp) + 1);
+  if (input_string == NULL)
+    return NULL;
 
-          for (i = 0; i < strlen (tmp); i++)
-            {
-              if ((g_ascii_isalpha (tmp[i]) && k >= 0 && g_ascii_isdigit (res[k])) ||
-                  (g_ascii_isdigit (tmp[i]) && k >= 0 && g_ascii_isalpha (res[k])))
-                {
-                  res[j] = ' ';
-                  k = j++;
-                  res[j] = tmp[i];
-                  k = j++;
-                }
-              else
-                {
-                  if (g_ascii_isspace (tmp[i]) || !g_ascii_isalnum (tmp[i]))
-                    {
-                      if (!(k >= 0 && res[k] == ' '))
-                        {
-                          res[j] = ' ';
-                          k = j++;
-                        }
-                    }
-                  else
-                    {
-                      res[j] = tmp[i];
-                      k = j++;
-                    }
-                }
-            }
+  start = input_string;
+  while (g_ascii_isspace (*start))
+    start++;
 
-          res[j] = '\0';
+  end = start + strlen (start);
+  while (end > start && g_ascii_isspace (end[-1]))
+    end--;
 
-          result = g_strdup (res);
+  result = g_new (gchar, 2 * (end - start) + 1);
+
+  for (p = start; p < end; p++)
+    {
+      gchar c = g_ascii_tolower (*p);
+
+      if (j > 0 &&
+          ((g_ascii_isalpha (c) && g_ascii_isdigit (result[j - 1])) ||
+           (g_ascii_isdigit (c) && g_ascii_isalpha (result[j - 1]))))
+        {
+          result[j++] = ' ';
+          result[j++] = c;
+        }
+      else if (!g_ascii_isalnum (c))
+        {
+          if (j == 0 || result[j - 1] != ' ')
+            result[j++] = ' ';
+        }
+      else
+        {
+          result[j++] = c;
         }
     }
 
+  result[j] = '\0';
+
   return result;
 }
 
@@ -1239,8 +1246,9 @@ ipp_attribute_free2 (gpointer attr)
   ipp_attribute_free (attribute);
 }
 
-static gpointer
-get_ipp_attributes_func (gpointer user_data)
+static void
+get_ipp_attributes_func (gpointer user_data,
+                         gpointer pool_data)
 {
   ipp_attribute_t  *attr = NULL;
   GIAData          *data = user_data;
@@ -1339,8 +1347,6 @@ get_ipp_attributes_func (gpointer user_data)
   g_free (requested_attrs);
 
   get_ipp_attributes_cb (data);
-
-  return NULL;
 }
 
 void
@@ -1350,23 +1356,10 @@ get_ipp_attributes_async (const gchar  *printer_name,
                           gpointer      user_data)
 {
   GIAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
 
   data = gia_data_new (printer_name, attributes_names, callback, user_data);
 
-  thread = g_thread_try_new ("get-ipp-attributes",
-                             get_ipp_attributes_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gia_data_free (data);
-    }
+  pp_ipp_pool_push (get_ipp_attributes_func, data, PP_IPP_PRIORITY_HIGH);
 }
 
 IPPAttribute *
@@ -1687,8 +1680,9 @@ get_ppds_attribute_cb (gpointer user_data)
   g_source_attach (idle_source, data->context);
 }
 
-static gpointer
-get_ppds_attribute_func (gpointer user_data)
+static void
+get_ppds_attribute_func (gpointer user_data,
+                         gpointer pool_data)
 {
   ppd_file_t  *ppd_file;
   ppd_attr_t  *ppd_attr;
@@ -1716,8 +1710,6 @@ get_ppds_attribute_func (gpointer user_data)
     }
 
   get_ppds_attribute_cb (data);
-
-  return NULL;
 }
 
 /*
@@ -1730,8 +1722,6 @@ get_ppds_attribute_async (gchar       **ppds_names,
                           gpointer      user_data)
 {
   GPAData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
 
   if (!ppds_names || !attribute_name)
     {
@@ -1741,18 +1731,7 @@ get_ppds_attribute_async (gchar       **ppds_names,
 
   data = gpa_data_new (ppds_names, attribute_name, callback, user_data);
 
-  thread = g_thread_try_new ("get-ppds-attribute",
-                             get_ppds_attribute_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gpa_data_free (data);
-    }
+  pp_ipp_pool_push (get_ppds_attribute_func, data, PP_IPP_PRIORITY_LOW);
 }
 
 
@@ -2493,20 +2472,83 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
+/*
+ * Index of manufacturers_names by normalized name.
+ */
+static GHashTable *
+get_manufacturers_index (void)
+{
+  static gsize index = 0;
+
+  if (g_once_init_enter (&index))
+    {
+      GHashTable *table;
+      gint        i;
+
+      table = g_hash_table_new (g_str_hash, g_str_equal);
+      for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+        g_hash_table_insert (table,
+                             (gpointer) manufacturers_names[i].normalized_name,
+                             (gpointer) manufacturers_names[i].display_name);
+
+      g_once_init_leave (&index, (gsize) table);
+    }
+
+  return (GHashTable *) index;
+}
+
+/*
+ * Thousands of PPDs share a handful of manufacturer strings,
+ * so normalize each distinct one only once.
+ */
+static const gchar *
+normalize_cached (GHashTable  *normalized_names,
+                  const gchar *name)
+{
+  gchar *normalized;
+
+  normalized = g_hash_table_lookup (normalized_names, name);
+  if (normalized == NULL)
+    {
+      normalized = normalize_name (name);
+      g_hash_table_insert (normalized_names, g_strdup (name), normalized);
+    }
+
+  return normalized;
+}
+
 static gpointer
 get_all_ppds_func (gpointer user_data)
 {
   ipp_attribute_t *attr;
   GHashTable      *ppds_hash = NULL;
   GHashTable      *manufacturers_hash = NULL;
+  g_autoptr(GHashTable) normalized_names = NULL;
+  g_autofree gchar *cache_path = NULL;
   GAPData         *data = user_data;
   PPDName         *item;
   ipp_t           *request;
   ipp_t           *response;
   GList           *list;
   gchar           *manufacturer_display_name;
+  guint64          stamp;
   gint             i, j;
 
+  /*
+   * The catalogue only changes when drivers get installed or removed,
+   * so try the copy stored on disk before asking CUPS for all of it.
+   */
+  cache_path = pp_ppd_cache_get_default_path ();
+  stamp = pp_ppd_cache_get_default_stamp ();
+  data->result = pp_ppd_cache_load (cache_path, stamp);
+  if (data->result != NULL)
+    {
+      get_all_ppds_cb (data);
+      return NULL;
+    }
+
+  normalized_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
   request = ippNewRequest (CUPS_GET_PPDS);
   response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
 
@@ -2578,7 +2620,8 @@ get_all_ppds_func (gpointer user_data)
               mfg = get_tag_value (ppd_device_id, "mfg");
               if (!mfg)
                 mfg = get_tag_value (ppd_device_id, "manufacturer");
-              mfg_normalized = normalize (mfg);
+              if (mfg)
+                mfg_normalized = g_strdup (normalize_cached (normalized_names, mfg));
             }
 
           if (!mfg &&
@@ -2586,7 +2629,7 @@ get_all_ppds_func (gpointer user_data)
               ppd_make[0] != '\0')
             {
               mfg = g_strdup (ppd_make);
-              mfg_normalized = normalize (ppd_make);
+              mfg_normalized = g_strdup (normalize_cached (normalized_names, ppd_make));
             }
 
           /* Get model */
@@ -2624,7 +2667,7 @@ get_all_ppds_func (gpointer user_data)
               else
                 {
                   g_free (mfg_normalized);
-                  mfg_normalized = normalize (manufacturer_display_name);
+                  mfg_normalized = g_strdup (normalize_cached (normalized_names, manufacturer_display_name));
                 }
 
               item = g_new0 (PPDName, 1);
@@ -2705,6 +2748,14 @@ get_all_ppds_func (gpointer user_data)
       g_list_free_full (sort_list, g_free);
       g_hash_table_destroy (ppds_hash);
       g_hash_table_destroy (manufacturers_hash);
+
+      if (stamp != 0)
+        {
+          g_autoptr(GError) error = NULL;
+
+          if (!pp_ppd_cache_save (cache_path, stamp, data->result, &error))
+            g_warning ("Could not store PPD cache '%s': %s", cache_path, error->message);
+        }
     }
 
   get_all_ppds_cb (data);
@@ -2814,22 +2865,41 @@ gchar *
 get_standard_manufacturers_name (const gchar *name)
 {
   g_autofree gchar *normalized_name = NULL;
-  gint   i;
 
   if (name == NULL)
     return NULL;
 
-  normalized_name = normalize (name);
+  normalized_name = normalize_name (name);
+  if (normalized_name == NULL)
+    return NULL;
+
+  return g_strdup (g_hash_table_lookup (get_manufacturers_index (), normalized_name));
+}
+
+/*
+ * Returns normalized names of all known variants of given manufacturer,
+ * e.g. "hp" and "hewlett packard" for "Hewlett-Packard".
+ */
+gchar **
+get_manufacturers_aliases (const gchar *display_name)
+{
+  g_autoptr(GStrvBuilder) builder = NULL;
+  g_autofree gchar       *standard_name = NULL;
+  gint                    i;
+
+  builder = g_strv_builder_new ();
 
-  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+  standard_name = get_standard_manufacturers_name (display_name);
+  if (standard_name != NULL)
     {
-      if (g_strcmp0 (manufacturers_names[i].normalized_name, normalized_name) == 0)
+      for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
         {
-          return g_strdup (manufacturers_names[i].display_name);
+          if (g_strcmp0 (manufacturers_names[i].display_name, standard_name) == 0)
+            g_strv_builder_add (builder, manufacturers_names[i].normalized_name);
         }
     }
 
-  return NULL;
+  return g_strv_builder_end (builder);
 }
 
 typedef struct
@@ -3008,16 +3078,15 @@ get_named_dest_cb (gpointer user_data)
   g_source_attach (idle_source, data->context);
 }
 
-static gpointer
-get_named_dest_func (gpointer user_data)
+static void
+get_named_dest_func (gpointer user_data,
+                     gpointer pool_data)
 {
   GNDData *data = user_data;
 
   data->result = cupsGetNamedDest (CUPS_HTTP_DEFAULT, data->printer_name, NULL);
 
   get_named_dest_cb (data);
-
-  return NULL;
 }
 
 void
@@ -3026,23 +3095,10 @@ get_named_dest_async (const gchar *printer_name,
                       gpointer     user_data)
 {
   GNDData          *data;
-  g_autoptr(GThread) thread = NULL;
-  g_autoptr(GError) error = NULL;
 
   data = gnd_data_new (printer_name, callback, user_data);
 
-  thread = g_thread_try_new ("get-named-dest",
-                             get_named_dest_func,
-                             data,
-                             &error);
-
-  if (!thread)
-    {
-      g_warning ("%s", error->message);
-      callback (NULL, user_data);
-
-      gnd_data_free (data);
-    }
+  pp_ipp_pool_push (get_named_dest_func, data, PP_IPP_PRIORITY_NORMAL);
 }
 
 typedef struct
@@ -3421,6 +3477,59 @@ get_cups_devices_async (GCancellable *cancellable,
                           gcd_data_new (backend_list, cancellable, callback, user_data));
 }
 
+/*
+ * Finds host of a plain "scheme://host[:port][/resource]" URI in place.
+ * Returns FALSE for anything httpSeparateURI() would have to decode or
+ * could reject (user info, IPv6 literals, escapes, odd characters).
+ */
+static gboolean
+find_simple_uri_host (const gchar  *uri,
+                      const gchar **host,
+                      gsize        *host_length)
+{
+  const gchar *p = uri;
+  const gchar *host_end;
+  gint         port = 0;
+
+  while (g_ascii_isalnum (*p) || *p == '+' || *p == '-' || *p == '.')
+    p++;
+
+  if (p == uri || strncmp (p, "://", 3) != 0)
+    return FALSE;
+
+  p += 3;
+  *host = p;
+
+  while (g_ascii_isalnum (*p) || *p == '-' || *p == '.' || *p == '_' || *p == '~')
+    p++;
+
+  host_end = p;
+  if (host_end == *host || host_end - *host >= 256)
+    return FALSE;
+
+  if (*p == ':')
+    {
+      const gchar *port_start = ++p;
+
+      while (g_ascii_isdigit (*p) && p - port_start < 6)
+        port = port * 10 + (*p++ - '0');
+
+      if (p == port_start || port < 1 || port > 65535)
+        return FALSE;
+    }
+
+  if (*p != '/' && *p != '\0')
+    return FALSE;
+
+  for (; *p != '\0'; p++)
+    if (*p == '%' || *p == '@' || *p <= ' ' || *p >= 0x7f)
+      return FALSE;
+
+  *host_length = host_end - *host;
+
+  return TRUE;
+}
+
 gchar *
 guess_device_hostname (PpPrintDevice *device)
 {
@@ -3431,18 +3540,31 @@ guess_device_hostname (PpPrintDevice *device)
   char               resource[HTTP_MAX_URI];
   int                port;
   gchar             *result = NULL;
+  const gchar       *device_uri;
+  const gchar       *device_info;
+  const gchar       *host;
+  gsize              host_length;
   gchar             *hostname_begin;
   gchar             *hostname_end = NULL;
 
-  if (device != NULL && pp_print_device_get_device_uri (device) != NULL)
+  if (device == NULL)
+    return NULL;
+
+  device_uri = pp_print_device_get_device_uri (device);
+  device_info = pp_print_device_get_device_info (device);
+
+  if (device_uri != NULL)
     {
-      if (g_str_has_prefix (pp_print_device_get_device_uri (device), "socket") ||
-          g_str_has_prefix (pp_print_device_get_device_uri (device), "lpd") ||
-          g_str_has_prefix (pp_print_device_get_device_uri (device), "ipp") ||
-          g_str_has_prefix (pp_print_device_get_device_uri (device), "smb"))
+      if (g_str_has_prefix (device_uri, "socket") ||
+          g_str_has_prefix (device_uri, "lpd") ||
+          g_str_has_prefix (device_uri, "ipp") ||
+          g_str_has_prefix (device_uri, "smb"))
         {
+          if (find_simple_uri_host (device_uri, &host, &host_length))
+            return g_strndup (host, host_length);
+
           status = httpSeparateURI (HTTP_URI_CODING_ALL,
-                                    pp_print_device_get_device_uri (device),
+                                    device_uri,
                                     scheme, HTTP_MAX_URI,
                                     username, HTTP_MAX_URI,
                                     hostname, HTTP_MAX_URI,
@@ -3453,31 +3575,31 @@ guess_device_hostname (PpPrintDevice *device)
               hostname[0] != '\0')
             result = g_strdup (hostname);
         }
-      else if ((g_str_has_prefix (pp_print_device_get_device_uri (device), "dnssd") ||
-                g_str_has_prefix (pp_print_device_get_device_uri (device), "mdns")) &&
-               pp_print_device_get_device_info (device) != NULL)
+      else if ((g_str_has_prefix (device_uri, "dnssd") ||
+                g_str_has_prefix (device_uri, "mdns")) &&
+               device_info != NULL)
         {
           /*
            * CUPS browses its printers as
            * "PrinterName @ ComputerName" or "PrinterInfo @ ComputerName"
            * through DNS-SD.
            */
-          hostname_begin = g_strrstr (pp_print_device_get_device_info (device), " @ ");
+          hostname_begin = g_strrstr (device_info, " @ ");
           if (hostname_begin != NULL)
             result = g_strdup (hostname_begin + 3);
         }
-      else if (g_str_has_prefix (pp_print_device_get_device_uri (device), "hp:/net/") ||
-               g_str_has_prefix (pp_print_device_get_device_uri (device), "hpfax:/net/"))
+      else if (g_str_has_prefix (device_uri, "hp:/net/") ||
+               g_str_has_prefix (device_uri, "hpfax:/net/"))
         {
           /*
            * HPLIP printers have URI of form hp:/net/%s?ip=%s&port=%d
            * or hp:/net/%s?ip=%s.
            */
-          hostname_begin = g_strrstr (pp_print_device_get_device_uri (device), "ip=");
+          hostname_begin = g_strrstr (device_uri, "ip=");
           if (hostname_begin != NULL)
             {
               hostname_begin += 3;
-              hostname_end = strstr (hostname_begin, "&");
+              hostname_end = strchr (hostname_begin, '&');
             }
 
           if (hostname_end != NULL)
@@ -3490,6 +3612,38 @@ guess_device_hostname (PpPrintDevice *device)
   return result;
 }
 
+static gboolean
+is_device_name_taken (const gchar *name,
+                      GList       *device_names,
+                      GPtrArray   *local_cups_devices,
+                      cups_dest_t *dests,
+                      gint         num_of_dests)
+{
+  GList *iter;
+  gint   i;
+
+  for (i = 0; i < num_of_dests; i++)
+    if (g_strcmp0 (dests[i].name, name) == 0)
+      return TRUE;
+
+  for (iter = device_names; iter; iter = iter->next)
+    if (g_strcmp0 (iter->data, name) == 0)
+      return TRUE;
+
+  if (local_cups_devices != NULL)
+    {
+      for (guint j = 0; j < local_cups_devices->len; j++)
+        {
+          PpPrintDevice *item = g_ptr_array_index (local_cups_devices, j);
+
+          if (g_strcmp0 (pp_print_device_get_device_original_name (item), name) == 0)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 gchar *
 canonicalize_device_name (GList         *device_names,
                           GPtrArray     *local_cups_devices,
@@ -3497,12 +3651,12 @@ canonicalize_device_name (GList         *device_names,
                           gint           num_of_dests,
                           PpPrintDevice *device)
 {
-  PpPrintDevice             *item;
-  gboolean                   already_present;
-  GList                     *iter;
-  gsize                      len;
+  g_autoptr(GString)         candidate = NULL;
   g_autofree gchar          *name = NULL;
+  g_autofree gchar          *lower_name = NULL;
   gchar                     *occurrence;
+  gchar                     *src, *dst;
+  gsize                      len;
   gint                       name_index, j;
   static const char * const  residues[] = {
     "-foomatic",
@@ -3556,16 +3710,18 @@ canonicalize_device_name (GList         *device_names,
   g_strstrip (name);
   g_strcanon (name, ALLOWED_CHARACTERS, '-');
 
-  /* Remove common strings found in driver names */
+  /*
+   * Remove common strings found in driver names. The name is plain
+   * ASCII now, so one lowercase copy can be truncated along with it.
+   */
+  lower_name = g_ascii_strdown (name, -1);
   for (j = 0; j < G_N_ELEMENTS (residues); j++)
     {
-      g_autofree gchar *lower_name = g_ascii_strdown (name, -1);
-
       occurrence = g_strrstr (lower_name, residues[j]);
       if (occurrence != NULL)
         {
           occurrence[0] = '\0';
-          name[strlen (lower_name)] = '\0';
+          name[occurrence - lower_name] = '\0';
         }
     }
 
@@ -3574,56 +3730,23 @@ canonicalize_device_name (GList         *device_names,
   while (len-- && name[len] == '-')
     name[len] = '\0';
 
-  /* Merge "--" to "-" */
-  occurrence = g_strrstr (name, "--");
-  while (occurrence != NULL)
-    {
-      shift_string_left (occurrence);
-      occurrence = g_strrstr (name, "--");
-    }
-
-  /* Remove leading "-" */
-  if (name[0] == '-')
-    shift_string_left (name);
+  /* Merge "--" to "-" and remove leading "-" */
+  for (src = dst = name; *src != '\0'; src++)
+    if (*src != '-' || (dst != name && dst[-1] != '-'))
+      *dst++ = *src;
+  *dst = '\0';
 
-  name_index = 2;
-  already_present = FALSE;
-  while (TRUE)
+  len = dst - name;
+  candidate = g_string_new_len (name, len);
+  for (name_index = 2;
+       is_device_name_taken (candidate->str, device_names, local_cups_devices, dests, num_of_dests);
+       name_index++)
     {
-      g_autofree gchar *new_name = NULL;
-
-      if (already_present)
-        {
-          new_name = g_strdup_printf ("%s-%d", name, name_index);
-          name_index++;
-        }
-      else
-        {
-          new_name = g_strdup (name);
-        }
-
-      already_present = FALSE;
-      for (j = 0; j < num_of_dests; j++)
-        if (g_strcmp0 (dests[j].name, new_name) == 0)
-          already_present = TRUE;
-
-      for (iter = device_names; iter; iter = iter->next)
-        {
-          gchar *device_original_name = iter->data;
-          if (g_strcmp0 (device_original_name, new_name) == 0)
-            already_present = TRUE;
-        }
-
-      for (guint i = 0; i < local_cups_devices->len; i++)
-        {
-          item = g_ptr_array_index (local_cups_devices, i);
-          if (g_strcmp0 (pp_print_device_get_device_original_name (item), new_name) == 0)
-            already_present = TRUE;
-        }
-
-      if (!already_present)
-        return g_steal_pointer (&new_name);
+      g_string_truncate (candidate, len);
+      g_string_append_printf (candidate, "-%d", name_index);
     }
+
+  return g_string_free (g_steal_pointer (&candidate), FALSE);
 }
 
 void
@@ -207,8 +207,12 @@ IPPAttribute *ipp_attribute_copy (IPPAttribute *attr);
 
 void        ipp_attribute_free (IPPAttribute *attr);
 
+gchar      *normalize_name (const gchar *input_string);
+
 gchar      *get_standard_manufacturers_name (const gchar *name);
 
+gchar     **get_manufacturers_aliases (const gchar *display_name);
+
 typedef void (*PGPCallback) (const gchar *ppd_filename,
                              gpointer     user_data);
 
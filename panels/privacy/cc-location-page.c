@@ -19,6 +19,7 @@
  */
 
 #include "cc-location-page.h"
+#include "cc-permission-store.h"
 #include "cc-util.h"
 
 #include <gio/gdesktopappinfo.h>
@@ -40,7 +41,7 @@ struct _CcLocationPage
   GSettings    *location_settings;
   GCancellable *cancellable;
 
-  GDBusProxy   *perm_store;
+  CcPermissionStore *perm_store;
   GVariant     *location_apps_perms;
   GVariant     *location_apps_data;
   GHashTable   *location_app_switches;
@@ -71,14 +72,10 @@ on_perm_store_set_done (GObject      *source_object,
                         GAsyncResult *res,
                         gpointer      user_data)
 {
-  g_autoptr(GVariant) results = NULL;
   g_autoptr(GError) error = NULL;
   LocationAppStateData *data;
 
-  results = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object),
-                                      res,
-                                      &error);
-  if (results == NULL)
+  if (!cc_permission_store_set_finish (CC_PERMISSION_STORE (source_object), res, &error))
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         g_warning ("Failed to store permissions: %s", error->message);
@@ -98,7 +95,6 @@ on_location_app_state_set (GtkSwitch *widget,
 {
   LocationAppStateData *data = (LocationAppStateData *) user_data;
   CcLocationPage *self = data->self;
-  GVariant *params;
   GVariantIter iter;
   const gchar *key;
   gchar **value;
@@ -114,7 +110,7 @@ on_location_app_state_set (GtkSwitch *widget,
   data->pending_state = active_location && state;
 
   g_variant_iter_init (&iter, self->location_apps_perms);
-  g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sas}"));
   while (g_variant_iter_loop (&iter, "{&s^a&s}", &key, &value))
     {
       /* It's OK to drop the entry if it's not in expected format */
@@ -127,21 +123,14 @@ on_location_app_state_set (GtkSwitch *widget,
       g_variant_builder_add (&builder, "{s^as}", key, value);
     }
 
-  params = g_variant_new ("(sbsa{sas}v)",
-                          APP_PERMISSIONS_TABLE,
-                          TRUE,
-                          APP_PERMISSIONS_ID,
-                          &builder,
-                          self->location_apps_data);
-
-  g_dbus_proxy_call (self->perm_store,
-                     "Set",
-                     params,
-                     G_DBUS_CALL_FLAGS_NONE,
-                     -1,
-                     self->cancellable,
-                     on_perm_store_set_done,
-                     data);
+  cc_permission_store_set_async (self->perm_store,
+                                 APP_PERMISSIONS_TABLE,
+                                 APP_PERMISSIONS_ID,
+                                 g_variant_builder_end (&builder),
+                                 self->location_apps_data,
+                                 self->cancellable,
+                                 on_perm_store_set_done,
+                                 data);
 
   return TRUE;
 }
@@ -284,87 +273,50 @@ update_perm_store (CcLocationPage *self,
 }
 
 static void
-on_perm_store_signal (GDBusProxy *proxy,
-                      gchar      *sender_name,
-                      gchar      *signal_name,
-                      GVariant   *parameters,
-                      gpointer    user_data)
+on_perm_store_changed (CcPermissionStore *perm_store,
+                       const gchar       *table,
+                       const gchar       *id,
+                       CcLocationPage    *self)
 {
   GVariant *permissions, *permissions_data;
 
-  if (g_strcmp0 (signal_name, "Changed") != 0)
+  if (g_strcmp0 (table, APP_PERMISSIONS_TABLE) != 0 ||
+      g_strcmp0 (id, APP_PERMISSIONS_ID) != 0)
     return;
 
-  permissions = g_variant_get_child_value (parameters, 4);
-  permissions_data = g_variant_get_child_value (parameters, 3);
-  update_perm_store (user_data, permissions, permissions_data);
+  permissions = cc_permission_store_get_table (perm_store, table, id, &permissions_data);
+  update_perm_store (self, permissions, permissions_data);
 }
 
 static void
-on_perm_store_lookup_done(GObject *source_object,
-                          GAsyncResult *res,
-                          gpointer user_data)
+on_perm_store_load_done (GObject      *source_object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
 {
+  CcLocationPage *self = user_data;
+  GVariant *permissions, *permissions_data;
   g_autoptr(GError) error = NULL;
-  GVariant *ret, *permissions, *permissions_data;
 
-  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object),
-                                  res,
-                                  &error);
-  if (ret == NULL)
+  if (!cc_permission_store_load_finish (CC_PERMISSION_STORE (source_object), res, &error))
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Failed fetch permissions from flatpak permission store: %s",
-                   error->message);
+        g_warning ("Failed fetch permissions from flatpak permission store: %s", error->message);
       return;
     }
 
-  permissions = g_variant_get_child_value (ret, 0);
-  permissions_data = g_variant_get_child_value (ret, 1);
-  update_perm_store (user_data, permissions, permissions_data);
+  permissions = cc_permission_store_get_table (self->perm_store,
+                                               APP_PERMISSIONS_TABLE,
+                                               APP_PERMISSIONS_ID,
+                                               &permissions_data);
+  update_perm_store (self, permissions, permissions_data);
 
-  g_signal_connect_object (source_object,
-                           "g-signal",
-                           G_CALLBACK (on_perm_store_signal),
-                           user_data,
+  g_signal_connect_object (self->perm_store,
+                           "changed",
+                           G_CALLBACK (on_perm_store_changed),
+                           self,
                            0);
 }
 
-static void
-on_perm_store_ready (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-  g_autoptr(GError) error = NULL;
-  CcLocationPage *self;
-  GDBusProxy *proxy;
-  GVariant *params;
-
-  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
-  if (proxy == NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-          g_warning ("Failed to connect to flatpak permission store: %s",
-                     error->message);
-
-      return;
-    }
-  self = user_data;
-  self->perm_store = proxy;
-
-  params = g_variant_new ("(ss)",
-                          APP_PERMISSIONS_TABLE,
-                          APP_PERMISSIONS_ID);
-  g_dbus_proxy_call (self->perm_store,
-                     "Lookup",
-                     params,
-                     G_DBUS_CALL_FLAGS_NONE,
-                     -1,
-                     self->cancellable,
-                     on_perm_store_lookup_done,
-                     self);
-}
-
 static void
 cc_location_page_finalize (GObject *object)
 {
@@ -402,6 +354,7 @@ static void
 cc_location_page_init (CcLocationPage *self)
 {
   g_autofree gchar *privacy_policy_link = NULL;
+  const gchar * const tables[] = { APP_PERMISSIONS_TABLE, APP_PERMISSIONS_ID, NULL };
 
   gtk_widget_init_template (GTK_WIDGET (self));
 
@@ -425,13 +378,10 @@ cc_location_page_init (CcLocationPage *self)
                                                        g_free,
                                                        g_object_unref);
 
-  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
-                            G_DBUS_PROXY_FLAGS_NONE,
-                            NULL,
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            "/org/freedesktop/impl/portal/PermissionStore",
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            self->cancellable,
-                            on_perm_store_ready,
-                            self);
+  self->perm_store = g_object_ref (cc_permission_store_get_default ());
+  cc_permission_store_load_async (self->perm_store,
+                                  tables,
+                                  self->cancellable,
+                                  on_perm_store_load_done,
+                                  self);
 }
@@ -19,6 +19,7 @@
  */
 
 #include "cc-microphone-page.h"
+#include "cc-permission-store.h"
 #include "cc-util.h"
 
 #include <gio/gdesktopappinfo.h>
@@ -37,7 +38,7 @@ struct _CcMicrophonePage
   GSettings    *privacy_settings;
   GCancellable *cancellable;
 
-  GDBusProxy   *perm_store;
+  CcPermissionStore *perm_store;
   GVariant     *microphone_apps_perms;
   GVariant     *microphone_apps_data;
   GHashTable   *microphone_app_switches;
@@ -69,13 +70,9 @@ on_perm_store_set_done (GObject *source_object,
                         gpointer user_data)
 {
   MicrophoneAppStateData *data;
-  GVariant *results;
   GError *error = NULL;
 
-  results = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object),
-                                      res,
-                                      &error);
-  if (results == NULL)
+  if (!cc_permission_store_set_finish (CC_PERMISSION_STORE (source_object), res, &error))
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         g_warning ("Failed to store permissions: %s", error->message);
@@ -83,7 +80,6 @@ on_perm_store_set_done (GObject *source_object,
 
       return;
     }
-  g_variant_unref (results);
 
   data = (MicrophoneAppStateData *) user_data;
   data->changing_state = FALSE;
@@ -97,7 +93,6 @@ on_microphone_app_state_set (GtkSwitch *widget,
 {
   MicrophoneAppStateData *data = (MicrophoneAppStateData *) user_data;
   CcMicrophonePage *self = data->self;
-  GVariant *params;
   GVariantIter iter;
   const gchar *key;
   gchar **value;
@@ -113,7 +108,7 @@ on_microphone_app_state_set (GtkSwitch *widget,
   data->pending_state = active_microphone && state;
 
   g_variant_iter_init (&iter, self->microphone_apps_perms);
-  g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sas}"));
   while (g_variant_iter_loop (&iter, "{&s^a&s}", &key, &value))
     {
       if (g_strv_length (value) != 1)
@@ -126,21 +121,14 @@ on_microphone_app_state_set (GtkSwitch *widget,
       g_variant_builder_add (&builder, "{s^as}", key, value);
     }
 
-  params = g_variant_new ("(sbsa{sas}v)",
-                          APP_PERMISSIONS_TABLE,
-                          TRUE,
-                          APP_PERMISSIONS_ID,
-                          &builder,
-                          self->microphone_apps_data);
-
-  g_dbus_proxy_call (self->perm_store,
-                     "Set",
-                     params,
-                     G_DBUS_CALL_FLAGS_NONE,
-                     -1,
-                     self->cancellable,
-                     on_perm_store_set_done,
-                     data);
+  cc_permission_store_set_async (self->perm_store,
+                                 APP_PERMISSIONS_TABLE,
+                                 APP_PERMISSIONS_ID,
+                                 g_variant_builder_end (&builder),
+                                 self->microphone_apps_data,
+                                 self->cancellable,
+                                 on_perm_store_set_done,
+                                 data);
 
   return TRUE;
 }
@@ -269,85 +257,50 @@ update_perm_store (CcMicrophonePage *self,
 }
 
 static void
-on_perm_store_signal (GDBusProxy *proxy,
-                      gchar      *sender_name,
-                      gchar      *signal_name,
-                      GVariant   *parameters,
-                      gpointer    user_data)
+on_perm_store_changed (CcPermissionStore *perm_store,
+                       const gchar       *table,
+                       const gchar       *id,
+                       CcMicrophonePage  *self)
 {
   GVariant *permissions, *permissions_data;
 
-  if (g_strcmp0 (signal_name, "Changed") != 0)
+  if (g_strcmp0 (table, APP_PERMISSIONS_TABLE) != 0 ||
+      g_strcmp0 (id, APP_PERMISSIONS_ID) != 0)
     return;
 
-  permissions = g_variant_get_child_value (parameters, 4);
-  permissions_data = g_variant_get_child_value (parameters, 3);
-  update_perm_store (user_data, permissions, permissions_data);
+  permissions = cc_permission_store_get_table (perm_store, table, id, &permissions_data);
+  update_perm_store (self, permissions, permissions_data);
 }
 
 static void
-on_perm_store_lookup_done (GObject      *source_object,
-                           GAsyncResult *res,
-                           gpointer      user_data)
+on_perm_store_load_done (GObject      *source_object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
 {
   CcMicrophonePage *self = user_data;
+  GVariant *permissions, *permissions_data;
   g_autoptr(GError) error = NULL;
-  GVariant *ret, *permissions, *permissions_data;
 
-  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object),
-                                  res,
-                                  &error);
-  if (ret == NULL)
+  if (!cc_permission_store_load_finish (CC_PERMISSION_STORE (source_object), res, &error))
     {
       if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         g_warning ("Failed fetch permissions from flatpak permission store: %s", error->message);
       return;
     }
 
-  permissions = g_variant_get_child_value (ret, 0);
-  permissions_data = g_variant_get_child_value (ret, 1);
-  update_perm_store (user_data, permissions, permissions_data);
+  permissions = cc_permission_store_get_table (self->perm_store,
+                                               APP_PERMISSIONS_TABLE,
+                                               APP_PERMISSIONS_ID,
+                                               &permissions_data);
+  update_perm_store (self, permissions, permissions_data);
 
-  g_signal_connect_object (source_object,
-                           "g-signal",
-                           G_CALLBACK (on_perm_store_signal),
+  g_signal_connect_object (self->perm_store,
+                           "changed",
+                           G_CALLBACK (on_perm_store_changed),
                            self,
                            0);
 }
 
-static void
-on_perm_store_ready (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-  CcMicrophonePage *self;
-  g_autoptr(GError) error = NULL;
-  GDBusProxy *proxy;
-  GVariant *params;
-
-  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
-  if (proxy == NULL)
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Failed to connect to flatpak permission store: %s", error->message);
-      return;
-    }
-  self = user_data;
-  self->perm_store = proxy;
-
-  params = g_variant_new ("(ss)",
-                          APP_PERMISSIONS_TABLE,
-                          APP_PERMISSIONS_ID);
-  g_dbus_proxy_call (self->perm_store,
-                     "Lookup",
-                     params,
-                     G_DBUS_CALL_FLAGS_NONE,
-                     -1,
-                     self->cancellable,
-                     on_perm_store_lookup_done,
-                     self);
-}
-
 static void
 cc_microphone_page_finalize (GObject *object)
 {
@@ -383,6 +336,8 @@ cc_microphone_page_class_init (CcMicrophonePageClass *klass)
 static void
 cc_microphone_page_init (CcMicrophonePage *self)
 {
+  const gchar * const tables[] = { APP_PERMISSIONS_TABLE, APP_PERMISSIONS_ID, NULL };
+
   gtk_widget_init_template (GTK_WIDGET (self));
 
   self->microphone_icon_size_group = gtk_size_group_new (GTK_SIZE_GROUP_BOTH);
@@ -402,13 +357,10 @@ cc_microphone_page_init (CcMicrophonePage *self)
                                                        g_free,
                                                        g_object_unref);
 
-  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
-                            G_DBUS_PROXY_FLAGS_NONE,
-                            NULL,
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            "/org/freedesktop/impl/portal/PermissionStore",
-                            "org.freedesktop.impl.portal.PermissionStore",
-                            self->cancellable,
-                            on_perm_store_ready,
-                            self);
+  self->perm_store = g_object_ref (cc_permission_store_get_default ());
+  cc_permission_store_load_async (self->perm_store,
+                                  tables,
+                                  self->cancellable,
+                                  on_perm_store_load_done,
+                                  self);
 }
@@ -16,105 +16,117 @@
  */
 
 #include "cc-level-bar.h"
+#include "cc-level-monitor.h"
 #include "cc-sound-enums.h"
 #include "gvc-mixer-stream-private.h"
 
 struct _CcLevelBar
 {
-  GtkWidget    parent_instance;
+  GtkWidget       parent_instance;
 
-  GtkLevelBar *level_bar;
-  pa_stream   *level_stream;
+  GtkLevelBar    *level_bar;
+
+  CcLevelMonitor *monitor;
+  guint           watch_id;
+  gboolean        suspended;
+
+  gdouble         held_peak;
 };
 
 G_DEFINE_TYPE (CcLevelBar, cc_level_bar, GTK_TYPE_WIDGET)
 
-#define SMOOTHING 0.3
+#define PEAK_MARKER_WIDTH 2
 
+/* Called by the monitor at most once per frame */
 static void
-update_level (CcLevelBar *self,
-              gdouble     value)
+level_changed_cb (const CcLevelMeter *meter,
+                  gpointer            user_data)
 {
-  /* Use Exponential Moving Average (EMA) to smooth out value changes and
-   * reduce fluctuation and jitter.
-   */
-  double prev_ema = gtk_level_bar_get_value (self->level_bar);
-  double ema = (value * SMOOTHING) + (prev_ema * (1.0 - SMOOTHING));
-
-  ema = CLAMP (ema, 0.0, 1.0);
+  CcLevelBar *self = user_data;
 
-  gtk_level_bar_set_value (self->level_bar, ema);
+  gtk_level_bar_set_value (self->level_bar, meter->peak);
+  self->held_peak = meter->held_peak;
+  gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
 static void
-read_cb (pa_stream *stream,
-         size_t     length,
-         void      *userdata)
+update_suspended (CcLevelBar *self)
 {
-  CcLevelBar *self = userdata;
-  const void *data;
-  gdouble value;
+  if (self->watch_id == 0)
+    return;
 
-  if (pa_stream_peek (stream, &data, &length) < 0)
-    {
-      g_warning ("Failed to read data from stream");
-      return;
-    }
+  cc_level_monitor_set_suspended (self->monitor, self->watch_id,
+                                  self->suspended || !gtk_widget_get_mapped (GTK_WIDGET (self)));
+}
 
-  if (!data)
-    {
-      pa_stream_drop (stream);
-      return;
-    }
+static void
+unwatch (CcLevelBar *self)
+{
+  if (self->watch_id != 0)
+    cc_level_monitor_unwatch (self->monitor, self->watch_id);
+  self->watch_id = 0;
+  g_clear_object (&self->monitor);
+
+  gtk_level_bar_set_value (self->level_bar, 0.0);
+  self->held_peak = 0.0;
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
 
-  assert (length > 0);
-  assert (length % sizeof (float) == 0);
+static void
+cc_level_bar_dispose (GObject *object)
+{
+  CcLevelBar *self = CC_LEVEL_BAR (object);
 
-  value = ((const float *) data)[length / sizeof (float) -1];
+  unwatch (self);
 
-  pa_stream_drop (stream);
+  gtk_widget_unparent (GTK_WIDGET (self->level_bar));
 
-  update_level (self, value);
+  G_OBJECT_CLASS (cc_level_bar_parent_class)->dispose (object);
 }
 
 static void
-suspended_cb (pa_stream *stream,
-              void      *userdata)
+cc_level_bar_map (GtkWidget *widget)
 {
-  CcLevelBar *self = userdata;
+  GTK_WIDGET_CLASS (cc_level_bar_parent_class)->map (widget);
 
-  if (pa_stream_is_suspended (stream))
-    {
-      g_debug ("Stream suspended");
-      gtk_level_bar_set_value (self->level_bar, 0.0);
-    }
+  update_suspended (CC_LEVEL_BAR (widget));
 }
 
 static void
-close_stream (pa_stream *stream)
+cc_level_bar_unmap (GtkWidget *widget)
 {
-  if (stream == NULL)
-    return;
-
-  /* Stop receiving data */
-  pa_stream_set_read_callback (stream, NULL, NULL);
-  pa_stream_set_suspended_callback (stream, NULL, NULL);
+  GTK_WIDGET_CLASS (cc_level_bar_parent_class)->unmap (widget);
 
-  /* Disconnect from the stream */
-  pa_stream_disconnect (stream);
+  update_suspended (CC_LEVEL_BAR (widget));
 }
 
 static void
-cc_level_bar_dispose (GObject *object)
+cc_level_bar_snapshot (GtkWidget   *widget,
+                       GtkSnapshot *snapshot)
 {
-  CcLevelBar *self = CC_LEVEL_BAR (object);
+  CcLevelBar *self = CC_LEVEL_BAR (widget);
+  GdkRGBA     color;
+  gint        width, height;
+  gdouble     x;
 
-  close_stream (self->level_stream);
-  g_clear_pointer (&self->level_stream, pa_stream_unref);
+  GTK_WIDGET_CLASS (cc_level_bar_parent_class)->snapshot (widget, snapshot);
 
-  gtk_widget_unparent (GTK_WIDGET (self->level_bar));
+  /* Marker for the held peak */
+  if (self->held_peak <= 0.0)
+    return;
 
-  G_OBJECT_CLASS (cc_level_bar_parent_class)->dispose (object);
+  width = gtk_widget_get_width (widget);
+  height = gtk_widget_get_height (widget);
+  if (width <= PEAK_MARKER_WIDTH)
+    return;
+
+  x = self->held_peak * (width - PEAK_MARKER_WIDTH);
+  if (gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL)
+    x = width - PEAK_MARKER_WIDTH - x;
+
+  gtk_widget_get_color (widget, &color);
+  gtk_snapshot_append_color (snapshot, &color,
+                             &GRAPHENE_RECT_INIT (x, 0, PEAK_MARKER_WIDTH, height));
 }
 
 void
@@ -125,6 +137,10 @@ cc_level_bar_class_init (CcLevelBarClass *klass)
 
   object_class->dispose = cc_level_bar_dispose;
 
+  widget_class->map = cc_level_bar_map;
+  widget_class->unmap = cc_level_bar_unmap;
+  widget_class->snapshot = cc_level_bar_snapshot;
+
   gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BIN_LAYOUT);
 }
 
@@ -145,59 +161,33 @@ void
 cc_level_bar_set_stream (CcLevelBar     *self,
                          GvcMixerStream *stream)
 {
-  pa_context *context;
-  pa_sample_spec sample_spec;
-  pa_proplist *proplist;
-  pa_buffer_attr  attr;
-  g_autofree gchar *device = NULL;
-
   g_return_if_fail (CC_IS_LEVEL_BAR (self));
 
-  close_stream (self->level_stream);
-  g_clear_pointer (&self->level_stream, pa_stream_unref);
+  unwatch (self);
 
   if (stream == NULL)
-   {
-     gtk_level_bar_set_value (self->level_bar, 0.0);
-     return;
-   }
-
-  context = gvc_mixer_stream_get_pa_context (stream);
-
-  if (pa_context_get_server_protocol_version (context) < 13)
-    {
-      g_warning ("Unsupported version of PulseAudio");
-      return;
-    }
-
-  sample_spec.channels = 1;
-  sample_spec.format = PA_SAMPLE_FLOAT32;
-  sample_spec.rate = 25;
-
-  proplist = pa_proplist_new ();
-  pa_proplist_sets (proplist, PA_PROP_APPLICATION_ID, "org.gnome.VolumeControl");
-  self->level_stream = pa_stream_new_with_proplist (context, "Peak detect", &sample_spec, NULL, proplist);
-  pa_proplist_free (proplist);
-  if (self->level_stream == NULL)
-    {
-      g_warning ("Failed to create monitoring stream");
-      return;
-    }
-
-  pa_stream_set_read_callback (self->level_stream, read_cb, self);
-  pa_stream_set_suspended_callback (self->level_stream, suspended_cb, self);
-
-  memset (&attr, 0, sizeof (attr));
-  attr.fragsize = sizeof (float);
-  attr.maxlength = (uint32_t) -1;
-  device = g_strdup_printf ("%u", gvc_mixer_stream_get_index (stream));
-  if (pa_stream_connect_record (self->level_stream,
-                                device,
-                                &attr,
-                                (pa_stream_flags_t) (PA_STREAM_DONT_MOVE |
-                                                     PA_STREAM_PEAK_DETECT |
-                                                     PA_STREAM_ADJUST_LATENCY)) < 0)
-    {
-      g_warning ("Failed to connect monitoring stream");
-    }
+    return;
+
+  self->monitor = cc_level_monitor_get_for_context (gvc_mixer_stream_get_pa_context (stream));
+  self->watch_id = cc_level_monitor_watch (self->monitor, stream, GTK_WIDGET (self),
+                                           level_changed_cb, self);
+  update_suspended (self);
+}
+
+/**
+ * cc_level_bar_set_suspended:
+ * @bar: a #CcLevelBar
+ * @suspended: whether to stop metering
+ *
+ * Stops metering while the bar is out of sight, for example when it
+ * was scrolled out of view. Unmapped bars are always suspended.
+ */
+void
+cc_level_bar_set_suspended (CcLevelBar *self,
+                            gboolean    suspended)
+{
+  g_return_if_fail (CC_IS_LEVEL_BAR (self));
+
+  self->suspended = !!suspended;
+  update_suspended (self);
 }
@@ -28,7 +28,10 @@ G_BEGIN_DECLS
 #define CC_TYPE_LEVEL_BAR (cc_level_bar_get_type ())
 G_DECLARE_FINAL_TYPE (CcLevelBar, cc_level_bar, CC, LEVEL_BAR, GtkWidget)
 
-void cc_level_bar_set_stream (CcLevelBar     *bar,
-                              GvcMixerStream *stream);
+void cc_level_bar_set_stream    (CcLevelBar     *bar,
+                                 GvcMixerStream *stream);
+
+void cc_level_bar_set_suspended (CcLevelBar     *bar,
+                                 gboolean        suspended);
 
 G_END_DECLS
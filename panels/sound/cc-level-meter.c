@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "cc-level-meter.h"
+
+#define N_LANES 8
+
+/* Levels below this are shown as silence, so that the meter settles */
+#define SILENCE_THRESHOLD 1e-4
+
+/*
+ * Computes the absolute peak and the sum of squares of the samples.
+ * The main loop keeps independent per-lane accumulators and has no
+ * branches, so that the compiler can turn it into SIMD instructions.
+ */
+void
+cc_level_meter_measure (const gfloat *samples,
+                        gsize         n_samples,
+                        gfloat       *peak,
+                        gdouble      *sum_squares)
+{
+  gfloat  lane_peak[N_LANES] = { 0.0f, };
+  gfloat  lane_sum[N_LANES] = { 0.0f, };
+  gfloat  max = 0.0f;
+  gdouble sum = 0.0;
+  gsize   i, j;
+
+  for (i = 0; i + N_LANES <= n_samples; i += N_LANES)
+    {
+      for (j = 0; j < N_LANES; j++)
+        {
+          gfloat sample = samples[i + j];
+          gfloat magnitude = fabsf (sample);
+
+          lane_peak[j] = MAX (lane_peak[j], magnitude);
+          lane_sum[j] += sample * sample;
+        }
+    }
+
+  for (; i < n_samples; i++)
+    {
+      max = MAX (max, fabsf (samples[i]));
+      sum += samples[i] * samples[i];
+    }
+
+  for (j = 0; j < N_LANES; j++)
+    {
+      max = MAX (max, lane_peak[j]);
+      sum += lane_sum[j];
+    }
+
+  *peak = max;
+  *sum_squares = sum;
+}
+
+void
+cc_level_meter_reset (CcLevelMeter *meter)
+{
+  *meter = (CcLevelMeter) { 0, };
+}
+
+/*
+ * Accumulates samples until the next tick, which can happen after any
+ * number of fragments.
+ */
+void
+cc_level_meter_add_samples (CcLevelMeter *meter,
+                            const gfloat *samples,
+                            gsize         n_samples)
+{
+  gfloat  peak;
+  gdouble sum_squares;
+
+  if (n_samples == 0)
+    return;
+
+  cc_level_meter_measure (samples, n_samples, &peak, &sum_squares);
+
+  meter->pending_peak = MAX (meter->pending_peak, peak);
+  meter->pending_sum_squares += sum_squares;
+  meter->pending_samples += n_samples;
+}
+
+static gdouble
+settle (gdouble value)
+{
+  return value < SILENCE_THRESHOLD ? 0.0 : MIN (value, 1.0);
+}
+
+/*
+ * Updates the displayed values at given time. New levels are taken right
+ * away, lower ones fall off exponentially and the highest peak is held
+ * for a while before it falls as well.
+ *
+ * Returns TRUE if any of the displayed values changed.
+ */
+gboolean
+cc_level_meter_tick (CcLevelMeter *meter,
+                     gint64        time_us)
+{
+  gdouble decay = 1.0;
+  gdouble peak, rms, held_peak;
+  gboolean changed;
+
+  if (meter->last_tick_time > 0 && time_us > meter->last_tick_time)
+    decay = exp2 (-(gdouble) (time_us - meter->last_tick_time) / CC_LEVEL_METER_HALF_LIFE_US);
+  meter->last_tick_time = time_us;
+
+  peak = meter->peak * decay;
+  rms = meter->rms * decay;
+
+  if (meter->pending_samples > 0)
+    {
+      peak = MAX (peak, meter->pending_peak);
+      rms = MAX (rms, sqrt (meter->pending_sum_squares / meter->pending_samples));
+
+      meter->pending_peak = 0.0f;
+      meter->pending_sum_squares = 0.0;
+      meter->pending_samples = 0;
+    }
+
+  peak = settle (peak);
+  rms = settle (rms);
+
+  held_peak = meter->held_peak;
+  if (peak >= held_peak)
+    {
+      held_peak = peak;
+      meter->held_peak_time = time_us;
+    }
+  else if (time_us - meter->held_peak_time >= CC_LEVEL_METER_HOLD_TIME_US)
+    {
+      held_peak = settle (MAX (peak, held_peak * decay));
+    }
+
+  changed = peak != meter->peak || rms != meter->rms || held_peak != meter->held_peak;
+
+  meter->peak = peak;
+  meter->rms = rms;
+  meter->held_peak = held_peak;
+
+  return changed;
+}
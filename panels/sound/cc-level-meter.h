@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* How long the highest peak stays before it starts to fall */
+#define CC_LEVEL_METER_HOLD_TIME_US  (1500 * G_TIME_SPAN_MILLISECOND)
+/* Time for a level to fall to half of its value */
+#define CC_LEVEL_METER_HALF_LIFE_US  (150 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct
+{
+  /* Samples received since the last tick */
+  gfloat  pending_peak;
+  gdouble pending_sum_squares;
+  gsize   pending_samples;
+
+  /* Displayed values, linear amplitude in [0, 1] */
+  gdouble peak;
+  gdouble rms;
+  gdouble held_peak;
+
+  gint64  held_peak_time;
+  gint64  last_tick_time;
+} CcLevelMeter;
+
+void     cc_level_meter_measure       (const gfloat *samples,
+                                       gsize         n_samples,
+                                       gfloat       *peak,
+                                       gdouble      *sum_squares);
+
+void     cc_level_meter_reset         (CcLevelMeter *meter);
+
+void     cc_level_meter_add_samples   (CcLevelMeter *meter,
+                                       const gfloat *samples,
+                                       gsize         n_samples);
+
+gboolean cc_level_meter_tick          (CcLevelMeter *meter,
+                                       gint64        time_us);
+
+G_END_DECLS
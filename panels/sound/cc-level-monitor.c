@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-level-monitor.h"
+#include "gvc-mixer-stream-private.h"
+
+/*
+ * Level monitoring for all meters on one PulseAudio context.
+ *
+ * Every watched stream still needs its own record stream, but their
+ * samples are only accumulated when they arrive. Meters are advanced
+ * and their callbacks run from a single frame clock update per window,
+ * which only visits the meters that are not silent. Suspended watches
+ * keep their record stream corked, so they cost nothing.
+ */
+
+/* Rate of the monitoring streams, enough for a meter */
+#define LEVEL_SAMPLE_RATE 8000
+#define DEFAULT_REFRESH_RATE 60
+
+typedef struct _FrameGroup FrameGroup;
+
+typedef struct
+{
+  CcLevelMonitor     *monitor;
+  guint               id;
+
+  GtkWidget          *widget;
+  CcLevelMonitorFunc  func;
+  gpointer            user_data;
+
+  pa_stream          *stream;
+  CcLevelMeter        meter;
+  gboolean            suspended;
+
+  /* Set while the meter needs to be updated on every frame */
+  FrameGroup         *group;
+} Watch;
+
+/* The live meters of one frame clock */
+struct _FrameGroup
+{
+  CcLevelMonitor *monitor;
+  GdkFrameClock  *frame_clock;
+  gulong          update_id;
+  GPtrArray      *live;
+};
+
+struct _CcLevelMonitor
+{
+  GObject     parent_instance;
+
+  pa_context *context;
+  GHashTable *watches; /* id -> Watch */
+  GHashTable *groups;  /* GdkFrameClock -> FrameGroup */
+  guint       last_id;
+};
+
+G_DEFINE_TYPE (CcLevelMonitor, cc_level_monitor, G_TYPE_OBJECT)
+
+/* One monitor per context, pa_context -> CcLevelMonitor */
+static GHashTable *monitors = NULL;
+
+static void
+frame_group_free (FrameGroup *group)
+{
+  guint i;
+
+  for (i = 0; i < group->live->len; i++)
+    ((Watch *) g_ptr_array_index (group->live, i))->group = NULL;
+
+  g_signal_handler_disconnect (group->frame_clock, group->update_id);
+  gdk_frame_clock_end_updating (group->frame_clock);
+
+  g_object_unref (group->frame_clock);
+  g_ptr_array_unref (group->live);
+  g_free (group);
+}
+
+static void
+notify_watch (Watch *watch)
+{
+  watch->func (&watch->meter, watch->user_data);
+}
+
+static void
+update_cb (GdkFrameClock *frame_clock,
+           FrameGroup    *group)
+{
+  gint64 time = gdk_frame_clock_get_frame_time (frame_clock);
+  guint  i;
+
+  /* Backwards, so that silent meters can be dropped in place */
+  for (i = group->live->len; i > 0; i--)
+    {
+      Watch *watch = g_ptr_array_index (group->live, i - 1);
+
+      if (cc_level_meter_tick (&watch->meter, time))
+        notify_watch (watch);
+
+      if (watch->meter.held_peak == 0.0)
+        {
+          watch->group = NULL;
+          g_ptr_array_remove_index_fast (group->live, i - 1);
+        }
+    }
+
+  if (group->live->len == 0)
+    g_hash_table_remove (group->monitor->groups, frame_clock);
+}
+
+static void
+make_live (Watch *watch)
+{
+  CcLevelMonitor *self = watch->monitor;
+  GdkFrameClock  *frame_clock;
+  FrameGroup     *group;
+
+  if (watch->group != NULL)
+    return;
+
+  frame_clock = gtk_widget_get_frame_clock (watch->widget);
+  if (frame_clock == NULL)
+    {
+      /* Not shown anywhere */
+      cc_level_meter_reset (&watch->meter);
+      return;
+    }
+
+  group = g_hash_table_lookup (self->groups, frame_clock);
+  if (group == NULL)
+    {
+      group = g_new0 (FrameGroup, 1);
+      group->monitor = self;
+      group->frame_clock = g_object_ref (frame_clock);
+      group->live = g_ptr_array_new ();
+      group->update_id = g_signal_connect (frame_clock, "update", G_CALLBACK (update_cb), group);
+      gdk_frame_clock_begin_updating (frame_clock);
+
+      g_hash_table_insert (self->groups, frame_clock, group);
+    }
+
+  g_ptr_array_add (group->live, watch);
+  watch->group = group;
+}
+
+static void
+make_idle (Watch *watch)
+{
+  FrameGroup *group = watch->group;
+
+  if (group == NULL)
+    return;
+
+  watch->group = NULL;
+  g_ptr_array_remove_fast (group->live, watch);
+
+  if (group->live->len == 0)
+    g_hash_table_remove (watch->monitor->groups, group->frame_clock);
+}
+
+static void
+reset_watch (Watch *watch)
+{
+  make_idle (watch);
+  cc_level_meter_reset (&watch->meter);
+  notify_watch (watch);
+}
+
+static void
+read_cb (pa_stream *stream,
+         size_t     length,
+         void      *userdata)
+{
+  Watch      *watch = userdata;
+  const void *data;
+
+  if (pa_stream_peek (stream, &data, &length) < 0)
+    {
+      g_warning ("Failed to read data from stream");
+      return;
+    }
+
+  if (!data)
+    {
+      if (length > 0)
+        pa_stream_drop (stream);
+      return;
+    }
+
+  g_assert (length % sizeof (float) == 0);
+
+  /* Fragments which arrived before a cork took effect */
+  if (!watch->suspended)
+    {
+      cc_level_meter_add_samples (&watch->meter, data, length / sizeof (float));
+      make_live (watch);
+    }
+
+  pa_stream_drop (stream);
+}
+
+static void
+suspended_cb (pa_stream *stream,
+              void      *userdata)
+{
+  Watch *watch = userdata;
+
+  if (pa_stream_is_suspended (stream))
+    {
+      g_debug ("Stream suspended");
+      reset_watch (watch);
+    }
+}
+
+static void
+update_cork (Watch *watch)
+{
+  pa_operation *operation;
+
+  if (pa_stream_get_state (watch->stream) != PA_STREAM_READY ||
+      pa_stream_is_corked (watch->stream) == watch->suspended)
+    return;
+
+  operation = pa_stream_cork (watch->stream, watch->suspended, NULL, NULL);
+  if (operation != NULL)
+    pa_operation_unref (operation);
+}
+
+static void
+state_cb (pa_stream *stream,
+          void      *userdata)
+{
+  /* The watch may have been suspended or resumed while connecting */
+  update_cork (userdata);
+}
+
+static guint
+get_refresh_rate (GtkWidget *widget)
+{
+  GtkNative  *native = gtk_widget_get_native (widget);
+  GdkSurface *surface;
+  GdkMonitor *monitor;
+  gint        refresh_rate;
+
+  if (native == NULL)
+    return DEFAULT_REFRESH_RATE;
+
+  surface = gtk_native_get_surface (native);
+  if (surface == NULL)
+    return DEFAULT_REFRESH_RATE;
+
+  monitor = gdk_display_get_monitor_at_surface (gtk_widget_get_display (widget), surface);
+  if (monitor == NULL)
+    return DEFAULT_REFRESH_RATE;
+
+  /* In millihertz, 0 if unknown */
+  refresh_rate = gdk_monitor_get_refresh_rate (monitor) / 1000;
+
+  return refresh_rate > 0 ? refresh_rate : DEFAULT_REFRESH_RATE;
+}
+
+static gboolean
+connect_watch (Watch          *watch,
+               GvcMixerStream *stream)
+{
+  pa_sample_spec    sample_spec;
+  pa_proplist      *proplist;
+  pa_buffer_attr    attr;
+  pa_stream_flags_t flags;
+  g_autofree gchar *device = NULL;
+
+  sample_spec.channels = 1;
+  sample_spec.format = PA_SAMPLE_FLOAT32;
+  sample_spec.rate = LEVEL_SAMPLE_RATE;
+
+  proplist = pa_proplist_new ();
+  pa_proplist_sets (proplist, PA_PROP_APPLICATION_ID, "org.gnome.VolumeControl");
+  watch->stream = pa_stream_new_with_proplist (watch->monitor->context, "Peak detect", &sample_spec, NULL, proplist);
+  pa_proplist_free (proplist);
+  if (watch->stream == NULL)
+    {
+      g_warning ("Failed to create monitoring stream");
+      return FALSE;
+    }
+
+  pa_stream_set_read_callback (watch->stream, read_cb, watch);
+  pa_stream_set_suspended_callback (watch->stream, suspended_cb, watch);
+  pa_stream_set_state_callback (watch->stream, state_cb, watch);
+
+  /* Deliver one fragment per frame, metered as a whole */
+  memset (&attr, 0, sizeof (attr));
+  attr.fragsize = sizeof (float) * MAX (1, LEVEL_SAMPLE_RATE / get_refresh_rate (watch->widget));
+  attr.maxlength = (uint32_t) -1;
+
+  flags = PA_STREAM_DONT_MOVE | PA_STREAM_ADJUST_LATENCY;
+  if (watch->suspended)
+    flags |= PA_STREAM_START_CORKED;
+
+  device = g_strdup_printf ("%u", gvc_mixer_stream_get_index (stream));
+  if (pa_stream_connect_record (watch->stream, device, &attr, flags) < 0)
+    {
+      g_warning ("Failed to connect monitoring stream");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+watch_free (Watch *watch)
+{
+  make_idle (watch);
+
+  if (watch->stream != NULL)
+    {
+      /* Stop receiving data */
+      pa_stream_set_read_callback (watch->stream, NULL, NULL);
+      pa_stream_set_suspended_callback (watch->stream, NULL, NULL);
+      pa_stream_set_state_callback (watch->stream, NULL, NULL);
+
+      if (pa_stream_get_state (watch->stream) != PA_STREAM_UNCONNECTED)
+        pa_stream_disconnect (watch->stream);
+      pa_stream_unref (watch->stream);
+    }
+
+  g_free (watch);
+}
+
+static void
+cc_level_monitor_finalize (GObject *object)
+{
+  CcLevelMonitor *self = CC_LEVEL_MONITOR (object);
+
+  g_hash_table_remove (monitors, self->context);
+
+  g_hash_table_destroy (self->watches);
+  g_hash_table_destroy (self->groups);
+  pa_context_unref (self->context);
+
+  G_OBJECT_CLASS (cc_level_monitor_parent_class)->finalize (object);
+}
+
+static void
+cc_level_monitor_class_init (CcLevelMonitorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_level_monitor_finalize;
+}
+
+static void
+cc_level_monitor_init (CcLevelMonitor *self)
+{
+  self->watches = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) watch_free);
+  self->groups = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) frame_group_free);
+}
+
+/**
+ * cc_level_monitor_get_for_context:
+ * @context: a #pa_context
+ *
+ * Returns: (transfer full): the level monitor shared by all meters on @context
+ */
+CcLevelMonitor *
+cc_level_monitor_get_for_context (pa_context *context)
+{
+  CcLevelMonitor *self;
+
+  g_return_val_if_fail (context != NULL, NULL);
+
+  if (monitors == NULL)
+    monitors = g_hash_table_new (NULL, NULL);
+
+  self = g_hash_table_lookup (monitors, context);
+  if (self != NULL)
+    return g_object_ref (self);
+
+  self = g_object_new (CC_TYPE_LEVEL_MONITOR, NULL);
+  self->context = pa_context_ref (context);
+  g_hash_table_insert (monitors, context, self);
+
+  return self;
+}
+
+/**
+ * cc_level_monitor_watch:
+ * @monitor: a #CcLevelMonitor
+ * @stream: the stream to meter
+ * @widget: the widget showing the level, its frame clock paces the updates
+ * @func: called with the meter whenever it changed
+ * @user_data: data for @func
+ *
+ * Returns: an id for cc_level_monitor_unwatch(), or 0 if @stream can't be metered
+ */
+guint
+cc_level_monitor_watch (CcLevelMonitor     *self,
+                        GvcMixerStream     *stream,
+                        GtkWidget          *widget,
+                        CcLevelMonitorFunc  func,
+                        gpointer            user_data)
+{
+  Watch *watch;
+
+  g_return_val_if_fail (CC_IS_LEVEL_MONITOR (self), 0);
+  g_return_val_if_fail (GVC_IS_MIXER_STREAM (stream), 0);
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  if (pa_context_get_server_protocol_version (self->context) < 13)
+    {
+      g_warning ("Unsupported version of PulseAudio");
+      return 0;
+    }
+
+  watch = g_new0 (Watch, 1);
+  watch->monitor = self;
+  watch->id = ++self->last_id;
+  watch->widget = widget;
+  watch->func = func;
+  watch->user_data = user_data;
+  watch->suspended = !gtk_widget_get_mapped (widget);
+  cc_level_meter_reset (&watch->meter);
+
+  if (!connect_watch (watch, stream))
+    {
+      watch_free (watch);
+      return 0;
+    }
+
+  g_hash_table_insert (self->watches, GUINT_TO_POINTER (watch->id), watch);
+
+  return watch->id;
+}
+
+void
+cc_level_monitor_unwatch (CcLevelMonitor *self,
+                          guint           watch_id)
+{
+  g_return_if_fail (CC_IS_LEVEL_MONITOR (self));
+
+  g_hash_table_remove (self->watches, GUINT_TO_POINTER (watch_id));
+}
+
+/**
+ * cc_level_monitor_set_suspended:
+ * @monitor: a #CcLevelMonitor
+ * @watch_id: the id returned by cc_level_monitor_watch()
+ * @suspended: whether to stop metering
+ *
+ * Stops the samples of a meter which can't be seen, e.g. because it
+ * was scrolled out of view, without giving up its record stream.
+ */
+void
+cc_level_monitor_set_suspended (CcLevelMonitor *self,
+                                guint           watch_id,
+                                gboolean        suspended)
+{
+  Watch *watch;
+
+  g_return_if_fail (CC_IS_LEVEL_MONITOR (self));
+
+  watch = g_hash_table_lookup (self->watches, GUINT_TO_POINTER (watch_id));
+  if (watch == NULL || watch->suspended == suspended)
+    return;
+
+  watch->suspended = suspended;
+  update_cork (watch);
+
+  if (suspended)
+    reset_watch (watch);
+}
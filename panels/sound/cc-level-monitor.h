@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include <pulse/pulseaudio.h>
+#include <gvc-mixer-stream.h>
+
+#include "cc-level-meter.h"
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_LEVEL_MONITOR (cc_level_monitor_get_type ())
+G_DECLARE_FINAL_TYPE (CcLevelMonitor, cc_level_monitor, CC, LEVEL_MONITOR, GObject)
+
+typedef void (*CcLevelMonitorFunc) (const CcLevelMeter *meter,
+                                    gpointer            user_data);
+
+CcLevelMonitor *cc_level_monitor_get_for_context (pa_context       *context);
+
+guint           cc_level_monitor_watch           (CcLevelMonitor     *monitor,
+                                                  GvcMixerStream     *stream,
+                                                  GtkWidget          *widget,
+                                                  CcLevelMonitorFunc  func,
+                                                  gpointer            user_data);
+
+void            cc_level_monitor_unwatch         (CcLevelMonitor     *monitor,
+                                                  guint               watch_id);
+
+void            cc_level_monitor_set_suspended   (CcLevelMonitor     *monitor,
+                                                  guint               watch_id,
+                                                  gboolean            suspended);
+
+G_END_DECLS
@@ -20,6 +20,7 @@
 
 #include "cc-speaker-test-button.h"
 #include "cc-output-test-wheel.h"
+#include "cc-test-sound-cache.h"
 
 struct _CcOutputTestWheel
 {
@@ -39,6 +40,8 @@ struct _CcOutputTestWheel
   GtkWidget     *side_right_speaker_button;
 
   GSoundContext *context;
+  GCancellable  *cancellable;
+  GHashTable    *cached_events; /* pa_channel_position_t -> event id */
 };
 
 G_DEFINE_TYPE (CcOutputTestWheel, cc_output_test_wheel, GTK_TYPE_WIDGET)
@@ -145,11 +148,103 @@ cc_output_test_wheel_size_allocate (GtkWidget *widget,
   gtk_widget_size_allocate (self->lfe_speaker_button, &allocation, -1);
 }
 
+static void
+apply_cached_events (CcOutputTestWheel *self)
+{
+  GtkWidget *child;
+
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (self));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      CcSpeakerTestButton *button;
+      pa_channel_position_t position;
+
+      if (!CC_IS_SPEAKER_TEST_BUTTON (child))
+        continue;
+
+      button = CC_SPEAKER_TEST_BUTTON (child);
+      position = cc_speaker_test_button_get_channel_position (button);
+      cc_speaker_test_button_set_cached_event (button, g_hash_table_lookup (self->cached_events,
+                                                                            GINT_TO_POINTER (position)));
+    }
+}
+
+static void
+cache_cb (GObject      *source_object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+  CcOutputTestWheel *self = user_data;
+  g_autoptr(GHashTable) events = NULL;
+  g_autoptr(GError) error = NULL;
+  GHashTableIter iter;
+  gpointer position, event_id;
+
+  events = cc_test_sound_cache_finish (GSOUND_CONTEXT (source_object), result, &error);
+  if (events == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to cache test sounds: %s", error->message);
+      return;
+    }
+
+  g_hash_table_iter_init (&iter, events);
+  while (g_hash_table_iter_next (&iter, &position, &event_id))
+    g_hash_table_insert (self->cached_events, position, g_strdup (event_id));
+
+  apply_cached_events (self);
+}
+
+/* Uploads the sounds of the shown speakers which aren't cached yet */
+static void
+cache_sounds (CcOutputTestWheel *self)
+{
+  g_autoptr(GArray) positions = NULL;
+  GtkWidget *child;
+
+  positions = g_array_new (FALSE, FALSE, sizeof (pa_channel_position_t));
+
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (self));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      pa_channel_position_t position;
+
+      if (!CC_IS_SPEAKER_TEST_BUTTON (child) || !gtk_widget_get_visible (child))
+        continue;
+
+      position = cc_speaker_test_button_get_channel_position (CC_SPEAKER_TEST_BUTTON (child));
+      if (!g_hash_table_contains (self->cached_events, GINT_TO_POINTER (position)))
+        g_array_append_val (positions, position);
+    }
+
+  apply_cached_events (self);
+
+  if (positions->len == 0)
+    return;
+
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+  self->cancellable = g_cancellable_new ();
+
+  cc_test_sound_cache_async (self->context,
+                             (pa_channel_position_t *) positions->data,
+                             positions->len,
+                             self->cancellable,
+                             cache_cb,
+                             self);
+}
+
 static void
 cc_output_test_wheel_dispose (GObject *object)
 {
   CcOutputTestWheel *self = CC_OUTPUT_TEST_WHEEL (object);
 
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+  g_clear_pointer (&self->cached_events, g_hash_table_unref);
+
   g_clear_pointer (&self->label, gtk_widget_unparent);
 
   g_clear_pointer (&self->front_center_speaker_button, gtk_widget_unparent);
@@ -189,6 +284,8 @@ cc_output_test_wheel_init (CcOutputTestWheel *self)
   GtkSettings *settings;
   g_autofree gchar *theme_name = NULL;
 
+  self->cached_events = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
   self->context = gsound_context_new (NULL, NULL);
   gsound_context_set_driver (self->context, "pulse", NULL);
   gsound_context_set_attributes (self->context, NULL,
@@ -260,4 +357,6 @@ cc_output_test_wheel_set_stream (CcOutputTestWheel *self,
     {
       gtk_widget_set_visible (GTK_WIDGET (self->front_center_speaker_button), FALSE);
     }
+
+  cache_sounds (self);
 }
@@ -20,6 +20,7 @@
 
 #include "cc-sound-resources.h"
 #include "cc-speaker-test-button.h"
+#include "cc-test-sound-cache.h"
 
 struct _CcSpeakerTestButton
 {
@@ -29,6 +30,7 @@ struct _CcSpeakerTestButton
   GSoundContext        *context;
   pa_channel_position_t position;
   gint                  event_index;
+  gint                  first_event_index;
 };
 
 G_DEFINE_TYPE (CcSpeakerTestButton, cc_speaker_test_button, GTK_TYPE_BUTTON)
@@ -77,40 +79,6 @@ update_icon (CcSpeakerTestButton *self)
   gtk_button_set_icon_name (GTK_BUTTON (self), get_icon_name (self));
 }
 
-static GStrv
-get_sound_events (CcSpeakerTestButton *self)
-{
-  switch (self->position)
-    {
-  case PA_CHANNEL_POSITION_FRONT_LEFT:
-    return g_strsplit ("audio-channel-front-left;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_FRONT_RIGHT:
-    return g_strsplit ("audio-channel-front-right;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_FRONT_CENTER:
-    return g_strsplit ("audio-channel-front-center;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_REAR_LEFT:
-    return g_strsplit ("audio-channel-rear-left;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_REAR_RIGHT:
-    return g_strsplit ("audio-channel-rear-right;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_REAR_CENTER:
-    return g_strsplit ("audio-channel-rear-center;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_LFE:
-    return g_strsplit ("audio-channel-lfe;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_SIDE_LEFT:
-    return g_strsplit ("audio-channel-side-left;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_SIDE_RIGHT:
-    return g_strsplit ("audio-channel-side-right;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_FRONT_LEFT_OF_CENTER:
-    return g_strsplit ("audio-channel-front-left-of-center;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_FRONT_RIGHT_OF_CENTER:
-    return g_strsplit ("audio-channel-front-right-of-center;audio-test-signal;bell", ";", -1);
-  case PA_CHANNEL_POSITION_MONO:
-    return g_strsplit ("audio-channel-mono;audio-test-signal;bell", ";", -1);
-  default:
-    return g_strsplit ("audio-test-signal;bell", ";", -1);
-  }
-}
-
 static void
 finish_cb (GObject      *object,
            GAsyncResult *result,
@@ -143,7 +111,7 @@ play_sound (CcSpeakerTestButton *self)
   g_clear_object (&self->cancellable);
   self->cancellable = g_cancellable_new ();
 
-  events = get_sound_events (self);
+  events = cc_test_sound_get_events (self->position);
   if (events[self->event_index] == NULL)
     return FALSE;
 
@@ -152,6 +120,7 @@ play_sound (CcSpeakerTestButton *self)
                             GSOUND_ATTR_MEDIA_NAME, pa_channel_position_to_pretty_string (self->position),
                             GSOUND_ATTR_CANBERRA_FORCE_CHANNEL, pa_channel_position_to_string (self->position),
                             GSOUND_ATTR_CANBERRA_ENABLE, "1",
+                            GSOUND_ATTR_CANBERRA_CACHE_CONTROL, "permanent",
                             GSOUND_ATTR_EVENT_ID, events[self->event_index],
                             NULL);
   self->event_index++;
@@ -168,7 +137,7 @@ clicked_cb (CcSpeakerTestButton *self)
   gtk_widget_add_css_class (GTK_WIDGET (self), "playing");
 
   /* Play the per-channel sound name or a generic sound */
-  self->event_index = 0;
+  self->event_index = self->first_event_index;
   play_sound (self);
 }
 
@@ -231,5 +200,46 @@ cc_speaker_test_button_set_channel_position (CcSpeakerTestButton   *self,
     return;
 
   self->position = position;
+  self->first_event_index = 0;
   update_icon (self);
 }
+
+pa_channel_position_t
+cc_speaker_test_button_get_channel_position (CcSpeakerTestButton *self)
+{
+  g_return_val_if_fail (CC_IS_SPEAKER_TEST_BUTTON (self), PA_CHANNEL_POSITION_INVALID);
+
+  return self->position;
+}
+
+/**
+ * cc_speaker_test_button_set_cached_event:
+ * @button: a #CcSpeakerTestButton
+ * @event_id: (nullable): the cached sound of the button's position
+ *
+ * Makes the button start with the sound which is known to be in the
+ * sample cache, skipping the sounds the theme doesn't have.
+ */
+void
+cc_speaker_test_button_set_cached_event (CcSpeakerTestButton *self,
+                                         const gchar         *event_id)
+{
+  g_auto(GStrv) events = NULL;
+  gint i;
+
+  g_return_if_fail (CC_IS_SPEAKER_TEST_BUTTON (self));
+
+  self->first_event_index = 0;
+  if (event_id == NULL)
+    return;
+
+  events = cc_test_sound_get_events (self->position);
+  for (i = 0; events[i] != NULL; i++)
+    {
+      if (g_str_equal (events[i], event_id))
+        {
+          self->first_event_index = i;
+          return;
+        }
+    }
+}
@@ -33,4 +33,9 @@ GtkWidget *cc_speaker_test_button_new (GSoundContext         *context,
 void       cc_speaker_test_button_set_channel_position (CcSpeakerTestButton   *button,
                                                         pa_channel_position_t  position);
 
+pa_channel_position_t cc_speaker_test_button_get_channel_position (CcSpeakerTestButton *button);
+
+void       cc_speaker_test_button_set_cached_event     (CcSpeakerTestButton   *button,
+                                                        const gchar           *event_id);
+
 G_END_DECLS
@@ -125,3 +125,11 @@ cc_stream_row_get_id (CcStreamRow *self)
   g_return_val_if_fail (CC_IS_STREAM_ROW (self), 0);
   return self->id;
 }
+
+void
+cc_stream_row_set_level_suspended (CcStreamRow *self,
+                                   gboolean     suspended)
+{
+  g_return_if_fail (CC_IS_STREAM_ROW (self));
+  cc_level_bar_set_suspended (self->level_bar, suspended);
+}
@@ -39,4 +39,7 @@ GvcMixerStream *cc_stream_row_get_stream (CcStreamRow    *row);
 
 guint           cc_stream_row_get_id     (CcStreamRow    *row);
 
+void            cc_stream_row_set_level_suspended (CcStreamRow *row,
+                                                   gboolean     suspended);
+
 G_END_DECLS
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cc-test-sound-cache.h"
+
+/*
+ * Uploads the speaker test sounds to the sample cache of the sound
+ * server, so that a test plays without looking up and decoding the
+ * sound file first. Canberra names the cached samples by event id and
+ * plays them from the cache once they are there.
+ */
+
+typedef struct
+{
+  pa_channel_position_t *positions;
+  guint                  n_positions;
+} CacheData;
+
+static void
+cache_data_free (CacheData *data)
+{
+  g_free (data->positions);
+  g_free (data);
+}
+
+/**
+ * cc_test_sound_get_events:
+ * @position: a channel position
+ *
+ * Returns: (transfer full): the sound events to try for testing @position,
+ *   the channel specific ones first
+ */
+GStrv
+cc_test_sound_get_events (pa_channel_position_t position)
+{
+  switch (position)
+    {
+  case PA_CHANNEL_POSITION_FRONT_LEFT:
+    return g_strsplit ("audio-channel-front-left;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_FRONT_RIGHT:
+    return g_strsplit ("audio-channel-front-right;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_FRONT_CENTER:
+    return g_strsplit ("audio-channel-front-center;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_REAR_LEFT:
+    return g_strsplit ("audio-channel-rear-left;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_REAR_RIGHT:
+    return g_strsplit ("audio-channel-rear-right;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_REAR_CENTER:
+    return g_strsplit ("audio-channel-rear-center;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_LFE:
+    return g_strsplit ("audio-channel-lfe;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_SIDE_LEFT:
+    return g_strsplit ("audio-channel-side-left;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_SIDE_RIGHT:
+    return g_strsplit ("audio-channel-side-right;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_FRONT_LEFT_OF_CENTER:
+    return g_strsplit ("audio-channel-front-left-of-center;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_FRONT_RIGHT_OF_CENTER:
+    return g_strsplit ("audio-channel-front-right-of-center;audio-test-signal;bell", ";", -1);
+  case PA_CHANNEL_POSITION_MONO:
+    return g_strsplit ("audio-channel-mono;audio-test-signal;bell", ";", -1);
+  default:
+    return g_strsplit ("audio-test-signal;bell", ";", -1);
+  }
+}
+
+static void
+cache_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  GSoundContext *context = source_object;
+  CacheData *data = task_data;
+  g_autoptr(GHashTable) events = NULL;
+  g_autoptr(GHashTable) tried = NULL;
+  guint i, j;
+
+  events = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  /* Sound name -> whether it could be cached, most positions share a fallback */
+  tried = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; i < data->n_positions; i++)
+    {
+      g_auto(GStrv) names = cc_test_sound_get_events (data->positions[i]);
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      /* The first sound the theme has is the one a test plays */
+      for (j = 0; names[j] != NULL; j++)
+        {
+          gpointer value;
+          gboolean cached;
+
+          if (g_hash_table_lookup_extended (tried, names[j], NULL, &value))
+            {
+              cached = GPOINTER_TO_INT (value);
+            }
+          else
+            {
+              g_autoptr(GError) error = NULL;
+
+              cached = gsound_context_cache (context, &error,
+                                             GSOUND_ATTR_EVENT_ID, names[j],
+                                             NULL);
+              if (!cached)
+                g_debug ("Failed to cache sound %s: %s", names[j], error->message);
+
+              g_hash_table_insert (tried, g_strdup (names[j]), GINT_TO_POINTER (cached));
+            }
+
+          if (cached)
+            {
+              g_hash_table_insert (events, GINT_TO_POINTER (data->positions[i]), g_strdup (names[j]));
+              break;
+            }
+        }
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&events), (GDestroyNotify) g_hash_table_unref);
+}
+
+/**
+ * cc_test_sound_cache_async:
+ * @context: the context the tests are played with
+ * @positions: (array length=n_positions): the channel positions to be tested
+ * @n_positions: the number of positions
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when done
+ * @user_data: data for @callback
+ *
+ * Decodes and uploads the test sounds of @positions in a thread.
+ */
+void
+cc_test_sound_cache_async (GSoundContext               *context,
+                           const pa_channel_position_t *positions,
+                           guint                        n_positions,
+                           GCancellable                *cancellable,
+                           GAsyncReadyCallback          callback,
+                           gpointer                     user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  CacheData *data;
+
+  g_return_if_fail (GSOUND_IS_CONTEXT (context));
+
+  data = g_new0 (CacheData, 1);
+  data->positions = g_memdup2 (positions, n_positions * sizeof (pa_channel_position_t));
+  data->n_positions = n_positions;
+
+  task = g_task_new (context, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_test_sound_cache_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) cache_data_free);
+  g_task_run_in_thread (task, cache_thread);
+}
+
+/**
+ * cc_test_sound_cache_finish:
+ * @context: the #GSoundContext
+ * @result: a #GAsyncResult
+ * @error: return location for an error
+ *
+ * Returns: (transfer full): the cached event id of each channel position
+ *   which has a test sound, or %NULL on error
+ */
+GHashTable *
+cc_test_sound_cache_finish (GSoundContext  *context,
+                            GAsyncResult   *result,
+                            GError        **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, context), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <gsound.h>
+#include <pulse/pulseaudio.h>
+
+G_BEGIN_DECLS
+
+GStrv       cc_test_sound_get_events   (pa_channel_position_t         position);
+
+void        cc_test_sound_cache_async  (GSoundContext                *context,
+                                        const pa_channel_position_t  *positions,
+                                        guint                         n_positions,
+                                        GCancellable                 *cancellable,
+                                        GAsyncReadyCallback           callback,
+                                        gpointer                      user_data);
+
+GHashTable *cc_test_sound_cache_finish (GSoundContext                *context,
+                                        GAsyncResult                 *result,
+                                        GError                      **error);
+
+G_END_DECLS
@@ -31,7 +31,9 @@ struct _CcVolumeLevelsWindow
   GtkSizeGroup    *label_size_group;
 
   GvcMixerControl *mixer_control;
-  GListStore      *stream_list;
+
+  GtkAdjustment   *vadjustment;
+  guint            visibility_tick_id;
 };
 
 G_DEFINE_TYPE (CcVolumeLevelsWindow, cc_volume_levels_window, ADW_TYPE_WINDOW)
@@ -43,8 +45,6 @@ sort_stream (gconstpointer a,
 {
   CcVolumeLevelsWindow *self = user_data;
   GvcMixerStream *stream_a, *stream_b, *event_sink;
-  g_autofree gchar *name_a = NULL;
-  g_autofree gchar *name_b = NULL;
 
   stream_a = GVC_MIXER_STREAM (a);
   stream_b = GVC_MIXER_STREAM (b);
@@ -56,10 +56,8 @@ sort_stream (gconstpointer a,
   else if (stream_b == event_sink)
     return 1;
 
-  name_a = g_utf8_casefold (gvc_mixer_stream_get_name (stream_a), -1);
-  name_b = g_utf8_casefold (gvc_mixer_stream_get_name (stream_b), -1);
-
-  return g_strcmp0 (name_a, name_b);
+  /* The mixer control keeps the rest sorted by name */
+  return 0;
 }
 
 static gboolean
@@ -103,48 +101,75 @@ create_stream_row (gpointer item,
   return GTK_WIDGET (row);
 }
 
-static void
-stream_added_cb (CcVolumeLevelsWindow *self,
-                 guint                 id)
+/* Only rows in view are metered, the others keep their streams corked */
+static gboolean
+update_visibility_cb (GtkWidget     *widget,
+                      GdkFrameClock *frame_clock,
+                      gpointer       user_data)
 {
-  GvcMixerStream *stream = gvc_mixer_control_lookup_stream_id (self->mixer_control, id);
+  CcVolumeLevelsWindow *self = CC_VOLUME_LEVELS_WINDOW (widget);
+  GtkWidget *viewport;
+  GtkWidget *child;
+  gdouble height;
 
-  if (stream == NULL)
-    return;
+  self->visibility_tick_id = 0;
 
-  g_list_store_append (self->stream_list, G_OBJECT (stream));
-}
+  viewport = gtk_widget_get_ancestor (GTK_WIDGET (self->listbox), GTK_TYPE_SCROLLED_WINDOW);
+  if (viewport == NULL)
+    return G_SOURCE_REMOVE;
 
-static void
-stream_removed_cb (CcVolumeLevelsWindow *self,
-                   guint                 id)
-{
-  guint n_items = g_list_model_get_n_items (G_LIST_MODEL (self->stream_list));
+  height = gtk_widget_get_height (viewport);
 
-  for (guint i = 0; i < n_items; i++)
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (self->listbox));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
     {
-      g_autoptr(GObject) item;
-      guint stream_id;
+      graphene_rect_t bounds;
 
-      item = g_list_model_get_item (G_LIST_MODEL (self->stream_list), i);
-      stream_id = gvc_mixer_stream_get_id (GVC_MIXER_STREAM (item));
+      /* Rows which weren't allocated yet are metered until the next update */
+      if (!CC_IS_STREAM_ROW (child) ||
+          !gtk_widget_compute_bounds (child, viewport, &bounds))
+        continue;
 
-      if (id == stream_id)
-        {
-          g_list_store_remove (self->stream_list, i);
-          return;
-        }
+      cc_stream_row_set_level_suspended (CC_STREAM_ROW (child),
+                                         bounds.origin.y + bounds.size.height <= 0 ||
+                                         bounds.origin.y >= height);
     }
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
-add_stream (gpointer data,
-            gpointer user_data)
+queue_visibility_update (CcVolumeLevelsWindow *self)
 {
-  CcVolumeLevelsWindow *self = user_data;
-  GvcMixerStream *stream = data;
+  if (self->visibility_tick_id != 0)
+    return;
 
-  g_list_store_append (self->stream_list, G_OBJECT (stream));
+  self->visibility_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self), update_visibility_cb, NULL, NULL);
+}
+
+static void
+cc_volume_levels_window_map (GtkWidget *widget)
+{
+  CcVolumeLevelsWindow *self = CC_VOLUME_LEVELS_WINDOW (widget);
+  GtkWidget *scrolled_window;
+
+  GTK_WIDGET_CLASS (cc_volume_levels_window_parent_class)->map (widget);
+
+  scrolled_window = gtk_widget_get_ancestor (GTK_WIDGET (self->listbox), GTK_TYPE_SCROLLED_WINDOW);
+  if (scrolled_window == NULL || self->vadjustment != NULL)
+    return;
+
+  /* Scrolling, resizing and rows coming and going all change the adjustment */
+  self->vadjustment = g_object_ref (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (scrolled_window)));
+  g_signal_connect_object (self->vadjustment, "value-changed",
+                           G_CALLBACK (queue_visibility_update),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->vadjustment, "changed",
+                           G_CALLBACK (queue_visibility_update),
+                           self, G_CONNECT_SWAPPED);
+
+  queue_visibility_update (self);
 }
 
 static void
@@ -152,6 +177,11 @@ cc_volume_levels_window_dispose (GObject *object)
 {
   CcVolumeLevelsWindow *self = CC_VOLUME_LEVELS_WINDOW (object);
 
+  if (self->visibility_tick_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->visibility_tick_id);
+  self->visibility_tick_id = 0;
+
+  g_clear_object (&self->vadjustment);
   g_clear_object (&self->mixer_control);
 
   G_OBJECT_CLASS (cc_volume_levels_window_parent_class)->dispose (object);
@@ -165,6 +195,8 @@ cc_volume_levels_window_class_init (CcVolumeLevelsWindowClass *klass)
 
   object_class->dispose = cc_volume_levels_window_dispose;
 
+  widget_class->map = cc_volume_levels_window_map;
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/sound/cc-volume-levels-window.ui");
 
   gtk_widget_class_bind_template_child (widget_class, CcVolumeLevelsWindow, listbox);
@@ -176,17 +208,28 @@ cc_volume_levels_window_class_init (CcVolumeLevelsWindowClass *klass)
 void
 cc_volume_levels_window_init (CcVolumeLevelsWindow *self)
 {
+  gtk_widget_init_template (GTK_WIDGET (self));
+}
+
+CcVolumeLevelsWindow *
+cc_volume_levels_window_new (GvcMixerControl *mixer_control)
+{
+  CcVolumeLevelsWindow *self;
+  GListModel *streams;
   GtkFilter *filter;
   GtkFilterListModel *filter_model;
   GtkSorter *sorter;
   GtkSortListModel *sort_model;
 
-  gtk_widget_init_template (GTK_WIDGET (self));
+  self = g_object_new (CC_TYPE_VOLUME_LEVELS_WINDOW, NULL);
+
+  self->mixer_control = g_object_ref (mixer_control);
 
-  self->stream_list = g_list_store_new (GVC_TYPE_MIXER_STREAM);
+  /* Kept up to date and sorted by the mixer control */
+  streams = gvc_mixer_control_get_stream_model (self->mixer_control);
 
   filter = GTK_FILTER (gtk_custom_filter_new (filter_stream, NULL, NULL));
-  filter_model = gtk_filter_list_model_new (G_LIST_MODEL (self->stream_list), filter);
+  filter_model = gtk_filter_list_model_new (g_object_ref (streams), filter);
 
   sorter = GTK_SORTER (gtk_custom_sorter_new (sort_stream, self, NULL));
   sort_model = gtk_sort_list_model_new (G_LIST_MODEL (filter_model), sorter);
@@ -195,29 +238,6 @@ cc_volume_levels_window_init (CcVolumeLevelsWindow *self)
                            G_LIST_MODEL (sort_model),
                            create_stream_row,
                            self, NULL);
-}
-
-CcVolumeLevelsWindow *
-cc_volume_levels_window_new (GvcMixerControl *mixer_control)
-{
-  CcVolumeLevelsWindow *self;
-  g_autoptr(GSList) streams = NULL;
-
-  self = g_object_new (CC_TYPE_VOLUME_LEVELS_WINDOW, NULL);
-
-  self->mixer_control = g_object_ref (mixer_control);
-
-  streams = gvc_mixer_control_get_streams (self->mixer_control);
-  g_slist_foreach (streams, add_stream, self);
-
-  g_signal_connect_object (self->mixer_control,
-                           "stream-added",
-                           G_CALLBACK (stream_added_cb),
-                           self, G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->mixer_control,
-                           "stream-removed",
-                           G_CALLBACK (stream_removed_cb),
-                           self, G_CONNECT_SWAPPED);
 
   return self;
 }
@@ -26,6 +26,7 @@ G_BEGIN_DECLS
 /* Default storage keys */
 #define CC_OBJECT_NMCLIENT  "CcObjectStorage::nm-client"
 #define CC_OBJECT_HOSTNAME "CcObjectStorage::hostname"
+#define CC_OBJECT_PERMISSION_STORE "CcObjectStorage::permission-store"
 
 #define CC_TYPE_OBJECT_STORAGE (cc_object_storage_get_type())
 
@@ -49,9 +49,16 @@
 #include "gvc-channel-map-private.h"
 #include "gvc-mixer-control-private.h"
 #include "gvc-mixer-ui-device.h"
+#include "gvc-mixer-event-queue.h"
+#include "gvc-mixer-list-model.h"
 
 #define RECONNECT_DELAY 5
 
+/* Window in which subscription events are collected before refreshing */
+#define EVENT_COALESCE_TIMEOUT 50
+/* Changed objects of one kind above which all of them are listed at once */
+#define EVENT_LIST_THRESHOLD 8
+
 enum {
         PROP_0,
         PROP_NAME,
@@ -87,6 +94,17 @@ struct GvcMixerControlPrivate
         GHashTable       *clients;
         GHashTable       *cards;
 
+        GvcMixerEventQueue *event_queue;
+
+        /* Sorted views of the tables above, kept up to date as objects come and go */
+        GvcMixerListModel *stream_model;
+        GvcMixerListModel *sink_model;
+        GvcMixerListModel *source_model;
+        GvcMixerListModel *sink_input_model;
+        GvcMixerListModel *source_output_model;
+        GvcMixerListModel *ui_output_model;
+        GvcMixerListModel *ui_input_model;
+
         GvcMixerStream   *new_default_sink_stream; /* new default sink stream, used in gvc_mixer_control_set_default_sink () */
         GvcMixerStream   *new_default_source_stream; /* new default source stream, used in gvc_mixer_control_set_default_source () */
 
@@ -910,6 +928,125 @@ gvc_mixer_control_get_source_outputs (GvcMixerControl *control)
         return g_slist_sort (retval, (GCompareFunc) gvc_stream_collate);
 }
 
+/**
+ * gvc_mixer_control_get_stream_model:
+ * @control:
+ *
+ * Returns a list of all streams, sorted by name. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_stream_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->stream_model);
+}
+
+/**
+ * gvc_mixer_control_get_sink_model:
+ * @control:
+ *
+ * Returns a list of the sinks, sorted by name. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_sink_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->sink_model);
+}
+
+/**
+ * gvc_mixer_control_get_source_model:
+ * @control:
+ *
+ * Returns a list of the sources, sorted by name. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_source_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->source_model);
+}
+
+/**
+ * gvc_mixer_control_get_sink_input_model:
+ * @control:
+ *
+ * Returns a list of the sink inputs, sorted by name. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_sink_input_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->sink_input_model);
+}
+
+/**
+ * gvc_mixer_control_get_source_output_model:
+ * @control:
+ *
+ * Returns a list of the source outputs, sorted by name. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_source_output_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->source_output_model);
+}
+
+/**
+ * gvc_mixer_control_get_ui_output_model:
+ * @control:
+ *
+ * Returns a list of the visible output devices, sorted by description. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_ui_output_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->ui_output_model);
+}
+
+/**
+ * gvc_mixer_control_get_ui_input_model:
+ * @control:
+ *
+ * Returns a list of the visible input devices, sorted by description. The list is
+ * updated in place as they are added, removed or renamed.
+ *
+ * Returns: (transfer none):
+ */
+GListModel *
+gvc_mixer_control_get_ui_input_model (GvcMixerControl *control)
+{
+        g_return_val_if_fail (GVC_IS_MIXER_CONTROL (control), NULL);
+
+        return G_LIST_MODEL (control->priv->ui_input_model);
+}
+
 static void
 dec_outstanding (GvcMixerControl *control)
 {
@@ -1186,11 +1323,29 @@ update_server (GvcMixerControl      *control,
         }
 }
 
+static GvcMixerListModel *
+get_stream_type_model (GvcMixerControl *control,
+                       GvcMixerStream  *stream)
+{
+        if (GVC_IS_MIXER_SINK (stream))
+                return control->priv->sink_model;
+        if (GVC_IS_MIXER_SOURCE (stream))
+                return control->priv->source_model;
+        if (GVC_IS_MIXER_SINK_INPUT (stream))
+                return control->priv->sink_input_model;
+        if (GVC_IS_MIXER_SOURCE_OUTPUT (stream))
+                return control->priv->source_output_model;
+
+        /* Event role streams only show up in the list of all streams */
+        return NULL;
+}
+
 static void
 remove_stream (GvcMixerControl *control,
                GvcMixerStream  *stream)
 {
-        guint id;
+        GvcMixerListModel *model;
+        guint              id;
 
         g_object_ref (stream);
 
@@ -1204,6 +1359,10 @@ remove_stream (GvcMixerControl *control,
 
         g_hash_table_remove (control->priv->all_streams,
                              GUINT_TO_POINTER (id));
+        gvc_mixer_list_model_remove_id (control->priv->stream_model, id);
+        model = get_stream_type_model (control, stream);
+        if (model != NULL)
+                gvc_mixer_list_model_remove_id (model, id);
         g_signal_emit (G_OBJECT (control),
                        signals[STREAM_REMOVED],
                        0,
@@ -1215,9 +1374,15 @@ static void
 add_stream (GvcMixerControl *control,
             GvcMixerStream  *stream)
 {
+        GvcMixerListModel *model;
+
         g_hash_table_insert (control->priv->all_streams,
                              GUINT_TO_POINTER (gvc_mixer_stream_get_id (stream)),
                              stream);
+        gvc_mixer_list_model_add (control->priv->stream_model, stream);
+        model = get_stream_type_model (control, stream);
+        if (model != NULL)
+                gvc_mixer_list_model_add (model, stream);
         g_signal_emit (G_OBJECT (control),
                        signals[STREAM_ADDED],
                        0,
@@ -3275,6 +3440,44 @@ remove_source_output (GvcMixerControl *control,
         remove_stream (control, stream);
 }
 
+static void
+process_events_cb (pa_subscription_event_type_t facility,
+                   int                          index,
+                   gpointer                     user_data)
+{
+        GvcMixerControl *control = GVC_MIXER_CONTROL (user_data);
+
+        switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+                req_update_sink_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+                req_update_source_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+                req_update_sink_input_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+                req_update_source_output_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+                req_update_client_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+                req_update_server_info (control, index);
+                break;
+        case PA_SUBSCRIPTION_EVENT_CARD:
+                req_update_card (control, index);
+                break;
+        default:
+                break;
+        }
+}
+
+/*
+ * Removals are applied right away, changes are collected and refreshed
+ * once per window by process_events_cb().
+ */
 static void
 _pa_context_subscribe_cb (pa_context                  *context,
                           pa_subscription_event_type_t t,
@@ -3282,58 +3485,49 @@ _pa_context_subscribe_cb (pa_context                  *context,
                           void                        *userdata)
 {
         GvcMixerControl *control = GVC_MIXER_CONTROL (userdata);
+        pa_subscription_event_type_t facility = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+        gboolean removed = (t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE;
 
-        switch (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        switch (facility) {
         case PA_SUBSCRIPTION_EVENT_SINK:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_sink (control, index);
-                } else {
-                        req_update_sink_info (control, index);
-                }
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+        case PA_SUBSCRIPTION_EVENT_CLIENT:
+        case PA_SUBSCRIPTION_EVENT_CARD:
+                break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+                removed = FALSE;
                 break;
+        default:
+                return;
+        }
+
+        if (!removed) {
+                gvc_mixer_event_queue_update (control->priv->event_queue, facility, index);
+                return;
+        }
+
+        gvc_mixer_event_queue_cancel (control->priv->event_queue, facility, index);
 
+        switch (facility) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+                remove_sink (control, index);
+                break;
         case PA_SUBSCRIPTION_EVENT_SOURCE:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_source (control, index);
-                } else {
-                        req_update_source_info (control, index);
-                }
+                remove_source (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_sink_input (control, index);
-                } else {
-                        req_update_sink_input_info (control, index);
-                }
+                remove_sink_input (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_source_output (control, index);
-                } else {
-                        req_update_source_output_info (control, index);
-                }
+                remove_source_output (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_CLIENT:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_client (control, index);
-                } else {
-                        req_update_client_info (control, index);
-                }
-                break;
-
-        case PA_SUBSCRIPTION_EVENT_SERVER:
-                req_update_server_info (control, index);
+                remove_client (control, index);
                 break;
-
         case PA_SUBSCRIPTION_EVENT_CARD:
-                if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
-                        remove_card (control, index);
-                } else {
-                        req_update_card (control, index);
-                }
+                remove_card (control, index);
                 break;
         default:
                 break;
@@ -3461,6 +3655,16 @@ idle_reconnect (gpointer data)
 
         g_debug ("Reconnect: clean up all objects");
 
+        gvc_mixer_event_queue_clear (control->priv->event_queue);
+
+        gvc_mixer_list_model_remove_all (control->priv->stream_model);
+        gvc_mixer_list_model_remove_all (control->priv->sink_model);
+        gvc_mixer_list_model_remove_all (control->priv->source_model);
+        gvc_mixer_list_model_remove_all (control->priv->sink_input_model);
+        gvc_mixer_list_model_remove_all (control->priv->source_output_model);
+        gvc_mixer_list_model_remove_all (control->priv->ui_output_model);
+        gvc_mixer_list_model_remove_all (control->priv->ui_input_model);
+
         remove_all_items (control, control->priv->sinks, remove_sink);
         remove_all_items (control, control->priv->sources, remove_source);
         remove_all_items (control, control->priv->sink_inputs, remove_sink_input);
@@ -3503,6 +3707,7 @@ _pa_context_state_cb (pa_context *context,
                 break;
 
         case PA_CONTEXT_FAILED:
+                gvc_mixer_event_queue_clear (control->priv->event_queue);
                 control->priv->state = GVC_STATE_FAILED;
                 g_signal_emit (control, signals[STATE_CHANGED], 0, GVC_STATE_FAILED);
                 if (control->priv->reconnect_id == 0)
@@ -3563,6 +3768,16 @@ gvc_mixer_control_dispose (GObject *object)
                 control->priv->reconnect_id = 0;
         }
 
+        g_clear_pointer (&control->priv->event_queue, gvc_mixer_event_queue_free);
+
+        g_clear_object (&control->priv->stream_model);
+        g_clear_object (&control->priv->sink_model);
+        g_clear_object (&control->priv->source_model);
+        g_clear_object (&control->priv->sink_input_model);
+        g_clear_object (&control->priv->source_output_model);
+        g_clear_object (&control->priv->ui_output_model);
+        g_clear_object (&control->priv->ui_input_model);
+
         if (control->priv->pa_context != NULL) {
                 pa_context_unref (control->priv->pa_context);
                 control->priv->pa_context = NULL;
@@ -3681,6 +3896,42 @@ gvc_mixer_control_constructor (GType                  type,
         return object;
 }
 
+static void
+gvc_mixer_control_output_added (GvcMixerControl *control,
+                                guint            id)
+{
+        GvcMixerUIDevice *device;
+
+        device = g_hash_table_lookup (control->priv->ui_outputs, GUINT_TO_POINTER (id));
+        if (device != NULL)
+                gvc_mixer_list_model_add (control->priv->ui_output_model, device);
+}
+
+static void
+gvc_mixer_control_input_added (GvcMixerControl *control,
+                               guint            id)
+{
+        GvcMixerUIDevice *device;
+
+        device = g_hash_table_lookup (control->priv->ui_inputs, GUINT_TO_POINTER (id));
+        if (device != NULL)
+                gvc_mixer_list_model_add (control->priv->ui_input_model, device);
+}
+
+static void
+gvc_mixer_control_output_removed (GvcMixerControl *control,
+                                  guint            id)
+{
+        gvc_mixer_list_model_remove_id (control->priv->ui_output_model, id);
+}
+
+static void
+gvc_mixer_control_input_removed (GvcMixerControl *control,
+                                 guint            id)
+{
+        gvc_mixer_list_model_remove_id (control->priv->ui_input_model, id);
+}
+
 static void
 gvc_mixer_control_class_init (GvcMixerControlClass *klass)
 {
@@ -3692,6 +3943,11 @@ gvc_mixer_control_class_init (GvcMixerControlClass *klass)
         object_class->set_property = gvc_mixer_control_set_property;
         object_class->get_property = gvc_mixer_control_get_property;
 
+        klass->output_added = gvc_mixer_control_output_added;
+        klass->input_added = gvc_mixer_control_input_added;
+        klass->output_removed = gvc_mixer_control_output_removed;
+        klass->input_removed = gvc_mixer_control_input_removed;
+
         obj_props[PROP_NAME] = g_param_spec_string ("name",
                                                     "Name",
                                                     "Name to display for this mixer control",
@@ -3807,6 +4063,32 @@ gvc_mixer_control_class_init (GvcMixerControlClass *klass)
 }
 
 
+static GvcMixerListModel *
+new_stream_model (GType type)
+{
+        return gvc_mixer_list_model_new (type,
+                                         (GvcMixerListModelIdFunc) gvc_mixer_stream_get_id,
+                                         (GCompareFunc) gvc_stream_collate,
+                                         "name");
+}
+
+static int
+gvc_ui_device_collate (GvcMixerUIDevice *a,
+                       GvcMixerUIDevice *b)
+{
+        return gvc_name_collate (gvc_mixer_ui_device_get_description (a),
+                                 gvc_mixer_ui_device_get_description (b));
+}
+
+static GvcMixerListModel *
+new_device_model (void)
+{
+        return gvc_mixer_list_model_new (GVC_TYPE_MIXER_UI_DEVICE,
+                                         (GvcMixerListModelIdFunc) gvc_mixer_ui_device_get_id,
+                                         (GCompareFunc) gvc_ui_device_collate,
+                                         "description");
+}
+
 static void
 gvc_mixer_control_init (GvcMixerControl *control)
 {
@@ -3829,6 +4111,19 @@ gvc_mixer_control_init (GvcMixerControl *control)
 
         control->priv->clients = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_free);
 
+        control->priv->stream_model = new_stream_model (GVC_TYPE_MIXER_STREAM);
+        control->priv->sink_model = new_stream_model (GVC_TYPE_MIXER_SINK);
+        control->priv->source_model = new_stream_model (GVC_TYPE_MIXER_SOURCE);
+        control->priv->sink_input_model = new_stream_model (GVC_TYPE_MIXER_SINK_INPUT);
+        control->priv->source_output_model = new_stream_model (GVC_TYPE_MIXER_SOURCE_OUTPUT);
+        control->priv->ui_output_model = new_device_model ();
+        control->priv->ui_input_model = new_device_model ();
+
+        control->priv->event_queue = gvc_mixer_event_queue_new (EVENT_COALESCE_TIMEOUT,
+                                                                EVENT_LIST_THRESHOLD,
+                                                                process_events_cb,
+                                                                control);
+
 #ifdef HAVE_ALSA
         control->priv->headset_card = -1;
 #endif /* HAVE_ALSA */
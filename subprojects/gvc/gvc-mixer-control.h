@@ -21,7 +21,7 @@
 #ifndef __GVC_MIXER_CONTROL_H
 #define __GVC_MIXER_CONTROL_H
 
-#include <glib-object.h>
+#include <gio/gio.h>
 #include "gvc-mixer-stream.h"
 #include "gvc-mixer-card.h"
 #include "gvc-mixer-ui-device.h"
@@ -112,6 +112,14 @@ GSList *            gvc_mixer_control_get_sources         (GvcMixerControl *cont
 GSList *            gvc_mixer_control_get_sink_inputs     (GvcMixerControl *control);
 GSList *            gvc_mixer_control_get_source_outputs  (GvcMixerControl *control);
 
+GListModel *        gvc_mixer_control_get_stream_model        (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_sink_model          (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_source_model        (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_sink_input_model    (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_source_output_model (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_ui_output_model     (GvcMixerControl *control);
+GListModel *        gvc_mixer_control_get_ui_input_model      (GvcMixerControl *control);
+
 GvcMixerStream *        gvc_mixer_control_lookup_stream_id          (GvcMixerControl *control,
                                                                      guint            id);
 GvcMixerCard   *        gvc_mixer_control_lookup_card_id            (GvcMixerControl *control,
@@ -0,0 +1,242 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "gvc-mixer-event-queue.h"
+
+/*
+ * Collects objects changed by PulseAudio subscription events and asks
+ * for each of them once per window, instead of once per event. When
+ * many objects of one kind change at once (a profile switch, lots of
+ * streams coming and going), a single list request replaces them.
+ */
+
+#define N_FACILITIES (PA_SUBSCRIPTION_EVENT_FACILITY_MASK + 1)
+
+/* Same order as the initial introspection, so that e.g. sink inputs
+ * find their sinks and clients */
+static const pa_subscription_event_type_t facility_order[] = {
+        PA_SUBSCRIPTION_EVENT_SERVER,
+        PA_SUBSCRIPTION_EVENT_CARD,
+        PA_SUBSCRIPTION_EVENT_CLIENT,
+        PA_SUBSCRIPTION_EVENT_SINK,
+        PA_SUBSCRIPTION_EVENT_SOURCE,
+        PA_SUBSCRIPTION_EVENT_SINK_INPUT,
+        PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT,
+};
+
+struct GvcMixerEventQueue
+{
+        guint                   timeout_ms;
+        guint                   list_threshold;
+        GvcMixerEventQueueFunc  func;
+        gpointer                user_data;
+
+        guint                   timeout_id;
+        GHashTable             *dirty[N_FACILITIES];
+        gboolean                dirty_all[N_FACILITIES];
+
+        guint                   n_events;
+        guint                   n_requests;
+};
+
+GvcMixerEventQueue *
+gvc_mixer_event_queue_new (guint                  timeout_ms,
+                           guint                  list_threshold,
+                           GvcMixerEventQueueFunc func,
+                           gpointer               user_data)
+{
+        GvcMixerEventQueue *queue;
+        guint               i;
+
+        queue = g_new0 (GvcMixerEventQueue, 1);
+        queue->timeout_ms = timeout_ms;
+        queue->list_threshold = list_threshold;
+        queue->func = func;
+        queue->user_data = user_data;
+
+        for (i = 0; i < N_FACILITIES; i++)
+                queue->dirty[i] = g_hash_table_new (NULL, NULL);
+
+        return queue;
+}
+
+void
+gvc_mixer_event_queue_free (GvcMixerEventQueue *queue)
+{
+        guint i;
+
+        if (queue == NULL)
+                return;
+
+        if (queue->timeout_id != 0)
+                g_source_remove (queue->timeout_id);
+
+        for (i = 0; i < N_FACILITIES; i++)
+                g_hash_table_destroy (queue->dirty[i]);
+
+        g_free (queue);
+}
+
+static gboolean
+flush_timeout_cb (gpointer user_data)
+{
+        GvcMixerEventQueue *queue = user_data;
+
+        queue->timeout_id = 0;
+        gvc_mixer_event_queue_flush (queue);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Marks the object as changed. The window starts with the first event
+ * and is not extended by later ones, so that a steady stream of events
+ * can't postpone the refresh forever.
+ */
+void
+gvc_mixer_event_queue_update (GvcMixerEventQueue           *queue,
+                              pa_subscription_event_type_t  facility,
+                              guint32                       index)
+{
+        facility &= PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+
+        queue->n_events++;
+
+        if (!queue->dirty_all[facility]) {
+                if (index == PA_INVALID_INDEX || facility == PA_SUBSCRIPTION_EVENT_SERVER) {
+                        queue->dirty_all[facility] = TRUE;
+                } else {
+                        g_hash_table_add (queue->dirty[facility], GUINT_TO_POINTER (index));
+
+                        if (g_hash_table_size (queue->dirty[facility]) > queue->list_threshold)
+                                queue->dirty_all[facility] = TRUE;
+                }
+
+                if (queue->dirty_all[facility])
+                        g_hash_table_remove_all (queue->dirty[facility]);
+        }
+
+        if (queue->timeout_id == 0) {
+                queue->timeout_id = g_timeout_add (queue->timeout_ms, flush_timeout_cb, queue);
+                g_source_set_name_by_id (queue->timeout_id, "[gvc] flush_timeout_cb");
+        }
+}
+
+/*
+ * Forgets a pending refresh of an object that has been removed.
+ */
+void
+gvc_mixer_event_queue_cancel (GvcMixerEventQueue           *queue,
+                              pa_subscription_event_type_t  facility,
+                              guint32                       index)
+{
+        facility &= PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+
+        queue->n_events++;
+
+        g_hash_table_remove (queue->dirty[facility], GUINT_TO_POINTER (index));
+}
+
+static gint
+compare_indexes (gconstpointer a,
+                 gconstpointer b)
+{
+        guint index_a = GPOINTER_TO_UINT (*(gpointer *) a);
+        guint index_b = GPOINTER_TO_UINT (*(gpointer *) b);
+
+        return (index_a > index_b) - (index_a < index_b);
+}
+
+void
+gvc_mixer_event_queue_flush (GvcMixerEventQueue *queue)
+{
+        guint i, j;
+
+        if (queue->timeout_id != 0) {
+                g_source_remove (queue->timeout_id);
+                queue->timeout_id = 0;
+        }
+
+        for (i = 0; i < G_N_ELEMENTS (facility_order); i++) {
+                pa_subscription_event_type_t facility = facility_order[i];
+                gpointer                    *indexes;
+                guint                        n_indexes;
+
+                if (queue->dirty_all[facility]) {
+                        queue->dirty_all[facility] = FALSE;
+                        queue->n_requests++;
+                        queue->func (facility, -1, queue->user_data);
+                        continue;
+                }
+
+                if (g_hash_table_size (queue->dirty[facility]) == 0)
+                        continue;
+
+                /* Oldest objects first */
+                indexes = g_hash_table_get_keys_as_array (queue->dirty[facility], &n_indexes);
+                g_hash_table_steal_all (queue->dirty[facility]);
+                qsort (indexes, n_indexes, sizeof (gpointer), compare_indexes);
+
+                for (j = 0; j < n_indexes; j++) {
+                        queue->n_requests++;
+                        queue->func (facility, GPOINTER_TO_UINT (indexes[j]), queue->user_data);
+                }
+
+                g_free (indexes);
+        }
+}
+
+/*
+ * Drops all pending refreshes, e.g. when the connection is lost.
+ */
+void
+gvc_mixer_event_queue_clear (GvcMixerEventQueue *queue)
+{
+        guint i;
+
+        if (queue->timeout_id != 0) {
+                g_source_remove (queue->timeout_id);
+                queue->timeout_id = 0;
+        }
+
+        for (i = 0; i < N_FACILITIES; i++) {
+                g_hash_table_remove_all (queue->dirty[i]);
+                queue->dirty_all[i] = FALSE;
+        }
+}
+
+gboolean
+gvc_mixer_event_queue_is_pending (GvcMixerEventQueue *queue)
+{
+        return queue->timeout_id != 0;
+}
+
+void
+gvc_mixer_event_queue_get_stats (GvcMixerEventQueue *queue,
+                                 guint              *n_events,
+                                 guint              *n_requests)
+{
+        if (n_events != NULL)
+                *n_events = queue->n_events;
+        if (n_requests != NULL)
+                *n_requests = queue->n_requests;
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef __GVC_MIXER_EVENT_QUEUE_H
+#define __GVC_MIXER_EVENT_QUEUE_H
+
+#include <glib.h>
+#include <pulse/pulseaudio.h>
+
+G_BEGIN_DECLS
+
+typedef struct GvcMixerEventQueue GvcMixerEventQueue;
+
+/* Called for every object to refresh, with index -1 to refresh all
+ * objects of the facility */
+typedef void (*GvcMixerEventQueueFunc) (pa_subscription_event_type_t facility,
+                                        int                          index,
+                                        gpointer                     user_data);
+
+GvcMixerEventQueue *gvc_mixer_event_queue_new       (guint                         timeout_ms,
+                                                     guint                         list_threshold,
+                                                     GvcMixerEventQueueFunc        func,
+                                                     gpointer                      user_data);
+void                gvc_mixer_event_queue_free      (GvcMixerEventQueue           *queue);
+
+void                gvc_mixer_event_queue_update    (GvcMixerEventQueue           *queue,
+                                                     pa_subscription_event_type_t  facility,
+                                                     guint32                       index);
+void                gvc_mixer_event_queue_cancel    (GvcMixerEventQueue           *queue,
+                                                     pa_subscription_event_type_t  facility,
+                                                     guint32                       index);
+void                gvc_mixer_event_queue_flush     (GvcMixerEventQueue           *queue);
+void                gvc_mixer_event_queue_clear     (GvcMixerEventQueue           *queue);
+
+gboolean            gvc_mixer_event_queue_is_pending (GvcMixerEventQueue          *queue);
+void                gvc_mixer_event_queue_get_stats (GvcMixerEventQueue           *queue,
+                                                     guint                        *n_events,
+                                                     guint                        *n_requests);
+
+G_END_DECLS
+
+#endif /* __GVC_MIXER_EVENT_QUEUE_H */
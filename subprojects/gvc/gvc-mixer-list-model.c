@@ -0,0 +1,262 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#include "gvc-mixer-list-model.h"
+
+/*
+ * Sorted GListModel kept up to date incrementally. Items live in a
+ * balanced tree, so that adding, removing, re-sorting and looking up
+ * an item by position are all O(log n).
+ */
+
+struct _GvcMixerListModel
+{
+        GObject                  parent_instance;
+
+        GType                    item_type;
+        GvcMixerListModelIdFunc  id_func;
+        GCompareFunc             compare_func;
+        char                    *sort_notify;
+
+        GSequence               *items;
+        GHashTable              *iters; /* id -> GSequenceIter */
+};
+
+static void gvc_mixer_list_model_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GvcMixerListModel, gvc_mixer_list_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gvc_mixer_list_model_list_model_init))
+
+static GType
+gvc_mixer_list_model_get_item_type (GListModel *list)
+{
+        return GVC_MIXER_LIST_MODEL (list)->item_type;
+}
+
+static guint
+gvc_mixer_list_model_get_n_items (GListModel *list)
+{
+        return g_sequence_get_length (GVC_MIXER_LIST_MODEL (list)->items);
+}
+
+static gpointer
+gvc_mixer_list_model_get_item (GListModel *list,
+                               guint       position)
+{
+        GvcMixerListModel *model = GVC_MIXER_LIST_MODEL (list);
+        GSequenceIter     *iter;
+
+        iter = g_sequence_get_iter_at_pos (model->items, position);
+        if (g_sequence_iter_is_end (iter))
+                return NULL;
+
+        return g_object_ref (g_sequence_get (iter));
+}
+
+static void
+gvc_mixer_list_model_list_model_init (GListModelInterface *iface)
+{
+        iface->get_item_type = gvc_mixer_list_model_get_item_type;
+        iface->get_n_items = gvc_mixer_list_model_get_n_items;
+        iface->get_item = gvc_mixer_list_model_get_item;
+}
+
+static gint
+compare_items (gconstpointer a,
+               gconstpointer b,
+               gpointer      user_data)
+{
+        GvcMixerListModel *model = user_data;
+        gint               result;
+        guint              id_a, id_b;
+
+        result = model->compare_func (a, b);
+        if (result != 0)
+                return result;
+
+        /* Keep the order of equally named items stable */
+        id_a = model->id_func ((gpointer) a);
+        id_b = model->id_func ((gpointer) b);
+
+        return (id_a > id_b) - (id_a < id_b);
+}
+
+static void
+sort_key_changed_cb (GObject    *object,
+                     GParamSpec *pspec,
+                     gpointer    user_data)
+{
+        GvcMixerListModel *model = GVC_MIXER_LIST_MODEL (user_data);
+        GSequenceIter     *iter;
+        guint              old_position, new_position;
+
+        iter = g_hash_table_lookup (model->iters, GUINT_TO_POINTER (model->id_func (object)));
+        if (iter == NULL)
+                return;
+
+        old_position = g_sequence_iter_get_position (iter);
+        g_sequence_sort_changed (iter, compare_items, model);
+        new_position = g_sequence_iter_get_position (iter);
+
+        /* Only the items between both positions moved */
+        if (old_position != new_position) {
+                guint first = MIN (old_position, new_position);
+                guint n_moved = MAX (old_position, new_position) - first + 1;
+
+                g_list_model_items_changed (G_LIST_MODEL (model), first, n_moved, n_moved);
+        }
+}
+
+static void
+release_item (GvcMixerListModel *model,
+              gpointer           item)
+{
+        g_signal_handlers_disconnect_by_func (item, sort_key_changed_cb, model);
+        g_object_unref (item);
+}
+
+void
+gvc_mixer_list_model_add (GvcMixerListModel *model,
+                          gpointer           item)
+{
+        GSequenceIter *iter;
+        guint          id;
+
+        g_return_if_fail (GVC_IS_MIXER_LIST_MODEL (model));
+        g_return_if_fail (G_TYPE_CHECK_INSTANCE_TYPE (item, model->item_type));
+
+        id = model->id_func (item);
+        if (g_hash_table_contains (model->iters, GUINT_TO_POINTER (id)))
+                return;
+
+        iter = g_sequence_insert_sorted (model->items, g_object_ref (item), compare_items, model);
+        g_hash_table_insert (model->iters, GUINT_TO_POINTER (id), iter);
+
+        if (model->sort_notify != NULL)
+                g_signal_connect_object (item, model->sort_notify,
+                                         G_CALLBACK (sort_key_changed_cb), model, 0);
+
+        g_list_model_items_changed (G_LIST_MODEL (model), g_sequence_iter_get_position (iter), 0, 1);
+}
+
+void
+gvc_mixer_list_model_remove_id (GvcMixerListModel *model,
+                                guint              id)
+{
+        GSequenceIter *iter;
+        guint          position;
+
+        g_return_if_fail (GVC_IS_MIXER_LIST_MODEL (model));
+
+        iter = g_hash_table_lookup (model->iters, GUINT_TO_POINTER (id));
+        if (iter == NULL)
+                return;
+
+        g_hash_table_remove (model->iters, GUINT_TO_POINTER (id));
+
+        position = g_sequence_iter_get_position (iter);
+        release_item (model, g_sequence_get (iter));
+        g_sequence_remove (iter);
+
+        g_list_model_items_changed (G_LIST_MODEL (model), position, 1, 0);
+}
+
+void
+gvc_mixer_list_model_remove_all (GvcMixerListModel *model)
+{
+        GSequenceIter *iter;
+        guint          n_items;
+
+        g_return_if_fail (GVC_IS_MIXER_LIST_MODEL (model));
+
+        n_items = g_sequence_get_length (model->items);
+        if (n_items == 0)
+                return;
+
+        for (iter = g_sequence_get_begin_iter (model->items);
+             !g_sequence_iter_is_end (iter);
+             iter = g_sequence_iter_next (iter))
+                release_item (model, g_sequence_get (iter));
+
+        g_sequence_remove_range (g_sequence_get_begin_iter (model->items),
+                                 g_sequence_get_end_iter (model->items));
+        g_hash_table_remove_all (model->iters);
+
+        g_list_model_items_changed (G_LIST_MODEL (model), 0, n_items, 0);
+}
+
+static void
+gvc_mixer_list_model_finalize (GObject *object)
+{
+        GvcMixerListModel *model = GVC_MIXER_LIST_MODEL (object);
+        GSequenceIter     *iter;
+
+        for (iter = g_sequence_get_begin_iter (model->items);
+             !g_sequence_iter_is_end (iter);
+             iter = g_sequence_iter_next (iter))
+                release_item (model, g_sequence_get (iter));
+
+        g_sequence_free (model->items);
+        g_hash_table_destroy (model->iters);
+        g_free (model->sort_notify);
+
+        G_OBJECT_CLASS (gvc_mixer_list_model_parent_class)->finalize (object);
+}
+
+static void
+gvc_mixer_list_model_class_init (GvcMixerListModelClass *klass)
+{
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->finalize = gvc_mixer_list_model_finalize;
+}
+
+static void
+gvc_mixer_list_model_init (GvcMixerListModel *model)
+{
+        model->items = g_sequence_new (NULL);
+        model->iters = g_hash_table_new (NULL, NULL);
+}
+
+/*
+ * Items are identified by id_func() and ordered by compare_func(). When
+ * sort_property is set, items are moved as soon as it changes.
+ */
+GvcMixerListModel *
+gvc_mixer_list_model_new (GType                   item_type,
+                          GvcMixerListModelIdFunc id_func,
+                          GCompareFunc            compare_func,
+                          const char             *sort_property)
+{
+        GvcMixerListModel *model;
+
+        g_return_val_if_fail (g_type_is_a (item_type, G_TYPE_OBJECT), NULL);
+        g_return_val_if_fail (id_func != NULL, NULL);
+        g_return_val_if_fail (compare_func != NULL, NULL);
+
+        model = g_object_new (GVC_TYPE_MIXER_LIST_MODEL, NULL);
+        model->item_type = item_type;
+        model->id_func = id_func;
+        model->compare_func = compare_func;
+        if (sort_property != NULL)
+                model->sort_notify = g_strconcat ("notify::", sort_property, NULL);
+
+        return model;
+}
@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef __GVC_MIXER_LIST_MODEL_H
+#define __GVC_MIXER_LIST_MODEL_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GVC_TYPE_MIXER_LIST_MODEL (gvc_mixer_list_model_get_type ())
+G_DECLARE_FINAL_TYPE (GvcMixerListModel, gvc_mixer_list_model, GVC, MIXER_LIST_MODEL, GObject)
+
+typedef guint (*GvcMixerListModelIdFunc) (gpointer item);
+
+GvcMixerListModel *gvc_mixer_list_model_new        (GType                    item_type,
+                                                    GvcMixerListModelIdFunc  id_func,
+                                                    GCompareFunc             compare_func,
+                                                    const char              *sort_property);
+
+void               gvc_mixer_list_model_add        (GvcMixerListModel       *model,
+                                                    gpointer                 item);
+void               gvc_mixer_list_model_remove_id  (GvcMixerListModel       *model,
+                                                    guint                    id);
+void               gvc_mixer_list_model_remove_all (GvcMixerListModel       *model);
+
+G_END_DECLS
+
+#endif /* __GVC_MIXER_LIST_MODEL_H */
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib/gstdio.h>
+#include <gio/gdesktopappinfo.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define N_APPS   3000
+#define N_EXTRA  50
+
+static gchar *applications_dir = NULL;
+
+typedef struct
+{
+  guint n_emissions;
+  guint n_removed;
+  guint n_added;
+} Changes;
+
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  Changes    *changes)
+{
+  changes->n_emissions++;
+  changes->n_removed += removed;
+  changes->n_added += added;
+}
+
+static gchar *
+get_desktop_id (guint i)
+{
+  return g_strdup_printf ("org.example.App%04u.desktop", i);
+}
+
+static void
+write_desktop_file_full (guint        i,
+                         const gchar *name,
+                         const gchar *extra)
+{
+  g_autofree gchar *id = get_desktop_id (i);
+  g_autofree gchar *path = g_build_filename (applications_dir, id, NULL);
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) error = NULL;
+
+  contents = g_strdup_printf ("[Desktop Entry]\n"
+                              "Type=Application\n"
+                              "Name=%s\n"
+                              "Icon=org.example.App%04u\n"
+                              "%s",
+                              name, i, extra ? extra : "Exec=true\n");
+
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+static void
+write_desktop_file (guint        i,
+                    const gchar *name)
+{
+  write_desktop_file_full (i, name, NULL);
+}
+
+/* Shuffled, and in mixed case, so that neither the file order nor a
+ * plain strcmp() gives the sorted order */
+static void
+write_desktop_files (void)
+{
+  guint i;
+
+  for (i = 0; i < N_APPS + N_EXTRA; i++)
+    {
+      g_autofree gchar *name = NULL;
+      guint n = (i * 7919) % (N_APPS + N_EXTRA);
+
+      name = g_strdup_printf ("%s %u", n % 2 ? "application" : "Application", n);
+      write_desktop_file (i, name);
+    }
+}
+
+static GPtrArray *
+load_apps (guint first,
+           guint last)
+{
+  GPtrArray *infos;
+  guint i;
+
+  infos = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = first; i < last; i++)
+    {
+      g_autofree gchar *id = get_desktop_id (i);
+      GDesktopAppInfo *info = g_desktop_app_info_new (id);
+
+      g_assert_nonnull (info);
+      g_ptr_array_add (infos, info);
+    }
+
+  return infos;
+}
+
+static void
+assert_sorted (GListModel *model)
+{
+  guint i;
+
+  for (i = 1; i < g_list_model_get_n_items (model); i++)
+    {
+      g_autoptr(GAppInfo) a = g_list_model_get_item (model, i - 1);
+      g_autoptr(GAppInfo) b = g_list_model_get_item (model, i);
+      g_autofree gchar *key_a = g_utf8_casefold (g_app_info_get_display_name (a), -1);
+      g_autofree gchar *key_b = g_utf8_casefold (g_app_info_get_display_name (b), -1);
+
+      g_assert_cmpint (g_utf8_collate (key_a, key_b), <=, 0);
+    }
+}
+
+static GAppInfo *
+find_app (GListModel  *model,
+          const gchar *id)
+{
+  guint i;
+
+  for (i = 0; i < g_list_model_get_n_items (model); i++)
+    {
+      g_autoptr(GAppInfo) info = g_list_model_get_item (model, i);
+
+      if (g_strcmp0 (g_app_info_get_id (info), id) == 0)
+        return info;
+    }
+
+  return NULL;
+}
+
+static void
+test_load (void)
+{
+  g_autoptr(GListStore) store = g_list_store_new (G_TYPE_APP_INFO);
+  g_autoptr(GPtrArray) infos = load_apps (0, N_APPS);
+  Changes changes = { 0, };
+
+  g_signal_connect (store, "items-changed", G_CALLBACK (items_changed_cb), &changes);
+
+  update_app_list (store, infos);
+
+  g_assert_cmpuint (changes.n_emissions, ==, 1);
+  g_assert_cmpuint (changes.n_added, ==, N_APPS);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (store)), ==, N_APPS);
+  assert_sorted (G_LIST_MODEL (store));
+
+  /* Nothing changed, nothing to do */
+  g_clear_pointer (&infos, g_ptr_array_unref);
+  infos = load_apps (0, N_APPS);
+  update_app_list (store, infos);
+  g_assert_cmpuint (changes.n_emissions, ==, 1);
+}
+
+static void
+test_update (void)
+{
+  g_autoptr(GListStore) store = g_list_store_new (G_TYPE_APP_INFO);
+  g_autoptr(GPtrArray) infos = load_apps (0, N_APPS);
+  g_autofree gchar *kept_id = get_desktop_id (N_APPS / 2);
+  g_autofree gchar *renamed_id = get_desktop_id (N_APPS / 3);
+  GAppInfo *kept;
+  Changes changes = { 0, };
+
+  update_app_list (store, infos);
+  kept = find_app (G_LIST_MODEL (store), kept_id);
+  g_assert_nonnull (kept);
+
+  g_signal_connect (store, "items-changed", G_CALLBACK (items_changed_cb), &changes);
+
+  /* Ten apps removed, all the extra ones added and one renamed */
+  write_desktop_file (N_APPS / 3, "Renamed");
+  g_clear_pointer (&infos, g_ptr_array_unref);
+  infos = load_apps (10, N_APPS + N_EXTRA);
+
+  update_app_list (store, infos);
+
+  g_assert_cmpuint (changes.n_removed, ==, 10 + 1);
+  g_assert_cmpuint (changes.n_added, ==, N_EXTRA + 1);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (store)), ==, N_APPS - 10 + N_EXTRA);
+  assert_sorted (G_LIST_MODEL (store));
+
+  g_assert_true (find_app (G_LIST_MODEL (store), kept_id) == kept);
+  g_assert_cmpstr (g_app_info_get_display_name (find_app (G_LIST_MODEL (store), renamed_id)), ==, "Renamed");
+}
+
+static void
+test_changed_entry (void)
+{
+  g_autoptr(GListStore) store = g_list_store_new (G_TYPE_APP_INFO);
+  g_autoptr(GPtrArray) infos = load_apps (0, N_APPS);
+  g_autofree gchar *changed_id = get_desktop_id (N_APPS / 4);
+  g_autofree gchar *name = NULL;
+  GAppInfo *old, *new;
+  guint old_position, position;
+  Changes changes = { 0, };
+
+  update_app_list (store, infos);
+  old = find_app (G_LIST_MODEL (store), changed_id);
+  g_assert_nonnull (old);
+  g_assert_true (g_list_store_find (store, old, &old_position));
+
+  g_signal_connect (store, "items-changed", G_CALLBACK (items_changed_cb), &changes);
+
+  /* Same name and icon, but something else the panel shows */
+  name = g_strdup (g_app_info_get_name (old));
+  write_desktop_file_full (N_APPS / 4, name,
+                           "Exec=other %U\n"
+                           "MimeType=text/x-example;\n");
+  g_clear_pointer (&infos, g_ptr_array_unref);
+  infos = load_apps (0, N_APPS);
+
+  update_app_list (store, infos);
+
+  g_assert_cmpuint (changes.n_emissions, ==, 1);
+  g_assert_cmpuint (changes.n_removed, ==, 1);
+  g_assert_cmpuint (changes.n_added, ==, 1);
+
+  new = find_app (G_LIST_MODEL (store), changed_id);
+  g_assert_true (new != old);
+  g_assert_true (g_list_store_find (store, new, &position));
+  g_assert_cmpuint (position, ==, old_position);
+  g_assert_cmpstr (g_app_info_get_commandline (new), ==, "other %U");
+  g_assert_cmpstrv (g_app_info_get_supported_types (new), ((const gchar *[]) { "text/x-example", NULL }));
+}
+
+/* What the panel used to do */
+static gint
+compare_rows (gconstpointer  a,
+              gconstpointer  b,
+              gpointer       data)
+{
+  g_autofree gchar *key1 = NULL;
+  g_autofree gchar *key2 = NULL;
+  g_autofree gchar *sort_key1 = NULL;
+  g_autofree gchar *sort_key2 = NULL;
+
+  key1 = g_utf8_casefold (g_app_info_get_display_name (G_APP_INFO (a)), -1);
+  key2 = g_utf8_casefold (g_app_info_get_display_name (G_APP_INFO (b)), -1);
+  sort_key1 = g_utf8_collate_key (key1, -1);
+  sort_key2 = g_utf8_collate_key (key2, -1);
+
+  return strcmp (sort_key1, sort_key2);
+}
+
+static void
+test_benchmark (void)
+{
+  g_autoptr(GListStore) store = g_list_store_new (G_TYPE_APP_INFO);
+  g_autoptr(GListStore) reference = g_list_store_new (G_TYPE_APP_INFO);
+  g_autoptr(GPtrArray) infos = NULL;
+  gint64 start, elapsed;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  infos = load_apps (0, N_APPS);
+  g_test_message ("Loading %u desktop files took %.1f ms",
+                  N_APPS, (g_get_monotonic_time () - start) / 1000.0);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < infos->len; i++)
+    g_list_store_insert_sorted (reference, g_ptr_array_index (infos, i), compare_rows, NULL);
+  g_test_message ("Inserting %u apps one by one took %.1f ms",
+                  N_APPS, (g_get_monotonic_time () - start) / 1000.0);
+
+  start = g_get_monotonic_time ();
+  update_app_list (store, infos);
+  elapsed = g_get_monotonic_time () - start;
+  g_test_minimized_result (elapsed / 1000.0,
+                           "Listing %u apps took %.1f ms",
+                           N_APPS, elapsed / 1000.0);
+
+  /* A single app installed */
+  g_clear_pointer (&infos, g_ptr_array_unref);
+  infos = load_apps (0, N_APPS + 1);
+
+  start = g_get_monotonic_time ();
+  update_app_list (store, infos);
+  elapsed = g_get_monotonic_time () - start;
+  g_test_minimized_result (elapsed / 1000.0,
+                           "Updating %u apps took %.1f ms",
+                           N_APPS, elapsed / 1000.0);
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (store)), ==, N_APPS + 1);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *data_dirs = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* Only the generated apps are seen */
+  tmpdir = g_dir_make_tmp ("test-app-list-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  applications_dir = g_build_filename (tmpdir, "applications", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (applications_dir, 0755), ==, 0);
+  data_dirs = g_build_filename (tmpdir, "empty", NULL);
+
+  g_setenv ("XDG_DATA_HOME", tmpdir, TRUE);
+  g_setenv ("XDG_DATA_DIRS", data_dirs, TRUE);
+
+  write_desktop_files ();
+
+  g_test_add_func ("/applications/app-list/load", test_load);
+  g_test_add_func ("/applications/app-list/update", test_update);
+  g_test_add_func ("/applications/app-list/changed-entry", test_changed_entry);
+  g_test_add_func ("/applications/app-list/benchmark", test_benchmark);
+
+  ret = g_test_run ();
+
+  for (i = 0; i < N_APPS + N_EXTRA; i++)
+    {
+      g_autofree gchar *id = get_desktop_id (i);
+      g_autofree gchar *path = g_build_filename (applications_dir, id, NULL);
+
+      g_unlink (path);
+    }
+  g_rmdir (applications_dir);
+  g_rmdir (tmpdir);
+  g_clear_pointer (&applications_dir, g_free);
+
+  return ret;
+}
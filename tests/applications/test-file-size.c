@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib/gstdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#define FANOUT        4
+#define DEPTH         5
+#define FILES_PER_DIR 4
+#define CHAIN_DEPTH   100
+#define WIDTH         500
+#define MAX_FDS       64
+
+typedef struct
+{
+  gchar   *tmpdir;
+  GFile   *root;
+  gchar   *deepest;
+  guint64  expected;
+} Fixture;
+
+typedef struct
+{
+  gboolean  done;
+  guint64   size;
+  GError   *error;
+} SizeResult;
+
+static void
+write_file (Fixture     *fixture,
+            const gchar *dir,
+            const gchar *name,
+            gsize        size)
+{
+  g_autofree gchar *path = g_build_filename (dir, name, NULL);
+  g_autofree gchar *contents = g_malloc0 (size);
+  g_autoptr(GError) error = NULL;
+
+  g_file_set_contents (path, contents, size, &error);
+  g_assert_no_error (error);
+
+  fixture->expected += size;
+}
+
+static void
+make_tree (Fixture     *fixture,
+           const gchar *dir,
+           guint        depth)
+{
+  guint i;
+
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  for (i = 0; i < FILES_PER_DIR; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("file%u", i);
+
+      write_file (fixture, dir, name, (depth * 1000) + (i * 100) + 1);
+    }
+
+  if (depth == DEPTH)
+    return;
+
+  for (i = 0; i < FANOUT; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("dir%u", i);
+      g_autofree gchar *subdir = g_build_filename (dir, name, NULL);
+
+      make_tree (fixture, subdir, depth + 1);
+    }
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *link = NULL;
+  guint i;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-file-size-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  path = g_build_filename (fixture->tmpdir, "tree", NULL);
+  fixture->root = g_file_new_for_path (path);
+  make_tree (fixture, path, 0);
+
+  /* A long chain of directories, with a file at the very end */
+  fixture->deepest = g_strdup (path);
+  for (i = 0; i < CHAIN_DEPTH; i++)
+    {
+      gchar *deeper = g_build_filename (fixture->deepest, "level", NULL);
+
+      g_free (fixture->deepest);
+      fixture->deepest = deeper;
+    }
+  g_assert_cmpint (g_mkdir_with_parents (fixture->deepest, 0755), ==, 0);
+  write_file (fixture, fixture->deepest, "bottom", 4242);
+
+  /* Neither followed nor counted */
+  link = g_build_filename (path, "loop", NULL);
+  g_assert_cmpint (symlink (".", link), ==, 0);
+}
+
+static void
+remove_recursive (const gchar *path)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_SYMLINK))
+    dir = g_dir_open (path, 0, NULL);
+
+  while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *child = g_build_filename (path, name, NULL);
+      remove_recursive (child);
+    }
+
+  g_remove (path);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  remove_recursive (fixture->tmpdir);
+
+  g_clear_pointer (&fixture->tmpdir, g_free);
+  g_clear_pointer (&fixture->deepest, g_free);
+  g_clear_object (&fixture->root);
+}
+
+static void
+size_cb (GObject      *source,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  SizeResult *result = user_data;
+
+  file_size_finish (G_FILE (source), res, &result->size, &result->error);
+  result->done = TRUE;
+}
+
+static guint64
+get_size (GFile        *file,
+          GCancellable *cancellable,
+          GError      **error)
+{
+  SizeResult result = { 0, };
+
+  file_size_async (file, cancellable, size_cb, &result);
+  while (!result.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (result.error != NULL)
+    g_propagate_error (error, result.error);
+
+  return result.size;
+}
+
+static void
+test_tree (Fixture       *fixture,
+           gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  guint64 size;
+
+  size = get_size (fixture->root, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (size, ==, fixture->expected);
+}
+
+static void
+test_missing (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+  g_autoptr(GFile) missing = g_file_get_child (fixture->root, "missing");
+  g_autoptr(GError) error = NULL;
+
+  g_assert_cmpuint (get_size (missing, NULL, &error), ==, 0);
+  g_assert_no_error (error);
+}
+
+/* Like an app's data with thousands of node_modules directories */
+static void
+test_wide (Fixture       *fixture,
+           gconstpointer  user_data)
+{
+  g_autofree gchar *path = g_build_filename (fixture->tmpdir, "wide", NULL);
+  g_autoptr(GFile) wide = g_file_new_for_path (path);
+  g_autoptr(GError) error = NULL;
+  struct rlimit limit, saved_limit;
+  guint64 expected = 0;
+  guint64 size;
+  guint i;
+
+  for (i = 0; i < WIDTH; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("dir%u", i);
+      g_autofree gchar *subdir = g_build_filename (path, name, "node_modules", NULL);
+      g_autofree gchar *file = g_build_filename (subdir, "index.js", NULL);
+
+      g_assert_cmpint (g_mkdir_with_parents (subdir, 0755), ==, 0);
+      g_file_set_contents (file, "//", 2, &error);
+      g_assert_no_error (error);
+      expected += 2;
+    }
+
+  g_assert_cmpint (getrlimit (RLIMIT_NOFILE, &saved_limit), ==, 0);
+  limit = saved_limit;
+  limit.rlim_cur = MAX_FDS;
+  g_assert_cmpint (setrlimit (RLIMIT_NOFILE, &limit), ==, 0);
+
+  size = get_size (wide, NULL, &error);
+
+  g_assert_cmpint (setrlimit (RLIMIT_NOFILE, &saved_limit), ==, 0);
+
+  g_assert_no_error (error);
+  g_assert_cmpuint (size, ==, expected);
+}
+
+static void
+test_changes (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+  g_autoptr(GFile) subtree = g_file_get_child (fixture->root, "dir0");
+  g_autoptr(GError) error = NULL;
+  guint64 subtree_size;
+
+  g_assert_cmpuint (get_size (fixture->root, NULL, &error), ==, fixture->expected);
+  g_assert_no_error (error);
+
+  /* A new file deep down */
+  write_file (fixture, fixture->deepest, "new", 1234);
+  g_assert_cmpuint (get_size (fixture->root, NULL, &error), ==, fixture->expected);
+  g_assert_no_error (error);
+
+  /* A removed subtree */
+  subtree_size = get_size (subtree, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (subtree_size, >, 0);
+
+  remove_recursive (g_file_peek_path (subtree));
+  fixture->expected -= subtree_size;
+
+  g_assert_cmpuint (get_size (fixture->root, NULL, &error), ==, fixture->expected);
+  g_assert_no_error (error);
+}
+
+static void
+test_cancel (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GError) error = NULL;
+  SizeResult result = { 0, };
+
+  /* Selecting another app right away */
+  file_size_async (fixture->root, cancellable, size_cb, &result);
+  g_cancellable_cancel (cancellable);
+
+  while (!result.done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (result.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&result.error);
+
+  /* Whatever was read before is reused, and the total is still right */
+  g_assert_cmpuint (get_size (fixture->root, NULL, &error), ==, fixture->expected);
+  g_assert_no_error (error);
+}
+
+static void
+test_benchmark (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  gint64 start, cold, warm;
+
+  start = g_get_monotonic_time ();
+  g_assert_cmpuint (get_size (fixture->root, NULL, NULL), ==, fixture->expected);
+  cold = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  g_assert_cmpuint (get_size (fixture->root, NULL, NULL), ==, fixture->expected);
+  warm = g_get_monotonic_time () - start;
+
+  g_test_message ("Walking the tree took %.1f ms", cold / 1000.0);
+  g_test_minimized_result (warm / 1000.0,
+                           "Walking the unchanged tree again took %.1f ms",
+                           warm / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/applications/file-size/tree", Fixture, NULL,
+              fixture_set_up, test_tree, fixture_tear_down);
+  g_test_add ("/applications/file-size/missing", Fixture, NULL,
+              fixture_set_up, test_missing, fixture_tear_down);
+  g_test_add ("/applications/file-size/wide", Fixture, NULL,
+              fixture_set_up, test_wide, fixture_tear_down);
+  g_test_add ("/applications/file-size/changes", Fixture, NULL,
+              fixture_set_up, test_changes, fixture_tear_down);
+  g_test_add ("/applications/file-size/cancel", Fixture, NULL,
+              fixture_set_up, test_cancel, fixture_tear_down);
+  g_test_add ("/applications/file-size/benchmark", Fixture, NULL,
+              fixture_set_up, test_benchmark, fixture_tear_down);
+
+  return g_test_run ();
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#define N_APPS 200
+
+typedef struct
+{
+  gchar *tmpdir;
+  gchar *user_dir;
+  gchar *system_dir;
+} Fixture;
+
+typedef struct
+{
+  gboolean  done;
+  GKeyFile *metadata;
+  guint64   size;
+  GError   *error;
+} Lookup;
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-flatpak-app-info-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  fixture->user_dir = g_build_filename (fixture->tmpdir, "user", NULL);
+  fixture->system_dir = g_build_filename (fixture->tmpdir, "system", NULL);
+
+  g_setenv ("FLATPAK_USER_DIR", fixture->user_dir, TRUE);
+  g_setenv ("FLATPAK_SYSTEM_DIR", fixture->system_dir, TRUE);
+}
+
+static void
+remove_recursive (const gchar *path)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_SYMLINK))
+    dir = g_dir_open (path, 0, NULL);
+
+  while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+    {
+      g_autofree gchar *child = g_build_filename (path, name, NULL);
+      remove_recursive (child);
+    }
+
+  g_remove (path);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  remove_recursive (fixture->tmpdir);
+
+  g_clear_pointer (&fixture->tmpdir, g_free);
+  g_clear_pointer (&fixture->user_dir, g_free);
+  g_clear_pointer (&fixture->system_dir, g_free);
+}
+
+static void
+replace_link (const gchar *target,
+              const gchar *path)
+{
+  g_unlink (path);
+  g_assert_cmpint (symlink (target, path), ==, 0);
+}
+
+static void
+write_metadata (const gchar *deploy_dir,
+                const gchar *app_id,
+                const gchar *sockets)
+{
+  g_autofree gchar *path = g_build_filename (deploy_dir, "metadata", NULL);
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) error = NULL;
+
+  contents = g_strdup_printf ("[Application]\n"
+                              "name=%s\n"
+                              "runtime=org.gnome.Platform/x86_64/46\n"
+                              "\n"
+                              "[Context]\n"
+                              "sockets=%s\n"
+                              "shared=network;\n",
+                              app_id, sockets);
+
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+/* The same layout and deploy data flatpak writes */
+static void
+deploy_app (const gchar *installation,
+            const gchar *app_id,
+            const gchar *commit,
+            const gchar *sockets,
+            guint64      size)
+{
+  g_autofree gchar *app_dir = g_build_filename (installation, "app", app_id, NULL);
+  g_autofree gchar *branch_dir = g_build_filename (app_dir, "x86_64", "stable", NULL);
+  g_autofree gchar *deploy_dir = g_build_filename (branch_dir, commit, NULL);
+  g_autofree gchar *current_link = g_build_filename (app_dir, "current", NULL);
+  g_autofree gchar *active_link = g_build_filename (branch_dir, "active", NULL);
+  g_autofree gchar *deploy_path = g_build_filename (deploy_dir, "deploy", NULL);
+  g_autoptr(GVariant) deploy_data = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar * const subpaths[] = { NULL };
+
+  g_assert_cmpint (g_mkdir_with_parents (deploy_dir, 0755), ==, 0);
+
+  write_metadata (deploy_dir, app_id, sockets);
+
+  deploy_data = g_variant_ref_sink (g_variant_new ("(ss^ast@a{sv})",
+                                                   "flathub",
+                                                   commit,
+                                                   subpaths,
+                                                   GUINT64_TO_BE (size),
+                                                   g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0)));
+  g_file_set_contents (deploy_path,
+                       (const gchar *) g_variant_get_data (deploy_data),
+                       g_variant_get_size (deploy_data),
+                       &error);
+  g_assert_no_error (error);
+
+  replace_link ("x86_64/stable", current_link);
+  replace_link (commit, active_link);
+}
+
+static void
+lookup_cb (GObject      *source,
+           GAsyncResult *res,
+           gpointer      user_data)
+{
+  Lookup *lookup = user_data;
+
+  get_flatpak_app_info_finish (res, &lookup->metadata, &lookup->size, &lookup->error);
+  lookup->done = TRUE;
+}
+
+static void
+lookup_clear (Lookup *lookup)
+{
+  g_clear_pointer (&lookup->metadata, g_key_file_unref);
+  g_clear_error (&lookup->error);
+  lookup->done = FALSE;
+  lookup->size = 0;
+}
+
+static void
+lookup_app (Lookup      *lookup,
+            const gchar *app_id)
+{
+  lookup_clear (lookup);
+
+  get_flatpak_app_info_async (app_id, NULL, lookup_cb, lookup);
+  while (!lookup->done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+assert_sockets (GKeyFile    *metadata,
+                const gchar *socket)
+{
+  g_auto(GStrv) sockets = NULL;
+
+  g_assert_nonnull (metadata);
+
+  sockets = g_key_file_get_string_list (metadata, "Context", "sockets", NULL, NULL);
+  g_assert_nonnull (sockets);
+  g_assert_true (g_strv_contains ((const gchar * const *) sockets, socket));
+}
+
+static void
+test_metadata (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  Lookup lookup = { 0, };
+  g_autofree gchar *name = NULL;
+
+  deploy_app (fixture->system_dir, "org.example.App", "c0ffee", "wayland;", 123456789);
+
+  lookup_app (&lookup, "org.example.App");
+  g_assert_no_error (lookup.error);
+  g_assert_cmpuint (lookup.size, ==, 123456789);
+  assert_sockets (lookup.metadata, "wayland");
+
+  name = g_key_file_get_string (lookup.metadata, "Application", "name", NULL);
+  g_assert_cmpstr (name, ==, "org.example.App");
+
+  lookup_clear (&lookup);
+}
+
+static void
+test_user_installation (Fixture       *fixture,
+                        gconstpointer  user_data)
+{
+  Lookup lookup = { 0, };
+
+  deploy_app (fixture->system_dir, "org.example.App", "5y5", "x11;", 1000);
+  deploy_app (fixture->user_dir, "org.example.App", "u5e7", "wayland;", 2000);
+
+  /* Like flatpak, the user installation wins */
+  lookup_app (&lookup, "org.example.App");
+  g_assert_no_error (lookup.error);
+  g_assert_cmpuint (lookup.size, ==, 2000);
+  assert_sockets (lookup.metadata, "wayland");
+
+  lookup_clear (&lookup);
+}
+
+static void
+test_not_installed (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+  Lookup lookup = { 0, };
+
+  deploy_app (fixture->system_dir, "org.example.App", "c0ffee", "wayland;", 1000);
+
+  lookup_app (&lookup, "org.example.Other");
+  g_assert_error (lookup.error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+  g_assert_null (lookup.metadata);
+
+  lookup_clear (&lookup);
+}
+
+static void
+test_update (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autofree gchar *deploy_dir = NULL;
+  Lookup lookup = { 0, };
+
+  deploy_app (fixture->system_dir, "org.example.App", "c0ffee", "wayland;", 1000);
+
+  lookup_app (&lookup, "org.example.App");
+  assert_sockets (lookup.metadata, "wayland");
+
+  /* A deployed commit is never modified, so it is not read again */
+  deploy_dir = g_build_filename (fixture->system_dir, "app", "org.example.App",
+                                 "x86_64", "stable", "c0ffee", NULL);
+  write_metadata (deploy_dir, "org.example.App", "x11;");
+
+  lookup_app (&lookup, "org.example.App");
+  assert_sockets (lookup.metadata, "wayland");
+  g_assert_cmpuint (lookup.size, ==, 1000);
+
+  /* But an update is picked up */
+  deploy_app (fixture->system_dir, "org.example.App", "deadbeef", "pulseaudio;", 2000);
+
+  lookup_app (&lookup, "org.example.App");
+  assert_sockets (lookup.metadata, "pulseaudio");
+  g_assert_cmpuint (lookup.size, ==, 2000);
+
+  lookup_clear (&lookup);
+}
+
+static void
+reselect_cb (GObject      *source,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  guint *n_finished = user_data;
+  g_autoptr(GError) error = NULL;
+
+  if (get_flatpak_app_info_finish (res, NULL, NULL, &error))
+    n_finished[0]++;
+  else
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      n_finished[1]++;
+    }
+}
+
+static void
+test_reselect (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  guint n_finished[2] = { 0, 0 };
+  gint64 start, busy = 0;
+  guint i;
+
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      deploy_app (fixture->system_dir, app_id, "c0ffee", "wayland;", i);
+    }
+
+  /* Selecting apps in quick succession, like the panel does */
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      start = g_get_monotonic_time ();
+
+      g_cancellable_cancel (cancellable);
+      g_clear_object (&cancellable);
+      cancellable = g_cancellable_new ();
+      get_flatpak_app_info_async (app_id, cancellable, reselect_cb, n_finished);
+
+      busy += g_get_monotonic_time () - start;
+    }
+
+  while (n_finished[0] + n_finished[1] < N_APPS)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* Only the last selection gets its result */
+  g_assert_cmpuint (n_finished[0], ==, 1);
+  g_assert_cmpuint (n_finished[1], ==, N_APPS - 1);
+
+  g_test_minimized_result (busy / 1000.0 / N_APPS,
+                           "Selecting an app blocked for %.3f ms",
+                           busy / 1000.0 / N_APPS);
+}
+
+static void
+test_cached (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  Lookup lookup = { 0, };
+  gint64 start, cold, warm;
+  guint i;
+
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      deploy_app (fixture->user_dir, app_id, "c0ffee", "wayland;", i);
+    }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      lookup_app (&lookup, app_id);
+      g_assert_cmpuint (lookup.size, ==, i);
+    }
+  cold = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      lookup_app (&lookup, app_id);
+      g_assert_cmpuint (lookup.size, ==, i);
+    }
+  warm = g_get_monotonic_time () - start;
+
+  lookup_clear (&lookup);
+
+  g_test_message ("Looking up %u apps took %.1f ms, %.1f ms once cached",
+                  N_APPS, cold / 1000.0, warm / 1000.0);
+  g_test_minimized_result (warm / 1000.0 / N_APPS,
+                           "Looking up a cached app took %.3f ms",
+                           warm / 1000.0 / N_APPS);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/applications/flatpak-app-info/metadata", Fixture, NULL,
+              fixture_set_up, test_metadata, fixture_tear_down);
+  g_test_add ("/applications/flatpak-app-info/user-installation", Fixture, NULL,
+              fixture_set_up, test_user_installation, fixture_tear_down);
+  g_test_add ("/applications/flatpak-app-info/not-installed", Fixture, NULL,
+              fixture_set_up, test_not_installed, fixture_tear_down);
+  g_test_add ("/applications/flatpak-app-info/update", Fixture, NULL,
+              fixture_set_up, test_update, fixture_tear_down);
+  g_test_add ("/applications/flatpak-app-info/reselect", Fixture, NULL,
+              fixture_set_up, test_reselect, fixture_tear_down);
+  g_test_add ("/applications/flatpak-app-info/cached", Fixture, NULL,
+              fixture_set_up, test_cached, fixture_tear_down);
+
+  return g_test_run ();
+}
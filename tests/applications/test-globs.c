@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib/gstdio.h>
+
+#include "globs.h"
+
+#define N_TYPES 2000
+
+static gchar *data_dirs[2] = { NULL, };
+
+static void
+write_globs (guint        dir,
+             const gchar *contents)
+{
+  g_autofree gchar *mime_dir = g_build_filename (data_dirs[dir], "mime", NULL);
+  g_autofree gchar *path = g_build_filename (mime_dir, "globs", NULL);
+  g_autoptr(GError) error = NULL;
+
+  g_assert_cmpint (g_mkdir_with_parents (mime_dir, 0755), ==, 0);
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+/* Some types with several globs, some globs for several types, and
+ * types found in both dirs */
+static void
+write_database (void)
+{
+  g_autoptr(GString) first = g_string_new ("# This file was automatically generated\n");
+  g_autoptr(GString) second = g_string_new ("# This file was automatically generated\n");
+  guint i;
+
+  for (i = 0; i < N_TYPES; i++)
+    {
+      g_string_append_printf (first, "application/x-test-%u:*.t%u\n", i, i);
+
+      if (i % 3 == 0)
+        g_string_append_printf (first, "application/x-test-%u:*.T%u\n", i, i);
+      if (i % 5 == 0)
+        g_string_append_printf (first, "application/x-other-%u:*.t%u\n", i, i);
+      if (i % 7 == 0)
+        g_string_append_printf (second, "application/x-test-%u:*.second%u\n", i, i);
+    }
+
+  /* Without a glob, and without the final newline */
+  g_string_append (second, "application/x-no-glob\n\n");
+  g_string_append (second, "text/x-last:*.last");
+
+  write_globs (0, first->str);
+  write_globs (1, second->str);
+}
+
+/* What the panel used to do */
+static GHashTable *
+parse_globs (void)
+{
+  GHashTable *globs;
+  const gchar * const *dirs;
+  gint i;
+
+  globs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  dirs = g_get_system_data_dirs ();
+
+  for (i = 0; dirs[i]; i++)
+    {
+      g_autofree gchar *file = g_build_filename (dirs[i], "mime", "globs", NULL);
+      g_autofree gchar *contents = NULL;
+
+      if (g_file_get_contents (file, &contents, NULL, NULL))
+        {
+          g_auto(GStrv) strv = NULL;
+          int i;
+
+          strv = g_strsplit (contents, "\n", 0);
+          for (i = 0; strv[i]; i++)
+            {
+              g_auto(GStrv) parts = NULL;
+
+              if (strv[i][0] == '#' || strv[i][0] == '\0')
+                continue;
+
+              parts = g_strsplit (strv[i], ":", 2);
+              g_hash_table_insert (globs, g_strdup (parts[0]), g_strdup (parts[1]));
+            }
+        }
+    }
+
+  return globs;
+}
+
+static void
+assert_matches_text_parser (void)
+{
+  g_autoptr(GHashTable) reference = parse_globs ();
+  GHashTableIter iter;
+  const gchar *mime_type, *glob;
+
+  g_assert_cmpuint (g_hash_table_size (reference), >, N_TYPES);
+
+  g_hash_table_iter_init (&iter, reference);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &mime_type, (gpointer *) &glob))
+    {
+      g_autofree gchar *indexed = get_glob_for_mime_type (mime_type);
+
+      g_assert_cmpstr (indexed, ==, glob);
+    }
+}
+
+static void
+test_lookup (void)
+{
+  g_autofree gchar *glob = NULL;
+
+  assert_matches_text_parser ();
+
+  glob = get_glob_for_mime_type ("application/x-unknown");
+  g_assert_null (glob);
+  glob = get_glob_for_mime_type ("text/x-last");
+  g_assert_cmpstr (glob, ==, "*.last");
+}
+
+static void
+test_update (void)
+{
+  g_autofree gchar *glob = NULL;
+
+  assert_matches_text_parser ();
+
+  /* As if update-mime-database had just run */
+  write_globs (1, "text/x-new:*.new\n"
+                  "application/x-test-0:*.changed\n");
+
+  /* Only seen once revalidated */
+  glob = get_glob_for_mime_type ("text/x-new");
+  g_assert_null (glob);
+  glob = get_glob_for_mime_type ("text/x-last");
+  g_assert_cmpstr (glob, ==, "*.last");
+  g_clear_pointer (&glob, g_free);
+
+  globs_revalidate ();
+
+  glob = get_glob_for_mime_type ("text/x-new");
+  g_assert_cmpstr (glob, ==, "*.new");
+  g_clear_pointer (&glob, g_free);
+
+  glob = get_glob_for_mime_type ("text/x-last");
+  g_assert_null (glob);
+
+  assert_matches_text_parser ();
+
+  write_database ();
+  globs_revalidate ();
+  assert_matches_text_parser ();
+}
+
+static void
+test_benchmark (void)
+{
+  g_autoptr(GHashTable) reference = NULL;
+  gint64 start, elapsed;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  reference = parse_globs ();
+  g_test_message ("Parsing the globs took %.1f ms",
+                  (g_get_monotonic_time () - start) / 1000.0);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_TYPES; i++)
+    {
+      g_autofree gchar *mime_type = g_strdup_printf ("application/x-test-%u", i);
+      g_autofree gchar *glob = get_glob_for_mime_type (mime_type);
+
+      g_assert_nonnull (glob);
+    }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_test_minimized_result (elapsed / 1000.0,
+                           "Looking up %u types took %.1f ms",
+                           N_TYPES, elapsed / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *dirs = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* Only the synthetic database is seen */
+  tmpdir = g_dir_make_tmp ("test-globs-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  data_dirs[0] = g_build_filename (tmpdir, "first", NULL);
+  data_dirs[1] = g_build_filename (tmpdir, "second", NULL);
+  dirs = g_strjoin (G_SEARCHPATH_SEPARATOR_S, data_dirs[0], data_dirs[1], NULL);
+  g_setenv ("XDG_DATA_DIRS", dirs, TRUE);
+
+  write_database ();
+
+  g_test_add_func ("/applications/globs/lookup", test_lookup);
+  g_test_add_func ("/applications/globs/update", test_update);
+  g_test_add_func ("/applications/globs/benchmark", test_benchmark);
+
+  ret = g_test_run ();
+
+  for (i = 0; i < G_N_ELEMENTS (data_dirs); i++)
+    {
+      g_autofree gchar *mime_dir = g_build_filename (data_dirs[i], "mime", NULL);
+      g_autofree gchar *path = g_build_filename (mime_dir, "globs", NULL);
+
+      g_unlink (path);
+      g_rmdir (mime_dir);
+      g_rmdir (data_dirs[i]);
+      g_clear_pointer (&data_dirs[i], g_free);
+    }
+  g_rmdir (tmpdir);
+
+  return ret;
+}
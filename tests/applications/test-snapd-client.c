@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib/gstdio.h>
+#include <gio/gunixsocketaddress.h>
+#include <libsoup/soup.h>
+
+#include "cc-snapd-client.h"
+
+#define N_REQUESTS 20
+
+/* A tiny snapd, knowing about one snap with a camera plug */
+typedef struct
+{
+  gchar         *tmpdir;
+  gchar         *socket_path;
+  SoupServer    *server;
+
+  /* Path → number of requests */
+  GHashTable    *requests;
+  /* Connections the requests came on */
+  GHashTable    *sockets;
+
+  gboolean       connected;
+  guint          change_polls;
+
+  CcSnapdClient *client;
+} Fixture;
+
+typedef struct
+{
+  guint       n_done;
+  JsonObject *object;
+  JsonArray  *plugs;
+  JsonArray  *slots;
+  gchar      *change_id;
+  GError     *error;
+} Result;
+
+static void
+reply (SoupServerMessage *msg,
+       guint              status,
+       const gchar       *format,
+       ...)
+{
+  g_autofree gchar *result = NULL;
+  g_autofree gchar *body = NULL;
+  va_list args;
+
+  va_start (args, format);
+  result = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  body = g_strdup_printf ("{\"type\":\"%s\",\"status-code\":%u,%s}",
+                          status == SOUP_STATUS_ACCEPTED ? "async" : "sync",
+                          status, result);
+
+  soup_server_message_set_status (msg, status, NULL);
+  soup_server_message_set_response (msg, "application/json", SOUP_MEMORY_COPY, body, strlen (body));
+}
+
+static void
+handle_interfaces (Fixture           *fixture,
+                   SoupServerMessage *msg)
+{
+  SoupMessageBody *request_body = soup_server_message_get_request_body (msg);
+  g_autoptr(JsonParser) parser = json_parser_new ();
+  g_autoptr(GError) error = NULL;
+  const gchar *action;
+
+  json_parser_load_from_data (parser, request_body->data, request_body->length, &error);
+  g_assert_no_error (error);
+
+  action = json_object_get_string_member (json_node_get_object (json_parser_get_root (parser)), "action");
+  fixture->connected = g_str_equal (action, "connect");
+  fixture->change_polls = 0;
+
+  reply (msg, SOUP_STATUS_ACCEPTED, "\"change\":\"42\"");
+}
+
+static void
+server_cb (SoupServer        *server,
+           SoupServerMessage *msg,
+           const gchar       *path,
+           GHashTable        *query,
+           gpointer           user_data)
+{
+  Fixture *fixture = user_data;
+  GSocket *socket = soup_server_message_get_socket (msg);
+
+  g_hash_table_add (fixture->sockets, g_object_ref (socket));
+  g_hash_table_insert (fixture->requests, g_strdup (path),
+                       GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (fixture->requests, path)) + 1));
+
+  if (g_str_equal (path, "/v2/connections"))
+    reply (msg, SOUP_STATUS_OK,
+           "\"result\":{"
+           "\"plugs\":[{\"snap\":\"foo\",\"plug\":\"camera\",\"interface\":\"camera\"%s}],"
+           "\"slots\":[{\"snap\":\"core\",\"slot\":\"camera\",\"interface\":\"camera\"}]}",
+           fixture->connected ? ",\"connections\":[{\"snap\":\"core\",\"slot\":\"camera\"}]" : "");
+  else if (g_str_equal (path, "/v2/interfaces"))
+    handle_interfaces (fixture, msg);
+  else if (g_str_equal (path, "/v2/changes/42"))
+    reply (msg, SOUP_STATUS_OK,
+           "\"result\":{\"id\":\"42\",\"ready\":%s,\"status\":\"%s\"}",
+           ++fixture->change_polls > 1 ? "true" : "false",
+           fixture->change_polls > 1 ? "Done" : "Doing");
+  else if (g_str_has_prefix (path, "/v2/snaps/snap"))
+    reply (msg, SOUP_STATUS_OK,
+           "\"result\":{\"name\":\"%s\",\"installed-size\":%u}",
+           path + strlen ("/v2/snaps/"), (guint) strlen (path) * 1000);
+  else
+    reply (msg, SOUP_STATUS_NOT_FOUND, "\"result\":{\"message\":\"not found\"}");
+}
+
+static guint
+get_n_requests (Fixture     *fixture,
+                const gchar *path)
+{
+  return GPOINTER_TO_UINT (g_hash_table_lookup (fixture->requests, path));
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(GSocket) socket = NULL;
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-snapd-client-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->socket_path = g_build_filename (fixture->tmpdir, "snapd.socket", NULL);
+
+  socket = g_socket_new (G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, &error);
+  g_assert_no_error (error);
+  address = g_unix_socket_address_new (fixture->socket_path);
+  g_socket_bind (socket, address, TRUE, &error);
+  g_assert_no_error (error);
+  g_socket_listen (socket, &error);
+  g_assert_no_error (error);
+
+  fixture->requests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  fixture->sockets = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  fixture->server = soup_server_new (NULL, NULL);
+  soup_server_add_handler (fixture->server, NULL, server_cb, fixture, NULL);
+  soup_server_listen_socket (fixture->server, socket, 0, &error);
+  g_assert_no_error (error);
+
+  fixture->client = cc_snapd_client_new_for_socket (fixture->socket_path);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_object (&fixture->client);
+
+  soup_server_disconnect (fixture->server);
+  g_clear_object (&fixture->server);
+  g_clear_pointer (&fixture->requests, g_hash_table_unref);
+  g_clear_pointer (&fixture->sockets, g_hash_table_unref);
+
+  g_unlink (fixture->socket_path);
+  g_rmdir (fixture->tmpdir);
+  g_clear_pointer (&fixture->socket_path, g_free);
+  g_clear_pointer (&fixture->tmpdir, g_free);
+}
+
+static void
+result_clear (Result *result)
+{
+  g_clear_pointer (&result->object, json_object_unref);
+  g_clear_pointer (&result->plugs, json_array_unref);
+  g_clear_pointer (&result->slots, json_array_unref);
+  g_clear_pointer (&result->change_id, g_free);
+  g_clear_error (&result->error);
+  result->n_done = 0;
+}
+
+static void
+wait_for (Result *result,
+          guint   n_done)
+{
+  while (result->n_done < n_done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+get_snap_cb (GObject      *object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  Result *result = user_data;
+  g_autoptr(JsonObject) snap = NULL;
+
+  snap = cc_snapd_client_get_snap_finish (CC_SNAPD_CLIENT (object), res, result->error ? NULL : &result->error);
+  if (snap != NULL)
+    {
+      g_clear_pointer (&result->object, json_object_unref);
+      result->object = g_steal_pointer (&snap);
+    }
+  result->n_done++;
+}
+
+static void
+get_connections_cb (GObject      *object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  Result *result = user_data;
+  g_autoptr(JsonArray) plugs = NULL;
+  g_autoptr(JsonArray) slots = NULL;
+
+  if (cc_snapd_client_get_all_connections_finish (CC_SNAPD_CLIENT (object), res, &plugs, &slots,
+                                                  result->error ? NULL : &result->error))
+    {
+      g_clear_pointer (&result->plugs, json_array_unref);
+      g_clear_pointer (&result->slots, json_array_unref);
+      result->plugs = g_steal_pointer (&plugs);
+      result->slots = g_steal_pointer (&slots);
+    }
+  result->n_done++;
+}
+
+static void
+connect_cb (GObject      *object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  Result *result = user_data;
+
+  result->change_id = cc_snapd_client_connect_interface_finish (CC_SNAPD_CLIENT (object), res, &result->error);
+  result->n_done++;
+}
+
+static void
+get_change_cb (GObject      *object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  Result *result = user_data;
+
+  g_clear_pointer (&result->object, json_object_unref);
+  result->object = cc_snapd_client_get_change_finish (CC_SNAPD_CLIENT (object), res, &result->error);
+  result->n_done++;
+}
+
+static void
+test_get_snap (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  Result result = { 0, };
+
+  cc_snapd_client_get_snap_async (fixture->client, "snap1", NULL, get_snap_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  g_assert_cmpstr (json_object_get_string_member (result.object, "name"), ==, "snap1");
+  g_assert_cmpint (json_object_get_int_member (result.object, "installed-size"), ==, strlen ("/v2/snaps/snap1") * 1000);
+  result_clear (&result);
+
+  cc_snapd_client_get_snap_async (fixture->client, "missing", NULL, get_snap_cb, &result);
+  wait_for (&result, 1);
+  g_assert_error (result.error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_assert_null (result.object);
+  result_clear (&result);
+}
+
+static void
+test_shared_requests (Fixture       *fixture,
+                      gconstpointer  user_data)
+{
+  Result result = { 0, };
+  guint i;
+
+  /* Every row of an app asking at once */
+  for (i = 0; i < N_REQUESTS; i++)
+    cc_snapd_client_get_all_connections_async (fixture->client, NULL, get_connections_cb, &result);
+  wait_for (&result, N_REQUESTS);
+
+  g_assert_no_error (result.error);
+  g_assert_cmpuint (json_array_get_length (result.plugs), ==, 1);
+  g_assert_cmpuint (json_array_get_length (result.slots), ==, 1);
+  g_assert_cmpuint (get_n_requests (fixture, "/v2/connections"), ==, 1);
+
+  /* And again right after */
+  result_clear (&result);
+  cc_snapd_client_get_all_connections_async (fixture->client, NULL, get_connections_cb, &result);
+  wait_for (&result, 1);
+
+  g_assert_no_error (result.error);
+  g_assert_cmpuint (get_n_requests (fixture, "/v2/connections"), ==, 1);
+  result_clear (&result);
+}
+
+static void
+test_connect (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+  Result result = { 0, };
+  JsonObject *plug;
+
+  cc_snapd_client_get_all_connections_async (fixture->client, NULL, get_connections_cb, &result);
+  wait_for (&result, 1);
+  plug = json_array_get_object_element (result.plugs, 0);
+  g_assert_false (json_object_has_member (plug, "connections"));
+  result_clear (&result);
+
+  cc_snapd_client_connect_interface_async (fixture->client, "foo", "camera", "core", "camera",
+                                           NULL, connect_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  g_assert_cmpstr (result.change_id, ==, "42");
+  result_clear (&result);
+
+  /* Changes are polled, never cached */
+  cc_snapd_client_get_change_async (fixture->client, "42", NULL, get_change_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  g_assert_false (json_object_get_boolean_member (result.object, "ready"));
+  result_clear (&result);
+
+  cc_snapd_client_get_change_async (fixture->client, "42", NULL, get_change_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  g_assert_true (json_object_get_boolean_member (result.object, "ready"));
+  g_assert_cmpuint (get_n_requests (fixture, "/v2/changes/42"), ==, 2);
+  result_clear (&result);
+
+  /* The connections changed, so they are asked for again */
+  cc_snapd_client_get_all_connections_async (fixture->client, NULL, get_connections_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  plug = json_array_get_object_element (result.plugs, 0);
+  g_assert_true (json_object_has_member (plug, "connections"));
+  g_assert_cmpuint (get_n_requests (fixture, "/v2/connections"), ==, 2);
+  result_clear (&result);
+}
+
+static void
+test_keep_alive (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+  Result result = { 0, };
+  gint64 start;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_REQUESTS; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("snap%u", i);
+
+      cc_snapd_client_get_snap_async (fixture->client, name, NULL, get_snap_cb, &result);
+      wait_for (&result, i + 1);
+      g_assert_no_error (result.error);
+    }
+
+  g_test_minimized_result ((g_get_monotonic_time () - start) / 1000.0 / N_REQUESTS,
+                           "A request took %.3f ms",
+                           (g_get_monotonic_time () - start) / 1000.0 / N_REQUESTS);
+
+  /* One after the other, always on the same connection */
+  g_assert_cmpuint (g_hash_table_size (fixture->sockets), ==, 1);
+  result_clear (&result);
+
+  /* At once, on the few connections the session keeps */
+  for (i = 0; i < N_REQUESTS; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("snap%u", N_REQUESTS + i);
+
+      cc_snapd_client_get_snap_async (fixture->client, name, NULL, get_snap_cb, &result);
+    }
+  wait_for (&result, N_REQUESTS);
+  g_assert_no_error (result.error);
+  g_assert_cmpuint (g_hash_table_size (fixture->sockets), <, N_REQUESTS / 2);
+  result_clear (&result);
+}
+
+static void
+test_cancel (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  Result result = { 0, };
+
+  cc_snapd_client_get_snap_async (fixture->client, "snap1", cancellable, get_snap_cb, &result);
+  g_cancellable_cancel (cancellable);
+  wait_for (&result, 1);
+  g_assert_error (result.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  result_clear (&result);
+
+  /* Others asking for the same are not affected */
+  cc_snapd_client_get_snap_async (fixture->client, "snap1", NULL, get_snap_cb, &result);
+  wait_for (&result, 1);
+  g_assert_no_error (result.error);
+  result_clear (&result);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/applications/snapd-client/get-snap", Fixture, NULL,
+              fixture_set_up, test_get_snap, fixture_tear_down);
+  g_test_add ("/applications/snapd-client/shared-requests", Fixture, NULL,
+              fixture_set_up, test_shared_requests, fixture_tear_down);
+  g_test_add ("/applications/snapd-client/connect", Fixture, NULL,
+              fixture_set_up, test_connect, fixture_tear_down);
+  g_test_add ("/applications/snapd-client/keep-alive", Fixture, NULL,
+              fixture_set_up, test_keep_alive, fixture_tear_down);
+  g_test_add ("/applications/snapd-client/cancel", Fixture, NULL,
+              fixture_set_up, test_cancel, fixture_tear_down);
+
+  return g_test_run ();
+}
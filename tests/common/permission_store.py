@@ -0,0 +1,114 @@
+'''xdg-desktop-portal permission store mock template
+
+This creates the expected methods and signals of the
+org.freedesktop.impl.portal.PermissionStore service, keeping the
+tables in memory.
+'''
+
+# Copyright (C) 2024 GNOME Settings contributors
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+import dbus
+
+from dbusmock import MOCK_IFACE
+
+BUS_NAME = 'org.freedesktop.impl.portal.PermissionStore'
+MAIN_OBJ = '/org/freedesktop/impl/portal/PermissionStore'
+MAIN_IFACE = 'org.freedesktop.impl.portal.PermissionStore'
+SYSTEM_BUS = False
+
+NOT_FOUND = 'org.freedesktop.portal.Error.NotFound'
+
+
+def load(mock, parameters):
+    # (table, id) → [permissions, data]
+    mock.tables = {}
+    mock.n_lookups = 0
+    # (table, id) whose Lookup fails
+    mock.broken = set()
+
+
+def get_entry(self, table, id):
+    if (table, id) not in self.tables:
+        raise dbus.exceptions.DBusException('No entry for %s' % id, name=NOT_FOUND)
+
+    return self.tables[(table, id)]
+
+
+def emit_changed(self, table, id, deleted):
+    permissions, data = self.tables.get((table, id), ({}, dbus.Byte(0)))
+
+    self.EmitSignal(MAIN_IFACE, 'Changed', 'ssbva{sas}',
+                    [table, id, deleted, data,
+                     dbus.Dictionary(permissions, signature='sas')])
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='ss', out_signature='a{sas}v')
+def Lookup(self, table, id):
+    self.n_lookups += 1
+
+    if (table, id) in self.broken:
+        raise dbus.exceptions.DBusException('Lookup of %s failed' % id,
+                                            name='org.freedesktop.DBus.Error.Failed')
+
+    permissions, data = get_entry(self, table, id)
+    return (dbus.Dictionary(permissions, signature='sas'), data)
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='sbsa{sas}v', out_signature='')
+def Set(self, table, create, id, app_permissions, data):
+    if not create:
+        get_entry(self, table, id)
+
+    self.tables[(table, id)] = ({str(app): [str(p) for p in perms]
+                                 for app, perms in app_permissions.items()}, data)
+    emit_changed(self, table, id, False)
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='sbssas', out_signature='')
+def SetPermission(self, table, create, id, app, permissions):
+    if not create:
+        get_entry(self, table, id)
+
+    entry = self.tables.setdefault((table, id), ({}, dbus.Byte(0)))
+    entry[0][str(app)] = [str(p) for p in permissions]
+    emit_changed(self, table, id, False)
+
+
+@dbus.service.method(MAIN_IFACE, in_signature='ss', out_signature='')
+def Delete(self, table, id):
+    get_entry(self, table, id)
+
+    del self.tables[(table, id)]
+    emit_changed(self, table, id, True)
+
+
+@dbus.service.method(MOCK_IFACE, in_signature='', out_signature='u')
+def GetLookupCount(self):
+    '''Number of Lookup calls since the mock started'''
+
+    return self.n_lookups
+
+
+@dbus.service.method(MOCK_IFACE, in_signature='ssb', out_signature='')
+def SetLookupBroken(self, table, id, broken):
+    '''Make the Lookup of a resource fail, or work again'''
+
+    if broken:
+        self.broken.add((table, id))
+    else:
+        self.broken.discard((table, id))
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "cc-permission-store.h"
+#include "shell/cc-object-storage.h"
+
+#define BUS_NAME    "org.freedesktop.impl.portal.PermissionStore"
+#define OBJECT_PATH "/org/freedesktop/impl/portal/PermissionStore"
+#define MOCK_IFACE  "org.freedesktop.DBus.Mock"
+
+#define N_APPS 200
+
+/* What the applications panel and the privacy pages show */
+static const gchar * const tables[] = {
+  "devices", "camera",
+  "devices", "microphone",
+  "location", "location",
+  NULL
+};
+
+typedef struct
+{
+  guint   n_done;
+  GError *error;
+} LoadResult;
+
+static GDBusConnection *
+get_bus (void)
+{
+  g_autoptr(GError) error = NULL;
+  GDBusConnection *bus;
+
+  bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  g_assert_no_error (error);
+
+  return bus;
+}
+
+static GVariant *
+call (const gchar *interface,
+      const gchar *method,
+      GVariant    *parameters)
+{
+  g_autoptr(GDBusConnection) bus = get_bus ();
+  g_autoptr(GError) error = NULL;
+  GVariant *ret;
+
+  ret = g_dbus_connection_call_sync (bus, BUS_NAME, OBJECT_PATH, interface, method, parameters,
+                                     NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+  g_assert_no_error (error);
+
+  return ret;
+}
+
+/* As an app using a portal would */
+static void
+set_permission (const gchar *table,
+                const gchar *id,
+                const gchar *app_id,
+                const gchar *permission)
+{
+  const gchar *permissions[] = { permission, NULL };
+  g_autoptr(GVariant) ret = NULL;
+
+  ret = call (BUS_NAME, "SetPermission",
+              g_variant_new ("(sbss^as)", table, TRUE, id, app_id, permissions));
+}
+
+static guint
+get_lookup_count (void)
+{
+  g_autoptr(GVariant) ret = call (MOCK_IFACE, "GetLookupCount", NULL);
+  guint count;
+
+  g_variant_get (ret, "(u)", &count);
+
+  return count;
+}
+
+static void
+load_cb (GObject      *object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  LoadResult *result = user_data;
+
+  cc_permission_store_load_finish (CC_PERMISSION_STORE (object), res,
+                                   result->error ? NULL : &result->error);
+  result->n_done++;
+}
+
+static void
+load (CcPermissionStore *store)
+{
+  LoadResult result = { 0, };
+
+  cc_permission_store_load_async (store, tables, NULL, load_cb, &result);
+  while (result.n_done < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_no_error (result.error);
+}
+
+static void
+changed_cb (CcPermissionStore *store,
+            const gchar       *table,
+            const gchar       *id,
+            guint             *n_changes)
+{
+  (*n_changes)++;
+}
+
+static void
+wait_for_changes (guint *n_changes,
+                  guint  expected)
+{
+  while (*n_changes < expected)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+assert_permission (CcPermissionStore *store,
+                   const gchar       *table,
+                   const gchar       *id,
+                   const gchar       *app_id,
+                   const gchar       *expected)
+{
+  g_auto(GStrv) permissions = cc_permission_store_get_permissions (store, table, id, app_id);
+
+  if (expected == NULL)
+    {
+      g_assert_null (permissions);
+      return;
+    }
+
+  g_assert_nonnull (permissions);
+  g_assert_cmpstr (permissions[0], ==, expected);
+}
+
+static void
+test_load (void)
+{
+  g_autoptr(CcPermissionStore) store = NULL;
+  g_autoptr(GVariant) permissions = NULL;
+  g_autoptr(GVariant) data = NULL;
+
+  set_permission ("devices", "camera", "org.example.Camera", "yes");
+  set_permission ("devices", "camera", "org.example.NoCamera", "no");
+  set_permission ("location", "location", "org.example.Maps", "EXACT");
+
+  store = g_object_new (CC_TYPE_PERMISSION_STORE, NULL);
+  load (store);
+
+  assert_permission (store, "devices", "camera", "org.example.Camera", "yes");
+  assert_permission (store, "devices", "camera", "org.example.NoCamera", "no");
+  assert_permission (store, "devices", "camera", "org.example.Maps", NULL);
+  assert_permission (store, "location", "location", "org.example.Maps", "EXACT");
+
+  /* Never stored, but loaded anyway */
+  assert_permission (store, "devices", "microphone", "org.example.Camera", NULL);
+  permissions = cc_permission_store_get_table (store, "devices", "microphone", &data);
+  g_assert_nonnull (permissions);
+  g_assert_cmpuint (g_variant_n_children (permissions), ==, 0);
+  g_assert_nonnull (data);
+
+  /* Not loaded */
+  g_assert_null (cc_permission_store_get_table (store, "screenshot", "screenshot", NULL));
+
+  g_assert_cmpuint (get_lookup_count (), ==, 3);
+}
+
+static void
+test_shared (void)
+{
+  CcPermissionStore *store;
+  LoadResult result = { 0, };
+  guint i;
+
+  cc_object_storage_initialize ();
+
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      set_permission ("devices", "camera", app_id, i % 2 ? "yes" : "no");
+    }
+
+  /* The panels and pages opening together */
+  store = cc_permission_store_get_default ();
+  g_assert_true (store == cc_permission_store_get_default ());
+
+  for (i = 0; i < 10; i++)
+    cc_permission_store_load_async (store, tables, NULL, load_cb, &result);
+  while (result.n_done < 10)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_no_error (result.error);
+
+  /* Selecting every app */
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      assert_permission (store, "devices", "camera", app_id, i % 2 ? "yes" : "no");
+      assert_permission (store, "location", "location", app_id, NULL);
+    }
+
+  /* Loaded already */
+  load (store);
+
+  g_assert_cmpuint (get_lookup_count (), ==, 3);
+
+  cc_object_storage_destroy ();
+}
+
+static void
+test_changed (void)
+{
+  g_autoptr(CcPermissionStore) store = NULL;
+  g_autoptr(GVariantBuilder) builder = NULL;
+  g_autoptr(GVariant) permissions = NULL;
+  g_autoptr(GVariant) data = NULL;
+  g_autoptr(GVariant) ret = NULL;
+  guint n_changes = 0;
+
+  set_permission ("devices", "camera", "org.example.Camera", "yes");
+
+  store = g_object_new (CC_TYPE_PERMISSION_STORE, NULL);
+  g_signal_connect (store, "changed", G_CALLBACK (changed_cb), &n_changes);
+  load (store);
+
+  /* From somewhere else */
+  set_permission ("devices", "camera", "org.example.Camera", "no");
+  wait_for_changes (&n_changes, 1);
+  assert_permission (store, "devices", "camera", "org.example.Camera", "no");
+
+  /* In a table nobody loaded */
+  set_permission ("screenshot", "screenshot", "org.example.Camera", "yes");
+
+  /* From the applications panel */
+  cc_permission_store_set_permission (store, "location", "location", "org.example.Maps",
+                                      (const gchar *[]) { "NONE", "0", NULL });
+  wait_for_changes (&n_changes, 2);
+  assert_permission (store, "location", "location", "org.example.Maps", "NONE");
+
+  /* From a privacy page */
+  permissions = cc_permission_store_get_table (store, "devices", "camera", &data);
+  builder = g_variant_builder_new (G_VARIANT_TYPE ("a{sas}"));
+  g_variant_builder_add (builder, "{s^as}", "org.example.Camera", (const gchar *[]) { "yes", NULL });
+  g_variant_builder_add (builder, "{s^as}", "org.example.Other", (const gchar *[]) { "no", NULL });
+
+  cc_permission_store_set_async (store, "devices", "camera",
+                                 g_variant_builder_end (builder), data,
+                                 NULL, NULL, NULL);
+  wait_for_changes (&n_changes, 3);
+  assert_permission (store, "devices", "camera", "org.example.Camera", "yes");
+  assert_permission (store, "devices", "camera", "org.example.Other", "no");
+
+  /* Removed */
+  ret = call (BUS_NAME, "Delete", g_variant_new ("(ss)", "devices", "camera"));
+  wait_for_changes (&n_changes, 4);
+  assert_permission (store, "devices", "camera", "org.example.Camera", NULL);
+
+  g_assert_cmpuint (n_changes, ==, 4);
+  g_assert_cmpuint (get_lookup_count (), ==, 3);
+}
+
+static void
+test_broken (void)
+{
+  g_autoptr(CcPermissionStore) store = NULL;
+  g_autoptr(GVariant) ret = NULL;
+  LoadResult result = { 0, };
+
+  set_permission ("devices", "camera", "org.example.Camera", "yes");
+  set_permission ("location", "location", "org.example.Maps", "EXACT");
+  ret = call (MOCK_IFACE, "SetLookupBroken", g_variant_new ("(ssb)", "devices", "camera", TRUE));
+
+  store = g_object_new (CC_TYPE_PERMISSION_STORE, NULL);
+  cc_permission_store_load_async (store, tables, NULL, load_cb, &result);
+  while (result.n_done < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* Only the broken table is missing */
+  g_assert_error (result.error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED);
+  g_clear_error (&result.error);
+  g_assert_null (cc_permission_store_get_table (store, "devices", "camera", NULL));
+  assert_permission (store, "devices", "camera", "org.example.Camera", NULL);
+  assert_permission (store, "location", "location", "org.example.Maps", "EXACT");
+  g_assert_cmpuint (get_lookup_count (), ==, 3);
+
+  /* And the only one looked up again */
+  g_clear_pointer (&ret, g_variant_unref);
+  ret = call (MOCK_IFACE, "SetLookupBroken", g_variant_new ("(ssb)", "devices", "camera", FALSE));
+  load (store);
+
+  assert_permission (store, "devices", "camera", "org.example.Camera", "yes");
+  g_assert_cmpuint (get_lookup_count (), ==, 4);
+}
+
+static void
+test_benchmark (void)
+{
+  g_autoptr(CcPermissionStore) store = NULL;
+  g_autoptr(GDBusConnection) bus = get_bus ();
+  gint64 start, elapsed;
+  guint i;
+
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+
+      set_permission ("devices", "camera", app_id, "yes");
+      set_permission ("devices", "microphone", app_id, "yes");
+      set_permission ("location", "location", app_id, "EXACT");
+    }
+
+  /* What the applications panel used to do for every app */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_APPS; i++)
+    {
+      guint j;
+
+      for (j = 0; tables[j] != NULL; j += 2)
+        {
+          g_autoptr(GVariant) ret = NULL;
+
+          ret = g_dbus_connection_call_sync (bus, BUS_NAME, OBJECT_PATH, BUS_NAME, "Lookup",
+                                             g_variant_new ("(ss)", tables[j], tables[j + 1]),
+                                             NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+          g_assert_nonnull (ret);
+        }
+    }
+  g_test_message ("Looking up the permissions of %u apps took %.1f ms",
+                  N_APPS, (g_get_monotonic_time () - start) / 1000.0);
+
+  start = g_get_monotonic_time ();
+  store = g_object_new (CC_TYPE_PERMISSION_STORE, NULL);
+  load (store);
+  for (i = 0; i < N_APPS; i++)
+    {
+      g_autofree gchar *app_id = g_strdup_printf ("org.example.App%u", i);
+      guint j;
+
+      for (j = 0; tables[j] != NULL; j += 2)
+        {
+          g_auto(GStrv) permissions = cc_permission_store_get_permissions (store, tables[j], tables[j + 1], app_id);
+
+          g_assert_nonnull (permissions);
+        }
+    }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_test_minimized_result (elapsed / 1000.0,
+                           "Loading and reading the permissions of %u apps took %.1f ms",
+                           N_APPS, elapsed / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/common/permission-store/load", test_load);
+  g_test_add_func ("/common/permission-store/shared", test_shared);
+  g_test_add_func ("/common/permission-store/changed", test_changed);
+  g_test_add_func ("/common/permission-store/broken", test_broken);
+  g_test_add_func ("/common/permission-store/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Copyright (C) 2024 GNOME Settings contributors
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+import os
+import subprocess
+import sys
+import unittest
+
+try:
+    import dbusmock
+except ImportError:
+    sys.stderr.write('You need python-dbusmock (http://pypi.python.org/pypi/python-dbusmock) for this test suite.\n')
+    sys.exit(1)
+
+# Add the shared directory to the search path
+sys.path.append(os.path.join(os.path.dirname(__file__), '..', 'shared'))
+
+from gtest import GTest
+
+BUILDDIR = os.environ.get('BUILDDIR', os.path.join(os.path.dirname(__file__)))
+TEMPLATE = os.path.join(os.path.dirname(__file__), 'permission_store.py')
+
+
+class PermissionStoreTestCase(dbusmock.DBusTestCase, GTest):
+    g_test_exe = os.path.join(BUILDDIR, 'test-permission-store')
+
+    @classmethod
+    def setUpClass(klass):
+        klass.start_session_bus()
+
+    def setUp(self):
+        # A new store for every test
+        self.p_mock, _ = self.spawn_server_template(TEMPLATE, {}, stdout=subprocess.DEVNULL)
+
+    def tearDown(self):
+        self.p_mock.terminate()
+        self.p_mock.wait()
+
+
+if __name__ == '__main__':
+    # avoid writing to stderr
+    unittest.main(testRunner=unittest.TextTestRunner(stream=sys.stdout, verbosity=2))
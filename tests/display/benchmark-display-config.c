@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times the display configuration code against the mutter_display_config
+ * dbusmock template. Run through benchmark-display-config.py, which sets
+ * up the session bus and the mock for each scenario.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "cc-display-arrangement.h"
+#include "cc-display-config.h"
+#include "cc-display-config-manager-dbus.h"
+
+#define MINIMUM_WIDTH 740
+#define MINIMUM_HEIGHT 530
+
+static int iterations = 200;
+
+static GOptionEntry entries[] =
+{
+  { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of layout changes to time", "N" },
+  { NULL }
+};
+
+static void
+on_manager_changed (CcDisplayConfigManager *manager,
+                    gboolean               *changed)
+{
+  *changed = TRUE;
+}
+
+static CcDisplayConfig *
+wait_for_config (CcDisplayConfigManager *manager,
+                 gboolean               *changed)
+{
+  CcDisplayConfig *config;
+
+  while (!*changed)
+    g_main_context_iteration (NULL, TRUE);
+  *changed = FALSE;
+
+  config = cc_display_config_manager_get_current (manager);
+  if (config)
+    {
+      cc_display_config_set_minimum_size (config, MINIMUM_WIDTH, MINIMUM_HEIGHT);
+      cc_display_config_update_ui_numbers_names (config);
+    }
+
+  return config;
+}
+
+static void
+print_result (const char *name,
+              gint64      usec,
+              int         count)
+{
+  g_print ("%-10s %10.3f ms total %10.3f ms/op (%d ops)\n",
+           name, usec / 1000.0, usec / 1000.0 / MAX (count, 1), count);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(CcDisplayConfigManager) manager = NULL;
+  g_autoptr(CcDisplayConfig) config = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GRand) rand = NULL;
+  GList *monitors, *l;
+  gboolean changed = FALSE;
+  guint n_monitors, n_modes = 0;
+  gint64 start;
+  int i, n_verify;
+
+  context = g_option_context_new ("- benchmark the display configuration");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  /* Panel open: connect, fetch and parse the current state */
+  start = g_get_monotonic_time ();
+  manager = cc_display_config_manager_dbus_new ();
+  g_signal_connect (manager, "changed", G_CALLBACK (on_manager_changed), &changed);
+  config = wait_for_config (manager, &changed);
+  if (!config)
+    {
+      g_printerr ("No display configuration, is the DisplayConfig mock running?\n");
+      return 1;
+    }
+  monitors = cc_display_config_get_ui_sorted_monitors (config);
+  print_result ("open", g_get_monotonic_time () - start, 1);
+
+  n_monitors = g_list_length (monitors);
+  for (l = monitors; l != NULL; l = l->next)
+    n_modes += g_list_length (cc_display_monitor_get_modes (l->data));
+  g_print ("%u monitors, %u modes\n", n_monitors, n_modes);
+
+  /* Layout changes: drag a monitor somewhere and let the arrangement snap it */
+  rand = g_rand_new_with_seed (42);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    {
+      CcDisplayMonitor *monitor = g_list_nth_data (monitors, i % n_monitors);
+
+      cc_display_monitor_set_position (monitor,
+                                       g_rand_int_range (rand, -8000, 8000),
+                                       g_rand_int_range (rand, -8000, 8000));
+      cc_display_config_snap_outputs (config);
+    }
+  print_result ("layout", g_get_monotonic_time () - start, iterations);
+
+  /* Verify, as done by the panel before enabling the Apply button */
+  n_verify = MAX (iterations / 10, 1);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_verify; i++)
+    {
+      if (!cc_display_config_is_applicable (config))
+        {
+          g_printerr ("Snapped layout is not applicable\n");
+          return 1;
+        }
+    }
+  print_result ("verify", g_get_monotonic_time () - start, n_verify);
+
+  /* Apply, then wait for MonitorsChanged and the reloaded state */
+  start = g_get_monotonic_time ();
+  if (!cc_display_config_apply (config, &error))
+    {
+      g_printerr ("Failed to apply configuration: %s\n", error->message);
+      return 1;
+    }
+  g_clear_object (&config);
+  config = wait_for_config (manager, &changed);
+  print_result ("apply", g_get_monotonic_time () - start, 1);
+
+  return config != NULL ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# Copyright © 2024 GNOME Settings contributors
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+import os
+import subprocess
+import sys
+
+try:
+    import dbusmock
+except ImportError:
+    sys.stderr.write('You need python-dbusmock (http://pypi.python.org/pypi/python-dbusmock) for this benchmark.\n')
+    sys.exit(1)
+
+BUILDDIR = os.environ.get('BUILDDIR', os.path.join(os.path.dirname(__file__)))
+TOP_SRCDIR = os.path.join(os.path.dirname(__file__), '..', '..')
+TEMPLATE = os.path.join(TOP_SRCDIR, 'panels', 'display', 'dbusmock-templates', 'mutter_display_config.py')
+
+SCENARIOS = [
+    ('single', {'monitors': 1, 'modes': 8}),
+    ('dual', {'monitors': 2, 'modes': 40}),
+    ('fractional', {'monitors': 3, 'modes': 40, 'scales': [1.0, 1.25, 1.5, 1.75, 2.0, 2.25, 2.5, 3.0]}),
+    ('wall', {'monitors': 12, 'modes': 120}),
+    ('latency', {'monitors': 4, 'modes': 40, 'latency': 50}),
+]
+
+
+class DisplayConfigBenchmark(dbusmock.DBusTestCase):
+    @classmethod
+    def setUpClass(klass):
+        klass.start_session_bus()
+
+    def run_scenario(self, name, parameters):
+        mock_server, _ = self.spawn_server_template(TEMPLATE, parameters, stdout=subprocess.DEVNULL)
+        try:
+            print('== %s: %s' % (name, parameters), flush=True)
+            subprocess.check_call([os.path.join(BUILDDIR, 'benchmark-display-config')] + sys.argv[1:])
+        finally:
+            mock_server.terminate()
+            mock_server.wait()
+
+
+if __name__ == '__main__':
+    DisplayConfigBenchmark.setUpClass()
+    try:
+        benchmark = DisplayConfigBenchmark()
+        for name, parameters in SCENARIOS:
+            benchmark.run_scenario(name, parameters)
+    finally:
+        DisplayConfigBenchmark.tearDownClass()
@@ -466,12 +466,14 @@ PW_BITRATE = "Bitrate"
 PW_ACCESS_POINTS = "AccessPoints"
 PW_ACTIVE_ACCESS_POINT = "ActiveAccessPoint"
 PW_WIRELESS_CAPABILITIES = "WirelessCapabilities"
+PW_LAST_SCAN = "LastScan"
 
 class WifiDevice(Device):
     def __init__(self, bus, iface):
         self.mac = random_mac()
         self.aps = []
         self.active_ap = None
+        self.last_scan = -1
 
         self.add_dbus_interface(IFACE_WIFI, self.__get_props, WifiDevice.PropertiesChanged)
         Device.__init__(self, bus, iface, NM_DEVICE_TYPE_WIFI)
@@ -489,7 +491,9 @@ class WifiDevice(Device):
 
     @dbus.service.method(dbus_interface=IFACE_WIFI, in_signature='a{sv}', out_signature='')
     def RequestScan(self, props):
-        pass
+        # Scans finish immediately, the APs are whatever the test added
+        self.last_scan = GLib.get_monotonic_time() // 1000
+        self.__notify(PW_LAST_SCAN)
 
     @dbus.service.signal(IFACE_WIFI, signature='o')
     def AccessPointAdded(self, ap_path):
@@ -519,6 +523,7 @@ class WifiDevice(Device):
         props[PW_WIRELESS_CAPABILITIES] = dbus.UInt32(0xFF)
         props[PW_ACCESS_POINTS] = to_path_array(self.aps)
         props[PW_ACTIVE_ACCESS_POINT] = to_path(self.active_ap)
+        props[PW_LAST_SCAN] = dbus.Int64(self.last_scan)
         return props
 
     def __notify(self, propname):
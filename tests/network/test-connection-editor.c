@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "test-connection-editor"
+
+#include "nm-macros-internal.h"
+
+#include <NetworkManager.h>
+#include <gtk/gtk.h>
+#include <adwaita.h>
+
+#include "nm-test-libnm-utils.h"
+
+#include "net-connection-editor.h"
+#include "ce-page.h"
+#include "vpn-helpers.h"
+
+#include "nmtst-helpers.h"
+
+#define TIMEOUT_S 30
+
+typedef struct {
+  NMTstcServiceInfo *sinfo;
+  NMClient *client;
+  NMDevice *device;
+  NMConnection *connection;
+
+  NetConnectionEditor *editor;
+} EditorFixture;
+
+static void
+fixture_set_up (EditorFixture *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(NMConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  gint64 deadline;
+
+  fixture->sinfo = nmtstc_service_init ();
+
+  fixture->client = nm_client_new (NULL, &error);
+  g_assert_no_error (error);
+
+  fixture->device = nmtstc_service_add_wired_device (fixture->sinfo,
+                                                     fixture->client,
+                                                     "eth1000",
+                                                     "52:54:00:ab:db:23",
+                                                     NULL);
+
+  connection = nmtst_create_minimal_connection ("wired", NULL, NM_SETTING_WIRED_SETTING_NAME, NULL);
+
+  /* Not something the editor would save, but the settings may come from anywhere */
+  if (user_data)
+    {
+      NMSettingIPConfig *s_ip4;
+
+      s_ip4 = NM_SETTING_IP_CONFIG (nm_setting_ip4_config_new ());
+      g_object_set (s_ip4,
+                    NM_SETTING_IP_CONFIG_METHOD, NM_SETTING_IP4_CONFIG_METHOD_MANUAL,
+                    NULL);
+      nm_connection_add_setting (connection, NM_SETTING (s_ip4));
+    }
+
+  nmtstc_service_add_connection (fixture->sinfo, connection, FALSE, &path);
+
+  deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+  while (!(fixture->connection = NM_CONNECTION (nm_client_get_connection_by_path (fixture->client, path))))
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, FALSE);
+    }
+}
+
+static void
+fixture_tear_down (EditorFixture *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_pointer ((GtkWindow **) &fixture->editor, gtk_window_destroy);
+  g_clear_object (&fixture->client);
+
+  g_clear_pointer (&fixture->sinfo, nmtstc_service_cleanup);
+}
+
+static GtkWidget *
+find_child (GtkWidget *widget,
+            GType      type)
+{
+  GtkWidget *child;
+
+  if (G_TYPE_CHECK_INSTANCE_TYPE (widget, type))
+    return widget;
+
+  for (child = gtk_widget_get_first_child (widget); child; child = gtk_widget_get_next_sibling (child))
+    {
+      GtkWidget *found = find_child (child, type);
+
+      if (found)
+        return found;
+    }
+
+  return NULL;
+}
+
+static GtkWidget *
+find_button (GtkWidget   *widget,
+             const gchar *label)
+{
+  GtkWidget *child;
+
+  if (GTK_IS_BUTTON (widget) && g_strcmp0 (gtk_button_get_label (GTK_BUTTON (widget)), label) == 0)
+    return widget;
+
+  for (child = gtk_widget_get_first_child (widget); child; child = gtk_widget_get_next_sibling (child))
+    {
+      GtkWidget *found = find_button (child, label);
+
+      if (found)
+        return found;
+    }
+
+  return NULL;
+}
+
+static CEPage *
+get_page (GtkNotebook *notebook,
+          gint         page_num)
+{
+  GtkWidget *child;
+
+  child = adw_bin_get_child (ADW_BIN (gtk_notebook_get_nth_page (notebook, page_num)));
+
+  return CE_IS_PAGE (child) ? CE_PAGE (child) : NULL;
+}
+
+static void
+wait_for_page (GtkNotebook *notebook,
+               gint         page_num)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+
+  while (!get_page (notebook, page_num))
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, FALSE);
+    }
+}
+
+static GtkNotebook *
+open_editor (EditorFixture *fixture)
+{
+  GtkNotebook *notebook;
+  gint64 start;
+
+  start = g_get_monotonic_time ();
+
+  fixture->editor = net_connection_editor_new (fixture->connection, fixture->device, NULL, fixture->client);
+  notebook = GTK_NOTEBOOK (find_child (GTK_WIDGET (fixture->editor), GTK_TYPE_NOTEBOOK));
+  g_assert_nonnull (notebook);
+
+  wait_for_page (notebook, 0);
+
+  g_test_minimized_result ((g_get_monotonic_time () - start) / 1000.0,
+                           "Opening the editor took %.1f ms",
+                           (g_get_monotonic_time () - start) / 1000.0);
+
+  return notebook;
+}
+
+static void
+test_open (EditorFixture *fixture,
+           gconstpointer  user_data)
+{
+  GtkNotebook *notebook;
+  gint i;
+
+  notebook = open_editor (fixture);
+
+  /* Every tab is there, but only the details were built */
+  g_assert_cmpint (gtk_notebook_get_n_pages (notebook), ==, 5);
+  g_assert_cmpstr (ce_page_get_title (get_page (notebook, 0)), ==, "Details");
+  for (i = 1; i < gtk_notebook_get_n_pages (notebook); i++)
+    g_assert_null (get_page (notebook, i));
+
+  gtk_notebook_set_current_page (notebook, 2);
+  wait_for_page (notebook, 2);
+
+  g_assert_cmpstr (ce_page_get_title (get_page (notebook, 2)), ==, "IPv4");
+  g_assert_null (get_page (notebook, 1));
+  g_assert_null (get_page (notebook, 3));
+}
+
+static void
+test_validate_unvisited (EditorFixture *fixture,
+                         gconstpointer  user_data)
+{
+  GtkNotebook *notebook;
+  GtkWidget *apply_button;
+  gint64 deadline;
+
+  notebook = open_editor (fixture);
+  g_assert_null (get_page (notebook, 2));
+
+  apply_button = find_button (GTK_WIDGET (fixture->editor), "_Apply");
+  g_assert_nonnull (apply_button);
+
+  /* The IPv4 page was never shown, its settings are still checked */
+  deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+  while (!gtk_widget_get_tooltip_text (apply_button))
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, FALSE);
+    }
+
+  g_assert_true (g_str_has_prefix (gtk_widget_get_tooltip_text (apply_button), "Invalid setting IPv4"));
+  g_assert_false (gtk_widget_get_sensitive (apply_button));
+  g_assert_null (get_page (notebook, 2));
+}
+
+static void
+test_new_connection (EditorFixture *fixture,
+                     gconstpointer  user_data)
+{
+  g_autoptr(NMConnection) connection = NULL;
+  GtkNotebook *notebook;
+
+  /* Not known to NetworkManager yet, as from "Add" */
+  connection = nmtst_create_minimal_connection ("new", NULL, NM_SETTING_WIRED_SETTING_NAME, NULL);
+  fixture->connection = connection;
+
+  notebook = open_editor (fixture);
+
+  /* What only the security page can check is there right away */
+  g_assert_cmpint (gtk_notebook_get_n_pages (notebook), ==, 5);
+  wait_for_page (notebook, 4);
+  g_assert_cmpstr (ce_page_get_title (get_page (notebook, 4)), ==, "Security");
+  g_assert_null (get_page (notebook, 1));
+  g_assert_null (get_page (notebook, 2));
+  g_assert_null (get_page (notebook, 3));
+
+  g_assert_nonnull (find_button (GTK_WIDGET (fixture->editor), "_Add"));
+}
+
+static void
+test_vpn_plugins (void)
+{
+  gint64 start;
+
+  vpn_get_plugins ();
+
+  /* The plugins are only loaded once */
+  start = g_get_monotonic_time ();
+  g_assert_true (vpn_get_plugins () == vpn_get_plugins ());
+
+  g_test_minimized_result ((g_get_monotonic_time () - start) / 1000.0,
+                           "Listing the VPN plugins again took %.3f ms",
+                           (g_get_monotonic_time () - start) / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  g_setenv ("LIBNM_USE_SESSION_BUS", "1", TRUE);
+  g_setenv ("LC_ALL", "C", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+  adw_init ();
+
+  g_test_add ("/connection-editor/open",
+              EditorFixture,
+              NULL,
+              fixture_set_up,
+              test_open,
+              fixture_tear_down);
+
+  g_test_add ("/connection-editor/validate-unvisited",
+              EditorFixture,
+              GINT_TO_POINTER (TRUE),
+              fixture_set_up,
+              test_validate_unvisited,
+              fixture_tear_down);
+
+  g_test_add ("/connection-editor/new-connection",
+              EditorFixture,
+              NULL,
+              fixture_set_up,
+              test_new_connection,
+              fixture_tear_down);
+
+  g_test_add_func ("/connection-editor/vpn-plugins", test_vpn_plugins);
+
+  return g_test_run ();
+}
@@ -0,0 +1,627 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "test-network-scale"
+
+#include "nm-macros-internal.h"
+
+#include <NetworkManager.h>
+#include <gtk/gtk.h>
+#include <adwaita.h>
+#include <string.h>
+
+#include "nm-test-libnm-utils.h"
+
+#include "cc-test-window.h"
+#include "cc-wifi-connection-row.h"
+#include "net-device-ethernet.h"
+#include "net-vpn.h"
+#include "shell/cc-object-storage.h"
+
+#include "nmtst-helpers.h"
+
+#define TIMEOUT_S 60
+
+/* Networks replaced on every device for each scan */
+#define SCAN_CHURN    10
+#define N_CHURN_ROUNDS 20
+#define CHURN_PER_ROUND 5
+
+typedef struct {
+  guint n_wifi_devices;
+  guint n_wired_devices;
+  /* Per Wi-Fi device, each with its own SSID */
+  guint n_aps;
+  /* Wi-Fi connections, the first n_aps / 2 are in range of every device */
+  guint n_saved;
+  guint n_vpns;
+} ScaleScenario;
+
+/* Built as benchmark-network-scale with NETWORK_SCALE_BENCHMARK defined,
+ * to run the large scenario with meson test --benchmark only */
+#ifndef NETWORK_SCALE_BENCHMARK
+static const ScaleScenario small_scenario = {
+  .n_wifi_devices = 1,
+  .n_wired_devices = 1,
+  .n_aps = 20,
+  .n_saved = 20,
+  .n_vpns = 5,
+};
+
+#else
+static const ScaleScenario large_scenario = {
+  .n_wifi_devices = 2,
+  .n_wired_devices = 4,
+  .n_aps = 200,
+  .n_saved = 300,
+  .n_vpns = 50,
+};
+#endif
+
+typedef struct {
+  const ScaleScenario *scenario;
+
+  NMTstcServiceInfo *sinfo;
+  NMClient *client;
+  GPtrArray *wifi_devices;
+  /* Paths of the unsaved APs of each device, oldest first */
+  GPtrArray *other_aps;
+  guint n_ap_events;
+  guint ap_counter;
+
+  GtkWindow *shell;
+  CcPanel *panel;
+} ScaleFixture;
+
+extern GType cc_network_panel_get_type (void);
+extern GType cc_wifi_panel_get_type (void);
+
+/* Main loop accounting: whatever isn't spent in poll() is spent handling events */
+
+static GPollFunc default_poll_func;
+static gint64 poll_time;
+static gint64 busy_since;
+static gint64 longest_busy;
+
+static gint
+timed_poll_func (GPollFD *fds,
+                 guint    nfds,
+                 gint     timeout)
+{
+  gint64 start = g_get_monotonic_time ();
+  gint result;
+
+  longest_busy = MAX (longest_busy, start - busy_since);
+
+  result = default_poll_func (fds, nfds, timeout);
+
+  busy_since = g_get_monotonic_time ();
+  poll_time += busy_since - start;
+
+  return result;
+}
+
+typedef struct {
+  gint64 busy;
+  gint64 start;
+  gint64 poll_time;
+} BusyTimer;
+
+static void
+busy_timer_init (BusyTimer *timer)
+{
+  timer->busy = 0;
+  longest_busy = 0;
+}
+
+static void
+busy_timer_start (BusyTimer *timer)
+{
+  timer->start = g_get_monotonic_time ();
+  timer->poll_time = poll_time;
+  busy_since = timer->start;
+}
+
+static void
+busy_timer_stop (BusyTimer *timer)
+{
+  timer->busy += g_get_monotonic_time () - timer->start - (poll_time - timer->poll_time);
+}
+
+static void
+busy_timer_report (BusyTimer   *timer,
+                   const gchar *what,
+                   guint        n_events)
+{
+  gdouble busy = timer->busy / 1000.0;
+
+  g_test_minimized_result (busy / MAX (n_events, 1),
+                           "%s: %u events, %.1f ms main loop time, %.2f ms per event",
+                           what, n_events, busy, busy / MAX (n_events, 1));
+  g_test_minimized_result (longest_busy / 1000.0,
+                           "%s: longest main loop iteration %.1f ms",
+                           what, longest_busy / 1000.0);
+}
+
+static gboolean
+wait_timeout_cb (gpointer user_data)
+{
+  g_error ("Timed out waiting for %s", (const gchar *) user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+#define WAIT_FOR(condition) \
+  G_STMT_START { \
+    guint _timeout_id = g_timeout_add_seconds (TIMEOUT_S, wait_timeout_cb, (gpointer) #condition); \
+    while (!(condition)) \
+      g_main_context_iteration (NULL, TRUE); \
+    g_source_remove (_timeout_id); \
+  } G_STMT_END
+
+/* Scenario */
+
+static NMConnection *
+create_wifi_connection (const gchar *ssid)
+{
+  g_autoptr(GBytes) ssid_bytes = NULL;
+  NMSettingWirelessSecurity *s_sec;
+  NMConnection *connection;
+
+  connection = nmtst_create_minimal_connection (ssid, NULL, NM_SETTING_WIRELESS_SETTING_NAME, NULL);
+
+  ssid_bytes = g_bytes_new (ssid, strlen (ssid));
+  g_object_set (nm_connection_get_setting_wireless (connection),
+                NM_SETTING_WIRELESS_SSID, ssid_bytes,
+                NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_INFRA,
+                NULL);
+
+  s_sec = NM_SETTING_WIRELESS_SECURITY (nm_setting_wireless_security_new ());
+  g_object_set (s_sec,
+                NM_SETTING_WIRELESS_SECURITY_KEY_MGMT, "wpa-psk",
+                NM_SETTING_WIRELESS_SECURITY_PSK, "password",
+                NULL);
+  nm_connection_add_setting (connection, NM_SETTING (s_sec));
+
+  return connection;
+}
+
+static NMConnection *
+create_vpn_connection (const gchar *id)
+{
+  NMConnection *connection;
+
+  connection = nmtst_create_minimal_connection (id, NULL, NM_SETTING_VPN_SETTING_NAME, NULL);
+  g_object_set (nm_connection_get_setting_vpn (connection),
+                NM_SETTING_VPN_SERVICE_TYPE, "org.freedesktop.NetworkManager.openvpn",
+                NULL);
+
+  return connection;
+}
+
+static gchar *
+add_access_point (ScaleFixture *fixture,
+                  NMDevice     *device,
+                  const gchar  *ssid)
+{
+  g_autoptr(GVariant) result = NULL;
+  g_autoptr(GError) error = NULL;
+  gchar *path;
+
+  /* An empty MAC address makes the service pick a random one */
+  result = g_dbus_proxy_call_sync (fixture->sinfo->proxy,
+                                   "AddWifiAp",
+                                   g_variant_new ("(sss)", nm_device_get_iface (device), ssid, ""),
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                   3000,
+                                   NULL,
+                                   &error);
+  g_assert_no_error (error);
+
+  g_variant_get (result, "(o)", &path);
+
+  return path;
+}
+
+static void
+add_other_access_point (ScaleFixture *fixture,
+                        guint         device_idx)
+{
+  NMDevice *device = g_ptr_array_index (fixture->wifi_devices, device_idx);
+  g_autofree gchar *ssid = NULL;
+
+  ssid = g_strdup_printf ("%s-%05u", nm_device_get_iface (device), fixture->ap_counter++);
+  g_ptr_array_add (g_ptr_array_index (fixture->other_aps, device_idx),
+                   add_access_point (fixture, device, ssid));
+}
+
+static void
+remove_other_access_point (ScaleFixture *fixture,
+                           guint         device_idx)
+{
+  NMDevice *device = g_ptr_array_index (fixture->wifi_devices, device_idx);
+  GPtrArray *paths = g_ptr_array_index (fixture->other_aps, device_idx);
+  g_autofree gchar *path = NULL;
+  g_autoptr(GVariant) result = NULL;
+  g_autoptr(GError) error = NULL;
+
+  path = g_ptr_array_steal_index (paths, 0);
+
+  result = g_dbus_proxy_call_sync (fixture->sinfo->proxy,
+                                   "RemoveWifiAp",
+                                   g_variant_new ("(so)", nm_device_get_iface (device), path),
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                   3000,
+                                   NULL,
+                                   &error);
+  g_assert_no_error (error);
+}
+
+static void
+on_access_point_changed_cb (ScaleFixture *fixture)
+{
+  fixture->n_ap_events++;
+}
+
+static gboolean
+all_access_points_added (ScaleFixture *fixture)
+{
+  guint i;
+
+  for (i = 0; i < fixture->wifi_devices->len; i++)
+    {
+      NMDeviceWifi *device = g_ptr_array_index (fixture->wifi_devices, i);
+
+      if (nm_device_wifi_get_access_points (device)->len != fixture->scenario->n_aps)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+populate (ScaleFixture *fixture)
+{
+  const ScaleScenario *scenario = fixture->scenario;
+  guint n_in_range = scenario->n_aps / 2;
+  guint i, j;
+
+  g_assert_cmpuint (scenario->n_saved, >=, n_in_range);
+
+  for (i = 0; i < scenario->n_wired_devices; i++)
+    {
+      g_autofree gchar *ifname = g_strdup_printf ("eth%u", i);
+      g_autofree gchar *mac = g_strdup_printf ("52:54:00:ab:db:%02x", i);
+
+      nmtstc_service_add_wired_device (fixture->sinfo, fixture->client, ifname, mac, NULL);
+    }
+
+  for (i = 0; i < scenario->n_wifi_devices; i++)
+    {
+      g_autofree gchar *ifname = g_strdup_printf ("wlan%u", i);
+      NMDevice *device;
+
+      device = nmtstc_service_add_device (fixture->sinfo, fixture->client, "AddWifiDevice", ifname);
+      g_ptr_array_add (fixture->wifi_devices, device);
+      g_ptr_array_add (fixture->other_aps, g_ptr_array_new_with_free_func (g_free));
+
+      g_signal_connect_swapped (device, "access-point-added",
+                                G_CALLBACK (on_access_point_changed_cb), fixture);
+      g_signal_connect_swapped (device, "access-point-removed",
+                                G_CALLBACK (on_access_point_changed_cb), fixture);
+    }
+
+  for (i = 0; i < scenario->n_saved; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("saved-%03u", i);
+      g_autoptr(NMConnection) connection = create_wifi_connection (ssid);
+
+      nmtstc_service_add_connection (fixture->sinfo, connection, TRUE, NULL);
+    }
+
+  for (i = 0; i < scenario->n_vpns; i++)
+    {
+      g_autofree gchar *id = g_strdup_printf ("vpn-%03u", i);
+      g_autoptr(NMConnection) connection = create_vpn_connection (id);
+
+      nmtstc_service_add_connection (fixture->sinfo, connection, FALSE, NULL);
+    }
+
+  for (i = 0; i < fixture->wifi_devices->len; i++)
+    {
+      NMDevice *device = g_ptr_array_index (fixture->wifi_devices, i);
+
+      for (j = 0; j < n_in_range; j++)
+        {
+          g_autofree gchar *ssid = g_strdup_printf ("saved-%03u", j);
+          g_free (add_access_point (fixture, device, ssid));
+        }
+
+      for (j = n_in_range; j < scenario->n_aps; j++)
+        add_other_access_point (fixture, i);
+    }
+
+  WAIT_FOR (nm_client_get_connections (fixture->client)->len == scenario->n_saved + scenario->n_vpns);
+  WAIT_FOR (all_access_points_added (fixture));
+}
+
+static void
+fixture_set_up (ScaleFixture  *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  fixture->scenario = user_data;
+  fixture->wifi_devices = g_ptr_array_new ();
+  fixture->other_aps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+
+  cc_object_storage_initialize ();
+
+  fixture->sinfo = nmtstc_service_init ();
+
+  fixture->client = nm_client_new (NULL, &error);
+  g_assert_no_error (error);
+
+  /* Insert into object storage so that we see the same events as the panel. */
+  cc_object_storage_add_object (CC_OBJECT_NMCLIENT, fixture->client);
+
+  populate (fixture);
+
+  fixture->shell = GTK_WINDOW (cc_test_window_new ());
+  gtk_window_present (fixture->shell);
+}
+
+static void
+fixture_tear_down (ScaleFixture  *fixture,
+                   gconstpointer  user_data)
+{
+  guint i;
+
+  for (i = 0; i < fixture->wifi_devices->len; i++)
+    g_signal_handlers_disconnect_by_data (g_ptr_array_index (fixture->wifi_devices, i), fixture);
+
+  g_clear_object (&fixture->panel);
+  g_clear_pointer (&fixture->shell, gtk_window_destroy);
+  g_clear_object (&fixture->client);
+
+  cc_object_storage_destroy ();
+
+  g_clear_pointer (&fixture->wifi_devices, g_ptr_array_unref);
+  g_clear_pointer (&fixture->other_aps, g_ptr_array_unref);
+  g_clear_pointer (&fixture->sinfo, nmtstc_service_cleanup);
+}
+
+static void
+open_panel (ScaleFixture *fixture,
+            GType         panel_type)
+{
+  gint64 start;
+
+  start = g_get_monotonic_time ();
+
+  fixture->panel = g_object_new (panel_type,
+                                 "shell", CC_SHELL (fixture->shell),
+                                 NULL);
+  g_object_ref (fixture->panel);
+  cc_shell_set_active_panel (CC_SHELL (fixture->shell), fixture->panel);
+
+  g_test_minimized_result ((g_get_monotonic_time () - start) / 1000.0,
+                           "Opening %s took %.1f ms",
+                           g_type_name (panel_type),
+                           (g_get_monotonic_time () - start) / 1000.0);
+}
+
+static guint
+count_widgets (GtkWidget *widget,
+               GType      type)
+{
+  GtkWidget *child;
+  guint n = 0;
+
+  if (!gtk_widget_get_visible (widget))
+    return 0;
+
+  if (G_TYPE_CHECK_INSTANCE_TYPE (widget, type))
+    return 1;
+
+  for (child = gtk_widget_get_first_child (widget); child; child = gtk_widget_get_next_sibling (child))
+    n += count_widgets (child, type);
+
+  return n;
+}
+
+static void
+assert_wifi_rows (ScaleFixture *fixture)
+{
+  guint n_rows;
+
+  n_rows = count_widgets (GTK_WIDGET (fixture->panel), CC_TYPE_WIFI_CONNECTION_ROW);
+  g_test_message ("%u visible Wi-Fi rows", n_rows);
+
+  /* Every network in range once, saved ones out of range are hidden */
+  g_assert_cmpuint (n_rows, ==, fixture->scenario->n_wifi_devices * fixture->scenario->n_aps);
+}
+
+/* Tests */
+
+static void
+test_network_panel_open (ScaleFixture  *fixture,
+                         gconstpointer  user_data)
+{
+  open_panel (fixture, cc_network_panel_get_type ());
+
+  g_assert_cmpuint (count_widgets (GTK_WIDGET (fixture->panel), net_device_ethernet_get_type ()),
+                    ==, fixture->scenario->n_wired_devices);
+  g_assert_cmpuint (count_widgets (GTK_WIDGET (fixture->panel), net_vpn_get_type ()),
+                    ==, fixture->scenario->n_vpns);
+}
+
+static void
+test_wifi_panel_scan (ScaleFixture  *fixture,
+                      gconstpointer  user_data)
+{
+  g_autoptr(GArray) last_scans = g_array_new (FALSE, FALSE, sizeof (gint64));
+  BusyTimer timer;
+  guint n_expected;
+  guint i, j;
+
+  open_panel (fixture, cc_wifi_panel_get_type ());
+  assert_wifi_rows (fixture);
+
+  /* Some networks went away, as many new ones showed up */
+  fixture->n_ap_events = 0;
+  for (i = 0; i < fixture->wifi_devices->len; i++)
+    {
+      NMDeviceWifi *device = g_ptr_array_index (fixture->wifi_devices, i);
+      gint64 last_scan = nm_device_wifi_get_last_scan (device);
+
+      g_array_append_val (last_scans, last_scan);
+
+      for (j = 0; j < SCAN_CHURN; j++)
+        {
+          remove_other_access_point (fixture, i);
+          add_other_access_point (fixture, i);
+        }
+
+      nm_device_wifi_request_scan_async (device, NULL, NULL, NULL);
+    }
+  n_expected = fixture->wifi_devices->len * SCAN_CHURN * 2;
+
+  busy_timer_init (&timer);
+  busy_timer_start (&timer);
+
+  WAIT_FOR (fixture->n_ap_events == n_expected);
+  for (i = 0; i < fixture->wifi_devices->len; i++)
+    {
+      NMDeviceWifi *device = g_ptr_array_index (fixture->wifi_devices, i);
+
+      WAIT_FOR (nm_device_wifi_get_last_scan (device) != g_array_index (last_scans, gint64, i));
+    }
+
+  busy_timer_stop (&timer);
+  busy_timer_report (&timer, "Scan", n_expected);
+
+  assert_wifi_rows (fixture);
+}
+
+static void
+test_wifi_panel_connect (ScaleFixture  *fixture,
+                         gconstpointer  user_data)
+{
+  NMDevice *device = g_ptr_array_index (fixture->wifi_devices, 0);
+  NMRemoteConnection *connection = NULL;
+  const GPtrArray *connections;
+  BusyTimer timer;
+  guint i;
+
+  open_panel (fixture, cc_wifi_panel_get_type ());
+
+  connections = nm_client_get_connections (fixture->client);
+  for (i = 0; i < connections->len && !connection; i++)
+    {
+      if (g_strcmp0 (nm_connection_get_id (g_ptr_array_index (connections, i)), "saved-000") == 0)
+        connection = g_ptr_array_index (connections, i);
+    }
+  g_assert_nonnull (connection);
+
+  nm_client_activate_connection_async (fixture->client, NM_CONNECTION (connection), device,
+                                       NULL, NULL, NULL, NULL);
+
+  busy_timer_init (&timer);
+  busy_timer_start (&timer);
+
+  WAIT_FOR (nm_device_get_active_connection (device) != NULL);
+
+  busy_timer_stop (&timer);
+  busy_timer_report (&timer, "Connect", 1);
+
+  assert_wifi_rows (fixture);
+}
+
+static void
+test_wifi_panel_churn (ScaleFixture  *fixture,
+                       gconstpointer  user_data)
+{
+  BusyTimer timer;
+  guint n_expected;
+  guint iteration, i, j;
+
+  open_panel (fixture, cc_wifi_panel_get_type ());
+
+  n_expected = 0;
+  fixture->n_ap_events = 0;
+  busy_timer_init (&timer);
+
+  /* APs coming in and out of range while walking around */
+  for (iteration = 0; iteration < N_CHURN_ROUNDS; iteration++)
+    {
+      for (i = 0; i < fixture->wifi_devices->len; i++)
+        {
+          for (j = 0; j < CHURN_PER_ROUND; j++)
+            {
+              remove_other_access_point (fixture, i);
+              add_other_access_point (fixture, i);
+            }
+        }
+      n_expected += fixture->wifi_devices->len * CHURN_PER_ROUND * 2;
+
+      /* Leave out the D-Bus calls made by the test itself */
+      busy_timer_start (&timer);
+      WAIT_FOR (fixture->n_ap_events == n_expected);
+      busy_timer_stop (&timer);
+    }
+
+  busy_timer_report (&timer, "AP churn", n_expected);
+
+  assert_wifi_rows (fixture);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  g_setenv ("LIBNM_USE_SESSION_BUS", "1", TRUE);
+  g_setenv ("LC_ALL", "C", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+  adw_init ();
+
+  default_poll_func = g_main_context_get_poll_func (NULL);
+  g_main_context_set_poll_func (NULL, timed_poll_func);
+
+#ifndef NETWORK_SCALE_BENCHMARK
+  g_test_add ("/network-scale/small/network-panel-open", ScaleFixture, &small_scenario,
+              fixture_set_up, test_network_panel_open, fixture_tear_down);
+  g_test_add ("/network-scale/small/wifi-panel-scan", ScaleFixture, &small_scenario,
+              fixture_set_up, test_wifi_panel_scan, fixture_tear_down);
+  g_test_add ("/network-scale/small/wifi-panel-connect", ScaleFixture, &small_scenario,
+              fixture_set_up, test_wifi_panel_connect, fixture_tear_down);
+  g_test_add ("/network-scale/small/wifi-panel-churn", ScaleFixture, &small_scenario,
+              fixture_set_up, test_wifi_panel_churn, fixture_tear_down);
+#else
+  g_test_add ("/network-scale/large/network-panel-open", ScaleFixture, &large_scenario,
+              fixture_set_up, test_network_panel_open, fixture_tear_down);
+  g_test_add ("/network-scale/large/wifi-panel-scan", ScaleFixture, &large_scenario,
+              fixture_set_up, test_wifi_panel_scan, fixture_tear_down);
+  g_test_add ("/network-scale/large/wifi-panel-connect", ScaleFixture, &large_scenario,
+              fixture_set_up, test_wifi_panel_connect, fixture_tear_down);
+  g_test_add ("/network-scale/large/wifi-panel-churn", ScaleFixture, &large_scenario,
+              fixture_set_up, test_wifi_panel_churn, fixture_tear_down);
+#endif
+
+  return g_test_run ();
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "test-wifi-connection-index"
+
+#include "nm-macros-internal.h"
+
+#include <NetworkManager.h>
+#include <string.h>
+
+#include "nm-test-libnm-utils.h"
+
+#include "cc-wifi-connection-index.h"
+
+#include "nmtst-helpers.h"
+
+#define N_CONNECTIONS 500
+#define N_APS         200
+
+#define TIMEOUT_S     30
+
+typedef struct {
+  NMTstcServiceInfo *sinfo;
+  NMClient *client;
+  NMDeviceWifi *device;
+
+  CcWifiConnectionIndex *index;
+  GPtrArray *connections;
+} IndexFixture;
+
+static NMAccessPoint *
+add_access_point (IndexFixture *fixture,
+                  const gchar  *ssid)
+{
+  g_autoptr(GVariant) result = NULL;
+  g_autoptr(GError) error = NULL;
+  const GPtrArray *aps;
+  const gchar *path;
+  gint64 deadline;
+  guint i;
+
+  /* The fake service only has WPA/WPA2 PSK access points */
+  result = g_dbus_proxy_call_sync (fixture->sinfo->proxy,
+                                   "AddWifiAp",
+                                   g_variant_new ("(sss)", "wlan0", ssid, ""),
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                   3000,
+                                   NULL,
+                                   &error);
+  g_assert_no_error (error);
+  g_variant_get (result, "(&o)", &path);
+
+  deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+  while (TRUE)
+    {
+      aps = nm_device_wifi_get_access_points (fixture->device);
+      for (i = 0; i < aps->len; i++)
+        {
+          NMAccessPoint *ap = g_ptr_array_index (aps, i);
+
+          if (g_strcmp0 (nm_object_get_path (NM_OBJECT (ap)), path) == 0 &&
+              nm_access_point_get_ssid (ap) != NULL)
+            return ap;
+        }
+
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, TRUE);
+    }
+}
+
+static NMConnection *
+create_wifi_connection (const gchar *ssid,
+                        const gchar *key_mgmt)
+{
+  NMSettingWireless *s_wifi;
+  NMConnection *connection;
+
+  connection = nmtst_create_minimal_connection (ssid ? ssid : "hidden", NULL,
+                                                NM_SETTING_WIRELESS_SETTING_NAME, NULL);
+  s_wifi = nm_connection_get_setting_wireless (connection);
+  g_object_set (s_wifi, NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_INFRA, NULL);
+
+  if (ssid)
+    {
+      g_autoptr(GBytes) ssid_bytes = g_bytes_new (ssid, strlen (ssid));
+
+      g_object_set (s_wifi, NM_SETTING_WIRELESS_SSID, ssid_bytes, NULL);
+    }
+
+  if (key_mgmt)
+    {
+      NMSetting *s_wsec = nm_setting_wireless_security_new ();
+
+      g_object_set (s_wsec, NM_SETTING_WIRELESS_SECURITY_KEY_MGMT, key_mgmt, NULL);
+      nm_connection_add_setting (connection, s_wsec);
+    }
+
+  return connection;
+}
+
+static NMConnection *
+add_connection (IndexFixture *fixture,
+                const gchar  *ssid,
+                const gchar  *key_mgmt)
+{
+  NMConnection *connection = create_wifi_connection (ssid, key_mgmt);
+
+  g_ptr_array_add (fixture->connections, connection);
+  cc_wifi_connection_index_add (fixture->index, connection);
+
+  return connection;
+}
+
+static void
+set_ssid (NMConnection *connection,
+          const gchar  *ssid)
+{
+  g_autoptr(GBytes) ssid_bytes = g_bytes_new (ssid, strlen (ssid));
+
+  g_object_set (nm_connection_get_setting_wireless (connection),
+                NM_SETTING_WIRELESS_SSID, ssid_bytes,
+                NULL);
+}
+
+/* The index finds the same connections as libnm does */
+static void
+assert_lookup (IndexFixture  *fixture,
+               NMAccessPoint *ap)
+{
+  g_autoptr(GPtrArray) expected = NULL;
+  g_autoptr(GPtrArray) found = NULL;
+  guint i;
+
+  expected = nm_access_point_filter_connections (ap, fixture->connections);
+  found = cc_wifi_connection_index_lookup (fixture->index, ap);
+
+  g_assert_cmpuint (found->len, ==, expected->len);
+  for (i = 0; i < expected->len; i++)
+    g_assert_true (g_ptr_array_find (found, g_ptr_array_index (expected, i), NULL));
+}
+
+static void
+fixture_set_up (IndexFixture  *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  /* Bring up the libnm service. */
+  fixture->sinfo = nmtstc_service_init ();
+
+  fixture->client = nm_client_new (NULL, &error);
+  g_assert_no_error (error);
+
+  fixture->device = NM_DEVICE_WIFI (nmtstc_service_add_device (fixture->sinfo,
+                                                               fixture->client,
+                                                               "AddWifiDevice",
+                                                               "wlan0"));
+
+  fixture->index = cc_wifi_connection_index_new ();
+  fixture->connections = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+static void
+fixture_tear_down (IndexFixture  *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_pointer (&fixture->index, cc_wifi_connection_index_free);
+  g_clear_pointer (&fixture->connections, g_ptr_array_unref);
+  g_clear_object (&fixture->client);
+
+  g_clear_pointer (&fixture->sinfo, nmtstc_service_cleanup);
+}
+
+static void
+test_lookup (IndexFixture  *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GPtrArray) found = NULL;
+  NMConnection *corp_psk;
+  NMAccessPoint *corp;
+  NMAccessPoint *guest;
+
+  corp = add_access_point (fixture, "corp");
+  guest = add_access_point (fixture, "guest");
+
+  corp_psk = add_connection (fixture, "corp", "wpa-psk");
+  add_connection (fixture, "corp", NULL);
+  add_connection (fixture, "corp", "none");
+  add_connection (fixture, "corp", "wpa-eap");
+  add_connection (fixture, "corp", "sae");
+  add_connection (fixture, "corporate", "wpa-psk");
+  add_connection (fixture, "guest", NULL);
+  add_connection (fixture, NULL, "wpa-psk");
+
+  found = cc_wifi_connection_index_lookup (fixture->index, corp);
+  g_assert_cmpuint (found->len, ==, 1);
+  g_assert_true (g_ptr_array_index (found, 0) == corp_psk);
+
+  assert_lookup (fixture, corp);
+  assert_lookup (fixture, guest);
+}
+
+static void
+test_remove (IndexFixture  *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GPtrArray) found = NULL;
+  NMConnection *first;
+  NMConnection *second;
+  NMAccessPoint *ap;
+
+  ap = add_access_point (fixture, "home");
+  first = add_connection (fixture, "home", "wpa-psk");
+  second = add_connection (fixture, "home", "wpa-psk");
+
+  /* Adding twice does not duplicate it */
+  cc_wifi_connection_index_add (fixture->index, first);
+  assert_lookup (fixture, ap);
+
+  cc_wifi_connection_index_remove (fixture->index, first);
+  g_ptr_array_remove (fixture->connections, first);
+  assert_lookup (fixture, ap);
+
+  cc_wifi_connection_index_remove (fixture->index, second);
+  g_ptr_array_remove (fixture->connections, second);
+  found = cc_wifi_connection_index_lookup (fixture->index, ap);
+  g_assert_cmpuint (found->len, ==, 0);
+
+  /* Removing an unknown connection is harmless */
+  cc_wifi_connection_index_remove (fixture->index, second);
+}
+
+static void
+test_update (IndexFixture  *fixture,
+             gconstpointer  user_data)
+{
+  NMSettingWirelessSecurity *s_wsec;
+  NMConnection *connection;
+  NMAccessPoint *home;
+  NMAccessPoint *office;
+
+  home = add_access_point (fixture, "home");
+  office = add_access_point (fixture, "office");
+  connection = add_connection (fixture, "home", "wpa-psk");
+
+  /* Only SSID and security changes matter */
+  s_wsec = nm_connection_get_setting_wireless_security (connection);
+  g_object_set (s_wsec, NM_SETTING_WIRELESS_SECURITY_PSK, "password", NULL);
+  g_assert_false (cc_wifi_connection_index_update (fixture->index, connection));
+
+  set_ssid (connection, "office");
+  g_assert_true (cc_wifi_connection_index_update (fixture->index, connection));
+  g_assert_false (cc_wifi_connection_index_update (fixture->index, connection));
+  assert_lookup (fixture, home);
+  assert_lookup (fixture, office);
+
+  g_object_set (s_wsec, NM_SETTING_WIRELESS_SECURITY_KEY_MGMT, "wpa-eap", NULL);
+  g_assert_true (cc_wifi_connection_index_update (fixture->index, connection));
+  assert_lookup (fixture, office);
+
+  g_object_set (s_wsec, NM_SETTING_WIRELESS_SECURITY_KEY_MGMT, "wpa-psk", NULL);
+  g_assert_true (cc_wifi_connection_index_update (fixture->index, connection));
+  assert_lookup (fixture, office);
+
+  cc_wifi_connection_index_remove_all (fixture->index);
+  g_ptr_array_set_size (fixture->connections, 0);
+  assert_lookup (fixture, office);
+}
+
+static void
+test_scale (IndexFixture  *fixture,
+            gconstpointer  user_data)
+{
+  static const gchar * const key_mgmts[] = { "wpa-psk", "wpa-eap", NULL, "sae" };
+  g_autoptr(GPtrArray) aps = g_ptr_array_new ();
+  gint64 start, filter_time, index_time;
+  guint n_matches = 0;
+  guint i;
+
+  /* Many profiles for the same few campus SSIDs, and many BSSIDs */
+  for (i = 0; i < N_CONNECTIONS; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("net-%03u", i % (N_CONNECTIONS / 2));
+
+      add_connection (fixture, ssid, key_mgmts[i % G_N_ELEMENTS (key_mgmts)]);
+    }
+
+  for (i = 0; i < N_APS; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("net-%03u", i);
+
+      g_ptr_array_add (aps, add_access_point (fixture, ssid));
+    }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < aps->len; i++)
+    {
+      g_autoptr(GPtrArray) found = NULL;
+
+      found = nm_access_point_filter_connections (g_ptr_array_index (aps, i), fixture->connections);
+      n_matches += found->len;
+    }
+  filter_time = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < aps->len; i++)
+    {
+      g_autoptr(GPtrArray) found = NULL;
+
+      found = cc_wifi_connection_index_lookup (fixture->index, g_ptr_array_index (aps, i));
+      n_matches -= found->len;
+    }
+  index_time = g_get_monotonic_time () - start;
+
+  g_assert_cmpuint (n_matches, ==, 0);
+
+  for (i = 0; i < aps->len; i++)
+    assert_lookup (fixture, g_ptr_array_index (aps, i));
+
+  g_test_minimized_result (index_time / 1000.0,
+                           "Matching %u APs against %u connections took %.2f ms, %.2f ms without the index",
+                           N_APS, N_CONNECTIONS, index_time / 1000.0, filter_time / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_setenv ("LIBNM_USE_SESSION_BUS", "1", TRUE);
+  g_setenv ("LC_ALL", "C", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/wifi-connection-index/lookup",
+              IndexFixture,
+              NULL,
+              fixture_set_up,
+              test_lookup,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-index/remove",
+              IndexFixture,
+              NULL,
+              fixture_set_up,
+              test_remove,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-index/update",
+              IndexFixture,
+              NULL,
+              fixture_set_up,
+              test_update,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-index/scale",
+              IndexFixture,
+              NULL,
+              fixture_set_up,
+              test_scale,
+              fixture_tear_down);
+
+  return g_test_run ();
+}
@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2024 GNOME Settings contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "test-wifi-connection-list"
+
+#include "nm-macros-internal.h"
+
+#include <NetworkManager.h>
+#include <gtk/gtk.h>
+#include <adwaita.h>
+#include <string.h>
+
+#include "nm-test-libnm-utils.h"
+
+#include "cc-wifi-connection-list.h"
+#include "cc-wifi-connection-row.h"
+
+#include "nmtst-helpers.h"
+
+/* Saved connections, the first N_SAVED_APS of them are in range */
+#define N_CONNECTIONS 400
+#define N_SAVED_APS   100
+/* Networks in range which were never connected to */
+#define N_OTHER_APS   100
+
+#define TIMEOUT_S     30
+
+typedef struct {
+  NMTstcServiceInfo *sinfo;
+  NMClient *client;
+  NMDeviceWifi *device;
+
+  CcWifiConnectionList *list;
+  guint n_added;
+  guint n_removed;
+
+  gint64 update_start;
+  gint64 update_time;
+} WifiListFixture;
+
+static void
+wait_for_count (guint  (*get_count) (WifiListFixture *fixture),
+                WifiListFixture *fixture,
+                guint            count)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+
+  while (get_count (fixture) != count)
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+      g_main_context_iteration (NULL, FALSE);
+    }
+}
+
+static guint
+get_n_connections (WifiListFixture *fixture)
+{
+  return nm_client_get_connections (fixture->client)->len;
+}
+
+static guint
+get_n_access_points (WifiListFixture *fixture)
+{
+  return nm_device_wifi_get_access_points (fixture->device)->len;
+}
+
+static guint
+get_n_updates (WifiListFixture *fixture)
+{
+  return fixture->n_added + fixture->n_removed;
+}
+
+static NMConnection *
+create_wifi_connection (const gchar *ssid)
+{
+  g_autoptr(GBytes) ssid_bytes = NULL;
+  NMSettingWirelessSecurity *s_sec;
+  NMConnection *connection;
+
+  connection = nmtst_create_minimal_connection (ssid, NULL, NM_SETTING_WIRELESS_SETTING_NAME, NULL);
+
+  ssid_bytes = g_bytes_new (ssid, strlen (ssid));
+  g_object_set (nm_connection_get_setting_wireless (connection),
+                NM_SETTING_WIRELESS_SSID, ssid_bytes,
+                NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_INFRA,
+                NULL);
+
+  s_sec = NM_SETTING_WIRELESS_SECURITY (nm_setting_wireless_security_new ());
+  g_object_set (s_sec,
+                NM_SETTING_WIRELESS_SECURITY_KEY_MGMT, "wpa-psk",
+                NM_SETTING_WIRELESS_SECURITY_PSK, "password",
+                NULL);
+  nm_connection_add_setting (connection, NM_SETTING (s_sec));
+
+  return connection;
+}
+
+static void
+add_access_point (WifiListFixture *fixture,
+                  const gchar     *ssid)
+{
+  g_autoptr(GVariant) result = NULL;
+  g_autoptr(GError) error = NULL;
+
+  /* An empty MAC address makes the service pick a random one */
+  result = g_dbus_proxy_call_sync (fixture->sinfo->proxy,
+                                   "AddWifiAp",
+                                   g_variant_new ("(sss)", "wlan0", ssid, ""),
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                   3000,
+                                   NULL,
+                                   &error);
+  g_assert_no_error (error);
+}
+
+static void
+on_add_row_cb (WifiListFixture *fixture)
+{
+  fixture->n_added++;
+}
+
+static void
+on_remove_row_cb (WifiListFixture *fixture)
+{
+  fixture->n_removed++;
+}
+
+static void
+on_connection_changed_cb (WifiListFixture *fixture)
+{
+  fixture->update_start = g_get_monotonic_time ();
+}
+
+static void
+on_connection_changed_after_cb (WifiListFixture *fixture)
+{
+  fixture->update_time = g_get_monotonic_time () - fixture->update_start;
+}
+
+static void
+fixture_set_up (WifiListFixture *fixture,
+                gconstpointer    user_data)
+{
+  g_autoptr(GError) error = NULL;
+  gint64 start;
+  guint i;
+
+  /* Bring up the libnm service. */
+  fixture->sinfo = nmtstc_service_init ();
+
+  fixture->client = nm_client_new (NULL, &error);
+  g_assert_no_error (error);
+
+  fixture->device = NM_DEVICE_WIFI (nmtstc_service_add_device (fixture->sinfo,
+                                                               fixture->client,
+                                                               "AddWifiDevice",
+                                                               "wlan0"));
+
+  for (i = 0; i < N_CONNECTIONS; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("saved-%03u", i);
+      g_autoptr(NMConnection) connection = create_wifi_connection (ssid);
+
+      nmtstc_service_add_connection (fixture->sinfo, connection, TRUE, NULL);
+    }
+
+  for (i = 0; i < N_SAVED_APS; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("saved-%03u", i);
+      add_access_point (fixture, ssid);
+    }
+
+  for (i = 0; i < N_OTHER_APS; i++)
+    {
+      g_autofree gchar *ssid = g_strdup_printf ("other-%03u", i);
+      add_access_point (fixture, ssid);
+    }
+
+  wait_for_count (get_n_connections, fixture, N_CONNECTIONS);
+  wait_for_count (get_n_access_points, fixture, N_SAVED_APS + N_OTHER_APS);
+
+  /* Connected before and after the handlers of the list to time them */
+  g_signal_connect_swapped (fixture->client, "connection-added",
+                            G_CALLBACK (on_connection_changed_cb), fixture);
+  g_signal_connect_swapped (fixture->client, "connection-removed",
+                            G_CALLBACK (on_connection_changed_cb), fixture);
+
+  start = g_get_monotonic_time ();
+  fixture->list = cc_wifi_connection_list_new (fixture->client, fixture->device,
+                                               FALSE, TRUE, FALSE, TRUE);
+  g_object_ref_sink (fixture->list);
+
+  g_test_minimized_result ((g_get_monotonic_time () - start) / 1000.0,
+                           "Populating the list with %u connections and %u APs took %.1f ms",
+                           N_CONNECTIONS, N_SAVED_APS + N_OTHER_APS,
+                           (g_get_monotonic_time () - start) / 1000.0);
+
+  g_signal_connect_swapped (fixture->list, "add-row", G_CALLBACK (on_add_row_cb), fixture);
+  g_signal_connect_swapped (fixture->list, "remove-row", G_CALLBACK (on_remove_row_cb), fixture);
+
+  g_signal_connect_data (fixture->client, "connection-added",
+                         G_CALLBACK (on_connection_changed_after_cb), fixture,
+                         NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+  g_signal_connect_data (fixture->client, "connection-removed",
+                         G_CALLBACK (on_connection_changed_after_cb), fixture,
+                         NULL, G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+}
+
+static void
+fixture_tear_down (WifiListFixture *fixture,
+                   gconstpointer    user_data)
+{
+  g_signal_handlers_disconnect_by_data (fixture->client, fixture);
+
+  g_clear_object (&fixture->list);
+  g_clear_object (&fixture->client);
+
+  g_clear_pointer (&fixture->sinfo, nmtstc_service_cleanup);
+}
+
+static GHashTable *
+get_rows (WifiListFixture *fixture)
+{
+  GHashTable *rows = g_hash_table_new (NULL, NULL);
+  GtkWidget *child;
+
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (cc_wifi_connection_list_get_list_box (fixture->list)));
+       child;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (CC_IS_WIFI_CONNECTION_ROW (child))
+        g_hash_table_add (rows, child);
+    }
+
+  return rows;
+}
+
+static CcWifiConnectionRow *
+find_row (GHashTable  *rows,
+          const gchar *ssid)
+{
+  GHashTableIter iter;
+  CcWifiConnectionRow *row;
+
+  g_hash_table_iter_init (&iter, rows);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &row, NULL))
+    {
+      NMConnection *connection = cc_wifi_connection_row_get_connection (row);
+
+      if (connection && g_strcmp0 (nm_connection_get_id (connection), ssid) == 0)
+        return row;
+    }
+
+  return NULL;
+}
+
+/* Every row of @before is still there except for @removed */
+static void
+assert_rows_kept (GHashTable *before,
+                  GHashTable *after,
+                  guint       removed)
+{
+  GHashTableIter iter;
+  gpointer row;
+  guint n_gone = 0;
+
+  g_hash_table_iter_init (&iter, before);
+  while (g_hash_table_iter_next (&iter, &row, NULL))
+    {
+      if (!g_hash_table_contains (after, row))
+        n_gone++;
+    }
+
+  g_assert_cmpuint (n_gone, ==, removed);
+}
+
+static void
+test_populate (WifiListFixture *fixture,
+               gconstpointer    user_data)
+{
+  g_autoptr(GHashTable) rows = get_rows (fixture);
+  CcWifiConnectionRow *row;
+
+  /* One row per connection, and one per unknown SSID */
+  g_assert_cmpuint (g_hash_table_size (rows), ==, N_CONNECTIONS + N_OTHER_APS);
+
+  row = find_row (rows, "saved-000");
+  g_assert_nonnull (row);
+  g_assert_cmpuint (cc_wifi_connection_row_get_access_points (row)->len, ==, 1);
+
+  row = find_row (rows, "saved-399");
+  g_assert_nonnull (row);
+  g_assert_cmpuint (cc_wifi_connection_row_get_access_points (row)->len, ==, 0);
+}
+
+static void
+test_connection_add (WifiListFixture *fixture,
+                     gconstpointer    user_data)
+{
+  g_autoptr(NMConnection) connection = NULL;
+  g_autoptr(GHashTable) before = get_rows (fixture);
+  g_autoptr(GHashTable) after = NULL;
+  CcWifiConnectionRow *row;
+
+  /* Saving a network in range replaces its SSID row */
+  connection = create_wifi_connection ("other-000");
+  nmtstc_service_add_connection (fixture->sinfo, connection, TRUE, NULL);
+
+  wait_for_count (get_n_updates, fixture, 2);
+
+  g_test_minimized_result (fixture->update_time / 1000.0,
+                           "Adding a connection took %.3f ms",
+                           fixture->update_time / 1000.0);
+
+  g_assert_cmpuint (fixture->n_added, ==, 1);
+  g_assert_cmpuint (fixture->n_removed, ==, 1);
+
+  after = get_rows (fixture);
+  g_assert_cmpuint (g_hash_table_size (after), ==, N_CONNECTIONS + N_OTHER_APS);
+  assert_rows_kept (before, after, 1);
+
+  row = find_row (after, "other-000");
+  g_assert_nonnull (row);
+  g_assert_false (g_hash_table_contains (before, row));
+  g_assert_cmpuint (cc_wifi_connection_row_get_access_points (row)->len, ==, 1);
+}
+
+static void
+delete_cb (GObject      *object,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  nm_remote_connection_delete_finish (NM_REMOTE_CONNECTION (object), result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_connection_remove (WifiListFixture *fixture,
+                        gconstpointer    user_data)
+{
+  g_autoptr(GHashTable) before = get_rows (fixture);
+  g_autoptr(GHashTable) after = NULL;
+  NMRemoteConnection *connection;
+  CcWifiConnectionRow *removed;
+
+  removed = find_row (before, "saved-000");
+  connection = NM_REMOTE_CONNECTION (cc_wifi_connection_row_get_connection (removed));
+
+  /* The AP of the forgotten network goes back to an SSID row */
+  nm_remote_connection_delete_async (connection, NULL, delete_cb, NULL);
+
+  wait_for_count (get_n_updates, fixture, 2);
+
+  g_test_minimized_result (fixture->update_time / 1000.0,
+                           "Removing a connection took %.3f ms",
+                           fixture->update_time / 1000.0);
+
+  g_assert_cmpuint (fixture->n_added, ==, 1);
+  g_assert_cmpuint (fixture->n_removed, ==, 1);
+
+  after = get_rows (fixture);
+  g_assert_cmpuint (g_hash_table_size (after), ==, N_CONNECTIONS + N_OTHER_APS);
+  assert_rows_kept (before, after, 1);
+  g_assert_false (g_hash_table_contains (after, removed));
+  g_assert_null (find_row (after, "saved-000"));
+}
+
+static void
+test_connection_remove_unavailable (WifiListFixture *fixture,
+                                    gconstpointer    user_data)
+{
+  g_autoptr(GHashTable) before = get_rows (fixture);
+  g_autoptr(GHashTable) after = NULL;
+  NMRemoteConnection *connection;
+  CcWifiConnectionRow *removed;
+
+  /* Nothing else changes for a network which is not in range */
+  removed = find_row (before, "saved-399");
+  connection = NM_REMOTE_CONNECTION (cc_wifi_connection_row_get_connection (removed));
+
+  nm_remote_connection_delete_async (connection, NULL, delete_cb, NULL);
+
+  wait_for_count (get_n_updates, fixture, 1);
+  wait_for_count (get_n_connections, fixture, N_CONNECTIONS - 1);
+
+  g_assert_cmpuint (fixture->n_added, ==, 0);
+  g_assert_cmpuint (fixture->n_removed, ==, 1);
+
+  after = get_rows (fixture);
+  g_assert_cmpuint (g_hash_table_size (after), ==, N_CONNECTIONS + N_OTHER_APS - 1);
+  assert_rows_kept (before, after, 1);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  g_setenv ("LIBNM_USE_SESSION_BUS", "1", TRUE);
+  g_setenv ("LC_ALL", "C", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+  adw_init ();
+
+  g_test_add ("/wifi-connection-list/populate",
+              WifiListFixture,
+              NULL,
+              fixture_set_up,
+              test_populate,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-list/connection-add",
+              WifiListFixture,
+              NULL,
+              fixture_set_up,
+              test_connection_add,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-list/connection-remove",
+              WifiListFixture,
+              NULL,
+              fixture_set_up,
+              test_connection_remove,
+              fixture_tear_down);
+
+  g_test_add ("/wifi-connection-list/connection-remove-unavailable",
+              WifiListFixture,
+              NULL,
+              fixture_set_up,
+              test_connection_remove_unavailable,
+              fixture_tear_down);
+
+  return g_test_run ();
+}
@@ -63,6 +63,114 @@ test_escape_qr_string (void)
   g_free (str);
 }
 
+static void
+test_qr_code_modules (void)
+{
+  uint8_t qr_code[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+  uint8_t temp_buf[qrcodegen_BUFFER_LEN_FOR_VERSION (qrcodegen_VERSION_MAX)];
+  g_autoptr(GdkTexture) texture = NULL;
+  g_autofree guchar *pixels = NULL;
+  gint qr_size, x, y;
+
+  g_assert_true (qrcodegen_encodeText ("WIFI:S:test;T:WPA;P:password;;",
+                                       temp_buf, qr_code,
+                                       qrcodegen_Ecc_LOW,
+                                       qrcodegen_VERSION_MIN,
+                                       qrcodegen_VERSION_MAX,
+                                       qrcodegen_Mask_AUTO,
+                                       FALSE));
+  qr_size = qrcodegen_getSize (qr_code);
+
+  texture = render_modules (qr_code);
+  g_assert_cmpint (gdk_texture_get_width (texture), ==, qr_size);
+  g_assert_cmpint (gdk_texture_get_height (texture), ==, qr_size);
+
+  pixels = g_malloc (qr_size * qr_size * 4);
+  gdk_texture_download (texture, pixels, qr_size * 4);
+
+  /* Downloads are B8G8R8A8 on little endian, all channels match anyway */
+  for (y = 0; y < qr_size; y++)
+    for (x = 0; x < qr_size; x++)
+      {
+        guchar value = pixels[(y * qr_size + x) * 4];
+
+        g_assert_cmpuint (value, ==, qrcodegen_getModule (qr_code, x, y) ? 0x00 : 0xff);
+      }
+}
+
+static void
+test_qr_code_paintable (void)
+{
+  g_autoptr(CcQrCode) qr_code = cc_qr_code_new ();
+  g_autoptr(CcQrCode) other = cc_qr_code_new ();
+  GdkPaintable *paintable;
+  gint qr_size, size;
+
+  cc_qr_code_set_text (qr_code, "WIFI:S:paintable;;");
+  paintable = cc_qr_code_get_paintable (qr_code, 200);
+  g_assert_nonnull (paintable);
+
+  /* Whole pixels per module, never larger than asked for */
+  qr_size = gdk_texture_get_width (qr_code->texture);
+  size = gdk_paintable_get_intrinsic_width (paintable);
+  g_assert_cmpint (size % qr_size, ==, 0);
+  g_assert_cmpint (size, <=, 200);
+  g_assert_cmpint (size, >, 200 - qr_size);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (paintable), ==, size);
+
+  g_assert_true (cc_qr_code_get_paintable (qr_code, 200) == paintable);
+
+  /* The same payload in another dialog isn't encoded again */
+  cc_qr_code_set_text (other, "WIFI:S:paintable;;");
+  cc_qr_code_get_paintable (other, 400);
+  g_assert_true (other->texture == qr_code->texture);
+
+  /* A new payload is */
+  cc_qr_code_set_text (qr_code, "WIFI:S:other;;");
+  paintable = cc_qr_code_get_paintable (qr_code, 200);
+  g_assert_nonnull (paintable);
+  g_assert_true (other->texture != qr_code->texture);
+}
+
+static void
+test_qr_code_benchmark (void)
+{
+  g_autoptr(GString) text = g_string_new (NULL);
+  g_autoptr(GTimer) timer = g_timer_new ();
+  gdouble uncached = G_MAXDOUBLE, cached = G_MAXDOUBLE;
+  guint i;
+
+  /* Close to the capacity of a version 40 code */
+  while (text->len < 2900)
+    g_string_append (text, "0123456789abcdef");
+
+  for (i = 0; i < 5; i++)
+    {
+      g_autoptr(GdkTexture) texture = NULL;
+
+      g_timer_start (timer);
+      texture = encode_text (text->str);
+      uncached = MIN (uncached, g_timer_elapsed (timer, NULL));
+
+      g_assert_nonnull (texture);
+      g_assert_cmpint (gdk_texture_get_width (texture), ==, 177);
+    }
+
+  for (i = 0; i < 5; i++)
+    {
+      g_autoptr(CcQrCode) qr_code = cc_qr_code_new ();
+
+      cc_qr_code_set_text (qr_code, text->str);
+
+      g_timer_start (timer);
+      g_assert_nonnull (cc_qr_code_get_paintable (qr_code, 2 * 177));
+      cached = MIN (cached, g_timer_elapsed (timer, NULL));
+    }
+
+  g_test_minimized_result (uncached, "Encoding a version 40 code: %.3f ms", uncached * 1000);
+  g_test_minimized_result (cached, "Showing it again: %.3f ms", cached * 1000);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -70,6 +178,9 @@ main (int   argc,
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/wifi/escape-qr-string", test_escape_qr_string);
+  g_test_add_func ("/wifi/qr-code/modules", test_qr_code_modules);
+  g_test_add_func ("/wifi/qr-code/paintable", test_qr_code_paintable);
+  g_test_add_func ("/wifi/qr-code/benchmark", test_qr_code_benchmark);
 
   return g_test_run ();
 }
@@ -0,0 +1,281 @@
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "pp-host.h"
+
+typedef enum
+{
+  LISTENER_ACCEPT,
+  LISTENER_LPD,
+  LISTENER_SILENT
+} ListenerMode;
+
+typedef struct
+{
+  GSocketService *service;
+  ListenerMode    mode;
+  guint16         port;
+
+  GPtrArray      *devices;
+  GError         *error;
+  gboolean        done;
+} Fixture;
+
+static gboolean
+listener_run_cb (GThreadedSocketService *service,
+                 GSocketConnection      *connection,
+                 GObject                *source_object,
+                 gpointer                user_data)
+{
+  Fixture      *fixture = user_data;
+  GInputStream *input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  gchar         buffer[256];
+  gssize        length;
+
+  switch (fixture->mode)
+    {
+      case LISTENER_ACCEPT:
+        break;
+
+      case LISTENER_LPD:
+        /* Acknowledge every "receive a printer job" command */
+        length = g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL);
+        if (length > 0 && buffer[0] == '\2')
+          g_output_stream_write (g_io_stream_get_output_stream (G_IO_STREAM (connection)),
+                                 "", 1, NULL, NULL);
+        break;
+
+      case LISTENER_SILENT:
+        /* Never answer, wait for the client to give up */
+        while (g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL) > 0)
+          ;
+        break;
+    }
+
+  return TRUE;
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GInetAddress)   loopback = NULL;
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(GSocketAddress) effective_address = NULL;
+  g_autoptr(GError)         error = NULL;
+
+  fixture->mode = GPOINTER_TO_INT (user_data);
+  fixture->service = g_threaded_socket_service_new (4);
+  g_signal_connect (fixture->service, "run", G_CALLBACK (listener_run_cb), fixture);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+  g_socket_listener_add_address (G_SOCKET_LISTENER (fixture->service),
+                                 address,
+                                 G_SOCKET_TYPE_STREAM,
+                                 G_SOCKET_PROTOCOL_TCP,
+                                 NULL,
+                                 &effective_address,
+                                 &error);
+  g_assert_no_error (error);
+
+  fixture->port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective_address));
+  fixture->devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_socket_service_start (fixture->service);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_socket_service_stop (fixture->service);
+  g_socket_listener_close (G_SOCKET_LISTENER (fixture->service));
+  g_clear_object (&fixture->service);
+  g_clear_pointer (&fixture->devices, g_ptr_array_unref);
+  g_clear_error (&fixture->error);
+}
+
+static void
+devices_found_cb (GPtrArray *devices,
+                  gpointer   user_data)
+{
+  Fixture *fixture = user_data;
+  guint    i;
+
+  for (i = 0; i < devices->len; i++)
+    g_ptr_array_add (fixture->devices, g_object_ref (g_ptr_array_index (devices, i)));
+}
+
+static void
+get_devices_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  Fixture *fixture = user_data;
+
+  pp_host_get_devices_finish (PP_HOST (source_object), result, &fixture->error);
+  fixture->done = TRUE;
+}
+
+static void
+scan_network_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  Fixture *fixture = user_data;
+
+  pp_host_scan_network_finish (result, &fixture->error);
+  fixture->done = TRUE;
+}
+
+static void
+get_devices (Fixture      *fixture,
+             PpHostProbes  probes,
+             guint         timeout)
+{
+  g_autoptr(PpHost) host = NULL;
+
+  host = pp_host_new ("127.0.0.1");
+  g_object_set (host, "port", fixture->port, NULL);
+
+  pp_host_get_devices_async (host, probes, timeout, NULL,
+                             devices_found_cb, fixture,
+                             get_devices_cb, fixture);
+
+  while (!fixture->done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_jetdirect (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autofree gchar *expected_uri = NULL;
+  g_autofree gchar *device_uri = NULL;
+
+  get_devices (fixture, PP_HOST_PROBE_JETDIRECT, 5000);
+
+  g_assert_no_error (fixture->error);
+  g_assert_cmpuint (fixture->devices->len, ==, 1);
+
+  expected_uri = g_strdup_printf ("socket://127.0.0.1:%u", fixture->port);
+  g_object_get (g_ptr_array_index (fixture->devices, 0), "device-uri", &device_uri, NULL);
+  g_assert_cmpstr (device_uri, ==, expected_uri);
+}
+
+static void
+test_lpd (Fixture       *fixture,
+          gconstpointer  user_data)
+{
+  g_autofree gchar *expected_uri = NULL;
+  g_autofree gchar *device_uri = NULL;
+
+  get_devices (fixture, PP_HOST_PROBE_LPD, 5000);
+
+  g_assert_no_error (fixture->error);
+  g_assert_cmpuint (fixture->devices->len, ==, 1);
+
+  expected_uri = g_strdup_printf ("lpd://127.0.0.1:%u/PASSTHRU", fixture->port);
+  g_object_get (g_ptr_array_index (fixture->devices, 0), "device-uri", &device_uri, NULL);
+  g_assert_cmpstr (device_uri, ==, expected_uri);
+}
+
+static void
+test_deadline (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  gint64 start;
+
+  /* The JetDirect probe answers right away, the LPD one never does */
+  start = g_get_monotonic_time ();
+  get_devices (fixture, PP_HOST_PROBE_JETDIRECT | PP_HOST_PROBE_LPD, 300);
+
+  g_assert_no_error (fixture->error);
+  g_assert_cmpuint (fixture->devices->len, ==, 1);
+  g_assert_cmpint (g_get_monotonic_time () - start, <, G_USEC_PER_SEC);
+}
+
+static void
+test_cancel (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(PpHost)       host = NULL;
+
+  host = pp_host_new ("127.0.0.1");
+  g_object_set (host, "port", fixture->port, NULL);
+
+  cancellable = g_cancellable_new ();
+  pp_host_get_devices_async (host, PP_HOST_PROBE_LPD, 0, cancellable,
+                             devices_found_cb, fixture,
+                             get_devices_cb, fixture);
+
+  g_cancellable_cancel (cancellable);
+
+  while (!fixture->done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (fixture->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpuint (fixture->devices->len, ==, 0);
+}
+
+static void
+test_scan_network (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  /* Only 127.0.0.1 of 127.0.0.1 - 127.0.0.6 listens */
+  pp_host_scan_network_async ("127.0.0.0/29", fixture->port,
+                              PP_HOST_PROBE_JETDIRECT, 2, 2000, NULL,
+                              devices_found_cb, fixture,
+                              scan_network_cb, fixture);
+
+  while (!fixture->done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_no_error (fixture->error);
+  g_assert_cmpuint (fixture->devices->len, ==, 1);
+}
+
+static void
+test_scan_network_invalid (void)
+{
+  g_autoptr(GError) error = NULL;
+  Fixture           fixture = { 0, };
+
+  fixture.devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  pp_host_scan_network_async ("10.0.0.0/8", PP_HOST_UNSET_PORT,
+                              PP_HOST_PROBE_JETDIRECT, 2, 2000, NULL,
+                              devices_found_cb, &fixture,
+                              scan_network_cb, &fixture);
+
+  while (!fixture.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (fixture.error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+
+  g_clear_error (&fixture.error);
+  g_ptr_array_unref (fixture.devices);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/printers/host/jetdirect", Fixture, GINT_TO_POINTER (LISTENER_ACCEPT),
+              fixture_set_up, test_jetdirect, fixture_tear_down);
+  g_test_add ("/printers/host/lpd", Fixture, GINT_TO_POINTER (LISTENER_LPD),
+              fixture_set_up, test_lpd, fixture_tear_down);
+  g_test_add ("/printers/host/deadline", Fixture, GINT_TO_POINTER (LISTENER_SILENT),
+              fixture_set_up, test_deadline, fixture_tear_down);
+  g_test_add ("/printers/host/cancel", Fixture, GINT_TO_POINTER (LISTENER_SILENT),
+              fixture_set_up, test_cancel, fixture_tear_down);
+  g_test_add ("/printers/host/scan-network", Fixture, GINT_TO_POINTER (LISTENER_ACCEPT),
+              fixture_set_up, test_scan_network, fixture_tear_down);
+  g_test_add_func ("/printers/host/scan-network-invalid", test_scan_network_invalid);
+
+  return g_test_run ();
+}
@@ -0,0 +1,239 @@
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "pp-ipp-pool.h"
+
+#define N_JOBS 64
+
+static GMutex lock;
+static GCond  cond;
+
+typedef struct
+{
+  gboolean open;
+} Gate;
+
+static gint     running;
+static gint     max_running;
+static gint     finished;
+static gint     blocked;
+static GString *order;
+
+static void
+wait_for (gint *counter,
+          gint  value)
+{
+  g_mutex_lock (&lock);
+  while (*counter < value)
+    g_cond_wait (&cond, &lock);
+  g_mutex_unlock (&lock);
+}
+
+static void
+open_gate (Gate *gate)
+{
+  g_mutex_lock (&lock);
+  gate->open = TRUE;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static void
+blocking_job (gpointer data,
+              gpointer user_data)
+{
+  Gate *gate = data;
+
+  g_mutex_lock (&lock);
+  blocked++;
+  g_cond_broadcast (&cond);
+  while (!gate->open)
+    g_cond_wait (&cond, &lock);
+  finished++;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+}
+
+/* Occupies all workers until the gates get opened */
+static void
+block_workers (Gate *gates)
+{
+  gint i;
+
+  blocked = 0;
+  for (i = 0; i < PP_IPP_POOL_MAX_WORKERS; i++)
+    {
+      gates[i].open = FALSE;
+      pp_ipp_pool_push (blocking_job, &gates[i], PP_IPP_PRIORITY_HIGH);
+    }
+
+  wait_for (&blocked, PP_IPP_POOL_MAX_WORKERS);
+}
+
+static void
+counting_job (gpointer data,
+              gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  running++;
+  max_running = MAX (max_running, running);
+  g_mutex_unlock (&lock);
+
+  g_usleep (1000);
+
+  g_mutex_lock (&lock);
+  running--;
+  finished++;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static void
+test_bounded (void)
+{
+  PpIppPoolStats stats;
+  gint           i;
+
+  pp_ipp_pool_reset_stats ();
+  finished = 0;
+  max_running = 0;
+
+  for (i = 0; i < N_JOBS; i++)
+    pp_ipp_pool_push (counting_job, NULL, PP_IPP_PRIORITY_NORMAL);
+
+  wait_for (&finished, N_JOBS);
+
+  g_assert_cmpint (max_running, <=, PP_IPP_POOL_MAX_WORKERS);
+  g_assert_cmpint (max_running, >, 1);
+
+  /* The counters are updated after the job returns */
+  do
+    pp_ipp_pool_get_stats (&stats);
+  while (stats.running > 0);
+
+  g_assert_cmpuint (stats.queued, ==, 0);
+  g_assert_cmpuint (stats.completed, ==, N_JOBS);
+  g_assert_cmpuint (stats.cancelled, ==, 0);
+  g_assert_cmpint (stats.total_run_time, >=, N_JOBS * 1000);
+  g_assert_cmpint (stats.max_wait_time, >, 0);
+}
+
+static void
+ordered_job (gpointer data,
+             gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  g_string_append (order, data);
+  finished++;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static void
+test_priority (void)
+{
+  Gate           gates[PP_IPP_POOL_MAX_WORKERS];
+  PpIppPoolStats stats;
+  gint           i;
+
+  order = g_string_new (NULL);
+  finished = 0;
+
+  block_workers (gates);
+
+  pp_ipp_pool_push (ordered_job, "l", PP_IPP_PRIORITY_LOW);
+  pp_ipp_pool_push (ordered_job, "n", PP_IPP_PRIORITY_NORMAL);
+  pp_ipp_pool_push (ordered_job, "h", PP_IPP_PRIORITY_HIGH);
+  pp_ipp_pool_push (ordered_job, "N", PP_IPP_PRIORITY_NORMAL);
+  pp_ipp_pool_push (ordered_job, "H", PP_IPP_PRIORITY_HIGH);
+
+  pp_ipp_pool_get_stats (&stats);
+  g_assert_cmpuint (stats.queued, ==, 5);
+  g_assert_cmpuint (stats.running, ==, PP_IPP_POOL_MAX_WORKERS);
+
+  /* A single free worker processes the queue in order */
+  open_gate (&gates[0]);
+  wait_for (&finished, 6);
+  g_assert_cmpstr (order->str, ==, "hHnNl");
+
+  for (i = 1; i < PP_IPP_POOL_MAX_WORKERS; i++)
+    open_gate (&gates[i]);
+  wait_for (&finished, 5 + PP_IPP_POOL_MAX_WORKERS);
+
+  g_string_free (order, TRUE);
+}
+
+static gboolean task_ran;
+
+static void
+task_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  task_ran = TRUE;
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+task_cb (GObject      *source_object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+  GError **error = user_data;
+
+  g_assert_false (g_task_propagate_boolean (G_TASK (result), error));
+}
+
+static void
+test_cancel (void)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GTask)        task = NULL;
+  g_autoptr(GError)       error = NULL;
+  Gate                    gates[PP_IPP_POOL_MAX_WORKERS];
+  PpIppPoolStats          stats;
+  gint                    i;
+
+  finished = 0;
+  task_ran = FALSE;
+
+  block_workers (gates);
+  pp_ipp_pool_reset_stats ();
+
+  cancellable = g_cancellable_new ();
+  task = g_task_new (NULL, cancellable, task_cb, &error);
+  pp_ipp_pool_run_task (task, PP_IPP_PRIORITY_NORMAL, task_thread);
+  g_clear_object (&task);
+
+  g_cancellable_cancel (cancellable);
+
+  for (i = 0; i < PP_IPP_POOL_MAX_WORKERS; i++)
+    open_gate (&gates[i]);
+
+  while (error == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_false (task_ran);
+
+  wait_for (&finished, PP_IPP_POOL_MAX_WORKERS);
+  do
+    pp_ipp_pool_get_stats (&stats);
+  while (stats.running > 0);
+
+  g_assert_cmpuint (stats.cancelled, ==, 1);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/ipp-pool/bounded", test_bounded);
+  g_test_add_func ("/printers/ipp-pool/priority", test_priority);
+  g_test_add_func ("/printers/ipp-pool/cancel", test_cancel);
+
+  return g_test_run ();
+}
@@ -0,0 +1,242 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <utime.h>
+
+#include "pp-ppd-cache.h"
+
+#define N_MANUFACTURERS 120
+#define N_PPDS_PER_MANUFACTURER 250
+
+typedef struct
+{
+  gchar *tmpdir;
+  gchar *cache_path;
+} Fixture;
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  fixture->tmpdir = g_dir_make_tmp ("test-ppd-cache-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->cache_path = g_build_filename (fixture->tmpdir, "cache", "ppds", NULL);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_autofree gchar *cache_dir = g_path_get_dirname (fixture->cache_path);
+
+  g_unlink (fixture->cache_path);
+  g_rmdir (cache_dir);
+  g_rmdir (fixture->tmpdir);
+
+  g_free (fixture->cache_path);
+  g_free (fixture->tmpdir);
+}
+
+/*
+ * Generates a catalogue of the size of a system with
+ * foomatic and gutenprint installed.
+ */
+static PPDList *
+generate_ppd_list (void)
+{
+  PPDList *list;
+  gint     i, j;
+
+  list = g_new0 (PPDList, 1);
+  list->num_of_manufacturers = N_MANUFACTURERS;
+  list->manufacturers = g_new0 (PPDManufacturerItem *, N_MANUFACTURERS);
+
+  for (i = 0; i < N_MANUFACTURERS; i++)
+    {
+      PPDManufacturerItem *item = g_new0 (PPDManufacturerItem, 1);
+
+      item->manufacturer_name = g_strdup_printf ("vendor %03d", i);
+      item->manufacturer_display_name = g_strdup_printf ("Vendor %03d", i);
+      item->num_of_ppds = N_PPDS_PER_MANUFACTURER;
+      item->ppds = g_new0 (PPDName *, N_PPDS_PER_MANUFACTURER);
+
+      for (j = 0; j < N_PPDS_PER_MANUFACTURER; j++)
+        {
+          item->ppds[j] = g_new0 (PPDName, 1);
+          item->ppds[j]->ppd_name = g_strdup_printf ("foomatic-db-compressed-ppds:0/ppd/foomatic-ppd/Vendor_%03d-Model_%04d-pxlcolor.ppd", i, j);
+          /* Same models are shipped by several drivers */
+          item->ppds[j]->ppd_display_name = g_strdup_printf ("Vendor %03d Model %04d", i, j / 2);
+          item->ppds[j]->ppd_match_level = -1;
+        }
+
+      list->manufacturers[i] = item;
+    }
+
+  return list;
+}
+
+static void
+assert_ppd_lists_equal (PPDList *a,
+                        PPDList *b)
+{
+  gsize i, j;
+
+  g_assert_nonnull (a);
+  g_assert_nonnull (b);
+  g_assert_cmpuint (a->num_of_manufacturers, ==, b->num_of_manufacturers);
+
+  for (i = 0; i < a->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item_a = a->manufacturers[i];
+      PPDManufacturerItem *item_b = b->manufacturers[i];
+
+      g_assert_cmpstr (item_a->manufacturer_name, ==, item_b->manufacturer_name);
+      g_assert_cmpstr (item_a->manufacturer_display_name, ==, item_b->manufacturer_display_name);
+      g_assert_cmpuint (item_a->num_of_ppds, ==, item_b->num_of_ppds);
+
+      for (j = 0; j < item_a->num_of_ppds; j++)
+        {
+          g_assert_cmpstr (item_a->ppds[j]->ppd_name, ==, item_b->ppds[j]->ppd_name);
+          g_assert_cmpstr (item_a->ppds[j]->ppd_display_name, ==, item_b->ppds[j]->ppd_display_name);
+          g_assert_cmpint (item_b->ppds[j]->ppd_match_level, ==, -1);
+        }
+    }
+}
+
+static void
+test_round_trip (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  PPDList          *list;
+  PPDList          *loaded;
+  gint64            start;
+
+  list = generate_ppd_list ();
+
+  g_assert_true (pp_ppd_cache_save (fixture->cache_path, 42, list, &error));
+  g_assert_no_error (error);
+
+  start = g_get_monotonic_time ();
+  loaded = pp_ppd_cache_load (fixture->cache_path, 42);
+  g_test_message ("Loaded %d PPDs in %.3f ms",
+                  N_MANUFACTURERS * N_PPDS_PER_MANUFACTURER,
+                  (g_get_monotonic_time () - start) / 1000.0);
+
+  assert_ppd_lists_equal (list, loaded);
+
+  ppd_list_free (loaded);
+  ppd_list_free (list);
+}
+
+static void
+test_stale_stamp (Fixture       *fixture,
+                  gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  PPDList          *list;
+
+  list = generate_ppd_list ();
+  g_assert_true (pp_ppd_cache_save (fixture->cache_path, 42, list, &error));
+  g_assert_no_error (error);
+  ppd_list_free (list);
+
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 43));
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 0));
+}
+
+static void
+test_corrupted (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *contents = NULL;
+  gsize             length;
+  PPDList          *list;
+
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 42));
+
+  list = generate_ppd_list ();
+  g_assert_true (pp_ppd_cache_save (fixture->cache_path, 42, list, &error));
+  g_assert_no_error (error);
+  ppd_list_free (list);
+
+  g_assert_true (g_file_get_contents (fixture->cache_path, &contents, &length, &error));
+  g_assert_no_error (error);
+
+  /* Truncated file */
+  g_assert_true (g_file_set_contents (fixture->cache_path, contents, length / 2, &error));
+  g_assert_no_error (error);
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 42));
+
+  /* String pool without terminating NUL */
+  contents[length - 1] = 'x';
+  g_assert_true (g_file_set_contents (fixture->cache_path, contents, length, &error));
+  g_assert_no_error (error);
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 42));
+
+  /* Garbage */
+  memset (contents, 0xff, length);
+  g_assert_true (g_file_set_contents (fixture->cache_path, contents, length, &error));
+  g_assert_no_error (error);
+  g_assert_null (pp_ppd_cache_load (fixture->cache_path, 42));
+}
+
+static void
+test_stamp (Fixture       *fixture,
+            gconstpointer  user_data)
+{
+  g_autofree gchar *drivers = NULL;
+  g_autofree gchar *vendor = NULL;
+  g_autofree gchar *ppd = NULL;
+  const gchar      *directories[2];
+  guint64           stamp1, stamp2, stamp3;
+
+  drivers = g_build_filename (fixture->tmpdir, "ppd", NULL);
+  vendor = g_build_filename (drivers, "vendor", NULL);
+  ppd = g_build_filename (vendor, "model.ppd", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (vendor, 0700), ==, 0);
+
+  directories[0] = drivers;
+  directories[1] = NULL;
+
+  stamp1 = pp_ppd_cache_compute_stamp (directories);
+  g_assert_cmpuint (stamp1, !=, 0);
+  g_assert_cmpuint (stamp1, ==, pp_ppd_cache_compute_stamp (directories));
+
+  /* A driver got installed into a vendor subdirectory */
+  g_assert_true (g_file_set_contents (ppd, "*PPD-Adobe: \"4.3\"\n", -1, NULL));
+  g_assert_cmpint (g_utime (vendor, &(struct utimbuf) { 1, 1 }), ==, 0);
+  stamp2 = pp_ppd_cache_compute_stamp (directories);
+  g_assert_cmpuint (stamp2, !=, stamp1);
+
+  /* And removed again */
+  g_unlink (ppd);
+  g_assert_cmpint (g_utime (vendor, &(struct utimbuf) { 2, 2 }), ==, 0);
+  stamp3 = pp_ppd_cache_compute_stamp (directories);
+  g_assert_cmpuint (stamp3, !=, stamp2);
+
+  g_rmdir (vendor);
+  g_rmdir (drivers);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/printers/ppd-cache/round-trip", Fixture, NULL,
+              fixture_set_up, test_round_trip, fixture_tear_down);
+  g_test_add ("/printers/ppd-cache/stale-stamp", Fixture, NULL,
+              fixture_set_up, test_stale_stamp, fixture_tear_down);
+  g_test_add ("/printers/ppd-cache/corrupted", Fixture, NULL,
+              fixture_set_up, test_corrupted, fixture_tear_down);
+  g_test_add ("/printers/ppd-cache/stamp", Fixture, NULL,
+              fixture_set_up, test_stamp, fixture_tear_down);
+
+  return g_test_run ();
+}
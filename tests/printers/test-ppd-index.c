@@ -0,0 +1,225 @@
+#include "config.h"
+
+#include <glib.h>
+
+#include "pp-ppd-index.h"
+
+#define FRAME_BUDGET_MS 16.0
+
+typedef struct
+{
+  const gchar *manufacturer;
+  const gchar *model;
+} CatalogueEntry;
+
+static const CatalogueEntry catalogue[] = {
+  { "Hewlett-Packard", "HP LaserJet 4250 Foomatic/pxlmono" },
+  { "Hewlett-Packard", "HP LaserJet 4250 Postscript" },
+  { "Hewlett-Packard", "HP LaserJet 1020 Foomatic/foo2zjs" },
+  { "Hewlett-Packard", "HP DeskJet 2540 hpcups" },
+  { "Epson", "Epson Stylus Photo R300 - CUPS+Gutenprint" },
+  { "Epson", "Epson WorkForce WF-2650 Series" },
+  { "Minolta", "Konica Minolta bizhub C308 PS" },
+  { "Kyocera", "Kyocera ECOSYS P2135dn KPDL" },
+  { "Generic", "Generic PostScript Printer" },
+  { "Generic", "Generic PCL 6/PCL XL Printer Foomatic/pxlcolor" },
+};
+
+static PPDList *
+build_list (const CatalogueEntry *entries,
+            gsize                 n_entries)
+{
+  PPDList *list;
+  gsize    i;
+
+  list = g_new0 (PPDList, 1);
+  list->manufacturers = g_new0 (PPDManufacturerItem *, n_entries);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      PPDManufacturerItem *item = NULL;
+      PPDName             *ppd;
+
+      if (list->num_of_manufacturers > 0 &&
+          g_strcmp0 (list->manufacturers[list->num_of_manufacturers - 1]->manufacturer_display_name,
+                     entries[i].manufacturer) == 0)
+        item = list->manufacturers[list->num_of_manufacturers - 1];
+
+      if (item == NULL)
+        {
+          item = g_new0 (PPDManufacturerItem, 1);
+          item->manufacturer_name = g_ascii_strdown (entries[i].manufacturer, -1);
+          item->manufacturer_display_name = g_strdup (entries[i].manufacturer);
+          item->ppds = g_new0 (PPDName *, n_entries);
+          list->manufacturers[list->num_of_manufacturers++] = item;
+        }
+
+      ppd = g_new0 (PPDName, 1);
+      ppd->ppd_name = g_strdup_printf ("driver:%" G_GSIZE_FORMAT, i);
+      ppd->ppd_display_name = g_strdup (entries[i].model);
+      ppd->ppd_match_level = -1;
+      item->ppds[item->num_of_ppds++] = ppd;
+    }
+
+  return list;
+}
+
+static const gchar *
+top_match (PpPPDIndex  *index,
+           const gchar *query)
+{
+  g_autoptr(GArray) matches = NULL;
+
+  matches = pp_ppd_index_search (index, query, 5);
+  if (matches->len == 0)
+    return NULL;
+
+  return g_array_index (matches, PpPPDIndexMatch, 0).ppd->ppd_display_name;
+}
+
+static void
+test_search (void)
+{
+  g_autoptr(PpPPDIndex) index = NULL;
+  g_autoptr(GArray)     matches = NULL;
+  PPDList              *list;
+
+  list = build_list (catalogue, G_N_ELEMENTS (catalogue));
+  index = pp_ppd_index_new (list);
+
+  g_assert_cmpstr (top_match (index, "laserjet 1020"), ==, "HP LaserJet 1020 Foomatic/foo2zjs");
+  g_assert_cmpstr (top_match (index, "bizhub c308"), ==, "Konica Minolta bizhub C308 PS");
+
+  /* Model numbers glued to names */
+  g_assert_cmpstr (top_match (index, "LaserJet1020"), ==, "HP LaserJet 1020 Foomatic/foo2zjs");
+  g_assert_cmpstr (top_match (index, "WF2650"), ==, "Epson WorkForce WF-2650 Series");
+
+  /* Vendor naming variants */
+  g_assert_cmpstr (top_match (index, "hewlett packard deskjet"), ==, "HP DeskJet 2540 hpcups");
+  g_assert_cmpstr (top_match (index, "konica minolta c308"), ==, "Konica Minolta bizhub C308 PS");
+
+  /* Typos */
+  g_assert_cmpstr (top_match (index, "desjket 2540"), ==, "HP DeskJet 2540 hpcups");
+  g_assert_cmpstr (top_match (index, "ecosys p2135"), ==, "Kyocera ECOSYS P2135dn KPDL");
+
+  /* Nothing to look for */
+  g_assert_null (top_match (index, ""));
+  g_assert_null (top_match (index, " - / "));
+  g_assert_null (top_match (index, "zzzzzz"));
+
+  /* Limit */
+  matches = pp_ppd_index_search (index, "hp", 2);
+  g_assert_cmpuint (matches->len, ==, 2);
+
+  g_clear_pointer (&index, pp_ppd_index_free);
+  ppd_list_free (list);
+}
+
+/*
+ * Size of the full foomatic + gutenprint catalogue.
+ */
+#define N_GENERATED_MANUFACTURERS 70
+#define N_GENERATED_PPDS 30000
+
+static PPDList *
+generate_list (void)
+{
+  static const gchar *families[] = { "LaserJet", "DeskJet", "Stylus", "bizhub", "ECOSYS", "imageRUNNER", "WorkCentre", "Aficio", "PIXMA", "OfficeJet" };
+  static const gchar *drivers[] = { "Foomatic/pxlmono", "Foomatic/ljet4", "CUPS+Gutenprint", "Postscript", "hpcups", "KPDL" };
+  CatalogueEntry     *entries;
+  GPtrArray          *strings;
+  PPDList            *list;
+  gint                i;
+
+  strings = g_ptr_array_new_with_free_func (g_free);
+  entries = g_new0 (CatalogueEntry, N_GENERATED_PPDS);
+
+  for (i = 0; i < N_GENERATED_PPDS; i++)
+    {
+      gint   vendor = i * N_GENERATED_MANUFACTURERS / N_GENERATED_PPDS;
+      gchar *manufacturer;
+      gchar *model;
+
+      if (i == 0 || vendor != (i - 1) * N_GENERATED_MANUFACTURERS / N_GENERATED_PPDS)
+        {
+          manufacturer = g_strdup_printf ("Vendor%02d", vendor);
+          g_ptr_array_add (strings, manufacturer);
+        }
+      else
+        {
+          manufacturer = (gchar *) entries[i - 1].manufacturer;
+        }
+
+      model = g_strdup_printf ("%s %s %d%s %s",
+                               manufacturer,
+                               families[i % G_N_ELEMENTS (families)],
+                               1000 + (i * 7) % 9000,
+                               (i % 3 == 0) ? "dn" : "",
+                               drivers[i % G_N_ELEMENTS (drivers)]);
+      g_ptr_array_add (strings, model);
+
+      entries[i].manufacturer = manufacturer;
+      entries[i].model = model;
+    }
+
+  list = build_list (entries, N_GENERATED_PPDS);
+
+  g_free (entries);
+  g_ptr_array_unref (strings);
+
+  return list;
+}
+
+static void
+test_benchmark (void)
+{
+  static const gchar *queries[] = { "l", "la", "las", "lase", "laser", "laserjet", "laserjet 4", "laserjet 42", "laserjet 425", "laserjet 4250",
+                                    "vendor12 stylus", "ecosys p2135dn", "imagerunner", "bizhb 3000", "pixma 5000 gutenprint", "hpcups" };
+  g_autoptr(PpPPDIndex) index = NULL;
+  PPDList              *list;
+  gdouble               elapsed;
+  gdouble               worst = 0.0;
+  gdouble               total = 0.0;
+  gsize                 i;
+
+  list = generate_list ();
+
+  g_test_timer_start ();
+  index = pp_ppd_index_new (list);
+  elapsed = g_test_timer_elapsed () * 1000.0;
+  g_test_minimized_result (elapsed, "Index of %d PPDs built in %.3f ms", N_GENERATED_PPDS, elapsed);
+
+  for (i = 0; i < G_N_ELEMENTS (queries); i++)
+    {
+      g_autoptr(GArray) matches = NULL;
+
+      g_test_timer_start ();
+      matches = pp_ppd_index_search (index, queries[i], 200);
+      elapsed = g_test_timer_elapsed () * 1000.0;
+
+      g_test_message ("'%s': %u matches in %.3f ms", queries[i], matches->len, elapsed);
+      worst = MAX (worst, elapsed);
+      total += elapsed;
+    }
+
+  g_test_minimized_result (total / G_N_ELEMENTS (queries), "Average query time %.3f ms",
+                           total / G_N_ELEMENTS (queries));
+  g_test_minimized_result (worst, "Worst query time %.3f ms", worst);
+  g_assert_cmpfloat (worst, <, FRAME_BUDGET_MS);
+
+  g_clear_pointer (&index, pp_ppd_index_free);
+  ppd_list_free (list);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/ppd-index/search", test_search);
+
+  if (g_test_perf ())
+    g_test_add_func ("/printers/ppd-index/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,667 @@
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "pp-utils.h"
+
+#if (CUPS_VERSION_MAJOR == 1) && (CUPS_VERSION_MINOR <= 6)
+#define HTTP_URI_STATUS_OK HTTP_URI_OK
+#endif
+
+#define CORPUS_SIZE      20000
+#define BENCHMARK_ROUNDS 10
+
+/*
+ * Reference implementations, kept as they were before the fast paths
+ * were added to pp-utils.c. Every corpus entry has to give the same
+ * result with both.
+ */
+
+static gchar *
+reference_get_tag_value (const gchar *tag_string,
+                         const gchar *tag_name)
+{
+  gchar **tag_string_splitted = NULL;
+  gchar  *tag_value = NULL;
+  gint    tag_name_length;
+  gint    i;
+
+  if (tag_string && tag_name)
+    {
+      tag_name_length = strlen (tag_name);
+      tag_string_splitted = g_strsplit (tag_string, ";", 0);
+      if (tag_string_splitted)
+        {
+          for (i = 0; i < g_strv_length (tag_string_splitted); i++)
+            if (g_ascii_strncasecmp (tag_string_splitted[i], tag_name, tag_name_length) == 0)
+              if (strlen (tag_string_splitted[i]) > tag_name_length + 1)
+                {
+                  g_free (tag_value);
+                  tag_value = g_strdup (tag_string_splitted[i] + tag_name_length + 1);
+                }
+
+          g_strfreev (tag_string_splitted);
+        }
+    }
+
+  return tag_value;
+}
+
+static gchar *
+reference_normalize (const gchar *input_string)
+{
+  gchar *result = NULL;
+  gint   i, j = 0, k = -1;
+
+  if (input_string)
+    {
+      g_autofree gchar *tmp = g_strstrip (g_ascii_strdown (input_string, -1));
+      if (tmp)
+        {
+          g_autofree gchar *res = g_new (gchar, 2 * strlen (tmp) + 1);
+
+          for (i = 0; i < strlen (tmp); i++)
+            {
+              if ((g_ascii_isalpha (tmp[i]) && k >= 0 && g_ascii_isdigit (res[k])) ||
+                  (g_ascii_isdigit (tmp[i]) && k >= 0 && g_ascii_isalpha (res[k])))
+                {
+                  res[j] = ' ';
+                  k = j++;
+                  res[j] = tmp[i];
+                  k = j++;
+                }
+              else
+                {
+                  if (g_ascii_isspace (tmp[i]) || !g_ascii_isalnum (tmp[i]))
+                    {
+                      if (!(k >= 0 && res[k] == ' '))
+                        {
+                          res[j] = ' ';
+                          k = j++;
+                        }
+                    }
+                  else
+                    {
+                      res[j] = tmp[i];
+                      k = j++;
+                    }
+                }
+            }
+
+          res[j] = '\0';
+
+          result = g_strdup (res);
+        }
+    }
+
+  return result;
+}
+
+static gchar *
+reference_guess_device_hostname (PpPrintDevice *device)
+{
+  http_uri_status_t  status;
+  char               scheme[HTTP_MAX_URI];
+  char               username[HTTP_MAX_URI];
+  char               hostname[HTTP_MAX_URI];
+  char               resource[HTTP_MAX_URI];
+  int                port;
+  gchar             *result = NULL;
+  gchar             *hostname_begin;
+  gchar             *hostname_end = NULL;
+
+  if (device != NULL && pp_print_device_get_device_uri (device) != NULL)
+    {
+      if (g_str_has_prefix (pp_print_device_get_device_uri (device), "socket") ||
+          g_str_has_prefix (pp_print_device_get_device_uri (device), "lpd") ||
+          g_str_has_prefix (pp_print_device_get_device_uri (device), "ipp") ||
+          g_str_has_prefix (pp_print_device_get_device_uri (device), "smb"))
+        {
+          status = httpSeparateURI (HTTP_URI_CODING_ALL,
+                                    pp_print_device_get_device_uri (device),
+                                    scheme, HTTP_MAX_URI,
+                                    username, HTTP_MAX_URI,
+                                    hostname, HTTP_MAX_URI,
+                                    &port,
+                                    resource, HTTP_MAX_URI);
+
+          if (status >= HTTP_URI_STATUS_OK &&
+              hostname[0] != '\0')
+            result = g_strdup (hostname);
+        }
+      else if ((g_str_has_prefix (pp_print_device_get_device_uri (device), "dnssd") ||
+                g_str_has_prefix (pp_print_device_get_device_uri (device), "mdns")) &&
+               pp_print_device_get_device_info (device) != NULL)
+        {
+          hostname_begin = g_strrstr (pp_print_device_get_device_info (device), " @ ");
+          if (hostname_begin != NULL)
+            result = g_strdup (hostname_begin + 3);
+        }
+      else if (g_str_has_prefix (pp_print_device_get_device_uri (device), "hp:/net/") ||
+               g_str_has_prefix (pp_print_device_get_device_uri (device), "hpfax:/net/"))
+        {
+          hostname_begin = g_strrstr (pp_print_device_get_device_uri (device), "ip=");
+          if (hostname_begin != NULL)
+            {
+              hostname_begin += 3;
+              hostname_end = strstr (hostname_begin, "&");
+            }
+
+          if (hostname_end != NULL)
+            result = g_strndup (hostname_begin, hostname_end - hostname_begin);
+          else
+            result = g_strdup (hostname_begin);
+        }
+    }
+
+  return result;
+}
+
+static gchar *
+reference_canonicalize_device_name (GList         *device_names,
+                                    GPtrArray     *local_cups_devices,
+                                    cups_dest_t   *dests,
+                                    gint           num_of_dests,
+                                    PpPrintDevice *device)
+{
+  PpPrintDevice             *item;
+  gboolean                   already_present;
+  GList                     *iter;
+  gsize                      len;
+  g_autofree gchar          *name = NULL;
+  gchar                     *occurrence;
+  gint                       name_index, j;
+  static const char * const  residues[] = {
+    "-foomatic", "-hpijs", "-hpcups", "-cups", "-gutenprint", "-series",
+    "-label-printer", "-dot-matrix", "-ps3", "-ps2", "-br-script", "-kpdl",
+    "-pcl3", "-pcl", "-zxs", "-pxl"};
+
+  if (pp_print_device_get_device_id (device) != NULL)
+    {
+      name = reference_get_tag_value (pp_print_device_get_device_id (device), "mdl");
+      if (name == NULL)
+        name = reference_get_tag_value (pp_print_device_get_device_id (device), "model");
+    }
+
+  if (name == NULL &&
+      pp_print_device_get_device_make_and_model (device) != NULL &&
+      pp_print_device_get_device_make_and_model (device)[0] != '\0')
+    name = g_strdup (pp_print_device_get_device_make_and_model (device));
+
+  if (name == NULL &&
+      pp_print_device_get_device_original_name (device) != NULL &&
+      pp_print_device_get_device_original_name (device)[0] != '\0')
+    name = g_strdup (pp_print_device_get_device_original_name (device));
+
+  if (name == NULL &&
+      pp_print_device_get_device_info (device) != NULL &&
+      pp_print_device_get_device_info (device)[0] != '\0')
+    name = g_strdup (pp_print_device_get_device_info (device));
+
+  if (name == NULL)
+    return NULL;
+
+  g_strstrip (name);
+  g_strcanon (name, ALLOWED_CHARACTERS, '-');
+
+  for (j = 0; j < G_N_ELEMENTS (residues); j++)
+    {
+      g_autofree gchar *lower_name = g_ascii_strdown (name, -1);
+
+      occurrence = g_strrstr (lower_name, residues[j]);
+      if (occurrence != NULL)
+        {
+          occurrence[0] = '\0';
+          name[strlen (lower_name)] = '\0';
+        }
+    }
+
+  len = strlen (name);
+  while (len-- && name[len] == '-')
+    name[len] = '\0';
+
+  occurrence = g_strrstr (name, "--");
+  while (occurrence != NULL)
+    {
+      shift_string_left (occurrence);
+      occurrence = g_strrstr (name, "--");
+    }
+
+  if (name[0] == '-')
+    shift_string_left (name);
+
+  name_index = 2;
+  already_present = FALSE;
+  while (TRUE)
+    {
+      g_autofree gchar *new_name = NULL;
+
+      if (already_present)
+        {
+          new_name = g_strdup_printf ("%s-%d", name, name_index);
+          name_index++;
+        }
+      else
+        {
+          new_name = g_strdup (name);
+        }
+
+      already_present = FALSE;
+      for (j = 0; j < num_of_dests; j++)
+        if (g_strcmp0 (dests[j].name, new_name) == 0)
+          already_present = TRUE;
+
+      for (iter = device_names; iter; iter = iter->next)
+        if (g_strcmp0 (iter->data, new_name) == 0)
+          already_present = TRUE;
+
+      for (guint i = 0; i < local_cups_devices->len; i++)
+        {
+          item = g_ptr_array_index (local_cups_devices, i);
+          if (g_strcmp0 (pp_print_device_get_device_original_name (item), new_name) == 0)
+            already_present = TRUE;
+        }
+
+      if (!already_present)
+        return g_steal_pointer (&new_name);
+    }
+}
+
+/*
+ * Generated corpus
+ */
+
+typedef struct
+{
+  GPtrArray *device_ids;
+  GPtrArray *ppd_names;
+  GPtrArray *devices;
+  GList     *device_names;
+  GPtrArray *local_cups_devices;
+} Corpus;
+
+static const gchar *manufacturers[] = { "HP", "Hewlett-Packard", "EPSON", "Canon", "Brother", "KONICA MINOLTA", "Kyocera", "Lexmark", "Samsung", "Xerox", "Ricoh", "OKI DATA CORP", "Zebra", "Dymo" };
+static const gchar *models[] = { "LaserJet 4250", "Officejet Pro 8600", "Stylus Photo R300", "PIXMA MG5350", "HL-2270DW series", "bizhub C308", "ECOSYS P2135dn", "MS810de", "ML-2160 Series", "WorkCentre 6515", "Aficio MP C3003", "C5600(PCL)", "ZD420-300dpi ZPL", "LabelWriter 450 Turbo", "LBP6030/6040/6018L", "DCP-L2540DN series" };
+static const gchar *suffixes[] = { "", " Foomatic/pxlmono", " - CUPS+Gutenprint v5.2.11", ", hpcups 3.14.6", " PS3", " BR-Script3", " KPDL", " pcl3", " Label Printer", " Dot Matrix", " (recommended)", " series", "-series", "  ", " \xc3\xbc\xc3\xa9" };
+static const gchar *hosts[] = { "192.168.1.20", "10.0.0.7", "printer", "printer.local", "office-mfp.example.com", "PRN_07", "host~name", "[fe80::1]", "[::1]", "user@host", "user:pass@10.0.0.1", "with%20space", "ho st", "h\xc3\xb6st", "" };
+static const gchar *ports[] = { "", ":9100", ":631", ":515", ":0", ":65536", ":99999", ":abc", ":", ":80x" };
+static const gchar *resources[] = { "", "/", "/ipp/print", "/printers/Office", "/queue?waitjob=false", "/a%20b", "/%zz", "/path with space", "/x@y", "/q#frag", "?x=1" };
+static const gchar *schemes[] = { "socket", "lpd", "ipp", "ipps", "ippusb", "smb", "socket+tls", "lpd-x", "ipp:", "smb:/" };
+
+static const gchar *
+pick (GRand        *rand,
+      const gchar **items,
+      gsize         n_items)
+{
+  return items[g_rand_int_range (rand, 0, n_items)];
+}
+
+#define PICK(rand, items) pick ((rand), (items), G_N_ELEMENTS (items))
+
+static gchar *
+random_case (GRand       *rand,
+             const gchar *string)
+{
+  gchar *result = g_strdup (string);
+  gchar *p;
+
+  for (p = result; *p != '\0'; p++)
+    if (g_rand_boolean (rand))
+      *p = g_ascii_toupper (*p);
+    else
+      *p = g_ascii_tolower (*p);
+
+  return result;
+}
+
+static gchar *
+generate_device_id (GRand *rand)
+{
+  g_autoptr(GString) id = g_string_new (NULL);
+  gint               n_fields = g_rand_int_range (rand, 0, 7);
+  gint               i;
+
+  for (i = 0; i < n_fields; i++)
+    {
+      g_autofree gchar *tag = NULL;
+
+      switch (g_rand_int_range (rand, 0, 8))
+        {
+          case 0: tag = random_case (rand, "MFG:"); break;
+          case 1: tag = random_case (rand, "MDL:"); break;
+          case 2: tag = random_case (rand, "MODEL:"); break;
+          case 3: tag = random_case (rand, "MANUFACTURER:"); break;
+          case 4: tag = g_strdup ("CMD:"); break;
+          case 5: tag = g_strdup ("MDLX:"); break;
+          case 6: tag = g_strdup ("MDL"); break;
+          default: tag = g_strdup (""); break;
+        }
+
+      g_string_append (id, tag);
+      if (g_rand_int_range (rand, 0, 4) > 0)
+        g_string_append_printf (id, "%s%s", PICK (rand, models), PICK (rand, suffixes));
+      if (i + 1 < n_fields || g_rand_boolean (rand))
+        g_string_append_c (id, ';');
+    }
+
+  return g_string_free (g_steal_pointer (&id), FALSE);
+}
+
+static gchar *
+generate_ppd_name (GRand *rand)
+{
+  return g_strdup_printf ("%s%s %s%s%s",
+                          g_rand_boolean (rand) ? "" : " \t",
+                          PICK (rand, manufacturers),
+                          PICK (rand, models),
+                          PICK (rand, suffixes),
+                          g_rand_boolean (rand) ? "" : "\n ");
+}
+
+static gchar *
+generate_uri (GRand *rand)
+{
+  switch (g_rand_int_range (rand, 0, 6))
+    {
+      case 0:
+        return g_strdup_printf ("hp:/net/%s?ip=%s%s",
+                                PICK (rand, models), PICK (rand, hosts),
+                                g_rand_boolean (rand) ? "&port=1" : "");
+      case 1:
+        return g_strdup_printf ("dnssd://%s._ipp._tcp.local/", PICK (rand, models));
+      case 2:
+        return g_strdup_printf ("usb://%s/%s", PICK (rand, manufacturers), PICK (rand, models));
+      default:
+        return g_strdup_printf ("%s://%s%s%s",
+                                PICK (rand, schemes), PICK (rand, hosts),
+                                PICK (rand, ports), PICK (rand, resources));
+    }
+}
+
+static void
+corpus_init (Corpus        *corpus,
+             gconstpointer  user_data)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (2024);
+  gint             i;
+
+  corpus->device_ids = g_ptr_array_new_with_free_func (g_free);
+  corpus->ppd_names = g_ptr_array_new_with_free_func (g_free);
+  corpus->devices = g_ptr_array_new_with_free_func (g_object_unref);
+  corpus->local_cups_devices = g_ptr_array_new_with_free_func (g_object_unref);
+  corpus->device_names = NULL;
+
+  for (i = 0; i < CORPUS_SIZE; i++)
+    {
+      g_autofree gchar *device_id = generate_device_id (rand);
+      g_autofree gchar *make_and_model = NULL;
+      g_autofree gchar *uri = generate_uri (rand);
+      g_autofree gchar *info = NULL;
+
+      if (g_rand_boolean (rand))
+        make_and_model = generate_ppd_name (rand);
+      info = g_strdup_printf ("%s @ %s", PICK (rand, models), PICK (rand, hosts));
+
+      g_ptr_array_add (corpus->devices,
+                       g_object_new (PP_TYPE_PRINT_DEVICE,
+                                     "device-id", g_rand_boolean (rand) ? device_id : NULL,
+                                     "device-make-and-model", make_and_model,
+                                     "device-info", info,
+                                     "device-uri", uri,
+                                     NULL));
+
+      g_ptr_array_add (corpus->device_ids, g_steal_pointer (&device_id));
+      g_ptr_array_add (corpus->ppd_names, generate_ppd_name (rand));
+    }
+
+  /* Names already taken, so that some devices need a numeric suffix */
+  for (i = 0; i < G_N_ELEMENTS (models); i++)
+    {
+      g_autofree gchar *name = g_strdup (models[i]);
+
+      g_strcanon (name, ALLOWED_CHARACTERS, '-');
+      corpus->device_names = g_list_prepend (corpus->device_names, g_strdup (name));
+      corpus->device_names = g_list_prepend (corpus->device_names, g_strdup_printf ("%s-2", name));
+      g_ptr_array_add (corpus->local_cups_devices,
+                       g_object_new (PP_TYPE_PRINT_DEVICE,
+                                     "device-original-name", name,
+                                     NULL));
+    }
+}
+
+static void
+corpus_clear (Corpus        *corpus,
+              gconstpointer  user_data)
+{
+  g_clear_pointer (&corpus->device_ids, g_ptr_array_unref);
+  g_clear_pointer (&corpus->ppd_names, g_ptr_array_unref);
+  g_clear_pointer (&corpus->devices, g_ptr_array_unref);
+  g_clear_pointer (&corpus->local_cups_devices, g_ptr_array_unref);
+  g_list_free_full (g_steal_pointer (&corpus->device_names), g_free);
+}
+
+static void
+test_get_tag_value (Corpus        *corpus,
+                    gconstpointer  user_data)
+{
+  static const gchar *tags[] = { "mdl", "model", "mfg", "manufacturer", "cmd", "", "m" };
+  g_autofree gchar   *last = NULL;
+  guint               i, j;
+
+  for (i = 0; i < corpus->device_ids->len; i++)
+    for (j = 0; j < G_N_ELEMENTS (tags); j++)
+      {
+        const gchar      *device_id = g_ptr_array_index (corpus->device_ids, i);
+        g_autofree gchar *expected = reference_get_tag_value (device_id, tags[j]);
+        g_autofree gchar *value = get_tag_value (device_id, tags[j]);
+
+        g_assert_cmpstr (value, ==, expected);
+      }
+
+  g_assert_null (get_tag_value (NULL, "mdl"));
+  g_assert_null (get_tag_value ("MDL:x", NULL));
+  g_assert_null (get_tag_value ("", "mdl"));
+
+  last = get_tag_value ("MDL:first;mdl:second;", "mdl");
+  g_assert_cmpstr (last, ==, "second");
+}
+
+static void
+test_normalize (Corpus        *corpus,
+                gconstpointer  user_data)
+{
+  static const gchar *extra[] = { "", " ", "\t\n", "a", "1", "a1b2", "--", " Hewlett-Packard ", "LaserJet4250dn", "\xc3\xbc 9" };
+  guint               i;
+
+  for (i = 0; i < corpus->ppd_names->len; i++)
+    {
+      const gchar      *name = g_ptr_array_index (corpus->ppd_names, i);
+      g_autofree gchar *expected = reference_normalize (name);
+      g_autofree gchar *normalized = normalize_name (name);
+
+      g_assert_cmpstr (normalized, ==, expected);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (extra); i++)
+    {
+      g_autofree gchar *expected = reference_normalize (extra[i]);
+      g_autofree gchar *normalized = normalize_name (extra[i]);
+
+      g_assert_cmpstr (normalized, ==, expected);
+    }
+
+  g_assert_null (normalize_name (NULL));
+}
+
+static void
+test_guess_device_hostname (Corpus        *corpus,
+                            gconstpointer  user_data)
+{
+  guint i;
+
+  for (i = 0; i < corpus->devices->len; i++)
+    {
+      PpPrintDevice    *device = g_ptr_array_index (corpus->devices, i);
+      g_autofree gchar *expected = reference_guess_device_hostname (device);
+      g_autofree gchar *hostname = guess_device_hostname (device);
+
+      if (g_strcmp0 (hostname, expected) != 0)
+        g_error ("Hostname of '%s' doesn't match '%s' (got: '%s')",
+                 pp_print_device_get_device_uri (device), expected, hostname);
+    }
+}
+
+static void
+test_canonicalize_device_name (Corpus        *corpus,
+                               gconstpointer  user_data)
+{
+  cups_dest_t dests[] = { { (gchar *) "LaserJet-4250" }, { (gchar *) "LaserJet-4250-3" } };
+  guint       i;
+
+  for (i = 0; i < corpus->devices->len; i++)
+    {
+      PpPrintDevice    *device = g_ptr_array_index (corpus->devices, i);
+      g_autofree gchar *expected = NULL;
+      g_autofree gchar *name = NULL;
+
+      expected = reference_canonicalize_device_name (corpus->device_names,
+                                                     corpus->local_cups_devices,
+                                                     dests, G_N_ELEMENTS (dests),
+                                                     device);
+      name = canonicalize_device_name (corpus->device_names,
+                                       corpus->local_cups_devices,
+                                       dests, G_N_ELEMENTS (dests),
+                                       device);
+
+      if (g_strcmp0 (name, expected) != 0)
+        g_error ("Name of ('%s', '%s') doesn't match '%s' (got: '%s')",
+                 pp_print_device_get_device_id (device),
+                 pp_print_device_get_device_make_and_model (device),
+                 expected, name);
+    }
+}
+
+/*
+ * Throughput benchmarks, run with -m perf
+ */
+
+typedef gchar *(*StringFunc) (Corpus *corpus, guint index);
+
+static gchar *
+run_get_tag_value (Corpus *corpus, guint index)
+{
+  return get_tag_value (g_ptr_array_index (corpus->device_ids, index), "mdl");
+}
+
+static gchar *
+run_reference_get_tag_value (Corpus *corpus, guint index)
+{
+  return reference_get_tag_value (g_ptr_array_index (corpus->device_ids, index), "mdl");
+}
+
+static gchar *
+run_normalize (Corpus *corpus, guint index)
+{
+  return normalize_name (g_ptr_array_index (corpus->ppd_names, index));
+}
+
+static gchar *
+run_reference_normalize (Corpus *corpus, guint index)
+{
+  return reference_normalize (g_ptr_array_index (corpus->ppd_names, index));
+}
+
+static gchar *
+run_guess_device_hostname (Corpus *corpus, guint index)
+{
+  return guess_device_hostname (g_ptr_array_index (corpus->devices, index));
+}
+
+static gchar *
+run_reference_guess_device_hostname (Corpus *corpus, guint index)
+{
+  return reference_guess_device_hostname (g_ptr_array_index (corpus->devices, index));
+}
+
+static gchar *
+run_canonicalize_device_name (Corpus *corpus, guint index)
+{
+  return canonicalize_device_name (corpus->device_names, corpus->local_cups_devices, NULL, 0,
+                                   g_ptr_array_index (corpus->devices, index));
+}
+
+static gchar *
+run_reference_canonicalize_device_name (Corpus *corpus, guint index)
+{
+  return reference_canonicalize_device_name (corpus->device_names, corpus->local_cups_devices, NULL, 0,
+                                             g_ptr_array_index (corpus->devices, index));
+}
+
+static gdouble
+measure (Corpus     *corpus,
+         StringFunc  func)
+{
+  gdouble best = G_MAXDOUBLE;
+  gint    round;
+  guint   i;
+
+  for (round = 0; round < BENCHMARK_ROUNDS; round++)
+    {
+      g_test_timer_start ();
+      for (i = 0; i < CORPUS_SIZE; i++)
+        g_free (func (corpus, i));
+      best = MIN (best, g_test_timer_elapsed ());
+    }
+
+  /* Items per second */
+  return CORPUS_SIZE / MAX (best, 1e-9);
+}
+
+static void
+test_benchmark (Corpus        *corpus,
+                gconstpointer  user_data)
+{
+  static const struct
+  {
+    const gchar *name;
+    StringFunc   func;
+    StringFunc   reference;
+  } functions[] = {
+    { "get_tag_value", run_get_tag_value, run_reference_get_tag_value },
+    { "normalize_name", run_normalize, run_reference_normalize },
+    { "guess_device_hostname", run_guess_device_hostname, run_reference_guess_device_hostname },
+    { "canonicalize_device_name", run_canonicalize_device_name, run_reference_canonicalize_device_name },
+  };
+  gsize i;
+
+  for (i = 0; i < G_N_ELEMENTS (functions); i++)
+    {
+      gdouble reference = measure (corpus, functions[i].reference);
+      gdouble current = measure (corpus, functions[i].func);
+
+      g_test_maximized_result (current, "%s: %.0f items/s (was %.0f items/s)",
+                               functions[i].name, current, reference);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/printers/string-utils/get-tag-value", Corpus, NULL,
+              corpus_init, test_get_tag_value, corpus_clear);
+  g_test_add ("/printers/string-utils/normalize", Corpus, NULL,
+              corpus_init, test_normalize, corpus_clear);
+  g_test_add ("/printers/string-utils/guess-device-hostname", Corpus, NULL,
+              corpus_init, test_guess_device_hostname, corpus_clear);
+  g_test_add ("/printers/string-utils/canonicalize-device-name", Corpus, NULL,
+              corpus_init, test_canonicalize_device_name, corpus_clear);
+
+  if (g_test_perf ())
+    g_test_add ("/printers/string-utils/benchmark", Corpus, NULL,
+                corpus_init, test_benchmark, corpus_clear);
+
+  return g_test_run ();
+}
@@ -0,0 +1,186 @@
+#include <glib.h>
+#include <math.h>
+
+#include "cc-level-meter.h"
+
+#define SAMPLE_RATE  8000
+#define FRAME_TIME   (G_USEC_PER_SEC / 60)
+#define FRAGMENT     (SAMPLE_RATE / 60)
+
+static void
+fill_sine (gfloat *samples,
+           gsize   n_samples,
+           gdouble amplitude,
+           gdouble frequency)
+{
+  gsize i;
+
+  for (i = 0; i < n_samples; i++)
+    samples[i] = amplitude * sin (2 * G_PI * frequency * i / SAMPLE_RATE);
+}
+
+static void
+test_measure_sine (void)
+{
+  g_autofree gfloat *samples = g_new (gfloat, SAMPLE_RATE + 3);
+  gfloat             peak;
+  gdouble            sum_squares;
+
+  /* Whole number of periods plus an odd tail */
+  fill_sine (samples, SAMPLE_RATE + 3, 0.5, 1000);
+  cc_level_meter_measure (samples, SAMPLE_RATE, &peak, &sum_squares);
+
+  g_assert_cmpfloat_with_epsilon (peak, 0.5, 1e-3);
+  g_assert_cmpfloat_with_epsilon (sqrt (sum_squares / SAMPLE_RATE), 0.5 / G_SQRT2, 1e-4);
+}
+
+static void
+test_measure_square (void)
+{
+  gfloat  samples[101];
+  gfloat  peak;
+  gdouble sum_squares;
+  gsize   i;
+
+  for (i = 0; i < G_N_ELEMENTS (samples); i++)
+    samples[i] = (i / 5) % 2 ? -0.25f : 0.25f;
+
+  cc_level_meter_measure (samples, G_N_ELEMENTS (samples), &peak, &sum_squares);
+
+  g_assert_cmpfloat (peak, ==, 0.25f);
+  g_assert_cmpfloat_with_epsilon (sqrt (sum_squares / G_N_ELEMENTS (samples)), 0.25, 1e-6);
+}
+
+static void
+test_measure_lengths (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (34);
+  gfloat           samples[64];
+  gsize            i, n;
+
+  for (i = 0; i < G_N_ELEMENTS (samples); i++)
+    samples[i] = g_rand_double_range (rand, -1.0, 1.0);
+
+  /* Every split between the vector loop and the tail */
+  for (n = 0; n <= G_N_ELEMENTS (samples); n++)
+    {
+      gfloat  expected_peak = 0.0f;
+      gdouble expected_sum = 0.0;
+      gfloat  peak;
+      gdouble sum_squares;
+
+      for (i = 0; i < n; i++)
+        {
+          expected_peak = MAX (expected_peak, fabsf (samples[i]));
+          expected_sum += samples[i] * samples[i];
+        }
+
+      cc_level_meter_measure (samples, n, &peak, &sum_squares);
+
+      g_assert_cmpfloat (peak, ==, expected_peak);
+      g_assert_cmpfloat_with_epsilon (sum_squares, expected_sum, 1e-5);
+    }
+}
+
+static void
+test_transient (void)
+{
+  CcLevelMeter meter;
+  gfloat       samples[FRAGMENT] = { 0.0f, };
+
+  /* A click in the middle of the fragment, the last sample is silent */
+  samples[FRAGMENT / 2] = -0.9f;
+
+  cc_level_meter_reset (&meter);
+  cc_level_meter_add_samples (&meter, samples, FRAGMENT);
+
+  g_assert_true (cc_level_meter_tick (&meter, FRAME_TIME));
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.9, 1e-6);
+  g_assert_cmpfloat_with_epsilon (meter.rms, 0.9 / sqrt (FRAGMENT), 1e-6);
+  g_assert_cmpfloat_with_epsilon (meter.held_peak, 0.9, 1e-6);
+}
+
+static void
+test_fragments_per_tick (void)
+{
+  CcLevelMeter meter;
+  gfloat       loud[FRAGMENT];
+  gfloat       quiet[FRAGMENT];
+
+  fill_sine (loud, FRAGMENT, 0.8, 1000);
+  fill_sine (quiet, FRAGMENT, 0.1, 1000);
+
+  /* All fragments received within one frame count */
+  cc_level_meter_reset (&meter);
+  cc_level_meter_add_samples (&meter, quiet, FRAGMENT);
+  cc_level_meter_add_samples (&meter, loud, FRAGMENT);
+  cc_level_meter_add_samples (&meter, quiet, FRAGMENT);
+  cc_level_meter_tick (&meter, FRAME_TIME);
+
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.8, 1e-2);
+  g_assert_cmpfloat_with_epsilon (meter.rms, sqrt ((0.64 + 0.01 + 0.01) / 6), 1e-2);
+}
+
+static void
+test_hold_and_decay (void)
+{
+  CcLevelMeter meter;
+  gfloat       samples[FRAGMENT];
+  gfloat       quiet[FRAGMENT];
+  gint64       start = FRAME_TIME;
+  gint64       time;
+
+  fill_sine (samples, FRAGMENT, 1.0, 1000);
+  fill_sine (quiet, FRAGMENT, 0.2, 1000);
+
+  cc_level_meter_reset (&meter);
+  cc_level_meter_add_samples (&meter, samples, FRAGMENT);
+  cc_level_meter_tick (&meter, start);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 1.0, 1e-2);
+
+  /* One half life later the level has halved, the peak is still held */
+  cc_level_meter_tick (&meter, start + CC_LEVEL_METER_HALF_LIFE_US);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 0.5, 1e-2);
+  g_assert_cmpfloat_with_epsilon (meter.held_peak, 1.0, 1e-2);
+
+  /* Quieter input doesn't lower the held peak */
+  cc_level_meter_add_samples (&meter, quiet, FRAGMENT);
+  cc_level_meter_tick (&meter, start + CC_LEVEL_METER_HOLD_TIME_US - FRAME_TIME);
+  g_assert_cmpfloat_with_epsilon (meter.held_peak, 1.0, 1e-2);
+
+  /* After the hold time it falls as well */
+  cc_level_meter_tick (&meter, start + CC_LEVEL_METER_HOLD_TIME_US + CC_LEVEL_METER_HALF_LIFE_US);
+  g_assert_cmpfloat (meter.held_peak, <, 0.6);
+  g_assert_cmpfloat (meter.held_peak, >=, meter.peak);
+
+  /* New signal is taken right away */
+  time = start + CC_LEVEL_METER_HOLD_TIME_US + 2 * CC_LEVEL_METER_HALF_LIFE_US;
+  cc_level_meter_add_samples (&meter, samples, FRAGMENT);
+  cc_level_meter_tick (&meter, time);
+  g_assert_cmpfloat_with_epsilon (meter.peak, 1.0, 1e-2);
+  g_assert_cmpfloat_with_epsilon (meter.held_peak, 1.0, 1e-2);
+
+  /* Silence settles to zero and stops changing */
+  for (time += FRAME_TIME; time < start + 10 * G_USEC_PER_SEC; time += FRAME_TIME)
+    cc_level_meter_tick (&meter, time);
+
+  g_assert_cmpfloat (meter.peak, ==, 0.0);
+  g_assert_cmpfloat (meter.rms, ==, 0.0);
+  g_assert_cmpfloat (meter.held_peak, ==, 0.0);
+  g_assert_false (cc_level_meter_tick (&meter, time));
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sound/level-meter/measure-sine", test_measure_sine);
+  g_test_add_func ("/sound/level-meter/measure-square", test_measure_square);
+  g_test_add_func ("/sound/level-meter/measure-lengths", test_measure_lengths);
+  g_test_add_func ("/sound/level-meter/transient", test_transient);
+  g_test_add_func ("/sound/level-meter/fragments-per-tick", test_fragments_per_tick);
+  g_test_add_func ("/sound/level-meter/hold-and-decay", test_hold_and_decay);
+
+  return g_test_run ();
+}
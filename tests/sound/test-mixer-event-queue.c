@@ -0,0 +1,257 @@
+#include <glib.h>
+
+#include "gvc-mixer-event-queue.h"
+
+#define TIMEOUT_MS     50
+#define LIST_THRESHOLD 8
+#define N_OBJECTS      40
+#define N_TICKS        200
+#define EVENTS_PER_TICK 3
+#define TICK_MS        5
+
+typedef struct
+{
+  gboolean exists;
+  gboolean dirty;
+  gint64   dirty_since;
+} ObjectState;
+
+typedef struct
+{
+  GvcMixerEventQueue *queue;
+  GRand              *rand;
+
+  /* Sink and sink input objects, as the fake server sees them */
+  ObjectState         sinks[N_OBJECTS];
+  ObjectState         sink_inputs[N_OBJECTS];
+
+  guint               n_ticks;
+  gint64              max_latency;
+  guint               n_refreshed_removed;
+  guint               n_list_requests;
+  gboolean            done;
+} Fixture;
+
+static ObjectState *
+get_objects (Fixture                      *fixture,
+             pa_subscription_event_type_t  facility)
+{
+  return facility == PA_SUBSCRIPTION_EVENT_SINK ? fixture->sinks : fixture->sink_inputs;
+}
+
+static void
+refresh (ObjectState *object,
+         Fixture     *fixture)
+{
+  if (!object->dirty)
+    return;
+
+  fixture->max_latency = MAX (fixture->max_latency, g_get_monotonic_time () - object->dirty_since);
+  object->dirty = FALSE;
+}
+
+static void
+process_events_cb (pa_subscription_event_type_t facility,
+                   int                          index,
+                   gpointer                     user_data)
+{
+  Fixture     *fixture = user_data;
+  ObjectState *objects = get_objects (fixture, facility);
+  guint        i;
+
+  g_assert_true (facility == PA_SUBSCRIPTION_EVENT_SINK ||
+                 facility == PA_SUBSCRIPTION_EVENT_SINK_INPUT);
+
+  if (index < 0)
+    {
+      fixture->n_list_requests++;
+      for (i = 0; i < N_OBJECTS; i++)
+        refresh (&objects[i], fixture);
+      return;
+    }
+
+  g_assert_cmpint (index, <, N_OBJECTS);
+
+  /* A removed object must not be asked for */
+  if (!objects[index].exists)
+    fixture->n_refreshed_removed++;
+
+  refresh (&objects[index], fixture);
+}
+
+static void
+emit_event (Fixture *fixture)
+{
+  pa_subscription_event_type_t  facility;
+  ObjectState                  *object;
+  guint                         index;
+
+  /* Streams come and go much more often than devices */
+  facility = g_rand_int_range (fixture->rand, 0, 10) == 0 ?
+             PA_SUBSCRIPTION_EVENT_SINK : PA_SUBSCRIPTION_EVENT_SINK_INPUT;
+  index = g_rand_int_range (fixture->rand, 0, N_OBJECTS);
+  object = &get_objects (fixture, facility)[index];
+
+  if (object->exists && g_rand_int_range (fixture->rand, 0, 4) == 0)
+    {
+      object->exists = FALSE;
+      object->dirty = FALSE;
+      gvc_mixer_event_queue_cancel (fixture->queue, facility, index);
+      return;
+    }
+
+  object->exists = TRUE;
+  if (!object->dirty)
+    {
+      object->dirty = TRUE;
+      object->dirty_since = g_get_monotonic_time ();
+    }
+  gvc_mixer_event_queue_update (fixture->queue, facility, index);
+}
+
+static gboolean
+tick_cb (gpointer user_data)
+{
+  Fixture *fixture = user_data;
+  guint    i;
+
+  for (i = 0; i < EVENTS_PER_TICK; i++)
+    emit_event (fixture);
+
+  if (++fixture->n_ticks < N_TICKS)
+    return G_SOURCE_CONTINUE;
+
+  fixture->done = TRUE;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  fixture->rand = g_rand_new_with_seed (35);
+  fixture->queue = gvc_mixer_event_queue_new (TIMEOUT_MS, LIST_THRESHOLD,
+                                              process_events_cb, fixture);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_pointer (&fixture->queue, gvc_mixer_event_queue_free);
+  g_clear_pointer (&fixture->rand, g_rand_free);
+}
+
+static void
+test_coalesce (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  pa_subscription_event_type_t facility = PA_SUBSCRIPTION_EVENT_SINK_INPUT;
+  guint                        n_events, n_requests;
+
+  /* Many changes of one stream end up as one request */
+  gvc_mixer_event_queue_update (fixture->queue, facility, 1);
+  gvc_mixer_event_queue_update (fixture->queue, facility, 1);
+  gvc_mixer_event_queue_update (fixture->queue, facility | PA_SUBSCRIPTION_EVENT_CHANGE, 1);
+  fixture->sink_inputs[1] = (ObjectState) { TRUE, TRUE, g_get_monotonic_time () };
+
+  /* A stream which is gone before the window ends is not asked for */
+  gvc_mixer_event_queue_update (fixture->queue, facility, 2);
+  gvc_mixer_event_queue_cancel (fixture->queue, facility, 2);
+
+  g_assert_true (gvc_mixer_event_queue_is_pending (fixture->queue));
+  while (gvc_mixer_event_queue_is_pending (fixture->queue))
+    g_main_context_iteration (NULL, TRUE);
+
+  gvc_mixer_event_queue_get_stats (fixture->queue, &n_events, &n_requests);
+  g_assert_cmpuint (n_events, ==, 5);
+  g_assert_cmpuint (n_requests, ==, 1);
+  g_assert_false (fixture->sink_inputs[1].dirty);
+  g_assert_cmpuint (fixture->n_refreshed_removed, ==, 0);
+}
+
+static void
+test_list_threshold (Fixture       *fixture,
+                     gconstpointer  user_data)
+{
+  guint n_requests;
+  guint i;
+
+  /* A profile switch changes many sinks at once */
+  for (i = 0; i <= LIST_THRESHOLD; i++)
+    gvc_mixer_event_queue_update (fixture->queue, PA_SUBSCRIPTION_EVENT_SINK, i);
+
+  gvc_mixer_event_queue_flush (fixture->queue);
+
+  gvc_mixer_event_queue_get_stats (fixture->queue, NULL, &n_requests);
+  g_assert_cmpuint (n_requests, ==, 1);
+  g_assert_cmpuint (fixture->n_list_requests, ==, 1);
+  g_assert_false (gvc_mixer_event_queue_is_pending (fixture->queue));
+}
+
+static void
+test_clear (Fixture       *fixture,
+            gconstpointer  user_data)
+{
+  guint n_requests;
+
+  gvc_mixer_event_queue_update (fixture->queue, PA_SUBSCRIPTION_EVENT_SINK, 3);
+  gvc_mixer_event_queue_clear (fixture->queue);
+
+  g_assert_false (gvc_mixer_event_queue_is_pending (fixture->queue));
+  gvc_mixer_event_queue_flush (fixture->queue);
+
+  gvc_mixer_event_queue_get_stats (fixture->queue, NULL, &n_requests);
+  g_assert_cmpuint (n_requests, ==, 0);
+}
+
+static void
+test_stress (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  guint n_events, n_requests;
+  guint i;
+
+  /* About 600 events per second for one second */
+  g_timeout_add (TICK_MS, tick_cb, fixture);
+
+  while (!fixture->done || gvc_mixer_event_queue_is_pending (fixture->queue))
+    g_main_context_iteration (NULL, TRUE);
+
+  gvc_mixer_event_queue_get_stats (fixture->queue, &n_events, &n_requests);
+  g_test_message ("%u events caused %u requests (%u lists), max latency %" G_GINT64_FORMAT " ms",
+                  n_events, n_requests, fixture->n_list_requests,
+                  fixture->max_latency / 1000);
+
+  g_assert_cmpuint (n_events, ==, N_TICKS * EVENTS_PER_TICK);
+  g_assert_cmpuint (n_requests, <, n_events / 4);
+
+  /* Every object ended up refreshed after its last change */
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      g_assert_false (fixture->sinks[i].dirty);
+      g_assert_false (fixture->sink_inputs[i].dirty);
+    }
+
+  g_assert_cmpuint (fixture->n_refreshed_removed, ==, 0);
+
+  /* The window is never extended, allow for a loaded machine */
+  g_assert_cmpint (fixture->max_latency, <, 10 * TIMEOUT_MS * 1000);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/sound/mixer-event-queue/coalesce", Fixture, NULL,
+              fixture_set_up, test_coalesce, fixture_tear_down);
+  g_test_add ("/sound/mixer-event-queue/list-threshold", Fixture, NULL,
+              fixture_set_up, test_list_threshold, fixture_tear_down);
+  g_test_add ("/sound/mixer-event-queue/clear", Fixture, NULL,
+              fixture_set_up, test_clear, fixture_tear_down);
+  g_test_add ("/sound/mixer-event-queue/stress", Fixture, NULL,
+              fixture_set_up, test_stress, fixture_tear_down);
+
+  return g_test_run ();
+}
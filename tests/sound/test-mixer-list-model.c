@@ -0,0 +1,316 @@
+#include <gio/gio.h>
+
+#include "gvc-mixer-list-model.h"
+
+#define N_ITEMS 500
+
+#define TEST_TYPE_ITEM (test_item_get_type ())
+G_DECLARE_FINAL_TYPE (TestItem, test_item, TEST, ITEM, GObject)
+
+struct _TestItem
+{
+  GObject  parent_instance;
+  guint    id;
+  gchar   *name;
+};
+
+enum
+{
+  PROP_0,
+  PROP_NAME,
+  N_PROPS
+};
+
+static GParamSpec *props[N_PROPS];
+
+G_DEFINE_TYPE (TestItem, test_item, G_TYPE_OBJECT)
+
+static void
+test_item_set_property (GObject      *object,
+                        guint         prop_id,
+                        const GValue *value,
+                        GParamSpec   *pspec)
+{
+  TestItem *self = TEST_ITEM (object);
+
+  switch (prop_id)
+    {
+    case PROP_NAME:
+      g_free (self->name);
+      self->name = g_value_dup_string (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+test_item_get_property (GObject    *object,
+                        guint       prop_id,
+                        GValue     *value,
+                        GParamSpec *pspec)
+{
+  TestItem *self = TEST_ITEM (object);
+
+  switch (prop_id)
+    {
+    case PROP_NAME:
+      g_value_set_string (value, self->name);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+test_item_finalize (GObject *object)
+{
+  g_free (TEST_ITEM (object)->name);
+
+  G_OBJECT_CLASS (test_item_parent_class)->finalize (object);
+}
+
+static void
+test_item_class_init (TestItemClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->set_property = test_item_set_property;
+  object_class->get_property = test_item_get_property;
+  object_class->finalize = test_item_finalize;
+
+  props[PROP_NAME] = g_param_spec_string ("name", NULL, NULL, NULL,
+                                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, props);
+}
+
+static void
+test_item_init (TestItem *self)
+{
+}
+
+static TestItem *
+test_item_new (guint        id,
+               const gchar *name)
+{
+  TestItem *item = g_object_new (TEST_TYPE_ITEM, "name", name, NULL);
+
+  item->id = id;
+
+  return item;
+}
+
+static guint
+test_item_get_id (gpointer item)
+{
+  return TEST_ITEM (item)->id;
+}
+
+static gint
+test_item_compare (gconstpointer a,
+                   gconstpointer b)
+{
+  return g_strcmp0 (TEST_ITEM ((gpointer) a)->name, TEST_ITEM ((gpointer) b)->name);
+}
+
+typedef struct
+{
+  GvcMixerListModel *model;
+
+  /* Mirror of the model, as a view sees it through items-changed */
+  GPtrArray         *view;
+  guint              n_changes;
+} Fixture;
+
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  Fixture    *fixture)
+{
+  guint i;
+
+  g_assert_cmpuint (position + removed, <=, fixture->view->len);
+
+  g_ptr_array_remove_range (fixture->view, position, removed);
+  for (i = 0; i < added; i++)
+    g_ptr_array_insert (fixture->view, position + i, g_list_model_get_item (model, position + i));
+
+  g_assert_cmpuint (fixture->view->len, ==, g_list_model_get_n_items (model));
+  fixture->n_changes++;
+}
+
+static void
+assert_sorted (Fixture *fixture)
+{
+  GListModel *model = G_LIST_MODEL (fixture->model);
+  guint       n_items = g_list_model_get_n_items (model);
+  guint       i;
+
+  g_assert_cmpuint (fixture->view->len, ==, n_items);
+
+  for (i = 0; i < n_items; i++)
+    {
+      g_autoptr(TestItem) item = g_list_model_get_item (model, i);
+
+      g_assert_true (item == g_ptr_array_index (fixture->view, i));
+      if (i > 0)
+        {
+          TestItem *previous = g_ptr_array_index (fixture->view, i - 1);
+          gint      result = test_item_compare (previous, item);
+
+          g_assert_true (result < 0 || (result == 0 && previous->id < item->id));
+        }
+    }
+
+  g_assert_null (g_list_model_get_item (model, n_items));
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  fixture->model = gvc_mixer_list_model_new (TEST_TYPE_ITEM, test_item_get_id,
+                                             test_item_compare, "name");
+  fixture->view = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_signal_connect (fixture->model, "items-changed", G_CALLBACK (items_changed_cb), fixture);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_object (&fixture->model);
+  g_clear_pointer (&fixture->view, g_ptr_array_unref);
+}
+
+static void
+test_add_remove (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+  g_autoptr(TestItem) speakers = test_item_new (1, "Speakers");
+  g_autoptr(TestItem) headphones = test_item_new (2, "Headphones");
+  g_autoptr(TestItem) hdmi = test_item_new (3, "HDMI");
+  g_autoptr(TestItem) other_hdmi = test_item_new (4, "HDMI");
+
+  g_assert_true (g_list_model_get_item_type (G_LIST_MODEL (fixture->model)) == TEST_TYPE_ITEM);
+
+  gvc_mixer_list_model_add (fixture->model, speakers);
+  gvc_mixer_list_model_add (fixture->model, other_hdmi);
+  gvc_mixer_list_model_add (fixture->model, headphones);
+  gvc_mixer_list_model_add (fixture->model, hdmi);
+  assert_sorted (fixture);
+
+  g_assert_true (g_ptr_array_index (fixture->view, 0) == hdmi);
+  g_assert_true (g_ptr_array_index (fixture->view, 1) == other_hdmi);
+  g_assert_true (g_ptr_array_index (fixture->view, 3) == speakers);
+
+  /* Adding an item twice is ignored */
+  gvc_mixer_list_model_add (fixture->model, headphones);
+  g_assert_cmpuint (fixture->n_changes, ==, 4);
+
+  gvc_mixer_list_model_remove_id (fixture->model, 2);
+  gvc_mixer_list_model_remove_id (fixture->model, 2);
+  g_assert_cmpuint (fixture->n_changes, ==, 5);
+  assert_sorted (fixture);
+
+  gvc_mixer_list_model_remove_all (fixture->model);
+  g_assert_cmpuint (fixture->view->len, ==, 0);
+
+  /* Removed items are no longer watched */
+  g_object_set (speakers, "name", "Line Out", NULL);
+  g_assert_cmpuint (fixture->n_changes, ==, 6);
+}
+
+static void
+test_rename (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(TestItem) a = test_item_new (1, "A");
+  g_autoptr(TestItem) b = test_item_new (2, "B");
+  g_autoptr(TestItem) c = test_item_new (3, "C");
+  guint               n_changes;
+
+  gvc_mixer_list_model_add (fixture->model, a);
+  gvc_mixer_list_model_add (fixture->model, b);
+  gvc_mixer_list_model_add (fixture->model, c);
+
+  g_object_set (a, "name", "D", NULL);
+  assert_sorted (fixture);
+  g_assert_true (g_ptr_array_index (fixture->view, 2) == a);
+
+  /* A rename which keeps the order doesn't change the list */
+  n_changes = fixture->n_changes;
+  g_object_set (b, "name", "Bb", NULL);
+  g_assert_cmpuint (fixture->n_changes, ==, n_changes);
+  assert_sorted (fixture);
+}
+
+static void
+test_random (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+  g_autoptr(GPtrArray) items = g_ptr_array_new_with_free_func (g_object_unref);
+  g_autoptr(GRand)     rand = g_rand_new_with_seed (36);
+  gint64               start;
+  guint                i;
+
+  for (i = 0; i < N_ITEMS; i++)
+    {
+      g_autofree gchar *name = g_strdup_printf ("Stream %u", g_rand_int_range (rand, 0, N_ITEMS / 4));
+
+      g_ptr_array_add (items, test_item_new (i, name));
+    }
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < 20 * N_ITEMS; i++)
+    {
+      TestItem *item = g_ptr_array_index (items, g_rand_int_range (rand, 0, N_ITEMS));
+
+      switch (g_rand_int_range (rand, 0, 3))
+        {
+        case 0:
+          gvc_mixer_list_model_add (fixture->model, item);
+          break;
+
+        case 1:
+          gvc_mixer_list_model_remove_id (fixture->model, item->id);
+          break;
+
+        case 2:
+          {
+            g_autofree gchar *name = g_strdup_printf ("Stream %u", g_rand_int_range (rand, 0, N_ITEMS / 4));
+
+            g_object_set (item, "name", name, NULL);
+          }
+          break;
+        }
+    }
+
+  if (g_test_perf ())
+    g_test_minimized_result ((g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC,
+                             "%u random updates", 20 * N_ITEMS);
+
+  assert_sorted (fixture);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/sound/mixer-list-model/add-remove", Fixture, NULL,
+              fixture_set_up, test_add_remove, fixture_tear_down);
+  g_test_add ("/sound/mixer-list-model/rename", Fixture, NULL,
+              fixture_set_up, test_rename, fixture_tear_down);
+  g_test_add ("/sound/mixer-list-model/random", Fixture, NULL,
+              fixture_set_up, test_random, fixture_tear_down);
+
+  return g_test_run ();
+}
@@ -0,0 +1,473 @@
+#include <stdlib.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <gsound.h>
+#include <pulse/glib-mainloop.h>
+#include <pulse/pulseaudio.h>
+
+#include "cc-test-sound-cache.h"
+
+#define NULL_SINK_NAME "cc_test_sound_cache"
+#define SAMPLE_RATE    44100
+#define SAMPLE_MS      20
+#define N_PLAYS        10
+#define TIMEOUT_S      10
+
+/* A server of our own, with a null sink as its only sink, so that
+ * neither the session's server nor its speakers are touched */
+static GSubprocess *server = NULL;
+static gchar *server_dir = NULL;
+static gchar *server_address = NULL;
+
+typedef struct
+{
+  GSoundContext    *sound_context;
+  gchar            *tmpdir;
+  gchar            *sample_path;
+} Fixture;
+
+static void
+context_state_cb (pa_context *context,
+                  void       *userdata)
+{
+  gboolean *done = userdata;
+
+  if (!PA_CONTEXT_IS_GOOD (pa_context_get_state (context)) ||
+      pa_context_get_state (context) == PA_CONTEXT_READY)
+    *done = TRUE;
+}
+
+static gboolean
+server_is_ready (pa_glib_mainloop *mainloop)
+{
+  pa_context *context;
+  gboolean done = FALSE;
+  gboolean ready;
+
+  context = pa_context_new (pa_glib_mainloop_get_api (mainloop), "test-test-sound-cache");
+  pa_context_set_state_callback (context, context_state_cb, &done);
+
+  if (pa_context_connect (context, server_address, PA_CONTEXT_NOAUTOSPAWN, NULL) >= 0)
+    {
+      while (!done)
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  ready = pa_context_get_state (context) == PA_CONTEXT_READY;
+
+  pa_context_set_state_callback (context, NULL, NULL);
+  pa_context_disconnect (context);
+  pa_context_unref (context);
+
+  return ready;
+}
+
+static void
+stop_server (void)
+{
+  if (server != NULL)
+    {
+      g_subprocess_force_exit (server);
+      g_subprocess_wait (server, NULL, NULL);
+      g_clear_object (&server);
+    }
+
+  if (server_dir != NULL)
+    {
+      g_autoptr(GDir) dir = g_dir_open (server_dir, 0, NULL);
+      const gchar *name;
+
+      while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+        {
+          g_autofree gchar *path = g_build_filename (server_dir, name, NULL);
+
+          g_remove (path);
+        }
+      g_rmdir (server_dir);
+    }
+
+  g_clear_pointer (&server_dir, g_free);
+  g_clear_pointer (&server_address, g_free);
+}
+
+static gboolean
+start_server (void)
+{
+  g_autoptr(GSubprocessLauncher) launcher = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *pulseaudio = NULL;
+  g_autofree gchar *socket_path = NULL;
+  g_autofree gchar *native = NULL;
+  pa_glib_mainloop *mainloop;
+  gint64 deadline;
+  gboolean ready = FALSE;
+
+  pulseaudio = g_find_program_in_path ("pulseaudio");
+  if (pulseaudio == NULL)
+    return FALSE;
+
+  server_dir = g_dir_make_tmp ("test-sound-server-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  socket_path = g_build_filename (server_dir, "native", NULL);
+  server_address = g_strdup_printf ("unix:%s", socket_path);
+  native = g_strdup_printf ("module-native-protocol-unix socket=%s auth-anonymous=1", socket_path);
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_SILENCE |
+                                        G_SUBPROCESS_FLAGS_STDERR_SILENCE);
+  g_subprocess_launcher_setenv (launcher, "PULSE_RUNTIME_PATH", server_dir, TRUE);
+  g_subprocess_launcher_setenv (launcher, "PULSE_STATE_PATH", server_dir, TRUE);
+  g_subprocess_launcher_setenv (launcher, "HOME", server_dir, TRUE);
+
+  server = g_subprocess_launcher_spawn (launcher, &error,
+                                        pulseaudio,
+                                        "--daemonize=no",
+                                        "--use-pid-file=no",
+                                        "--exit-idle-time=-1",
+                                        "--disable-shm=yes",
+                                        "-n",
+                                        "--load", native,
+                                        "--load", "module-null-sink sink_name=" NULL_SINK_NAME,
+                                        NULL);
+  if (server == NULL)
+    {
+      g_debug ("Could not start a sound server: %s", error->message);
+      stop_server ();
+      return FALSE;
+    }
+
+  mainloop = pa_glib_mainloop_new (NULL);
+  deadline = g_get_monotonic_time () + TIMEOUT_S * G_USEC_PER_SEC;
+  while (!ready && g_get_monotonic_time () < deadline)
+    {
+      ready = server_is_ready (mainloop);
+      if (!ready)
+        g_usleep (50 * G_TIME_SPAN_MILLISECOND);
+    }
+  pa_glib_mainloop_free (mainloop);
+
+  if (!ready)
+    stop_server ();
+
+  return ready;
+}
+
+/* Twenty milliseconds of silence */
+static gchar *
+write_sample (const gchar *dir)
+{
+  g_autoptr(GByteArray) wav = g_byte_array_new ();
+  g_autoptr(GError) error = NULL;
+  gchar *path;
+  guint32 data_size = SAMPLE_RATE * SAMPLE_MS / 1000 * sizeof (gint16);
+  guint32 u32;
+  guint16 u16;
+  guint i;
+
+#define APPEND32(value) G_STMT_START { u32 = GUINT32_TO_LE (value); g_byte_array_append (wav, (guint8 *) &u32, sizeof (u32)); } G_STMT_END
+#define APPEND16(value) G_STMT_START { u16 = GUINT16_TO_LE (value); g_byte_array_append (wav, (guint8 *) &u16, sizeof (u16)); } G_STMT_END
+  g_byte_array_append (wav, (guint8 *) "RIFF", 4);
+  APPEND32 (36 + data_size);
+  g_byte_array_append (wav, (guint8 *) "WAVEfmt ", 8);
+  APPEND32 (16);
+  APPEND16 (1);                             /* PCM */
+  APPEND16 (1);                             /* mono */
+  APPEND32 (SAMPLE_RATE);
+  APPEND32 (SAMPLE_RATE * sizeof (gint16)); /* bytes per second */
+  APPEND16 (sizeof (gint16));               /* block align */
+  APPEND16 (16);                            /* bits per sample */
+  g_byte_array_append (wav, (guint8 *) "data", 4);
+  APPEND32 (data_size);
+  for (i = 0; i < data_size; i++)
+    g_byte_array_append (wav, (guint8 *) "", 1);
+#undef APPEND16
+#undef APPEND32
+
+  path = g_build_filename (dir, "silence.wav", NULL);
+  g_file_set_contents (path, (gchar *) wav->data, wav->len, &error);
+  g_assert_no_error (error);
+
+  return path;
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  if (server == NULL)
+    return;
+
+  /* Read by libpulse when GSound connects */
+  g_setenv ("PULSE_SERVER", server_address, TRUE);
+
+  fixture->sound_context = gsound_context_new (NULL, &error);
+  g_assert_no_error (error);
+  gsound_context_set_driver (fixture->sound_context, "pulse", &error);
+  g_assert_no_error (error);
+
+  fixture->tmpdir = g_dir_make_tmp ("test-sound-cache-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->sample_path = write_sample (fixture->tmpdir);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  g_clear_object (&fixture->sound_context);
+  g_unsetenv ("PULSE_SERVER");
+
+  if (fixture->sample_path != NULL)
+    g_unlink (fixture->sample_path);
+  if (fixture->tmpdir != NULL)
+    g_rmdir (fixture->tmpdir);
+  g_clear_pointer (&fixture->sample_path, g_free);
+  g_clear_pointer (&fixture->tmpdir, g_free);
+}
+
+static gboolean
+skip_without_server (Fixture *fixture)
+{
+  if (fixture->sound_context != NULL)
+    return FALSE;
+
+  g_test_skip ("Could not start a private PulseAudio server");
+  return TRUE;
+}
+
+typedef struct
+{
+  gint64   end_time;
+  gboolean done;
+  GError  *error;
+} PlayData;
+
+static void
+play_cb (GObject      *source_object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+  PlayData *data = user_data;
+
+  gsound_context_play_full_finish (GSOUND_CONTEXT (source_object), result, &data->error);
+  data->end_time = g_get_monotonic_time ();
+  data->done = TRUE;
+}
+
+/* Returns the time until a play finished, the sample length included */
+static gint64
+time_play (Fixture     *fixture,
+           const gchar *event_id,
+           gboolean     cached)
+{
+  PlayData data = { 0, };
+  gint64 start = g_get_monotonic_time ();
+
+  if (cached)
+    gsound_context_play_full (fixture->sound_context, NULL, play_cb, &data,
+                              GSOUND_ATTR_EVENT_ID, event_id,
+                              GSOUND_ATTR_CANBERRA_CACHE_CONTROL, "permanent",
+                              NULL);
+  else
+    gsound_context_play_full (fixture->sound_context, NULL, play_cb, &data,
+                              GSOUND_ATTR_EVENT_ID, event_id,
+                              GSOUND_ATTR_MEDIA_FILENAME, fixture->sample_path,
+                              GSOUND_ATTR_CANBERRA_CACHE_CONTROL, "never",
+                              NULL);
+
+  while (!data.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_no_error (data.error);
+
+  return data.end_time - start;
+}
+
+static gint
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 time_a = *(const gint64 *) a;
+  gint64 time_b = *(const gint64 *) b;
+
+  return (time_a > time_b) - (time_a < time_b);
+}
+
+static gint64
+median_play_time (Fixture     *fixture,
+                  const gchar *event_id,
+                  gboolean     cached)
+{
+  gint64 times[N_PLAYS];
+  guint i;
+
+  for (i = 0; i < N_PLAYS; i++)
+    times[i] = time_play (fixture, event_id, cached);
+
+  qsort (times, N_PLAYS, sizeof (gint64), compare_times);
+
+  return times[N_PLAYS / 2];
+}
+
+static void
+test_cached_sample (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  if (skip_without_server (fixture))
+    return;
+
+  gsound_context_cache (fixture->sound_context, &error,
+                        GSOUND_ATTR_EVENT_ID, "cc-test-sound-cached",
+                        GSOUND_ATTR_MEDIA_FILENAME, fixture->sample_path,
+                        NULL);
+  g_assert_no_error (error);
+
+  /* Without a file to decode, this only plays from the cache */
+  time_play (fixture, "cc-test-sound-cached", TRUE);
+}
+
+static void
+test_latency (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+  g_autoptr(GError) error = NULL;
+  gint64 uncached, cached;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Timing is only checked in performance mode");
+      return;
+    }
+
+  if (skip_without_server (fixture))
+    return;
+
+  gsound_context_cache (fixture->sound_context, &error,
+                        GSOUND_ATTR_EVENT_ID, "cc-test-sound-cached",
+                        GSOUND_ATTR_MEDIA_FILENAME, fixture->sample_path,
+                        NULL);
+  g_assert_no_error (error);
+
+  uncached = median_play_time (fixture, "cc-test-sound-uncached", FALSE);
+  cached = median_play_time (fixture, "cc-test-sound-cached", TRUE);
+
+  g_test_message ("Median time to play a %u ms sample: %" G_GINT64_FORMAT " µs decoded, %" G_GINT64_FORMAT " µs cached",
+                  SAMPLE_MS, uncached, cached);
+  g_test_minimized_result (cached / (gdouble) G_USEC_PER_SEC, "cached play of a %u ms sample", SAMPLE_MS);
+
+  /* Allow for scheduling noise, a cached play mustn't be slower */
+  g_assert_cmpint (cached, <=, uncached + 5 * G_TIME_SPAN_MILLISECOND);
+  g_assert_cmpint (cached, <, SAMPLE_MS * G_TIME_SPAN_MILLISECOND + 200 * G_TIME_SPAN_MILLISECOND);
+}
+
+static void
+cache_cb (GObject      *source_object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+  GHashTable **events = user_data;
+  g_autoptr(GError) error = NULL;
+
+  *events = cc_test_sound_cache_finish (GSOUND_CONTEXT (source_object), result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_cache_theme (Fixture       *fixture,
+                  gconstpointer  user_data)
+{
+  const pa_channel_position_t positions[] = {
+    PA_CHANNEL_POSITION_FRONT_LEFT,
+    PA_CHANNEL_POSITION_FRONT_RIGHT,
+    PA_CHANNEL_POSITION_LFE,
+  };
+  g_autoptr(GHashTable) events = NULL;
+  guint i;
+
+  if (skip_without_server (fixture))
+    return;
+
+  cc_test_sound_cache_async (fixture->sound_context, positions, G_N_ELEMENTS (positions),
+                             NULL, cache_cb, &events);
+
+  while (events == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (g_hash_table_size (events) == 0)
+    {
+      g_test_skip ("No sound theme with test sounds installed");
+      return;
+    }
+
+  /* Each position gets one of its own sounds, which then plays from the cache */
+  for (i = 0; i < G_N_ELEMENTS (positions); i++)
+    {
+      g_auto(GStrv) names = cc_test_sound_get_events (positions[i]);
+      const gchar *event_id = g_hash_table_lookup (events, GINT_TO_POINTER (positions[i]));
+
+      g_assert_nonnull (event_id);
+      g_assert_true (g_strv_contains ((const gchar * const *) names, event_id));
+
+      time_play (fixture, event_id, TRUE);
+    }
+}
+
+static void
+cancelled_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  GError **error = user_data;
+
+  g_assert_null (cc_test_sound_cache_finish (GSOUND_CONTEXT (source_object), result, error));
+}
+
+static void
+test_cache_cancel (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+  const pa_channel_position_t position = PA_CHANNEL_POSITION_FRONT_LEFT;
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GError) error = NULL;
+
+  if (skip_without_server (fixture))
+    return;
+
+  g_cancellable_cancel (cancellable);
+  cc_test_sound_cache_async (fixture->sound_context, &position, 1, cancellable,
+                             cancelled_cb, &error);
+
+  while (error == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+}
+
+int
+main (int argc, char **argv)
+{
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  start_server ();
+
+  g_test_add ("/sound/test-sound-cache/cached-sample", Fixture, NULL,
+              fixture_set_up, test_cached_sample, fixture_tear_down);
+  g_test_add ("/sound/test-sound-cache/latency", Fixture, NULL,
+              fixture_set_up, test_latency, fixture_tear_down);
+  g_test_add ("/sound/test-sound-cache/theme", Fixture, NULL,
+              fixture_set_up, test_cache_theme, fixture_tear_down);
+  g_test_add ("/sound/test-sound-cache/cancel", Fixture, NULL,
+              fixture_set_up, test_cache_cancel, fixture_tear_down);
+
+  ret = g_test_run ();
+
+  stop_server ();
+
+  return ret;
+}